@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-11-5      SummerGift   first version
+ * 2019-09-23     RT-Thread    add asynchronous transfer
  */
 
 #ifndef __DRV_SPI_H_
@@ -57,6 +58,12 @@ struct stm32_spi
     
     rt_uint8_t spi_dma_flag;
     struct rt_spi_bus spi_bus;
+
+#ifdef RT_USING_SPI_ASYNC
+    /* the message in DMA transfer which is started by xfer_async */
+    struct rt_spi_message *async_msg;
+    struct stm32_hw_spi_cs *async_cs;
+#endif
 };
 
 #if defined(BSP_USING_SPI2)
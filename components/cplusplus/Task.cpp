@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-24     RT-Thread    the first version
+ */
+
+#include "Task.h"
+
+#if defined(RT_USING_EXECUTOR) && defined(__cpp_impl_coroutine)
+
+using namespace rtthread;
+
+Task::Task(Task &&other) : _handle(other._handle)
+{
+    other._handle = nullptr;
+}
+
+Task::~Task()
+{
+    /* it's not spawned */
+    if (_handle)
+        _handle.destroy();
+}
+
+rt_err_t Task::spawn(struct rt_executor *executor)
+{
+    rt_err_t result;
+
+    if (!_handle)
+        return -RT_ERROR;
+
+    promise_type &promise = _handle.promise();
+    rt_task_init(&promise.task, entry, _handle.address());
+    promise.task.cleanup = cleanup;
+    promise.awaiter = RT_NULL;
+
+    result = rt_executor_spawn(executor, &promise.task);
+    if (result == RT_EOK)
+    {
+        /* the coroutine belongs to the executor */
+        _handle = nullptr;
+    }
+
+    return result;
+}
+
+int Task::entry(struct rt_task *task)
+{
+    handle_t handle = handle_t::from_address(task->user_data);
+    promise_type &promise = handle.promise();
+
+    if (promise.awaiter)
+    {
+        if (promise.awaiter->poll(task) == RT_TASK_PENDING)
+            return RT_TASK_PENDING;
+        promise.awaiter = RT_NULL;
+    }
+
+    handle.resume();
+
+    return handle.done() ? RT_TASK_DONE : RT_TASK_PENDING;
+}
+
+void Task::cleanup(struct rt_task *task)
+{
+    handle_t::from_address(task->user_data).destroy();
+}
+
+bool Awaiter::await_suspend(Task::handle_t handle)
+{
+    _task = &handle.promise().task;
+
+    /* it's done at once, the coroutine goes on */
+    if (poll(_task) == RT_TASK_DONE)
+        return false;
+
+    handle.promise().awaiter = this;
+    return true;
+}
+
+#endif /* RT_USING_EXECUTOR && __cpp_impl_coroutine */
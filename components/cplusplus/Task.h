@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-24     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    the condition of WaitQueue
+ * 2019-10-28     RT-Thread    the cost of SemTake and MqRecv
+ */
+
+#pragma once
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <ipc/executor.h>
+
+/* the coroutines of C++20, -std=c++20 (or -fcoroutines) */
+#if defined(RT_USING_EXECUTOR) && defined(__cpp_impl_coroutine)
+#include <coroutine>
+
+namespace rtthread {
+
+class Awaiter;
+
+/** The Task class is a coroutine which runs on a stackless task executor.
+
+    rtthread::Task echo(rt_device_t uart)
+    {
+        char buf[64];
+
+        while (true)
+        {
+            rt_base_t size = co_await rtthread::DeviceRead(uart, 0, buf, sizeof(buf));
+            rt_device_write(uart, 0, buf, size);
+        }
+    }
+
+    echo(uart).spawn(executor);
+*/
+class Task
+{
+public:
+    struct promise_type
+    {
+        struct rt_task task;
+        Awaiter *awaiter;       /* the await which the coroutine is suspended at */
+
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() {}
+    };
+    typedef std::coroutine_handle<promise_type> handle_t;
+
+    Task(Task &&other);
+    ~Task();
+
+    /** Run the coroutine on the executor, it's destroyed when it's done.
+      @param   executor  the executor.
+      @return  RT_EOK on success.
+    */
+    rt_err_t spawn(struct rt_executor *executor);
+
+private:
+    explicit Task(handle_t handle) : _handle(handle) {}
+    Task(const Task &);
+    Task &operator=(const Task &);
+
+    static int entry(struct rt_task *task);
+    static void cleanup(struct rt_task *task);
+
+    handle_t _handle;
+};
+
+/** The Awaiter class is the base of awaits, poll() is the await of C which
+    is called again when the coroutine is resumed, until it's done.
+*/
+class Awaiter
+{
+public:
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(Task::handle_t handle);
+    /** @return  the result of await, error code or size. */
+    rt_base_t await_resume() const { return _task->result; }
+
+    virtual int poll(struct rt_task *task) = 0;
+
+protected:
+    Awaiter() : _task(RT_NULL) {}
+    ~Awaiter() {}
+
+private:
+    struct rt_task *_task;
+};
+
+/** The coroutine is put at the end of ready tasks. */
+class Yield
+{
+public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Task::handle_t) {}
+    void await_resume() {}
+};
+
+class Sleep : public Awaiter
+{
+public:
+    explicit Sleep(rt_tick_t ticks) : _ticks(ticks) {}
+    int poll(struct rt_task *task) { return rt_task_sleep(task, _ticks); }
+
+private:
+    rt_tick_t _ticks;
+};
+
+/** The condition of WaitQueue which waits for the next rt_wqueue_wakeup(). */
+struct WaitWakeup
+{
+    bool operator()() const { return false; }
+};
+
+/** The coroutine is resumed when the condition is true or by rt_wqueue_wakeup(),
+    the condition is called at every poll. The timeout is in ticks.
+
+    while (!ready)
+        co_await rtthread::WaitQueue(&queue, [&] { return ready; });
+*/
+template <typename Condition = WaitWakeup>
+class WaitQueue : public Awaiter
+{
+public:
+    WaitQueue(rt_wqueue_t *queue, Condition condition = Condition(), rt_int32_t timeout = RT_WAITING_FOREVER)
+        : _queue(queue), _condition(condition), _timeout(timeout) {}
+    int poll(struct rt_task *task) { return rt_task_wqueue_wait(task, _queue, _condition() ? 1 : 0, _timeout); }
+
+private:
+    rt_wqueue_t *_queue;
+    Condition _condition;
+    rt_int32_t _timeout;
+};
+
+/** SemTake and MqRecv are checked every RT_EXECUTOR_POLL_TICK ticks, the executor
+    does not idle while they wait. WaitQueue is waked at once. */
+#ifdef RT_USING_SEMAPHORE
+class SemTake : public Awaiter
+{
+public:
+    SemTake(rt_sem_t sem, rt_int32_t timeout = RT_WAITING_FOREVER) : _sem(sem), _timeout(timeout) {}
+    int poll(struct rt_task *task) { return rt_task_sem_take(task, _sem, _timeout); }
+
+private:
+    rt_sem_t _sem;
+    rt_int32_t _timeout;
+};
+#endif
+
+#ifdef RT_USING_MESSAGEQUEUE
+class MqRecv : public Awaiter
+{
+public:
+    MqRecv(rt_mq_t mq, void *buffer, rt_size_t size, rt_int32_t timeout = RT_WAITING_FOREVER)
+        : _mq(mq), _buffer(buffer), _size(size), _timeout(timeout) {}
+    int poll(struct rt_task *task) { return rt_task_mq_recv(task, _mq, _buffer, _size, _timeout); }
+
+private:
+    rt_mq_t _mq;
+    void *_buffer;
+    rt_size_t _size;
+    rt_int32_t _timeout;
+};
+#endif
+
+class DeviceRead : public Awaiter
+{
+public:
+    DeviceRead(rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size, rt_int32_t timeout = RT_WAITING_FOREVER)
+        : _dev(dev), _pos(pos), _buffer(buffer), _size(size), _timeout(timeout) {}
+    int poll(struct rt_task *task) { return rt_task_device_read(task, _dev, _pos, _buffer, _size, _timeout); }
+
+private:
+    rt_device_t _dev;
+    rt_off_t _pos;
+    void *_buffer;
+    rt_size_t _size;
+    rt_int32_t _timeout;
+};
+
+#if defined(RT_USING_POSIX) && defined(SAL_USING_POSIX)
+class Recv : public Awaiter
+{
+public:
+    Recv(int s, void *mem, rt_size_t len, int flags = 0, rt_int32_t timeout = RT_WAITING_FOREVER)
+        : _s(s), _mem(mem), _len(len), _flags(flags), _timeout(timeout) {}
+    int poll(struct rt_task *task) { return rt_task_recv(task, _s, _mem, _len, _flags, _timeout); }
+
+private:
+    int _s;
+    void *_mem;
+    rt_size_t _len;
+    int _flags;
+    rt_int32_t _timeout;
+};
+
+class Send : public Awaiter
+{
+public:
+    Send(int s, const void *data, rt_size_t size, int flags = 0, rt_int32_t timeout = RT_WAITING_FOREVER)
+        : _s(s), _data(data), _size(size), _flags(flags), _timeout(timeout) {}
+    int poll(struct rt_task *task) { return rt_task_send(task, _s, _data, _size, _flags, _timeout); }
+
+private:
+    int _s;
+    const void *_data;
+    rt_size_t _size;
+    int _flags;
+    rt_int32_t _timeout;
+};
+
+class Accept : public Awaiter
+{
+public:
+    Accept(int s, struct sockaddr *addr, socklen_t *addrlen, rt_int32_t timeout = RT_WAITING_FOREVER)
+        : _s(s), _addr(addr), _addrlen(addrlen), _timeout(timeout) {}
+    int poll(struct rt_task *task) { return rt_task_accept(task, _s, _addr, _addrlen, _timeout); }
+
+private:
+    int _s;
+    struct sockaddr *_addr;
+    socklen_t *_addrlen;
+    rt_int32_t _timeout;
+};
+#endif /* RT_USING_POSIX && SAL_USING_POSIX */
+
+}
+
+#endif /* RT_USING_EXECUTOR && __cpp_impl_coroutine */
@@ -6,6 +6,8 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-02-11     Bernard      Ignore O_CREAT flag in open.
+ * 2019-08-12     RT-Thread    Bypass the dfs file buffer.
+ * 2019-10-26     RT-Thread    Add positional read and write.
  */
 
 #include <rtthread.h>
@@ -84,6 +86,24 @@ int dfs_device_fs_write(struct dfs_fd *file, const void *buf, size_t count)
     return result;
 }
 
+static int dfs_device_fs_pread(struct dfs_fd *file, void *buf, size_t count, off_t offset)
+{
+    rt_device_t dev_id = (rt_device_t)file->data;
+
+    RT_ASSERT(dev_id != RT_NULL);
+
+    return rt_device_read(dev_id, offset, buf, count);
+}
+
+static int dfs_device_fs_pwrite(struct dfs_fd *file, const void *buf, size_t count, off_t offset)
+{
+    rt_device_t dev_id = (rt_device_t)file->data;
+
+    RT_ASSERT(dev_id != RT_NULL);
+
+    return rt_device_write(dev_id, offset, buf, count);
+}
+
 int dfs_device_fs_close(struct dfs_fd *file)
 {
     rt_err_t result;
@@ -304,12 +324,16 @@ static const struct dfs_file_ops _device_fops =
     RT_NULL,                    /* lseek */
     dfs_device_fs_getdents,
     dfs_device_fs_poll,
+    RT_NULL,                    /* readv */
+    RT_NULL,                    /* writev */
+    dfs_device_fs_pread,
+    dfs_device_fs_pwrite,
 };
 
 static const struct dfs_filesystem_ops _device_fs =
 {
     "devfs",
-    DFS_FS_FLAG_DEFAULT,
+    DFS_FS_FLAG_NOBUF,
     &_device_fops,
 
     dfs_device_fs_mount,
@@ -5,6 +5,7 @@
  *
  * Change Logs:
  * Date           Author       Notes
+ * 2019-08-15     RT-Thread    Return the file data address by RT_FIOGETADDR.
  */
 
 #include <rtthread.h>
@@ -34,6 +35,20 @@ int dfs_romfs_unmount(struct dfs_filesystem *fs)
 
 int dfs_romfs_ioctl(struct dfs_fd *file, int cmd, void *args)
 {
+    struct romfs_dirent *dirent;
+
+    switch (cmd)
+    {
+    case RT_FIOGETADDR:
+        /* the file data is stored in place, it can be accessed directly */
+        dirent = (struct romfs_dirent *)file->data;
+        if (dirent == NULL || dirent->type != ROMFS_DIRENT_FILE)
+            return -EINVAL;
+
+        *(rt_ubase_t *)args = (rt_ubase_t)dirent->data;
+        return RT_EOK;
+    }
+
     return -EIO;
 }
 
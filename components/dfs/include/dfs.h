@@ -49,6 +49,7 @@
 
 #define DFS_FS_FLAG_DEFAULT     0x00    /* default flag */
 #define DFS_FS_FLAG_FULLPATH    0x01    /* set full path to underlaying file system */
+#define DFS_FS_FLAG_NOBUF       0x02    /* never buffer the file data, e.g. device file system */
 
 /* File types */
 #define FT_REGULAR               0   /* regular file */
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-01     RT-Thread    the first version
+ */
+
+#ifndef DFS_EPOLL_H__
+#define DFS_EPOLL_H__
+
+#include <stdint.h>
+#include <rtthread.h>
+
+#ifdef RT_USING_POSIX
+#include <dfs_file.h>
+#include <dfs_poll.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the event bits share the value with poll() */
+#define EPOLLIN         POLLIN
+#define EPOLLPRI        POLLPRI
+#define EPOLLOUT        POLLOUT
+#define EPOLLRDNORM     POLLRDNORM
+#define EPOLLWRNORM     POLLWRNORM
+#define EPOLLERR        POLLERR
+#define EPOLLHUP        POLLHUP
+
+#define EPOLLONESHOT    (1u << 30)
+#define EPOLLET         (1u << 31)
+
+#define EPOLL_CTL_ADD   1
+#define EPOLL_CTL_DEL   2
+#define EPOLL_CTL_MOD   3
+
+#define EPOLL_CLOEXEC   0x01
+
+typedef union epoll_data
+{
+    void *ptr;
+    int fd;
+    uint32_t u32;
+    uint64_t u64;
+} epoll_data_t;
+
+struct epoll_event
+{
+    uint32_t events;
+    epoll_data_t data;
+};
+
+int epoll_create(int size);
+int epoll_create1(int flags);
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+
+/* drop all epoll registrations of a file before it is closed */
+void dfs_epoll_fd_release(struct dfs_fd *fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RT_USING_POSIX */
+
+#endif /* DFS_EPOLL_H__ */
@@ -6,6 +6,10 @@
  * Change Logs:
  * Date           Author       Notes
  * 2005-01-26     Bernard      The first version.
+ * 2019-08-05     RT-Thread    Add readv/writev file operations.
+ * 2019-08-12     RT-Thread    Add the read-ahead and write-combining buffer.
+ * 2019-08-15     RT-Thread    Add RT_FIOGETADDR ioctl command.
+ * 2019-10-26     RT-Thread    Add pread/pwrite file operations.
  */
 
 #ifndef __DFS_FILE_H__
@@ -20,6 +24,20 @@ extern "C" {
 
 struct rt_pollreq;
 
+/* ioctl command: get the memory address of the data of a file which is
+ * stored in place, such as romfs, args is a rt_ubase_t pointer */
+#define RT_FIOGETADDR   0x52540001U
+
+/* scatter/gather element, the same layout as lwIP and POSIX <sys/uio.h> */
+#if !defined(iovec) && !defined(LWIP_HDR_SOCKETS_H)
+struct iovec
+{
+    void  *iov_base;
+    size_t iov_len;
+};
+#define iovec iovec
+#endif
+
 struct dfs_file_ops
 {
     int (*open)     (struct dfs_fd *fd);
@@ -32,7 +50,32 @@ struct dfs_file_ops
     int (*getdents) (struct dfs_fd *fd, struct dirent *dirp, uint32_t count);
 
     int (*poll)     (struct dfs_fd *fd, struct rt_pollreq *req);
+
+    /* optional, dfs_file_readv/writev fall back to read/write per vector */
+    int (*readv)    (struct dfs_fd *fd, const struct iovec *iov, int iovcnt);
+    int (*writev)   (struct dfs_fd *fd, const struct iovec *iov, int iovcnt);
+
+    /* optional, positional access without the file position. Both or none of
+     * them, otherwise dfs_file_pread/pwrite move the position under a lock */
+    int (*pread)    (struct dfs_fd *fd, void *buf, size_t count, off_t offset);
+    int (*pwrite)   (struct dfs_fd *fd, const void *buf, size_t count, off_t offset);
+};
+
+#ifdef DFS_USING_FILE_BUFFER
+/*
+ * read-ahead and write-combining buffer of a file descriptor. It holds either
+ * the data read ahead from the file system or the data waiting to be written,
+ * never both at the same time.
+ */
+struct dfs_file_buffer
+{
+    uint8_t *data;
+    size_t   size;               /* Capacity of the buffer */
+    off_t    offset;             /* File offset of the first byte in buffer */
+    size_t   len;                /* Valid bytes in buffer */
+    int      dirty;              /* The buffer holds data not written yet */
 };
+#endif
 
 /* file descriptor */
 #define DFS_FD_MAGIC     0xfdfd
@@ -50,8 +93,14 @@ struct dfs_fd
     uint32_t flags;              /* Descriptor flags */
     size_t   size;               /* Size in bytes */
     off_t    pos;                /* Current file position */
+    struct rt_mutex pos_lock;    /* The position lock of seekable files, see dfs_file_pread() */
 
     void *data;                  /* Specific file system data */
+
+#ifdef DFS_USING_FILE_BUFFER
+    size_t bufsz;                /* Buffer size, 0 for unbuffered */
+    struct dfs_file_buffer *buffer;
+#endif
 };
 
 int dfs_file_open(struct dfs_fd *fd, const char *path, int flags);
@@ -63,6 +112,13 @@ int dfs_file_unlink(const char *path);
 int dfs_file_write(struct dfs_fd *fd, const void *buf, size_t len);
 int dfs_file_flush(struct dfs_fd *fd);
 int dfs_file_lseek(struct dfs_fd *fd, off_t offset);
+int dfs_file_readv(struct dfs_fd *fd, const struct iovec *iov, int iovcnt);
+int dfs_file_writev(struct dfs_fd *fd, const struct iovec *iov, int iovcnt);
+int dfs_file_pread(struct dfs_fd *fd, void *buf, size_t len, off_t offset);
+int dfs_file_pwrite(struct dfs_fd *fd, const void *buf, size_t len, off_t offset);
+#ifdef DFS_USING_FILE_BUFFER
+int dfs_file_setbuf(struct dfs_fd *fd, size_t size);
+#endif
 
 int dfs_file_stat(const char *path, struct stat *buf);
 int dfs_file_rename(const char *oldpath, const char *newpath);
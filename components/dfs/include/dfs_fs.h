@@ -52,6 +52,10 @@ struct dfs_filesystem
     const struct dfs_filesystem_ops *ops; /* Operations for file system type */
 
     void *data;             /* Specific file system data */
+
+#ifdef DFS_USING_FILE_BUFFER
+    size_t bufsz;           /* Buffer size of the opened files, 0 for unbuffered */
+#endif
 };
 
 /* file system partition table */
@@ -87,6 +91,9 @@ int dfs_mount(const char *device_name,
               unsigned long rwflag,
               const void *data);
 int dfs_unmount(const char *specialfile);
+#ifdef DFS_USING_FILE_BUFFER
+int dfs_filesystem_set_bufsz(const char *path, size_t size);
+#endif
 
 int dfs_mkfs(const char *fs_name, const char *device_name);
 int dfs_statfs(const char *path, struct statfs *buffer);
@@ -10,6 +10,7 @@
  * 2011-05-16     Yi.qiu       Change parameter name of rename, "new" is C++ key word.
  * 2017-12-27     Bernard      Add fcntl API.
  * 2018-02-07     Bernard      Change the 3rd parameter of open/fcntl/ioctl to '...'
+ * 2019-08-05     RT-Thread    Add readv/writev/pread/pwrite.
  */
 
 #ifndef __DFS_POSIX_H__
@@ -51,6 +52,10 @@ int write(int fd, const void *buf, size_t len);
 #endif
 
 off_t lseek(int fd, off_t offset, int whence);
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t pread(int fd, void *buf, size_t len, off_t offset);
+ssize_t pwrite(int fd, const void *buf, size_t len, off_t offset);
 int rename(const char *from, const char *to);
 int unlink(const char *pathname);
 int stat(const char *file, struct stat *buf);
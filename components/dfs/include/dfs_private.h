@@ -25,4 +25,7 @@ extern const struct dfs_mount_tbl mount_table[];
 
 extern char working_directory[];
 
+void dfs_pos_lock(struct dfs_fd *fd);
+void dfs_pos_unlock(struct dfs_fd *fd);
+
 #endif
@@ -8,6 +8,8 @@
  * 2005-02-22     Bernard      The first version.
  * 2017-12-11     Bernard      Use rt_free to instead of free in fd_is_open().
  * 2018-03-20     Heyuanjie    dynamic allocation FD
+ * 2019-10-26     RT-Thread    Add the position lock of seekable files.
+ * 2019-10-28     RT-Thread    Move the position lock into the file descriptor.
  */
 
 #include <dfs.h>
@@ -118,6 +120,28 @@ void dfs_unlock(void)
     rt_mutex_release(&fslock);
 }
 
+/**
+ * this function will lock the position of a seekable file, it's recursive.
+ * The descriptors which are not in the fd table are not shared, they are not
+ * locked.
+ *
+ * @note please don't invoke it on ISR.
+ */
+void dfs_pos_lock(struct dfs_fd *fd)
+{
+    if (fd->magic == DFS_FD_MAGIC)
+        rt_mutex_take(&fd->pos_lock, RT_WAITING_FOREVER);
+}
+
+/**
+ * this function will unlock the position of a seekable file.
+ */
+void dfs_pos_unlock(struct dfs_fd *fd)
+{
+    if (fd->magic == DFS_FD_MAGIC)
+        rt_mutex_release(&fd->pos_lock);
+}
+
 static int fd_alloc(struct dfs_fdtable *fdt, int startfd)
 {
     int idx;
@@ -160,6 +184,8 @@ static int fd_alloc(struct dfs_fdtable *fdt, int startfd)
         fdt->fds[idx] = (struct dfs_fd *)rt_calloc(1, sizeof(struct dfs_fd));
         if (fdt->fds[idx] == RT_NULL)
             idx = fdt->maxfd;
+        else
+            rt_mutex_init(&fdt->fds[idx]->pos_lock, "fdpos", RT_IPC_FLAG_FIFO);
     }
 
 __exit:
@@ -267,6 +293,7 @@ void fd_put(struct dfs_fd *fd)
         {
             if (fdt->fds[index] == fd)
             {
+                rt_mutex_detach(&fd->pos_lock);
                 rt_free(fd);
                 fdt->fds[index] = 0;
                 break;
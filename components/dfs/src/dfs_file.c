@@ -9,18 +9,260 @@
  * 2011-12-08     Bernard      Merges rename patch from iamcacy.
  * 2015-05-27     Bernard      Fix the fd clear issue.
  * 2019-01-24     Bernard      Remove file repeatedly open check.
+ * 2019-08-01     RT-Thread    Release epoll registrations on close.
+ * 2019-08-05     RT-Thread    Add readv/writev/pread/pwrite.
+ * 2019-08-12     RT-Thread    Add the read-ahead and write-combining buffer.
+ * 2019-10-26     RT-Thread    Serialize pread/pwrite with the file position.
  */
 
 #include <dfs.h>
 #include <dfs_file.h>
+#include <dfs_epoll.h>
 #include <dfs_private.h>
 
+#if defined(DFS_USING_FILE_BUFFER) && !defined(O_DIRECT)
+#define O_DIRECT    0
+#endif
+
 /**
  * @addtogroup FileApi
  */
 
 /*@{*/
 
+/*
+ * pread/pwrite of the seekable files without positional operations move the
+ * file position for a while, the other accesses to the position of the same
+ * descriptor wait for it.
+ */
+static void dfs_file_lock(struct dfs_fd *fd)
+{
+    if (fd->fops->lseek != NULL && fd->fops->pread == NULL)
+        dfs_pos_lock(fd);
+}
+
+static void dfs_file_unlock(struct dfs_fd *fd)
+{
+    if (fd->fops->lseek != NULL && fd->fops->pread == NULL)
+        dfs_pos_unlock(fd);
+}
+
+#ifdef DFS_USING_FILE_BUFFER
+/*
+ * The file buffer sits between dfs_file_read/write and the file system. While
+ * it holds read-ahead data, the file system position is at the end of that
+ * data; while it holds pending write data, the file system position is at
+ * the start of it; when it is empty, the file system position is fd->pos.
+ */
+
+static struct dfs_file_buffer *dfs_file_buffer_get(struct dfs_fd *fd)
+{
+    struct dfs_file_buffer *buffer = fd->buffer;
+
+    if (buffer == NULL && fd->bufsz > 0)
+    {
+        buffer = (struct dfs_file_buffer *)rt_malloc(sizeof(struct dfs_file_buffer) + fd->bufsz);
+        if (buffer == NULL)
+            return NULL; /* fall back to unbuffered access */
+
+        buffer->data   = (uint8_t *)(buffer + 1);
+        buffer->size   = fd->bufsz;
+        buffer->offset = 0;
+        buffer->len    = 0;
+        buffer->dirty  = 0;
+        fd->buffer = buffer;
+    }
+
+    return buffer;
+}
+
+/* write the pending data to the file system */
+static int dfs_file_buffer_flush(struct dfs_fd *fd)
+{
+    struct dfs_file_buffer *buffer = fd->buffer;
+    size_t written = 0;
+    int result = 0;
+
+    if (buffer == NULL || !buffer->dirty)
+        return 0;
+
+    fd->pos = buffer->offset;
+    while (written < buffer->len)
+    {
+        result = fd->fops->write(fd, buffer->data + written, buffer->len - written);
+        if (result <= 0)
+            break;
+        written += result;
+    }
+    fd->pos = buffer->offset + written;
+
+    if (written < buffer->len && result == 0)
+        result = -ENOSPC;
+
+    buffer->len   = 0;
+    buffer->dirty = 0;
+
+    return result < 0 ? result : 0;
+}
+
+/* empty the buffer and bring the file system position back to fd->pos */
+static int dfs_file_buffer_sync(struct dfs_fd *fd)
+{
+    struct dfs_file_buffer *buffer = fd->buffer;
+    off_t pos, end;
+    int result;
+
+    if (buffer == NULL || buffer->len == 0)
+        return 0;
+
+    if (buffer->dirty)
+        return dfs_file_buffer_flush(fd);
+
+    /* drop the read-ahead data */
+    pos = fd->pos;
+    end = buffer->offset + buffer->len;
+    buffer->len = 0;
+    if (end != pos)
+    {
+        result = fd->fops->lseek(fd, pos);
+        if (result < 0)
+            return result;
+    }
+    fd->pos = pos;
+
+    return 0;
+}
+
+static int dfs_file_buffer_read(struct dfs_fd *fd, struct dfs_file_buffer *buffer,
+                                uint8_t *buf, size_t len)
+{
+    size_t total = 0;
+    off_t pos;
+    int result = 0;
+
+    if (buffer->dirty && (result = dfs_file_buffer_flush(fd)) < 0)
+        return result;
+
+    while (len > 0)
+    {
+        /* read hit */
+        if (buffer->len > 0 && fd->pos >= buffer->offset &&
+            fd->pos < buffer->offset + (off_t)buffer->len)
+        {
+            size_t length = buffer->offset + buffer->len - fd->pos;
+
+            if (length > len)
+                length = len;
+            memcpy(buf, buffer->data + (fd->pos - buffer->offset), length);
+            fd->pos += length;
+            buf     += length;
+            len     -= length;
+            total   += length;
+            continue;
+        }
+
+        /* the short read-ahead has reached the end of file */
+        if (total > 0 && buffer->len < buffer->size &&
+            fd->pos == buffer->offset + (off_t)buffer->len)
+            break;
+
+        /* read miss, move the file system position to fd->pos */
+        if ((result = dfs_file_buffer_sync(fd)) < 0)
+            break;
+
+        pos = fd->pos;
+        if (len >= buffer->size)
+        {
+            /* large read goes to the caller's buffer directly */
+            result = fd->fops->read(fd, buf, len);
+            if (result > 0)
+            {
+                fd->pos = pos + result;
+                total += result;
+            }
+            break;
+        }
+
+        result = fd->fops->read(fd, buffer->data, buffer->size);
+        fd->pos = pos;
+        if (result <= 0)
+            break;
+
+        buffer->offset = pos;
+        buffer->len    = result;
+    }
+
+    if (total == 0 && result < 0)
+    {
+        fd->flags |= DFS_F_EOF;
+        return result;
+    }
+
+    return total;
+}
+
+/* the data is smaller than the buffer, the larger writes bypass the buffer */
+static int dfs_file_buffer_write(struct dfs_fd *fd, struct dfs_file_buffer *buffer,
+                                 const void *buf, size_t len)
+{
+    int result;
+
+    /* the written data invalidates the read-ahead data */
+    if (!buffer->dirty && (result = dfs_file_buffer_sync(fd)) < 0)
+        return result;
+
+    if (buffer->dirty &&
+        (buffer->len + len > buffer->size ||
+         fd->pos != buffer->offset + (off_t)buffer->len))
+    {
+        if ((result = dfs_file_buffer_flush(fd)) < 0)
+            return result;
+    }
+
+    if (buffer->len == 0)
+        buffer->offset = fd->pos;
+    memcpy(buffer->data + buffer->len, buf, len);
+    buffer->len  += len;
+    buffer->dirty = 1;
+
+    fd->pos += len;
+    if ((size_t)fd->pos > fd->size)
+        fd->size = fd->pos;
+
+    return len;
+}
+
+/**
+ * this function will set the buffer size of an opened file. The buffered
+ * data is written back or dropped first.
+ *
+ * @param fd the file descriptor.
+ * @param size the buffer size, 0 to disable the file buffer.
+ *
+ * @return 0 on successful, negative on failed.
+ */
+int dfs_file_setbuf(struct dfs_fd *fd, size_t size)
+{
+    int result;
+
+    if (fd == NULL)
+        return -EINVAL;
+
+    if (fd->type != FT_REGULAR || fd->fops->lseek == NULL ||
+        (fd->fs->ops->flags & DFS_FS_FLAG_NOBUF))
+        return size ? -ENOSYS : 0;
+
+    if ((result = dfs_file_buffer_sync(fd)) < 0)
+        return result;
+
+    rt_free(fd->buffer);
+    fd->buffer = NULL;
+    fd->bufsz  = size;
+
+    return 0;
+}
+#endif
+
 /**
  * this function will open a file which specified by path with specified flags.
  *
@@ -68,6 +310,10 @@ int dfs_file_open(struct dfs_fd *fd, const char *path, int flags)
     fd->size  = 0;
     fd->pos   = 0;
     fd->data  = fs;
+#ifdef DFS_USING_FILE_BUFFER
+    fd->bufsz  = fs->bufsz;
+    fd->buffer = NULL;
+#endif
 
     if (!(fs->ops->flags & DFS_FS_FLAG_FULLPATH))
     {
@@ -111,6 +357,13 @@ int dfs_file_open(struct dfs_fd *fd, const char *path, int flags)
         fd->flags |= DFS_F_DIRECTORY;
     }
 
+#ifdef DFS_USING_FILE_BUFFER
+    /* appending writes are positioned by the file system, do not buffer */
+    if (fd->type != FT_REGULAR || fd->fops->lseek == NULL ||
+        (flags & (O_DIRECT | O_APPEND)))
+        fd->bufsz = 0;
+#endif
+
     LOG_D("open successful");
     return 0;
 }
@@ -129,8 +382,25 @@ int dfs_file_close(struct dfs_fd *fd)
     if (fd == NULL)
         return -ENXIO;
 
+#ifdef RT_USING_POSIX
+    /* the wait queues of the file go away with it */
+    dfs_epoll_fd_release(fd);
+#endif
+
+#ifdef DFS_USING_FILE_BUFFER
+    /* the file is closed even if the pending data fails to be written */
+    result = dfs_file_buffer_flush(fd);
+    rt_free(fd->buffer);
+    fd->buffer = NULL;
+#endif
+
     if (fd->fops->close != NULL)
-        result = fd->fops->close(fd);
+    {
+        int ret = fd->fops->close(fd);
+
+        if (ret < 0 || result == 0)
+            result = ret;
+    }
 
     /* close fd error, return */
     if (result < 0)
@@ -171,17 +441,60 @@ int dfs_file_ioctl(struct dfs_fd *fd, int cmd, void *args)
                 flags &= mask;
                 fd->flags &= ~mask;
                 fd->flags |= flags;
+#ifdef DFS_USING_FILE_BUFFER
+                if (flags & O_APPEND)
+                    dfs_file_setbuf(fd, 0);
+#endif
             }
             return 0;
         }
     }
 
     if (fd->fops->ioctl != NULL)
+    {
+#ifdef DFS_USING_FILE_BUFFER
+        /* the command may access the file data, such as a truncate */
+        int result = dfs_file_buffer_sync(fd);
+
+        if (result < 0)
+            return result;
+#endif
         return fd->fops->ioctl(fd, cmd, args);
+    }
 
     return -ENOSYS;
 }
 
+static int _dfs_file_read(struct dfs_fd *fd, void *buf, size_t len)
+{
+    int result = 0;
+
+    if (fd == NULL)
+        return -EINVAL;
+
+    if (fd->fops->read == NULL)
+        return -ENOSYS;
+
+#ifdef DFS_USING_FILE_BUFFER
+    if (fd->bufsz > 0 && len < fd->bufsz)
+    {
+        struct dfs_file_buffer *buffer = dfs_file_buffer_get(fd);
+
+        if (buffer != NULL)
+            return dfs_file_buffer_read(fd, buffer, (uint8_t *)buf, len);
+    }
+    else if ((result = dfs_file_buffer_sync(fd)) < 0)
+    {
+        return result;
+    }
+#endif
+
+    if ((result = fd->fops->read(fd, buf, len)) < 0)
+        fd->flags |= DFS_F_EOF;
+
+    return result;
+}
+
 /**
  * this function will read specified length data from a file descriptor to a
  * buffer.
@@ -194,16 +507,14 @@ int dfs_file_ioctl(struct dfs_fd *fd, int cmd, void *args)
  */
 int dfs_file_read(struct dfs_fd *fd, void *buf, size_t len)
 {
-    int result = 0;
+    int result;
 
     if (fd == NULL)
         return -EINVAL;
 
-    if (fd->fops->read == NULL)
-        return -ENOSYS;
-
-    if ((result = fd->fops->read(fd, buf, len)) < 0)
-        fd->flags |= DFS_F_EOF;
+    dfs_file_lock(fd);
+    result = _dfs_file_read(fd, buf, len);
+    dfs_file_unlock(fd);
 
     return result;
 }
@@ -282,6 +593,34 @@ __exit:
     return result;
 }
 
+static int _dfs_file_write(struct dfs_fd *fd, const void *buf, size_t len)
+{
+    if (fd == NULL)
+        return -EINVAL;
+
+    if (fd->fops->write == NULL)
+        return -ENOSYS;
+
+#ifdef DFS_USING_FILE_BUFFER
+    if (fd->bufsz > 0 && len < fd->bufsz)
+    {
+        struct dfs_file_buffer *buffer = dfs_file_buffer_get(fd);
+
+        if (buffer != NULL)
+            return dfs_file_buffer_write(fd, buffer, buf, len);
+    }
+    else
+    {
+        int result = dfs_file_buffer_sync(fd);
+
+        if (result < 0)
+            return result;
+    }
+#endif
+
+    return fd->fops->write(fd, buf, len);
+}
+
 /**
  * this function will write some specified length data to file system.
  *
@@ -293,13 +632,16 @@ __exit:
  */
 int dfs_file_write(struct dfs_fd *fd, const void *buf, size_t len)
 {
+    int result;
+
     if (fd == NULL)
         return -EINVAL;
 
-    if (fd->fops->write == NULL)
-        return -ENOSYS;
+    dfs_file_lock(fd);
+    result = _dfs_file_write(fd, buf, len);
+    dfs_file_unlock(fd);
 
-    return fd->fops->write(fd, buf, len);
+    return result;
 }
 
 /**
@@ -314,12 +656,60 @@ int dfs_file_flush(struct dfs_fd *fd)
     if (fd == NULL)
         return -EINVAL;
 
+#ifdef DFS_USING_FILE_BUFFER
+    {
+        int result = dfs_file_buffer_flush(fd);
+
+        if (result < 0)
+            return result;
+    }
+#endif
+
     if (fd->fops->flush == NULL)
         return -ENOSYS;
 
     return fd->fops->flush(fd);
 }
 
+static int _dfs_file_lseek(struct dfs_fd *fd, off_t offset)
+{
+    int result;
+
+    if (fd == NULL)
+        return -EINVAL;
+
+    if (fd->fops->lseek == NULL)
+        return -ENOSYS;
+
+#ifdef DFS_USING_FILE_BUFFER
+    if (fd->buffer != NULL && fd->buffer->len > 0)
+    {
+        struct dfs_file_buffer *buffer = fd->buffer;
+
+        /* seek inside the read-ahead data needs no file system access */
+        if (!buffer->dirty && offset >= buffer->offset &&
+            offset <= buffer->offset + (off_t)buffer->len)
+        {
+            fd->pos = offset;
+            return offset;
+        }
+
+        /* the read-ahead data is dropped, fops->lseek moves the position */
+        if (buffer->dirty && (result = dfs_file_buffer_flush(fd)) < 0)
+            return result;
+        buffer->len = 0;
+    }
+#endif
+
+    result = fd->fops->lseek(fd, offset);
+
+    /* update current position */
+    if (result >= 0)
+        fd->pos = result;
+
+    return result;
+}
+
 /**
  * this function will seek the offset for specified file descriptor.
  *
@@ -335,14 +725,232 @@ int dfs_file_lseek(struct dfs_fd *fd, off_t offset)
     if (fd == NULL)
         return -EINVAL;
 
-    if (fd->fops->lseek == NULL)
+    dfs_file_lock(fd);
+    result = _dfs_file_lseek(fd, offset);
+    dfs_file_unlock(fd);
+
+    return result;
+}
+
+static int _dfs_file_readv(struct dfs_fd *fd, const struct iovec *iov, int iovcnt)
+{
+    int index;
+    int result, total = 0;
+
+    if (fd == NULL || iov == NULL || iovcnt <= 0)
+        return -EINVAL;
+
+#ifdef DFS_USING_FILE_BUFFER
+    if ((result = dfs_file_buffer_sync(fd)) < 0)
+        return result;
+#endif
+
+    if (fd->fops->readv != NULL)
+    {
+        if ((result = fd->fops->readv(fd, iov, iovcnt)) < 0)
+            fd->flags |= DFS_F_EOF;
+
+        return result;
+    }
+
+    if (fd->fops->read == NULL)
         return -ENOSYS;
 
-    result = fd->fops->lseek(fd, offset);
+    for (index = 0; index < iovcnt; index ++)
+    {
+        if (iov[index].iov_len == 0)
+            continue;
 
-    /* update current position */
-    if (result >= 0)
-        fd->pos = result;
+        result = fd->fops->read(fd, iov[index].iov_base, iov[index].iov_len);
+        if (result < 0)
+        {
+            fd->flags |= DFS_F_EOF;
+            /* report the data already read */
+            return total ? total : result;
+        }
+
+        total += result;
+        if ((size_t)result < iov[index].iov_len)
+            break;
+    }
+
+    return total;
+}
+
+/**
+ * this function will read data from a file descriptor into several buffers.
+ * The vector is passed to the file system in one call when it supports
+ * readv, otherwise it is read buffer by buffer until a short read.
+ *
+ * @param fd the file descriptor.
+ * @param iov the buffer vector.
+ * @param iovcnt the number of buffers in the vector.
+ *
+ * @return the actual read data bytes or 0 on end of file, negative on failed.
+ */
+int dfs_file_readv(struct dfs_fd *fd, const struct iovec *iov, int iovcnt)
+{
+    int result;
+
+    if (fd == NULL)
+        return -EINVAL;
+
+    dfs_file_lock(fd);
+    result = _dfs_file_readv(fd, iov, iovcnt);
+    dfs_file_unlock(fd);
+
+    return result;
+}
+
+static int _dfs_file_writev(struct dfs_fd *fd, const struct iovec *iov, int iovcnt)
+{
+    int index;
+    int result, total = 0;
+
+    if (fd == NULL || iov == NULL || iovcnt <= 0)
+        return -EINVAL;
+
+#ifdef DFS_USING_FILE_BUFFER
+    if ((result = dfs_file_buffer_sync(fd)) < 0)
+        return result;
+#endif
+
+    if (fd->fops->writev != NULL)
+        return fd->fops->writev(fd, iov, iovcnt);
+
+    if (fd->fops->write == NULL)
+        return -ENOSYS;
+
+    for (index = 0; index < iovcnt; index ++)
+    {
+        if (iov[index].iov_len == 0)
+            continue;
+
+        result = fd->fops->write(fd, iov[index].iov_base, iov[index].iov_len);
+        if (result < 0)
+            return total ? total : result;
+
+        total += result;
+        if ((size_t)result < iov[index].iov_len)
+            break;
+    }
+
+    return total;
+}
+
+/**
+ * this function will write data from several buffers to a file descriptor.
+ * The vector is passed to the file system in one call when it supports
+ * writev, otherwise it is written buffer by buffer until a short write.
+ *
+ * @param fd the file descriptor.
+ * @param iov the buffer vector.
+ * @param iovcnt the number of buffers in the vector.
+ *
+ * @return the actual written data length, negative on failed.
+ */
+int dfs_file_writev(struct dfs_fd *fd, const struct iovec *iov, int iovcnt)
+{
+    int result;
+
+    if (fd == NULL)
+        return -EINVAL;
+
+    dfs_file_lock(fd);
+    result = _dfs_file_writev(fd, iov, iovcnt);
+    dfs_file_unlock(fd);
+
+    return result;
+}
+
+/**
+ * this function will read data at the specified offset of a file, the file
+ * position is left unchanged.
+ *
+ * @param fd the file descriptor.
+ * @param buf the buffer to save the read data.
+ * @param len the length of data buffer to be read.
+ * @param offset the file offset to read from.
+ *
+ * @return the actual read data bytes or 0 on end of file, negative on failed.
+ *
+ * @note the files without positional operations move the position and
+ * restore it under the position lock, which read, write and lseek take too.
+ */
+int dfs_file_pread(struct dfs_fd *fd, void *buf, size_t len, off_t offset)
+{
+    int result;
+    off_t pos;
+
+    if (fd == NULL || offset < 0)
+        return -EINVAL;
+
+    if (fd->fops->pread != NULL)
+    {
+#ifdef DFS_USING_FILE_BUFFER
+        if ((result = dfs_file_buffer_sync(fd)) < 0)
+            return result;
+#endif
+        return fd->fops->pread(fd, buf, len, offset);
+    }
+
+    /* sockets, pipes and the other streams */
+    if (fd->type == FT_SOCKET || fd->fops->lseek == NULL)
+        return -ESPIPE;
+
+    dfs_pos_lock(fd);
+    pos = fd->pos;
+    if ((result = _dfs_file_lseek(fd, offset)) >= 0)
+    {
+        result = _dfs_file_read(fd, buf, len);
+        _dfs_file_lseek(fd, pos);
+    }
+    dfs_pos_unlock(fd);
+
+    return result;
+}
+
+/**
+ * this function will write data at the specified offset of a file, the file
+ * position is left unchanged.
+ *
+ * @param fd the file descriptor.
+ * @param buf the data buffer to be written.
+ * @param len the data buffer length.
+ * @param offset the file offset to write to.
+ *
+ * @return the actual written data length, negative on failed.
+ *
+ * @note see dfs_file_pread() for the files without positional operations.
+ */
+int dfs_file_pwrite(struct dfs_fd *fd, const void *buf, size_t len, off_t offset)
+{
+    int result;
+    off_t pos;
+
+    if (fd == NULL || offset < 0)
+        return -EINVAL;
+
+    if (fd->fops->pwrite != NULL)
+    {
+#ifdef DFS_USING_FILE_BUFFER
+        if ((result = dfs_file_buffer_sync(fd)) < 0)
+            return result;
+#endif
+        return fd->fops->pwrite(fd, buf, len, offset);
+    }
+
+    if (fd->type == FT_SOCKET || fd->fops->lseek == NULL)
+        return -ESPIPE;
+
+    dfs_pos_lock(fd);
+    pos = fd->pos;
+    if ((result = _dfs_file_lseek(fd, offset)) >= 0)
+    {
+        result = _dfs_file_write(fd, buf, len);
+        _dfs_file_lseek(fd, pos);
+    }
+    dfs_pos_unlock(fd);
 
     return result;
 }
@@ -10,6 +10,7 @@
  * 2011-03-12     Bernard      fix the filesystem lookup issue.
  * 2017-11-30     Bernard      fix the filesystem_operation_table issue.
  * 2017-12-05     Bernard      fix the fs type search issue in mkfs.
+ * 2019-08-12     RT-Thread    Add the file buffer size of mount point.
  */
 
 #include <dfs_fs.h>
@@ -316,6 +317,12 @@ int dfs_mount(const char   *device_name,
     fs->path   = fullpath;
     fs->ops    = *ops;
     fs->dev_id = dev_id;
+#ifdef DFS_USING_FILE_BUFFER
+    if (fs->ops->flags & DFS_FS_FLAG_NOBUF)
+        fs->bufsz = 0;
+    else
+        fs->bufsz = DFS_FILE_BUFFER_SIZE;
+#endif
     /* release filesystem_table lock */
     dfs_unlock();
 
@@ -421,6 +428,53 @@ err1:
     return -1;
 }
 
+#ifdef DFS_USING_FILE_BUFFER
+/**
+ * this function will set the buffer size of the files opened later on a
+ * mounted file system.
+ *
+ * @param path the path which mounted a file system.
+ * @param size the buffer size, 0 to disable the file buffer.
+ *
+ * @return 0 on successful or -1 on failed.
+ */
+int dfs_filesystem_set_bufsz(const char *path, size_t size)
+{
+    char *fullpath;
+    struct dfs_filesystem *iter;
+    int result = -1;
+
+    fullpath = dfs_normalize_path(NULL, path);
+    if (fullpath == NULL)
+    {
+        rt_set_errno(-ENOTDIR);
+
+        return -1;
+    }
+
+    dfs_lock();
+    for (iter = &filesystem_table[0];
+            iter < &filesystem_table[DFS_FILESYSTEMS_MAX]; iter++)
+    {
+        if ((iter->path != NULL) && (strcmp(iter->path, fullpath) == 0))
+        {
+            /* the device file system is always unbuffered */
+            if (!(iter->ops->flags & DFS_FS_FLAG_NOBUF))
+                iter->bufsz = size;
+            result = 0;
+            break;
+        }
+    }
+    dfs_unlock();
+    rt_free(fullpath);
+
+    if (result < 0)
+        rt_set_errno(-ENOENT);
+
+    return result;
+}
+#endif
+
 /**
  * make a file system on the special device
  *
@@ -7,6 +7,8 @@
  * Date           Author       Notes
  * 2009-05-27     Yi.qiu       The first version
  * 2018-02-07     Bernard      Change the 3rd parameter of open/fcntl/ioctl to '...'
+ * 2019-08-05     RT-Thread    Add readv/writev/pread/pwrite.
+ * 2019-10-26     RT-Thread    Take the position lock in lseek.
  */
 
 #include <dfs.h>
@@ -211,6 +213,8 @@ off_t lseek(int fd, off_t offset, int whence)
         return -1;
     }
 
+    /* pread/pwrite on other threads may move the position for a while */
+    dfs_pos_lock(d);
     switch (whence)
     {
     case SEEK_SET:
@@ -225,6 +229,7 @@ off_t lseek(int fd, off_t offset, int whence)
         break;
 
     default:
+        dfs_pos_unlock(d);
         fd_put(d);
         rt_set_errno(-EINVAL);
 
@@ -233,12 +238,14 @@ off_t lseek(int fd, off_t offset, int whence)
 
     if (offset < 0)
     {
+        dfs_pos_unlock(d);
         fd_put(d);
         rt_set_errno(-EINVAL);
 
         return -1;
     }
     result = dfs_file_lseek(d, offset);
+    dfs_pos_unlock(d);
     if (result < 0)
     {
         fd_put(d);
@@ -254,6 +261,156 @@ off_t lseek(int fd, off_t offset, int whence)
 }
 RTM_EXPORT(lseek);
 
+/**
+ * this function is a POSIX compliant version, which will read data from an
+ * open file descriptor into several buffers.
+ *
+ * @param fd the file descriptor.
+ * @param iov the buffer vector.
+ * @param iovcnt the number of buffers in the vector.
+ *
+ * @return the actual read data length, or -1 on failed.
+ */
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    int result;
+    struct dfs_fd *d;
+
+    d = fd_get(fd);
+    if (d == NULL)
+    {
+        rt_set_errno(-EBADF);
+
+        return -1;
+    }
+
+    result = dfs_file_readv(d, iov, iovcnt);
+    fd_put(d);
+
+    if (result < 0)
+    {
+        rt_set_errno(result);
+
+        return -1;
+    }
+
+    return result;
+}
+RTM_EXPORT(readv);
+
+/**
+ * this function is a POSIX compliant version, which will write data from
+ * several buffers to an open file descriptor.
+ *
+ * @param fd the file descriptor.
+ * @param iov the buffer vector.
+ * @param iovcnt the number of buffers in the vector.
+ *
+ * @return the actual written data length, or -1 on failed.
+ */
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    int result;
+    struct dfs_fd *d;
+
+    d = fd_get(fd);
+    if (d == NULL)
+    {
+        rt_set_errno(-EBADF);
+
+        return -1;
+    }
+
+    result = dfs_file_writev(d, iov, iovcnt);
+    fd_put(d);
+
+    if (result < 0)
+    {
+        rt_set_errno(result);
+
+        return -1;
+    }
+
+    return result;
+}
+RTM_EXPORT(writev);
+
+/**
+ * this function is a POSIX compliant version, which will read data at the
+ * specified offset of an open file descriptor without moving its position.
+ *
+ * @param fd the file descriptor.
+ * @param buf the buffer to save the read data.
+ * @param len the maximal length of data buffer.
+ * @param offset the file offset to read from.
+ *
+ * @return the actual read data length, or -1 on failed.
+ */
+ssize_t pread(int fd, void *buf, size_t len, off_t offset)
+{
+    int result;
+    struct dfs_fd *d;
+
+    d = fd_get(fd);
+    if (d == NULL)
+    {
+        rt_set_errno(-EBADF);
+
+        return -1;
+    }
+
+    result = dfs_file_pread(d, buf, len, offset);
+    fd_put(d);
+
+    if (result < 0)
+    {
+        rt_set_errno(result);
+
+        return -1;
+    }
+
+    return result;
+}
+RTM_EXPORT(pread);
+
+/**
+ * this function is a POSIX compliant version, which will write data at the
+ * specified offset of an open file descriptor without moving its position.
+ *
+ * @param fd the file descriptor.
+ * @param buf the data buffer to be written.
+ * @param len the data buffer length.
+ * @param offset the file offset to write to.
+ *
+ * @return the actual written data length, or -1 on failed.
+ */
+ssize_t pwrite(int fd, const void *buf, size_t len, off_t offset)
+{
+    int result;
+    struct dfs_fd *d;
+
+    d = fd_get(fd);
+    if (d == NULL)
+    {
+        rt_set_errno(-EBADF);
+
+        return -1;
+    }
+
+    result = dfs_file_pwrite(d, buf, len, offset);
+    fd_put(d);
+
+    if (result < 0)
+    {
+        rt_set_errno(result);
+
+        return -1;
+    }
+
+    return result;
+}
+RTM_EXPORT(pwrite);
+
 /**
  * this function is a POSIX compliant version, which will rename old file name
  * to new file name.
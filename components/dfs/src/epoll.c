@@ -0,0 +1,645 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-01     RT-Thread    the first version
+ */
+#include <stdint.h>
+
+#include <rthw.h>
+#include <rtdevice.h>
+#include <rtthread.h>
+
+#include <dfs.h>
+#include <dfs_file.h>
+#include <dfs_posix.h>
+#include <dfs_poll.h>
+#include <dfs_epoll.h>
+
+struct rt_epitem;
+
+/* one epoll instance, kept in the data of the epoll fd */
+struct rt_eventpoll
+{
+    rt_list_t list;                 /* node in the eventpoll list */
+    struct rt_mutex lock;           /* protect the item list */
+    rt_wqueue_t wait_queue;         /* threads blocked in epoll_wait() */
+
+    rt_list_t items;                /* registered items */
+    rt_list_t rdlist;               /* ready items, filled from the wake callback */
+};
+
+/* one wait-queue registration of an item */
+struct rt_epoll_wait
+{
+    struct rt_wqueue_node wqn;
+    struct rt_epitem *epi;
+    struct rt_epoll_wait *next;
+};
+
+/* one file registered into an epoll instance */
+struct rt_epitem
+{
+    rt_list_t list;                 /* node in ep->items */
+    rt_list_t rdlink;               /* node in ep->rdlist, empty when not ready */
+
+    rt_pollreq_t req;
+    struct rt_eventpoll *ep;
+    struct dfs_fd *file;
+    int fd;
+
+    struct epoll_event event;
+    struct rt_epoll_wait *waits;
+    int error;                      /* -ENOMEM if a wait queue is not registered */
+};
+
+/* lock order: _eventpoll_lock -> ep->lock -> dfs_lock() */
+static struct rt_mutex _eventpoll_lock;
+static rt_list_t _eventpoll_list = RT_LIST_OBJECT_INIT(_eventpoll_list);
+
+static void ep_list_splice(rt_list_t *from, rt_list_t *to)
+{
+    if (!rt_list_isempty(from))
+    {
+        from->next->prev = to->prev;
+        to->prev->next = from->next;
+        from->prev->next = to;
+        to->prev = from->prev;
+
+        rt_list_init(from);
+    }
+}
+
+static int __wqueue_epollwake(struct rt_wqueue_node *wait, void *key)
+{
+    rt_base_t level;
+    struct rt_epitem *epi;
+
+    if (key && !((rt_ubase_t)key & wait->key))
+        return -1;
+
+    epi = rt_container_of(wait, struct rt_epoll_wait, wqn)->epi;
+
+    level = rt_hw_interrupt_disable();
+    if (rt_list_isempty(&epi->rdlink))
+        rt_list_insert_before(&(epi->ep->rdlist), &(epi->rdlink));
+    rt_hw_interrupt_enable(level);
+
+    rt_wqueue_wakeup(&(epi->ep->wait_queue), key);
+
+    /* keep the registration in the wait queue of the file */
+    return -1;
+}
+
+static void _ep_poll_add(rt_wqueue_t *wq, rt_pollreq_t *req)
+{
+    struct rt_epitem *epi;
+    struct rt_epoll_wait *ew;
+
+    epi = rt_container_of(req, struct rt_epitem, req);
+
+    ew = (struct rt_epoll_wait *)rt_malloc(sizeof(struct rt_epoll_wait));
+    if (ew == RT_NULL)
+    {
+        epi->error = -ENOMEM;
+        return;
+    }
+
+    ew->wqn.key = req->_key;
+    rt_list_init(&(ew->wqn.list));
+    ew->wqn.polling_thread = RT_NULL;
+    ew->wqn.wakeup = __wqueue_epollwake;
+    ew->epi = epi;
+    ew->next = epi->waits;
+    epi->waits = ew;
+    rt_wqueue_add(wq, &ew->wqn);
+}
+
+static int ep_item_poll(struct rt_epitem *epi, poll_queue_proc proc)
+{
+    int mask;
+
+    epi->req._proc = proc;
+    epi->req._key = epi->event.events | POLLERR | POLLHUP;
+
+    mask = POLLMASK_DEFAULT;
+    if (epi->file->fops->poll)
+        mask = epi->file->fops->poll(epi->file, &epi->req);
+
+    epi->req._proc = RT_NULL;
+
+    return mask & (epi->event.events | POLLERR | POLLHUP);
+}
+
+static void ep_item_ready(struct rt_epitem *epi)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    if (rt_list_isempty(&epi->rdlink))
+        rt_list_insert_before(&(epi->ep->rdlist), &(epi->rdlink));
+    rt_hw_interrupt_enable(level);
+}
+
+static void ep_item_unregister(struct rt_epitem *epi)
+{
+    struct rt_epoll_wait *ew, *next;
+    rt_base_t level;
+
+    next = epi->waits;
+    while (next)
+    {
+        ew = next;
+        rt_wqueue_remove(&ew->wqn);
+        next = ew->next;
+        rt_free(ew);
+    }
+    epi->waits = RT_NULL;
+
+    level = rt_hw_interrupt_disable();
+    rt_list_remove(&epi->rdlink);
+    rt_hw_interrupt_enable(level);
+}
+
+static void ep_item_free(struct rt_epitem *epi)
+{
+    ep_item_unregister(epi);
+    rt_list_remove(&epi->list);
+
+    fd_put(epi->file);
+    rt_free(epi);
+}
+
+static struct rt_epitem *ep_item_find(struct rt_eventpoll *ep, int fd)
+{
+    struct rt_list_node *node;
+    struct rt_epitem *epi;
+
+    for (node = ep->items.next; node != &(ep->items); node = node->next)
+    {
+        epi = rt_list_entry(node, struct rt_epitem, list);
+        if (epi->fd == fd)
+            return epi;
+    }
+
+    return RT_NULL;
+}
+
+static int ep_insert(struct rt_eventpoll *ep, int fd, struct epoll_event *event)
+{
+    struct rt_epitem *epi;
+    struct dfs_fd *file;
+
+    file = fd_get(fd);
+    if (file == RT_NULL)
+        return -EBADF;
+
+    epi = (struct rt_epitem *)rt_calloc(1, sizeof(struct rt_epitem));
+    if (epi == RT_NULL)
+    {
+        fd_put(file);
+        return -ENOMEM;
+    }
+
+    rt_list_init(&epi->list);
+    rt_list_init(&epi->rdlink);
+    epi->ep = ep;
+    epi->file = file;
+    epi->fd = fd;
+    epi->event = *event;
+    rt_list_insert_before(&ep->items, &epi->list);
+
+    /* register into the wait queues of the file once for all */
+    if (ep_item_poll(epi, _ep_poll_add))
+        ep_item_ready(epi);
+
+    /* the item is never waked without all of its wait queues */
+    if (epi->error)
+    {
+        int error = epi->error;
+
+        ep_item_free(epi);
+        return error;
+    }
+
+    return 0;
+}
+
+static int ep_modify(struct rt_epitem *epi, struct epoll_event *event)
+{
+    struct rt_epoll_wait *ew;
+
+    epi->event = *event;
+    for (ew = epi->waits; ew != RT_NULL; ew = ew->next)
+        ew->wqn.key = event->events | POLLERR | POLLHUP;
+
+    if (ep_item_poll(epi, RT_NULL))
+        ep_item_ready(epi);
+
+    return 0;
+}
+
+static int ep_send_events(struct rt_eventpoll *ep, struct epoll_event *events, int maxevents)
+{
+    int num = 0;
+    int mask;
+    rt_base_t level;
+    rt_list_t txlist, relist;
+    struct rt_epitem *epi;
+
+    rt_list_init(&txlist);
+    rt_list_init(&relist);
+
+    level = rt_hw_interrupt_disable();
+    ep_list_splice(&ep->rdlist, &txlist);
+    rt_hw_interrupt_enable(level);
+
+    while (num < maxevents)
+    {
+        level = rt_hw_interrupt_disable();
+        if (rt_list_isempty(&txlist))
+        {
+            rt_hw_interrupt_enable(level);
+            break;
+        }
+        epi = rt_list_entry(txlist.next, struct rt_epitem, rdlink);
+        rt_list_remove(&epi->rdlink);
+        rt_hw_interrupt_enable(level);
+
+        /* disarmed by EPOLLONESHOT, wait for EPOLL_CTL_MOD */
+        if (epi->event.events == 0)
+            continue;
+
+        /* the ready list is only a hint, ask the file for the real state */
+        mask = ep_item_poll(epi, RT_NULL);
+        if (mask == 0)
+            continue;
+
+        events[num].events = mask;
+        events[num].data = epi->event.data;
+        num ++;
+
+        if (epi->event.events & EPOLLONESHOT)
+        {
+            epi->event.events = 0;
+        }
+        else if (!(epi->event.events & EPOLLET))
+        {
+            /* level-triggered: report it again until the file is drained */
+            level = rt_hw_interrupt_disable();
+            if (rt_list_isempty(&epi->rdlink))
+                rt_list_insert_before(&relist, &epi->rdlink);
+            rt_hw_interrupt_enable(level);
+        }
+    }
+
+    level = rt_hw_interrupt_disable();
+    ep_list_splice(&txlist, &ep->rdlist);
+    ep_list_splice(&relist, &ep->rdlist);
+    rt_hw_interrupt_enable(level);
+
+    return num;
+}
+
+static int epoll_fops_close(struct dfs_fd *fd)
+{
+    struct rt_eventpoll *ep;
+
+    ep = (struct rt_eventpoll *)fd->data;
+    if (ep == RT_NULL)
+        return 0;
+
+    rt_mutex_take(&_eventpoll_lock, RT_WAITING_FOREVER);
+    rt_list_remove(&ep->list);
+    rt_mutex_release(&_eventpoll_lock);
+
+    rt_mutex_take(&ep->lock, RT_WAITING_FOREVER);
+    while (!rt_list_isempty(&ep->items))
+    {
+        ep_item_free(rt_list_entry(ep->items.next, struct rt_epitem, list));
+    }
+    rt_mutex_release(&ep->lock);
+
+    rt_mutex_detach(&ep->lock);
+    rt_free(ep);
+    fd->data = RT_NULL;
+
+    return 0;
+}
+
+static int epoll_fops_poll(struct dfs_fd *fd, struct rt_pollreq *req)
+{
+    int mask = 0;
+    struct rt_eventpoll *ep;
+
+    ep = (struct rt_eventpoll *)fd->data;
+
+    rt_poll_add(&ep->wait_queue, req);
+    if (!rt_list_isempty(&ep->rdlist))
+        mask |= POLLIN;
+
+    return mask;
+}
+
+static const struct dfs_file_ops _epoll_fops =
+{
+    RT_NULL,    /* open     */
+    epoll_fops_close,
+    RT_NULL,    /* ioctl    */
+    RT_NULL,    /* read     */
+    RT_NULL,    /* write    */
+    RT_NULL,    /* flush    */
+    RT_NULL,    /* lseek    */
+    RT_NULL,    /* getdents */
+    epoll_fops_poll,
+};
+
+static struct rt_eventpoll *ep_get(int epfd, struct dfs_fd **file)
+{
+    struct dfs_fd *d;
+
+    d = fd_get(epfd);
+    if (d == RT_NULL)
+        return RT_NULL;
+
+    if (d->fops != &_epoll_fops)
+    {
+        fd_put(d);
+        return RT_NULL;
+    }
+
+    *file = d;
+    return (struct rt_eventpoll *)d->data;
+}
+
+/**
+ * this function will create an epoll instance.
+ *
+ * @param flags EPOLL_CLOEXEC is accepted and ignored.
+ *
+ * @return the epoll file descriptor on successful, -1 on failed.
+ */
+int epoll_create1(int flags)
+{
+    int fd;
+    struct dfs_fd *d;
+    struct rt_eventpoll *ep;
+
+    if (flags & ~EPOLL_CLOEXEC)
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+
+    ep = (struct rt_eventpoll *)rt_malloc(sizeof(struct rt_eventpoll));
+    if (ep == RT_NULL)
+    {
+        rt_set_errno(-ENOMEM);
+        return -1;
+    }
+
+    rt_list_init(&ep->list);
+    rt_list_init(&ep->items);
+    rt_list_init(&ep->rdlist);
+    rt_wqueue_init(&ep->wait_queue);
+    rt_mutex_init(&ep->lock, "epoll", RT_IPC_FLAG_FIFO);
+
+    fd = fd_new();
+    if (fd < 0)
+    {
+        rt_mutex_detach(&ep->lock);
+        rt_free(ep);
+        rt_set_errno(-ENOMEM);
+        return -1;
+    }
+
+    d = fd_get(fd);
+    d->type = FT_USER;
+    d->path = RT_NULL;
+    d->fops = &_epoll_fops;
+    d->flags = O_RDWR;
+    d->size = 0;
+    d->pos = 0;
+    d->data = ep;
+
+    rt_mutex_take(&_eventpoll_lock, RT_WAITING_FOREVER);
+    rt_list_insert_after(&_eventpoll_list, &ep->list);
+    rt_mutex_release(&_eventpoll_lock);
+
+    /* release the ref-count of fd */
+    fd_put(d);
+
+    return fd;
+}
+RTM_EXPORT(epoll_create1);
+
+/**
+ * this function will create an epoll instance.
+ *
+ * @param size the hint of the number of files, must be positive.
+ *
+ * @return the epoll file descriptor on successful, -1 on failed.
+ */
+int epoll_create(int size)
+{
+    if (size <= 0)
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+
+    return epoll_create1(0);
+}
+RTM_EXPORT(epoll_create);
+
+/**
+ * this function will add, modify or remove a file in an epoll instance. The
+ * registration is kept in the wait queues of the file until it is removed,
+ * so epoll_wait() doesn't need to visit every file on each wakeup.
+ *
+ * @param epfd the epoll file descriptor.
+ * @param op EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL.
+ * @param fd the target file descriptor.
+ * @param event the events to watch, EPOLLET and EPOLLONESHOT are supported.
+ *
+ * @return 0 on successful, -1 on failed.
+ */
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    int result = 0;
+    struct dfs_fd *d;
+    struct rt_eventpoll *ep;
+    struct rt_epitem *epi;
+
+    if (epfd == fd)
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+
+    if (op != EPOLL_CTL_DEL && event == RT_NULL)
+    {
+        rt_set_errno(-EFAULT);
+        return -1;
+    }
+
+    ep = ep_get(epfd, &d);
+    if (ep == RT_NULL)
+    {
+        rt_set_errno(-EBADF);
+        return -1;
+    }
+
+    rt_mutex_take(&ep->lock, RT_WAITING_FOREVER);
+
+    epi = ep_item_find(ep, fd);
+    switch (op)
+    {
+    case EPOLL_CTL_ADD:
+        if (epi)
+            result = -EEXIST;
+        else
+            result = ep_insert(ep, fd, event);
+        break;
+
+    case EPOLL_CTL_MOD:
+        if (epi)
+            result = ep_modify(epi, event);
+        else
+            result = -ENOENT;
+        break;
+
+    case EPOLL_CTL_DEL:
+        if (epi)
+            ep_item_free(epi);
+        else
+            result = -ENOENT;
+        break;
+
+    default:
+        result = -EINVAL;
+        break;
+    }
+
+    rt_mutex_release(&ep->lock);
+    fd_put(d);
+
+    if (result < 0)
+    {
+        rt_set_errno(result);
+        return -1;
+    }
+
+    return 0;
+}
+RTM_EXPORT(epoll_ctl);
+
+/**
+ * this function will wait for events on an epoll instance.
+ *
+ * @param epfd the epoll file descriptor.
+ * @param events the buffer to save the ready events.
+ * @param maxevents the maximal number of events.
+ * @param timeout the timeout in millisecond, -1 for waiting forever.
+ *
+ * @return the number of ready files, 0 on timeout and -1 on failed.
+ */
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    int num;
+    rt_base_t level;
+    rt_tick_t start, delta, tick;
+    struct dfs_fd *d;
+    struct rt_eventpoll *ep;
+
+    if (events == RT_NULL || maxevents <= 0)
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+
+    ep = ep_get(epfd, &d);
+    if (ep == RT_NULL)
+    {
+        rt_set_errno(-EBADF);
+        return -1;
+    }
+
+    tick = rt_tick_from_millisecond(timeout);
+    start = rt_tick_get();
+
+    while (1)
+    {
+        /* any wakeup after this point makes rt_wqueue_wait() return at once */
+        level = rt_hw_interrupt_disable();
+        ep->wait_queue.flag = RT_WQ_FLAG_CLEAN;
+        rt_hw_interrupt_enable(level);
+
+        rt_mutex_take(&ep->lock, RT_WAITING_FOREVER);
+        num = ep_send_events(ep, events, maxevents);
+        rt_mutex_release(&ep->lock);
+
+        if (num || timeout == 0)
+            break;
+
+        if (timeout > 0)
+        {
+            int msec;
+
+            delta = rt_tick_get() - start;
+            if (delta >= tick)
+                break;
+
+            msec = (int)((tick - delta) * 1000 / RT_TICK_PER_SECOND);
+            rt_wqueue_wait(&ep->wait_queue, 0, msec > 0 ? msec : 1);
+        }
+        else
+        {
+            rt_wqueue_wait(&ep->wait_queue, 0, -1);
+        }
+    }
+
+    fd_put(d);
+
+    return num;
+}
+RTM_EXPORT(epoll_wait);
+
+void dfs_epoll_fd_release(struct dfs_fd *fd)
+{
+    struct rt_list_node *node, *n;
+    struct rt_eventpoll *ep;
+    struct rt_epitem *epi;
+
+    if (rt_list_isempty(&_eventpoll_list))
+        return;
+
+    rt_mutex_take(&_eventpoll_lock, RT_WAITING_FOREVER);
+    for (node = _eventpoll_list.next; node != &_eventpoll_list; node = node->next)
+    {
+        ep = rt_list_entry(node, struct rt_eventpoll, list);
+
+        rt_mutex_take(&ep->lock, RT_WAITING_FOREVER);
+        for (n = ep->items.next; n != &(ep->items); )
+        {
+            epi = rt_list_entry(n, struct rt_epitem, list);
+            n = n->next;
+
+            if (epi->file == fd)
+                ep_item_free(epi);
+        }
+        rt_mutex_release(&ep->lock);
+    }
+    rt_mutex_release(&_eventpoll_lock);
+}
+
+int dfs_epoll_init(void)
+{
+    rt_mutex_init(&_eventpoll_lock, "eplock", RT_IPC_FLAG_FIFO);
+
+    return 0;
+}
+INIT_PREV_EXPORT(dfs_epoll_init);
@@ -7,6 +7,8 @@
  * Date           Author       Notes
  * 2017-05-09     Urey         first version
  * 2019-07-09     Zero-Free    improve device ops interface and data flows
+ * 2019-10-14     RT-Thread    add the period ring and mixer of replay
+ * 2019-10-26     RT-Thread    lock the writers of mixer, wake them on stop
  */
 
 #include <stdio.h>
@@ -28,6 +30,205 @@ enum
     REPLAY_EVT_STOP  = 0x02,
 };
 
+#ifdef RT_AUDIO_USING_PERIOD
+#define AUDIO_GAIN_UNITY    0x8000
+
+static rt_uint32_t _audio_ring_len(struct rt_audio_channel *ch)
+{
+    rt_uint32_t put = ch->put_index, get = ch->get_index;
+
+    return put >= get ? put - get : 2 * ch->size + put - get;
+}
+
+static rt_uint32_t _audio_ring_put(struct rt_audio_channel *ch, const rt_uint8_t *data, rt_uint32_t len)
+{
+    rt_uint32_t put = ch->put_index;
+    rt_uint32_t pos = put < ch->size ? put : put - ch->size;
+    rt_uint32_t first;
+
+    len = MIN(len, ch->size - _audio_ring_len(ch));
+    first = MIN(len, ch->size - pos);
+    memcpy(&ch->buffer[pos], data, first);
+    memcpy(&ch->buffer[0], data + first, len - first);
+
+    /* the index is stored once, it is read by interrupt */
+    put += len;
+    ch->put_index = put < 2 * ch->size ? put : put - 2 * ch->size;
+
+    return len;
+}
+
+static rt_uint32_t _audio_ring_get(struct rt_audio_channel *ch, rt_uint8_t *data, rt_uint32_t len)
+{
+    rt_uint32_t get = ch->get_index;
+    rt_uint32_t pos = get < ch->size ? get : get - ch->size;
+    rt_uint32_t first;
+
+    len = MIN(len, _audio_ring_len(ch));
+    first = MIN(len, ch->size - pos);
+    memcpy(data, &ch->buffer[pos], first);
+    memcpy(data + first, &ch->buffer[0], len - first);
+
+    get += len;
+    ch->get_index = get < 2 * ch->size ? get : get - 2 * ch->size;
+
+    return len;
+}
+
+/* the volume and mixing are for 16 bits samples */
+static void _audio_gain(rt_int16_t *data, rt_size_t count, rt_uint32_t gain)
+{
+    rt_size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        data[i] = (rt_int16_t)(((rt_int32_t)data[i] * (rt_int32_t)gain) >> 15);
+    }
+}
+
+static void _audio_mix(rt_int16_t *dst, const rt_int16_t *src, rt_size_t count, rt_uint32_t gain)
+{
+    rt_int32_t value;
+    rt_size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        value = dst[i] + (((rt_int32_t)src[i] * (rt_int32_t)gain) >> 15);
+        if (value > 32767)
+            value = 32767;
+        else if (value < -32768)
+            value = -32768;
+        dst[i] = (rt_int16_t)value;
+    }
+}
+
+/*
+ * It is called by the half and full complete interrupts of DMA, a period of
+ * the hardware buffer is filled by the stream of channel 0, then the other
+ * channels of mixer are mixed in.
+ */
+static rt_err_t _audio_send_replay_frame(struct rt_audio_device *audio)
+{
+    rt_err_t result = RT_EOK;
+    struct rt_audio_replay *replay = audio->replay;
+    struct rt_audio_buf_info *buf_info = &replay->buf_info;
+    struct rt_audio_channel *ch = &replay->channel[0];
+    rt_uint8_t *dst;
+    rt_size_t dst_size, len;
+    rt_bool_t drained;
+    int i;
+
+    dst = &buf_info->buffer[replay->pos];
+    dst_size = buf_info->block_size;
+
+    len = _audio_ring_get(ch, dst, dst_size);
+    drained = (len == 0);
+    if (len < dst_size)
+    {
+        /* send zero frames, the stream has run dry */
+        memset(dst + len, 0, dst_size - len);
+        if (replay->running && !(replay->event & REPLAY_EVT_STOP))
+        {
+            LOG_D("under run %d, remain %d", replay->pos, len);
+            replay->stat.underrun ++;
+        }
+    }
+    replay->running = (len == dst_size);
+    if (len > 0)
+    {
+        if (ch->gain != AUDIO_GAIN_UNITY)
+            _audio_gain((rt_int16_t *)dst, len / 2, ch->gain);
+        rt_completion_done(&ch->cmp);
+
+        /* notify transmitted complete. */
+        if (audio->parent.tx_complete != RT_NULL)
+            audio->parent.tx_complete(&audio->parent, RT_NULL);
+    }
+
+    for (i = 1; i < RT_AUDIO_MIXER_CHANNELS; i++)
+    {
+        ch = &replay->channel[i];
+        len = _audio_ring_get(ch, (rt_uint8_t *)replay->mix, dst_size);
+        if (len > 0)
+        {
+            _audio_mix((rt_int16_t *)dst, replay->mix, len / 2, ch->gain);
+            rt_completion_done(&ch->cmp);
+            drained = RT_FALSE;
+        }
+    }
+    replay->stat.periods ++;
+
+    /* ack stop event */
+    if ((replay->event & REPLAY_EVT_STOP) && drained)
+        rt_completion_done(&replay->cmp);
+
+    if (audio->ops->transmit != RT_NULL)
+    {
+        if (audio->ops->transmit(audio, dst, RT_NULL, dst_size) != dst_size)
+            result = -RT_ERROR;
+    }
+
+    replay->pos += dst_size;
+    replay->pos %= buf_info->total_size;
+
+    return result;
+}
+
+static rt_err_t _audio_period_init(struct rt_audio_device *audio)
+{
+    struct rt_audio_replay *replay = audio->replay;
+    struct rt_audio_channel *ch;
+    int i;
+
+    /* the rings are made of the periods of hardware buffer */
+    if (replay->buf_info.buffer == RT_NULL || replay->buf_info.block_size == 0)
+    {
+        LOG_E("no buffer information of replay");
+        return -RT_EINVAL;
+    }
+
+    for (i = 0; i < RT_AUDIO_MIXER_CHANNELS; i++)
+    {
+        ch = &replay->channel[i];
+        ch->size = RT_AUDIO_REPLAY_PERIOD_COUNT * replay->buf_info.block_size;
+        ch->buffer = rt_malloc(ch->size);
+        if (ch->buffer == RT_NULL)
+        {
+            LOG_E("malloc memory for replay ring failed");
+            goto __exit;
+        }
+        ch->gain = AUDIO_GAIN_UNITY;
+        rt_completion_init(&ch->cmp);
+        rt_mutex_init(&ch->lock, "replay", RT_IPC_FLAG_PRIO);
+    }
+
+    if (RT_AUDIO_MIXER_CHANNELS > 1)
+    {
+        replay->mix = rt_malloc(replay->buf_info.block_size);
+        if (replay->mix == RT_NULL)
+        {
+            LOG_E("malloc memory for mixer failed");
+            goto __exit;
+        }
+    }
+
+    return RT_EOK;
+
+__exit:
+    for (i = 0; i < RT_AUDIO_MIXER_CHANNELS; i++)
+    {
+        ch = &replay->channel[i];
+        if (ch->buffer != RT_NULL)
+        {
+            rt_mutex_detach(&ch->lock);
+            rt_free(ch->buffer);
+            ch->buffer = RT_NULL;
+        }
+    }
+
+    return -RT_ENOMEM;
+}
+#else
 static rt_err_t _audio_send_replay_frame(struct rt_audio_device *audio)
 {
     rt_err_t result = RT_EOK;
@@ -67,6 +268,7 @@ static rt_err_t _audio_send_replay_frame(struct rt_audio_device *audio)
             if (result != RT_EOK)
             {
                 LOG_D("under run %d, remain %d", audio->replay->pos, remain_bytes);
+                audio->replay->stat.underrun ++;
                 audio->replay->pos -= remain_bytes;
                 audio->replay->pos += dst_size;
                 audio->replay->pos %= buf_info->total_size;
@@ -98,6 +300,8 @@ static rt_err_t _audio_send_replay_frame(struct rt_audio_device *audio)
         }
     }
 
+    audio->replay->stat.periods ++;
+
     if (audio->ops->transmit != RT_NULL)
     {
         if (audio->ops->transmit(audio, &buf_info->buffer[position], RT_NULL, dst_size) != dst_size)
@@ -123,11 +327,14 @@ static rt_err_t _audio_flush_replay_frame(struct rt_audio_device *audio)
 
     return result;
 }
+#endif /* RT_AUDIO_USING_PERIOD */
 
 static rt_err_t _aduio_replay_start(struct rt_audio_device *audio)
 {
     rt_err_t result = RT_EOK;
 
+    /* the writers of mixer start the replay, once */
+    rt_mutex_take(&audio->replay->lock, RT_WAITING_FOREVER);
     if (audio->replay->activated != RT_TRUE)
     {
         /* start playback hardware device */
@@ -137,6 +344,7 @@ static rt_err_t _aduio_replay_start(struct rt_audio_device *audio)
         audio->replay->activated = RT_TRUE;
         LOG_D("start audio replay device");
     }
+    rt_mutex_release(&audio->replay->lock);
 
     return result;
 }
@@ -145,10 +353,13 @@ static rt_err_t _aduio_replay_stop(struct rt_audio_device *audio)
 {
     rt_err_t result = RT_EOK;
 
+    rt_mutex_take(&audio->replay->lock, RT_WAITING_FOREVER);
     if (audio->replay->activated == RT_TRUE)
     {
+#ifndef RT_AUDIO_USING_PERIOD
         /* flush replay remian frames */
         _audio_flush_replay_frame(audio);
+#endif
 
         /* notify irq(or thread) to stop the data transmission */
         audio->replay->event |= REPLAY_EVT_STOP;
@@ -156,19 +367,74 @@ static rt_err_t _aduio_replay_stop(struct rt_audio_device *audio)
         /* waiting for the remaining data transfer to complete */
         rt_completion_init(&audio->replay->cmp);
         rt_completion_wait(&audio->replay->cmp, RT_WAITING_FOREVER);
-        audio->replay->event &= ~REPLAY_EVT_STOP;
 
         /* stop playback hardware device */
         if (audio->ops->stop)
             result = audio->ops->stop(audio, AUDIO_STREAM_REPLAY);
 
         audio->replay->activated = RT_FALSE;
+        audio->replay->event &= ~REPLAY_EVT_STOP;
+#ifdef RT_AUDIO_USING_PERIOD
+        {
+            int i;
+
+            /* the writers waiting for the rings are not waked by the hardware any more */
+            for (i = 0; i < RT_AUDIO_MIXER_CHANNELS; i++)
+                rt_completion_done(&audio->replay->channel[i].cmp);
+        }
+#endif
         LOG_D("stop audio replay device");
     }
+    rt_mutex_release(&audio->replay->lock);
 
     return result;
 }
 
+#ifdef RT_AUDIO_USING_PERIOD
+static rt_size_t _audio_channel_write(struct rt_audio_device *audio, struct rt_audio_channel *ch,
+                                      const rt_uint8_t *ptr, rt_size_t size)
+{
+    struct rt_audio_replay *replay = audio->replay;
+    rt_bool_t stopped = RT_FALSE;
+    rt_size_t index = 0;
+
+    /* the ring has one writer at a time */
+    rt_mutex_take(&ch->lock, RT_WAITING_FOREVER);
+    while (index < size)
+    {
+        /* the rings are drained by the stop, nothing is put */
+        if (replay->event & REPLAY_EVT_STOP)
+        {
+            stopped = RT_TRUE;
+            break;
+        }
+
+        index += _audio_ring_put(ch, &ptr[index], size - index);
+        if (index < size)
+        {
+            /* the ring is full, the hardware must run to make space */
+            if (replay->activated != RT_TRUE)
+                _aduio_replay_start(audio);
+            rt_completion_wait(&ch->cmp, RT_WAITING_FOREVER);
+
+            /* waked by the stop */
+            if (replay->activated != RT_TRUE)
+            {
+                stopped = RT_TRUE;
+                break;
+            }
+        }
+    }
+    rt_mutex_release(&ch->lock);
+
+    /* check replay state */
+    if (!stopped && replay->activated != RT_TRUE)
+        _aduio_replay_start(audio);
+
+    return index;
+}
+#endif /* RT_AUDIO_USING_PERIOD */
+
 static rt_err_t _audio_record_start(struct rt_audio_device *audio)
 {
     rt_err_t result = RT_EOK;
@@ -230,6 +496,7 @@ static rt_err_t _audio_dev_init(struct rt_device *dev)
             return -RT_ENOMEM;
         memset(replay, 0, sizeof(struct rt_audio_replay));
 
+#ifndef RT_AUDIO_USING_PERIOD
         /* init memory pool for replay */
         replay->mp = rt_mp_create("adu_mp", RT_AUDIO_REPLAY_MP_BLOCK_COUNT, RT_AUDIO_REPLAY_MP_BLOCK_SIZE);
         if (replay->mp == RT_NULL)
@@ -241,6 +508,7 @@ static rt_err_t _audio_dev_init(struct rt_device *dev)
 
         /* init queue for audio replay */
         rt_data_queue_init(&replay->queue, CFG_AUDIO_REPLAY_QUEUE_COUNT, 0, RT_NULL);
+#endif
 
         /* init mutex lock for audio replay */
         rt_mutex_init(&replay->lock, "replay", RT_IPC_FLAG_PRIO);
@@ -284,6 +552,20 @@ static rt_err_t _audio_dev_init(struct rt_device *dev)
     if (audio->ops->buffer_info)
         audio->ops->buffer_info(audio, &audio->replay->buf_info);
 
+#ifdef RT_AUDIO_USING_PERIOD
+    /* the rings of replay are made of the periods of hardware buffer */
+    if (audio->replay != RT_NULL)
+    {
+        result = _audio_period_init(audio);
+        if (result != RT_EOK)
+        {
+            rt_mutex_detach(&audio->replay->lock);
+            rt_free(audio->replay);
+            audio->replay = RT_NULL;
+        }
+    }
+#endif
+
     return result;
 }
 
@@ -313,6 +595,19 @@ static rt_err_t _audio_dev_open(struct rt_device *dev, rt_uint16_t oflag)
             audio->replay->read_index = 0;
             audio->replay->pos = 0;
             audio->replay->event = REPLAY_EVT_NONE;
+            memset(&audio->replay->stat, 0, sizeof(struct rt_audio_replay_stat));
+#ifdef RT_AUDIO_USING_PERIOD
+            {
+                int i;
+
+                for (i = 0; i < RT_AUDIO_MIXER_CHANNELS; i++)
+                {
+                    audio->replay->channel[i].put_index = 0;
+                    audio->replay->channel[i].get_index = 0;
+                }
+                audio->replay->running = RT_FALSE;
+            }
+#endif
         }
         dev->open_flag |= RT_DEVICE_OFLAG_WRONLY;
     }
@@ -368,6 +663,24 @@ static rt_size_t _audio_dev_read(struct rt_device *dev, rt_off_t pos, void *buff
     return rt_device_read(RT_DEVICE(&audio->record->pipe), pos, buffer, size);
 }
 
+#ifdef RT_AUDIO_USING_PERIOD
+static rt_size_t _audio_dev_write(struct rt_device *dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    struct rt_audio_device *audio;
+    rt_size_t index;
+
+    RT_ASSERT(dev != RT_NULL);
+    audio = (struct rt_audio_device *) dev;
+
+    if (!(dev->open_flag & RT_DEVICE_OFLAG_WRONLY) || (audio->replay == RT_NULL))
+        return 0;
+
+    /* the stream is the channel 0 of mixer */
+    index = _audio_channel_write(audio, &audio->replay->channel[0], (const rt_uint8_t *)buffer, size);
+
+    return index;
+}
+#else
 static rt_size_t _audio_dev_write(struct rt_device *dev, rt_off_t pos, const void *buffer, rt_size_t size)
 {
 
@@ -422,6 +735,7 @@ static rt_size_t _audio_dev_write(struct rt_device *dev, rt_off_t pos, const voi
 
     return index;
 }
+#endif /* RT_AUDIO_USING_PERIOD */
 
 static rt_err_t _audio_dev_control(struct rt_device *dev, int cmd, void *args)
 {
@@ -493,6 +807,23 @@ static rt_err_t _audio_dev_control(struct rt_device *dev, int cmd, void *args)
         break;
     }
 
+    case AUDIO_CTL_GETSTAT:
+    {
+        struct rt_audio_replay_stat *stat = (struct rt_audio_replay_stat *) args;
+
+        if (audio->replay == RT_NULL || stat == RT_NULL)
+        {
+            result = -RT_EINVAL;
+            break;
+        }
+        *stat = audio->replay->stat;
+#ifdef RT_AUDIO_USING_PERIOD
+        stat->queued = _audio_ring_len(&audio->replay->channel[0]);
+#endif
+
+        break;
+    }
+
     default:
         break;
     }
@@ -610,3 +941,38 @@ void rt_audio_rx_done(struct rt_audio_device *audio, rt_uint8_t *pbuf, rt_size_t
     if (audio->parent.rx_indicate != RT_NULL)
         audio->parent.rx_indicate(&audio->parent, len);
 }
+
+#ifdef RT_AUDIO_USING_PERIOD
+/*
+ * write a source of mixer, the channel 0 is written by rt_device_write(). It
+ * returns less than size if the replay is stopped while it's waiting.
+ */
+rt_size_t rt_audio_mixer_write(struct rt_audio_device *audio, int channel, const void *buffer, rt_size_t size)
+{
+    RT_ASSERT(audio != RT_NULL);
+
+    if (channel < 0 || channel >= RT_AUDIO_MIXER_CHANNELS || audio->replay == RT_NULL)
+        return 0;
+    if (!(audio->parent.open_flag & RT_DEVICE_OFLAG_WRONLY))
+        return 0;
+
+    return _audio_channel_write(audio, &audio->replay->channel[channel], (const rt_uint8_t *)buffer, size);
+}
+
+/* set the volume of a source, AUDIO_VOLUME_MIN ~ AUDIO_VOLUME_MAX */
+rt_err_t rt_audio_mixer_volume(struct rt_audio_device *audio, int channel, int volume)
+{
+    RT_ASSERT(audio != RT_NULL);
+
+    if (channel < 0 || channel >= RT_AUDIO_MIXER_CHANNELS || audio->replay == RT_NULL)
+        return -RT_EINVAL;
+
+    if (volume > AUDIO_VOLUME_MAX)
+        volume = AUDIO_VOLUME_MAX;
+    if (volume < AUDIO_VOLUME_MIN)
+        volume = AUDIO_VOLUME_MIN;
+    audio->replay->channel[channel].gain = volume * AUDIO_GAIN_UNITY / AUDIO_VOLUME_MAX;
+
+    return RT_EOK;
+}
+#endif /* RT_AUDIO_USING_PERIOD */
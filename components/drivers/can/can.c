@@ -7,6 +7,8 @@
  * Date           Author            Notes
  * 2015-05-14     aubrcool@qq.com   first version
  * 2015-07-06     Bernard           code cleanup and remove RT_CAN_USING_LED;
+ * 2019-10-03     RT-Thread         rx ring of messages, hash of software filters
+ *                                  and batch read.
  */
 
 #include <rthw.h>
@@ -16,6 +18,171 @@
 #define CAN_LOCK(can)   rt_mutex_take(&(can->lock), RT_WAITING_FOREVER)
 #define CAN_UNLOCK(can) rt_mutex_release(&(can->lock))
 
+/* the messages copied out in one critical section of read */
+#ifndef RT_CAN_RX_BATCH
+#define RT_CAN_RX_BATCH 8
+#endif
+
+/*
+ * rx fifo, the ISR is the only producer and the reader (with interrupt
+ * disabled) is the only consumer. The message is dropped when it is full.
+ */
+static struct rt_can_rx_fifo *_can_fifo_create(rt_uint32_t msgboxsz)
+{
+    rt_uint32_t size = 1;
+    struct rt_can_rx_fifo *fifo;
+
+    while (size < msgboxsz) size <<= 1;
+
+    fifo = (struct rt_can_rx_fifo *) rt_malloc(sizeof(struct rt_can_rx_fifo) +
+            size * sizeof(struct rt_can_msg));
+    if (fifo == RT_NULL) return RT_NULL;
+
+    fifo->buffer = (struct rt_can_msg *)(fifo + 1);
+    fifo->size = size;
+    fifo->put_index = 0;
+    fifo->get_index = 0;
+
+    return fifo;
+}
+
+rt_inline rt_uint32_t _can_fifo_len(struct rt_can_rx_fifo *fifo)
+{
+    return fifo->put_index - fifo->get_index;
+}
+
+rt_inline rt_bool_t _can_fifo_put(struct rt_can_rx_fifo *fifo, const struct rt_can_msg *msg)
+{
+    rt_uint32_t put_index = fifo->put_index;
+
+    if (put_index - fifo->get_index >= fifo->size)
+        return RT_FALSE;
+
+    fifo->buffer[put_index & (fifo->size - 1)] = *msg;
+    /* publish the message after it is written */
+    fifo->put_index = put_index + 1;
+
+    return RT_TRUE;
+}
+
+rt_inline rt_bool_t _can_fifo_get(struct rt_can_rx_fifo *fifo, struct rt_can_msg *msg)
+{
+    rt_uint32_t get_index = fifo->get_index;
+
+    if (fifo->put_index == get_index)
+        return RT_FALSE;
+
+    *msg = fifo->buffer[get_index & (fifo->size - 1)];
+    fifo->get_index = get_index + 1;
+
+    return RT_TRUE;
+}
+
+#ifdef RT_CAN_USING_HDR
+/*
+ * software filter, for the messages which are not matched by hardware
+ * (hdr out of range). The items which match one id are hashed by the id,
+ * the others (mask) are linked in the last bucket and matched one by one.
+ */
+rt_inline rt_uint32_t _can_filter_hash(rt_uint32_t id, rt_uint32_t ide)
+{
+    id ^= (id >> 11) ^ (id >> 22);
+    return (id ^ (ide << 3)) & (RT_CAN_FILTER_HASH_SZ - 1);
+}
+
+static rt_uint32_t _can_filter_bucket(const struct rt_can_filter_item *item)
+{
+    rt_uint32_t idmask = item->ide ? 0x1FFFFFFF : 0x7FF;
+
+    /* mode 1 is list mode, the id is matched exactly */
+    if (item->mode || (item->mask & idmask) == idmask)
+        return _can_filter_hash(item->id, item->ide);
+
+    return RT_CAN_FILTER_HASH_SZ;
+}
+
+rt_inline rt_bool_t _can_filter_item_match(const struct rt_can_filter_item *item,
+                                           const struct rt_can_msg *msg)
+{
+    rt_uint32_t idmask = item->ide ? 0x1FFFFFFF : 0x7FF;
+
+    if (item->ide != msg->ide || item->rtr != msg->rtr)
+        return RT_FALSE;
+    /* the mask is not used in list mode, see rt_can_filter_item */
+    if (!item->mode)
+        idmask &= item->mask;
+
+    return ((item->id ^ msg->id) & idmask) == 0;
+}
+
+static rt_int32_t _can_filter_match(struct rt_can_device *can, const struct rt_can_msg *msg)
+{
+    rt_int32_t hdr;
+
+    for (hdr = can->hdr_hash[_can_filter_hash(msg->id, msg->ide)]; hdr >= 0; hdr = can->hdr[hdr].next)
+    {
+        if (_can_filter_item_match(&can->hdr[hdr].filter, msg))
+            return hdr;
+    }
+    for (hdr = can->hdr_hash[RT_CAN_FILTER_HASH_SZ]; hdr >= 0; hdr = can->hdr[hdr].next)
+    {
+        if (_can_filter_item_match(&can->hdr[hdr].filter, msg))
+            return hdr;
+    }
+
+    return -1;
+}
+
+static rt_err_t _can_hdr_connect(struct rt_can_device *can, const struct rt_can_filter_item *item)
+{
+    struct rt_can_hdr *phdr = &can->hdr[item->hdr];
+    struct rt_can_rx_fifo *fifo;
+    rt_int8_t *bucket;
+    rt_base_t level;
+
+    fifo = _can_fifo_create(can->config.msgboxsz);
+    if (fifo == RT_NULL)
+        return -RT_ENOMEM;
+
+    rt_memcpy(&phdr->filter, item, sizeof(struct rt_can_filter_item));
+    bucket = &can->hdr_hash[_can_filter_bucket(item)];
+
+    level = rt_hw_interrupt_disable();
+    phdr->fifo = fifo;
+    phdr->next = *bucket;
+    *bucket = item->hdr;
+    phdr->connected = 1;
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+static void _can_hdr_disconnect(struct rt_can_device *can, rt_int32_t hdr)
+{
+    struct rt_can_hdr *phdr = &can->hdr[hdr];
+    struct rt_can_rx_fifo *fifo;
+    rt_int8_t *link;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    for (link = &can->hdr_hash[_can_filter_bucket(&phdr->filter)]; *link >= 0; link = &can->hdr[*link].next)
+    {
+        if (*link == hdr)
+        {
+            *link = phdr->next;
+            break;
+        }
+    }
+    phdr->connected = 0;
+    fifo = phdr->fifo;
+    phdr->fifo = RT_NULL;
+    rt_hw_interrupt_enable(level);
+
+    rt_free(fifo);
+    rt_memset(&phdr->filter, 0, sizeof(struct rt_can_filter_item));
+}
+#endif /*RT_CAN_USING_HDR*/
+
 static rt_err_t rt_can_init(struct rt_device *dev)
 {
     rt_err_t result = RT_EOK;
@@ -38,85 +205,67 @@ static rt_err_t rt_can_init(struct rt_device *dev)
 /*
  * can interrupt routines
  */
+/* the fifo to read for the hdr of message, called with interrupt disabled */
+rt_inline struct rt_can_rx_fifo *_can_rx_fifo(struct rt_can_device *can, struct rt_can_msg *data)
+{
+    struct rt_can_rx_fifo *rx_fifo = (struct rt_can_rx_fifo *) can->can_rx;
+#ifdef RT_CAN_USING_HDR
+    rt_int8_t hdr = data->hdr;
+    rt_int32_t i;
+
+    if (hdr >= 0)
+    {
+        if (can->hdr && hdr < can->config.maxhdr && can->hdr[hdr].connected)
+            return can->hdr[hdr].fifo;
+        return RT_NULL;
+    }
+
+    /* hdr -1 reads any message, the unfiltered ones first */
+    if (_can_fifo_len(rx_fifo) == 0 && can->hdr != RT_NULL)
+    {
+        for (i = 0; i < can->config.maxhdr; i++)
+        {
+            if (can->hdr[i].connected && _can_fifo_len(can->hdr[i].fifo))
+                return can->hdr[i].fifo;
+        }
+    }
+#endif /*RT_CAN_USING_HDR*/
+
+    return rx_fifo;
+}
+
 rt_inline int _can_int_rx(struct rt_can_device *can, struct rt_can_msg *data, int msgs)
 {
     int size;
-    struct rt_can_rx_fifo *rx_fifo;
     RT_ASSERT(can != RT_NULL);
     size = msgs;
 
-    rx_fifo = (struct rt_can_rx_fifo *) can->can_rx;
-    RT_ASSERT(rx_fifo != RT_NULL);
+    RT_ASSERT(can->can_rx != RT_NULL);
 
-    /* read from software FIFO */
-    while (msgs)
+    /* read from software FIFO, a batch of messages in one critical section */
+    while (msgs >= sizeof(struct rt_can_msg))
     {
         rt_base_t level;
-#ifdef RT_CAN_USING_HDR
-        rt_int8_t hdr;
-#endif /*RT_CAN_USING_HDR*/
-        struct rt_can_msg_list *listmsg = RT_NULL;
+        int batch = RT_CAN_RX_BATCH;
+        struct rt_can_rx_fifo *fifo;
 
         /* disable interrupt */
         level = rt_hw_interrupt_disable();
-#ifdef RT_CAN_USING_HDR
-        hdr = data->hdr;
-
-        if (hdr >= 0 && can->hdr && hdr < can->config.maxhdr && !rt_list_isempty(&can->hdr[hdr].list))
+        while (batch && msgs >= sizeof(struct rt_can_msg))
         {
-            listmsg = rt_list_entry(can->hdr[hdr].list.next, struct rt_can_msg_list, hdrlist);
-            rt_list_remove(&listmsg->list);
-            rt_list_remove(&listmsg->hdrlist);
-            if (can->hdr[hdr].msgs)
-            {
-                can->hdr[hdr].msgs--;
-            }
-            listmsg->owner = RT_NULL;
-        }
-        else if (hdr == -1)
-#endif /*RT_CAN_USING_HDR*/
-        {
-            if (!rt_list_isempty(&rx_fifo->uselist))
-            {
-                listmsg = rt_list_entry(rx_fifo->uselist.next, struct rt_can_msg_list, list);
-                rt_list_remove(&listmsg->list);
-#ifdef RT_CAN_USING_HDR
-                rt_list_remove(&listmsg->hdrlist);
-                if (listmsg->owner != RT_NULL && listmsg->owner->msgs)
-                {
-                    listmsg->owner->msgs--;
-                }
-                listmsg->owner = RT_NULL;
-#endif /*RT_CAN_USING_HDR*/
-            }
-            else
-            {
-                /* no data, enable interrupt and break out */
-                rt_hw_interrupt_enable(level);
+            fifo = _can_rx_fifo(can, data);
+            if (fifo == RT_NULL || !_can_fifo_get(fifo, data))
                 break;
-            }
-        }
 
+            data ++;
+            msgs -= sizeof(struct rt_can_msg);
+            batch --;
+        }
         /* enable interrupt */
         rt_hw_interrupt_enable(level);
-        if (listmsg != RT_NULL)
-        {
-            rt_memcpy(data, &listmsg->data, sizeof(struct rt_can_msg));
-
-            level = rt_hw_interrupt_disable();
-            rt_list_insert_before(&rx_fifo->freelist, &listmsg->list);
-            rx_fifo->freenumbers++;
-            RT_ASSERT(rx_fifo->freenumbers <= can->config.msgboxsz);
-            rt_hw_interrupt_enable(level);
 
-            listmsg = RT_NULL;
-        }
-        else
-        {
-            break;
-        }
-        data ++;
-        msgs -= sizeof(struct rt_can_msg);
+        /* no more data */
+        if (batch) break;
     }
 
     return (size - msgs);
@@ -270,26 +419,10 @@ static rt_err_t rt_can_open(struct rt_device *dev, rt_uint16_t oflag)
     {
         if (oflag & RT_DEVICE_FLAG_INT_RX)
         {
-            int i = 0;
             struct rt_can_rx_fifo *rx_fifo;
 
-            rx_fifo = (struct rt_can_rx_fifo *) rt_malloc(sizeof(struct rt_can_rx_fifo) +
-                      can->config.msgboxsz * sizeof(struct rt_can_msg_list));
+            rx_fifo = _can_fifo_create(can->config.msgboxsz);
             RT_ASSERT(rx_fifo != RT_NULL);
-
-            rx_fifo->buffer = (struct rt_can_msg_list *)(rx_fifo + 1);
-            rt_memset(rx_fifo->buffer, 0, can->config.msgboxsz * sizeof(struct rt_can_msg_list));
-            rt_list_init(&rx_fifo->freelist);
-            rt_list_init(&rx_fifo->uselist);
-            rx_fifo->freenumbers = can->config.msgboxsz;
-            for (i = 0;  i < can->config.msgboxsz; i++)
-            {
-                rt_list_insert_before(&rx_fifo->freelist, &rx_fifo->buffer[i].list);
-#ifdef RT_CAN_USING_HDR
-                rt_list_init(&rx_fifo->buffer[i].hdrlist);
-                rx_fifo->buffer[i].owner = RT_NULL;
-#endif
-            }
             can->can_rx = rx_fifo;
 
             dev->open_flag |= RT_DEVICE_FLAG_INT_RX;
@@ -338,12 +471,19 @@ static rt_err_t rt_can_open(struct rt_device *dev, rt_uint16_t oflag)
         int i = 0;
         struct rt_can_hdr *phdr;
 
-        phdr = (struct rt_can_hdr *) rt_malloc(can->config.maxhdr * sizeof(struct rt_can_hdr));
+        /* the buckets of hash are placed after the hdr */
+        phdr = (struct rt_can_hdr *) rt_malloc(can->config.maxhdr * sizeof(struct rt_can_hdr) +
+                                               (RT_CAN_FILTER_HASH_SZ + 1) * sizeof(rt_int8_t));
         RT_ASSERT(phdr != RT_NULL);
         rt_memset(phdr, 0, can->config.maxhdr * sizeof(struct rt_can_hdr));
         for (i = 0;  i < can->config.maxhdr; i++)
         {
-            rt_list_init(&phdr[i].list);
+            phdr[i].next = -1;
+        }
+        can->hdr_hash = (rt_int8_t *)(phdr + can->config.maxhdr);
+        for (i = 0;  i <= RT_CAN_FILTER_HASH_SZ; i++)
+        {
+            can->hdr_hash[i] = -1;
         }
 
         can->hdr = phdr;
@@ -391,8 +531,21 @@ static rt_err_t rt_can_close(struct rt_device *dev)
 #ifdef RT_CAN_USING_HDR
     if (can->hdr != RT_NULL)
     {
-        rt_free(can->hdr);
+        int i;
+        rt_base_t level;
+        struct rt_can_hdr *phdr = can->hdr;
+
+        for (i = 0;  i < can->config.maxhdr; i++)
+        {
+            if (phdr[i].connected)
+                _can_hdr_disconnect(can, i);
+        }
+
+        level = rt_hw_interrupt_disable();
         can->hdr = RT_NULL;
+        can->hdr_hash = RT_NULL;
+        rt_hw_interrupt_enable(level);
+        rt_free(phdr);
     }
 #endif
 
@@ -565,70 +718,31 @@ static rt_err_t rt_can_control(struct rt_device *dev,
             struct rt_can_filter_config *pfilter;
             struct rt_can_filter_item *pitem;
             rt_uint32_t count;
-            rt_base_t level;
 
             pfilter = (struct rt_can_filter_config *)args;
             count = pfilter->count;
             pitem = pfilter->items;
-            if (pfilter->actived)
+            while (count)
             {
-                while (count)
+                if (pitem->hdr >= can->config.maxhdr || pitem->hdr < 0)
                 {
-                    if (pitem->hdr >= can->config.maxhdr || pitem->hdr < 0)
-                    {
-                        count--;
-                        pitem++;
-                        continue;
-                    }
-
-                    level = rt_hw_interrupt_disable();
-                    if (!can->hdr[pitem->hdr].connected)
-                    {
-                        rt_hw_interrupt_enable(level);
-                        rt_memcpy(&can->hdr[pitem->hdr].filter, pitem,
-                                  sizeof(struct rt_can_filter_item));
-			level = rt_hw_interrupt_disable();
-                        can->hdr[pitem->hdr].connected = 1;
-                        can->hdr[pitem->hdr].msgs = 0;
-                        rt_list_init(&can->hdr[pitem->hdr].list);
-                    }
-                    rt_hw_interrupt_enable(level);
-
                     count--;
                     pitem++;
+                    continue;
                 }
-            }
-            else
-            {
-                while (count)
-                {
-                    if (pitem->hdr >= can->config.maxhdr || pitem->hdr < 0)
-                    {
-                        count--;
-                        pitem++;
-                        continue;
-                    }
-                    level = rt_hw_interrupt_disable();
 
-                    if (can->hdr[pitem->hdr].connected)
-                    {
-                        can->hdr[pitem->hdr].connected = 0;
-                        can->hdr[pitem->hdr].msgs = 0;
-                        if (!rt_list_isempty(&can->hdr[pitem->hdr].list))
-                        {
-                            rt_list_remove(can->hdr[pitem->hdr].list.next);
-                        }
-                        rt_hw_interrupt_enable(level);
-                        rt_memset(&can->hdr[pitem->hdr].filter, 0,
-                                  sizeof(struct rt_can_filter_item));
-                    }
-		    else
-		    {
-                        rt_hw_interrupt_enable(level);
-		    }
-                    count--;
-                    pitem++;
+                if (pfilter->actived && !can->hdr[pitem->hdr].connected)
+                {
+                    res = _can_hdr_connect(can, pitem);
+                    if (res != RT_EOK) return res;
+                }
+                else if (!pfilter->actived && can->hdr[pitem->hdr].connected)
+                {
+                    _can_hdr_disconnect(can, pitem->hdr);
                 }
+
+                count--;
+                pitem++;
             }
         }
         break;
@@ -705,6 +819,7 @@ rt_err_t rt_hw_can_register(struct rt_can_device *can,
     device->tx_complete = RT_NULL;
 #ifdef RT_CAN_USING_HDR
     can->hdr            = RT_NULL;
+    can->hdr_hash       = RT_NULL;
 #endif
     can->can_rx         = RT_NULL;
     can->can_tx         = RT_NULL;
@@ -757,13 +872,11 @@ void rt_hw_can_isr(struct rt_can_device *can, int event)
     case RT_CAN_EVENT_RX_IND:
     {
         struct rt_can_msg tmpmsg;
-        struct rt_can_rx_fifo *rx_fifo;
-        struct rt_can_msg_list *listmsg = RT_NULL;
+        struct rt_can_rx_fifo *rx_fifo, *fifo;
 #ifdef RT_CAN_USING_HDR
-        rt_int8_t hdr;
+        rt_int32_t hdr = -1;
 #endif
         int ch = -1;
-        rt_base_t level;
         rt_uint32_t no;
 
         rx_fifo = (struct rt_can_rx_fifo *)can->can_rx;
@@ -775,89 +888,47 @@ void rt_hw_can_isr(struct rt_can_device *can, int event)
         ch = can->ops->recvmsg(can, &tmpmsg, no);
         if (ch == -1) break;
 
-        /* disable interrupt */
-        level = rt_hw_interrupt_disable();
         can->status.rcvpkg++;
         can->status.rcvchange = 1;
-        if (!rt_list_isempty(&rx_fifo->freelist))
-        {
-            listmsg = rt_list_entry(rx_fifo->freelist.next, struct rt_can_msg_list, list);
-            rt_list_remove(&listmsg->list);
+
+        fifo = rx_fifo;
 #ifdef RT_CAN_USING_HDR
-            rt_list_remove(&listmsg->hdrlist);
-            if (listmsg->owner != RT_NULL && listmsg->owner->msgs)
-            {
-                listmsg->owner->msgs--;
-            }
-            listmsg->owner = RT_NULL;
-#endif /*RT_CAN_USING_HDR*/
-            RT_ASSERT(rx_fifo->freenumbers > 0);
-            rx_fifo->freenumbers--;
-        }
-        else if (!rt_list_isempty(&rx_fifo->uselist))
+        if (can->hdr != RT_NULL)
         {
-            listmsg = rt_list_entry(rx_fifo->uselist.next, struct rt_can_msg_list, list);
-            can->status.dropedrcvpkg++;
-            rt_list_remove(&listmsg->list);
-#ifdef RT_CAN_USING_HDR
-            rt_list_remove(&listmsg->hdrlist);
-            if (listmsg->owner != RT_NULL && listmsg->owner->msgs)
+            hdr = tmpmsg.hdr;
+            /* not matched by hardware filter */
+            if (hdr >= can->config.maxhdr)
             {
-                listmsg->owner->msgs--;
+                hdr = _can_filter_match(can, &tmpmsg);
+                tmpmsg.hdr = hdr;
             }
-            listmsg->owner = RT_NULL;
-#endif
+
+            if (hdr >= 0 && can->hdr[hdr].connected)
+                fifo = can->hdr[hdr].fifo;
+            else
+                hdr = -1;
         }
-        /* enable interrupt */
-        rt_hw_interrupt_enable(level);
+#endif
 
-        if (listmsg != RT_NULL)
+        /* the ISR is the only producer of fifo, no lock is needed */
+        if (!_can_fifo_put(fifo, &tmpmsg))
         {
-            rt_memcpy(&listmsg->data, &tmpmsg, sizeof(struct rt_can_msg));
-            level = rt_hw_interrupt_disable();
-            rt_list_insert_before(&rx_fifo->uselist, &listmsg->list);
-#ifdef RT_CAN_USING_HDR
-            hdr = tmpmsg.hdr;
-            if (can->hdr != RT_NULL)
-            {
-                RT_ASSERT(hdr < can->config.maxhdr && hdr >= 0);
-                if (can->hdr[hdr].connected)
-                {
-                    rt_list_insert_before(&can->hdr[hdr].list, &listmsg->hdrlist);
-                    listmsg->owner = &can->hdr[hdr];
-                    can->hdr[hdr].msgs++;
-                }
-
-            }
-#endif
-            rt_hw_interrupt_enable(level);
+            can->status.dropedrcvpkg++;
         }
 
         /* invoke callback */
 #ifdef RT_CAN_USING_HDR
-        if (can->hdr != RT_NULL && can->hdr[hdr].connected && can->hdr[hdr].filter.ind)
+        if (hdr >= 0 && can->hdr[hdr].filter.ind)
         {
-            rt_size_t rx_length;
-            RT_ASSERT(hdr < can->config.maxhdr && hdr >= 0);
-
-            level = rt_hw_interrupt_disable();
-            rx_length = can->hdr[hdr].msgs * sizeof(struct rt_can_msg);
-            rt_hw_interrupt_enable(level);
-            can->hdr[hdr].filter.ind(&can->parent, can->hdr[hdr].filter.args, hdr, rx_length);
+            can->hdr[hdr].filter.ind(&can->parent, can->hdr[hdr].filter.args, hdr,
+                                     _can_fifo_len(fifo) * sizeof(struct rt_can_msg));
         }
         else
 #endif
         {
             if (can->parent.rx_indicate != RT_NULL)
             {
-                rt_size_t rx_length;
-
-                level = rt_hw_interrupt_disable();
-                /* get rx length */
-                rx_length = rt_list_len(&rx_fifo->uselist)* sizeof(struct rt_can_msg);
-                rt_hw_interrupt_enable(level);
-
-                can->parent.rx_indicate(&can->parent, rx_length);
+                can->parent.rx_indicate(&can->parent, _can_fifo_len(fifo) * sizeof(struct rt_can_msg));
             }
         }
         break;
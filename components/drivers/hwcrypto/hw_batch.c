@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2006-2019, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-10     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    reset the CRC of every request, check the key length
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <hw_batch.h>
+
+struct batch_ctx
+{
+    struct rt_hwcrypto_device *device;  /**< The selected device, ctx->device is the software device after fallback */
+    hwcrypto_type type;
+    struct rt_hwcrypto_ctx *ctx;
+};
+
+static rt_uint32_t _batch_obj_size(hwcrypto_type type)
+{
+    switch (type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(RT_HWCRYPTO_USING_CRC)
+    case HWCRYPTO_TYPE_CRC:
+        return sizeof(struct hwcrypto_crc);
+#endif
+#if defined(RT_HWCRYPTO_USING_MD5) || defined(RT_HWCRYPTO_USING_SHA1) || defined(RT_HWCRYPTO_USING_SHA2)
+    case HWCRYPTO_TYPE_MD5:
+    case HWCRYPTO_TYPE_SHA1:
+    case HWCRYPTO_TYPE_SHA2:
+        return sizeof(struct hwcrypto_hash);
+#endif
+#if defined(RT_HWCRYPTO_USING_AES) || defined(RT_HWCRYPTO_USING_DES) || \
+    defined(RT_HWCRYPTO_USING_3DES) || defined(RT_HWCRYPTO_USING_RC4)
+    case HWCRYPTO_TYPE_AES:
+    case HWCRYPTO_TYPE_DES:
+    case HWCRYPTO_TYPE_3DES:
+    case HWCRYPTO_TYPE_RC4:
+        return sizeof(struct hwcrypto_symmetric);
+#endif
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static struct rt_hwcrypto_ctx *_batch_ctx_get(struct batch_ctx *cache, int *next,
+                                              struct rt_hwcrypto_device *device, hwcrypto_type type)
+{
+    struct batch_ctx *entry;
+    rt_uint32_t size;
+    int i;
+
+    for (i = 0; i < RT_HWCRYPTO_BATCH_CTX_NUM; i++)
+    {
+        if (cache[i].ctx && cache[i].device == device && cache[i].type == type)
+        {
+            return cache[i].ctx;
+        }
+    }
+
+    size = _batch_obj_size(type);
+    if (size == 0)
+    {
+        return RT_NULL;
+    }
+
+    /* Replace the oldest context */
+    entry = &cache[*next];
+    *next = (*next + 1) % RT_HWCRYPTO_BATCH_CTX_NUM;
+    if (entry->ctx)
+    {
+        rt_hwcrypto_ctx_destroy(entry->ctx);
+    }
+    entry->device = device;
+    entry->type = type;
+    entry->ctx = rt_hwcrypto_ctx_create(device, type, size);
+
+    return entry->ctx;
+}
+
+static rt_err_t _batch_do(struct rt_hwcrypto_ctx *ctx, struct hwcrypto_request *req)
+{
+    rt_err_t err = RT_EOK;
+
+    switch (req->type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(RT_HWCRYPTO_USING_CRC)
+    case HWCRYPTO_TYPE_CRC:
+    {
+        rt_uint32_t i;
+
+        /* The CRC of the previous request is not chained */
+        rt_hwcrypto_ctx_reset(ctx);
+        rt_hwcrypto_crc_cfg(ctx, &req->crc_cfg);
+        for (i = 0; i < req->sg_num; i++)
+        {
+            req->crc = rt_hwcrypto_crc_update(ctx, req->sg[i].buf, req->sg[i].length);
+        }
+        break;
+    }
+#endif
+#if defined(RT_HWCRYPTO_USING_MD5) || defined(RT_HWCRYPTO_USING_SHA1) || defined(RT_HWCRYPTO_USING_SHA2)
+    case HWCRYPTO_TYPE_MD5:
+    case HWCRYPTO_TYPE_SHA1:
+    case HWCRYPTO_TYPE_SHA2:
+    {
+        rt_uint32_t i;
+
+        rt_hwcrypto_hash_reset(ctx);
+        for (i = 0; i < req->sg_num && err == RT_EOK; i++)
+        {
+            err = rt_hwcrypto_hash_update(ctx, req->sg[i].buf, req->sg[i].length);
+        }
+        if (err == RT_EOK)
+        {
+            err = rt_hwcrypto_hash_finish(ctx, req->out, req->out_len);
+        }
+        break;
+    }
+#endif
+#if defined(RT_HWCRYPTO_USING_AES) || defined(RT_HWCRYPTO_USING_DES) || \
+    defined(RT_HWCRYPTO_USING_3DES) || defined(RT_HWCRYPTO_USING_RC4)
+    case HWCRYPTO_TYPE_AES:
+    case HWCRYPTO_TYPE_DES:
+    case HWCRYPTO_TYPE_3DES:
+    case HWCRYPTO_TYPE_RC4:
+    {
+        struct hwcrypto_symmetric *symmetric_ctx = (struct hwcrypto_symmetric *)ctx;
+        rt_uint8_t *out = req->out;
+        rt_uint32_t i;
+
+        if (req->key == RT_NULL || req->key_bitlen > RT_HWCRYPTO_KEYBIT_MAX_SIZE)
+        {
+            err = -RT_EINVAL;
+            break;
+        }
+        /* The key is not set again, so it is not expanded again */
+        if (symmetric_ctx->key_bitlen != req->key_bitlen ||
+            rt_memcmp(symmetric_ctx->key, req->key, req->key_bitlen >> 3) != 0)
+        {
+            err = rt_hwcrypto_symmetric_setkey(ctx, req->key, req->key_bitlen);
+        }
+        if (err == RT_EOK && req->iv)
+        {
+            err = rt_hwcrypto_symmetric_setiv(ctx, req->iv, req->iv_len);
+            rt_hwcrypto_symmetric_set_ivoff(ctx, 0);
+        }
+        for (i = 0; i < req->sg_num && err == RT_EOK; i++)
+        {
+            err = rt_hwcrypto_symmetric_crypt(ctx, req->mode, req->sg[i].length, req->sg[i].buf, out);
+            out += req->sg[i].length;
+        }
+        break;
+    }
+#endif
+    default:
+        err = -RT_ERROR;
+        break;
+    }
+
+    return err;
+}
+
+/**
+ * @brief           Do a batch of requests, every request is done by the
+ *                  device of rt_hwcrypto_dev_select(), the contexts are
+ *                  shared by the requests of same type
+ *
+ * @param reqs      The requests
+ * @param num       The number of requests
+ *
+ * @return          RT_EOK if all requests are done successfully.
+ */
+rt_err_t rt_hwcrypto_batch(struct hwcrypto_request *reqs, rt_size_t num)
+{
+    struct batch_ctx cache[RT_HWCRYPTO_BATCH_CTX_NUM];
+    struct rt_hwcrypto_device *device;
+    struct rt_hwcrypto_ctx *ctx;
+    rt_err_t err = RT_EOK;
+    rt_size_t i;
+    int next = 0;
+
+    if (reqs == RT_NULL)
+    {
+        return -RT_EINVAL;
+    }
+    rt_memset(cache, 0, sizeof(cache));
+
+    for (i = 0; i < num; i++)
+    {
+        /* The device is selected by the depth of hardware for every request */
+        device = rt_hwcrypto_dev_select();
+        ctx = device ? _batch_ctx_get(cache, &next, device, reqs[i].type) : RT_NULL;
+        if (ctx == RT_NULL)
+        {
+            reqs[i].device = RT_NULL;
+            reqs[i].result = -RT_ERROR;
+            err = -RT_ERROR;
+            continue;
+        }
+
+        reqs[i].device = ctx->device;
+        reqs[i].result = _batch_do(ctx, &reqs[i]);
+        if (reqs[i].result != RT_EOK)
+        {
+            err = reqs[i].result;
+        }
+    }
+
+    for (i = 0; i < RT_HWCRYPTO_BATCH_CTX_NUM; i++)
+    {
+        if (cache[i].ctx)
+        {
+            rt_hwcrypto_ctx_destroy(cache[i].ctx);
+        }
+    }
+
+    return err;
+}
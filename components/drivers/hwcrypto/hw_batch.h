@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2006-2019, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-10     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    the last_val of CRC is not updated
+ */
+
+#ifndef __HW_BATCH_H__
+#define __HW_BATCH_H__
+
+#include <hwcrypto.h>
+#include <hw_crc.h>
+
+#ifndef RT_HWCRYPTO_BATCH_CTX_NUM
+#define RT_HWCRYPTO_BATCH_CTX_NUM   (4)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct hwcrypto_sg
+{
+    const rt_uint8_t *buf;              /**< Input data */
+    rt_size_t length;                   /**< The length of input data in Bytes */
+};
+
+struct hwcrypto_request
+{
+    hwcrypto_type type;                 /**< HWCRYPTO_TYPE_CRC, HWCRYPTO_TYPE_SHA256, HWCRYPTO_TYPE_AES_CTR... */
+    hwcrypto_mode mode;                 /**< Symmetric crypto mode */
+    const struct hwcrypto_sg *sg;       /**< The scatter list of input data */
+    rt_uint32_t sg_num;                 /**< The number of sg */
+    rt_uint8_t *out;                    /**< Symmetric: the output of all sg, hash: the digest */
+    rt_size_t out_len;                  /**< The length of hash digest buffer */
+    const rt_uint8_t *key;              /**< Symmetric key */
+    rt_uint32_t key_bitlen;             /**< Symmetric key bit length */
+    const rt_uint8_t *iv;               /**< Symmetric IV, RT_NULL in ECB mode */
+    rt_uint32_t iv_len;                 /**< Symmetric IV length */
+    struct hwcrypto_crc_cfg crc_cfg;    /**< CRC configure, the last_val is the initial value and it is not updated,
+                                             the engines keep different values in it */
+    rt_uint32_t crc;                    /**< CRC value */
+    struct rt_hwcrypto_device *device;  /**< The device has done the request */
+    rt_err_t result;                    /**< RT_EOK on success */
+};
+
+/**
+ * @brief           Do a batch of requests, every request is done by the
+ *                  device of rt_hwcrypto_dev_select(), the contexts are
+ *                  shared by the requests of same type
+ *
+ * @param reqs      The requests
+ * @param num       The number of requests
+ *
+ * @return          RT_EOK if all requests are done successfully.
+ */
+rt_err_t rt_hwcrypto_batch(struct hwcrypto_request *reqs, rt_size_t num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
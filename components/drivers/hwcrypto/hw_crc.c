@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-04-25     tyx          the first version
+ * 2019-10-10     RT-Thread    count the requests in progress
  */
 
 #include <rtthread.h>
@@ -94,9 +95,14 @@ rt_uint32_t rt_hwcrypto_crc_update(struct rt_hwcrypto_ctx *ctx,
                                              rt_size_t length)
 {
     struct hwcrypto_crc *crc_ctx = (struct hwcrypto_crc *)ctx;
+    rt_uint32_t crc;
+
     if (ctx && crc_ctx->ops->update)
     {
-        return crc_ctx->ops->update(crc_ctx, input, length);
+        rt_hwcrypto_dev_enter(ctx->device);
+        crc = crc_ctx->ops->update(crc_ctx, input, length);
+        rt_hwcrypto_dev_leave(ctx->device);
+        return crc;
     }
     return 0;
 }
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-04-23     tyx          the first version
+ * 2019-10-10     RT-Thread    count the requests in progress
  */
 
 #include <rtthread.h>
@@ -49,9 +50,14 @@ void rt_hwcrypto_hash_destroy(struct rt_hwcrypto_ctx *ctx)
  */
 rt_err_t rt_hwcrypto_hash_finish(struct rt_hwcrypto_ctx *ctx, rt_uint8_t *output, rt_size_t length)
 {
+    rt_err_t err;
+
     if (ctx && ((struct hwcrypto_hash *)ctx)->ops->finish)
     {
-        return ((struct hwcrypto_hash *)ctx)->ops->finish((struct hwcrypto_hash *)ctx, output, length);
+        rt_hwcrypto_dev_enter(ctx->device);
+        err = ((struct hwcrypto_hash *)ctx)->ops->finish((struct hwcrypto_hash *)ctx, output, length);
+        rt_hwcrypto_dev_leave(ctx->device);
+        return err;
     }
     return -RT_ERROR;
 }
@@ -67,9 +73,14 @@ rt_err_t rt_hwcrypto_hash_finish(struct rt_hwcrypto_ctx *ctx, rt_uint8_t *output
  */
 rt_err_t rt_hwcrypto_hash_update(struct rt_hwcrypto_ctx *ctx, const rt_uint8_t *input, rt_size_t length)
 {
+    rt_err_t err;
+
     if (ctx && ((struct hwcrypto_hash *)ctx)->ops->update)
     {
-        return ((struct hwcrypto_hash *)ctx)->ops->update((struct hwcrypto_hash *)ctx, input, length);
+        rt_hwcrypto_dev_enter(ctx->device);
+        err = ((struct hwcrypto_hash *)ctx)->ops->update((struct hwcrypto_hash *)ctx, input, length);
+        rt_hwcrypto_dev_leave(ctx->device);
+        return err;
     }
     return -RT_ERROR;
 }
@@ -0,0 +1,846 @@
+/*
+ * Copyright (c) 2006-2019, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-10     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    keep the CRC table on reset
+ */
+
+/*
+ * The software crypto engine. It is registered as a crypto device like the
+ * hardware, the context of framework is created on it when there is no
+ * hardware or the hardware does not support the type. The state of every
+ * context is kept in ctx->contex, so the contexts are used by the threads
+ * at the same time without a lock.
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <hw_soft.h>
+
+#define DBG_TAG                 "swcrypto"
+#define DBG_LVL                 DBG_INFO
+#include <rtdbg.h>
+
+/* The big endian words */
+#define SOFT_GET_U32(p)     ((rt_uint32_t)(p)[0] << 24 | (rt_uint32_t)(p)[1] << 16 | (rt_uint32_t)(p)[2] << 8 | (p)[3])
+#define SOFT_PUT_U32(p, v)                  \
+    do {                                    \
+        (p)[0] = (rt_uint8_t)((v) >> 24);   \
+        (p)[1] = (rt_uint8_t)((v) >> 16);   \
+        (p)[2] = (rt_uint8_t)((v) >> 8);    \
+        (p)[3] = (rt_uint8_t)(v);           \
+    } while (0)
+
+#if defined(RT_HWCRYPTO_USING_CRC)
+struct soft_crc
+{
+    rt_uint32_t poly;                   /**< The table is made for the poly, width and flags */
+    rt_uint16_t width;
+    rt_uint16_t flags;
+    rt_uint16_t slices;                 /**< 8 for slice-by-8, or 1 */
+    rt_uint32_t table[1];               /**< 256 * slices words */
+};
+
+static rt_uint32_t _crc_reflect(rt_uint32_t v, int width)
+{
+    rt_uint32_t r = 0;
+    int i;
+
+    for (i = 0; i < width; i++)
+    {
+        r = (r << 1) | (v & 0x1);
+        v >>= 1;
+    }
+    return r;
+}
+
+static void _crc_make_table(struct soft_crc *crc, const struct hwcrypto_crc_cfg *cfg)
+{
+    rt_uint32_t *t = crc->table;
+    rt_uint32_t c, poly;
+    int i, j, k;
+
+    if (cfg->flags & CRC_FLAG_REFIN)
+    {
+        /* LSB first, the register is right aligned */
+        poly = _crc_reflect(cfg->poly, cfg->width);
+        for (i = 0; i < 256; i++)
+        {
+            c = i;
+            for (j = 0; j < 8; j++)
+                c = (c & 0x1) ? (c >> 1) ^ poly : c >> 1;
+            t[i] = c;
+        }
+        for (k = 1; k < crc->slices; k++)
+        {
+            for (i = 0; i < 256; i++)
+            {
+                c = t[(k - 1) * 256 + i];
+                t[k * 256 + i] = (c >> 8) ^ t[c & 0xff];
+            }
+        }
+    }
+    else
+    {
+        /* MSB first, the register is left aligned */
+        poly = cfg->poly << (32 - cfg->width);
+        for (i = 0; i < 256; i++)
+        {
+            c = (rt_uint32_t)i << 24;
+            for (j = 0; j < 8; j++)
+                c = (c & 0x80000000) ? (c << 1) ^ poly : c << 1;
+            t[i] = c;
+        }
+        for (k = 1; k < crc->slices; k++)
+        {
+            for (i = 0; i < 256; i++)
+            {
+                c = t[(k - 1) * 256 + i];
+                t[k * 256 + i] = (c << 8) ^ t[c >> 24];
+            }
+        }
+    }
+
+    crc->poly = cfg->poly;
+    crc->width = cfg->width;
+    crc->flags = cfg->flags & (CRC_FLAG_REFIN | CRC_FLAG_REFOUT);
+}
+
+static rt_uint32_t _crc_refin(const rt_uint32_t *t, int slices, rt_uint32_t r, const rt_uint8_t *p, rt_size_t len)
+{
+    rt_uint32_t one, two;
+
+    if (slices == 8)
+    {
+        while (len >= 8)
+        {
+            one = r ^ (p[0] | p[1] << 8 | p[2] << 16 | (rt_uint32_t)p[3] << 24);
+            two = p[4] | p[5] << 8 | p[6] << 16 | (rt_uint32_t)p[7] << 24;
+            r = t[7 * 256 + (one & 0xff)] ^ t[6 * 256 + ((one >> 8) & 0xff)] ^
+                t[5 * 256 + ((one >> 16) & 0xff)] ^ t[4 * 256 + (one >> 24)] ^
+                t[3 * 256 + (two & 0xff)] ^ t[2 * 256 + ((two >> 8) & 0xff)] ^
+                t[1 * 256 + ((two >> 16) & 0xff)] ^ t[two >> 24];
+            p += 8;
+            len -= 8;
+        }
+    }
+    while (len--)
+    {
+        r = (r >> 8) ^ t[(r ^ *p++) & 0xff];
+    }
+    return r;
+}
+
+static rt_uint32_t _crc_normal(const rt_uint32_t *t, int slices, rt_uint32_t r, const rt_uint8_t *p, rt_size_t len)
+{
+    rt_uint32_t one, two;
+
+    if (slices == 8)
+    {
+        while (len >= 8)
+        {
+            one = r ^ ((rt_uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]);
+            two = (rt_uint32_t)p[4] << 24 | p[5] << 16 | p[6] << 8 | p[7];
+            r = t[7 * 256 + (one >> 24)] ^ t[6 * 256 + ((one >> 16) & 0xff)] ^
+                t[5 * 256 + ((one >> 8) & 0xff)] ^ t[4 * 256 + (one & 0xff)] ^
+                t[3 * 256 + (two >> 24)] ^ t[2 * 256 + ((two >> 16) & 0xff)] ^
+                t[1 * 256 + ((two >> 8) & 0xff)] ^ t[two & 0xff];
+            p += 8;
+            len -= 8;
+        }
+    }
+    while (len--)
+    {
+        r = (r << 8) ^ t[(r >> 24) ^ *p++];
+    }
+    return r;
+}
+
+/*
+ * crc_cfg.last_val is the register of the Rocksoft model, it is the initial
+ * value of the first update and is chained by the next updates. The result
+ * is reflected by CRC_FLAG_REFOUT and XORed by xorout.
+ */
+static rt_uint32_t _crc_update(struct hwcrypto_crc *ctx, const rt_uint8_t *in, rt_size_t length)
+{
+    struct soft_crc *crc = (struct soft_crc *)ctx->parent.contex;
+    struct hwcrypto_crc_cfg *cfg = &ctx->crc_cfg;
+    rt_uint32_t mask, r;
+
+    if (cfg->width == 0 || cfg->width > 32)
+    {
+        return 0;
+    }
+    mask = cfg->width == 32 ? 0xFFFFFFFF : (1UL << cfg->width) - 1;
+
+    /* The configure is changed by rt_hwcrypto_crc_cfg() */
+    if (crc->poly != cfg->poly || crc->width != cfg->width ||
+        crc->flags != (cfg->flags & (CRC_FLAG_REFIN | CRC_FLAG_REFOUT)))
+    {
+        _crc_make_table(crc, cfg);
+    }
+
+    if (cfg->flags & CRC_FLAG_REFIN)
+    {
+        r = _crc_reflect(cfg->last_val & mask, cfg->width);
+        r = _crc_refin(crc->table, crc->slices, r, in, length);
+        r = _crc_reflect(r, cfg->width);
+    }
+    else
+    {
+        r = (cfg->last_val & mask) << (32 - cfg->width);
+        r = _crc_normal(crc->table, crc->slices, r, in, length);
+        r = r >> (32 - cfg->width);
+    }
+    cfg->last_val = r;
+
+    if (cfg->flags & CRC_FLAG_REFOUT)
+    {
+        r = _crc_reflect(r, cfg->width);
+    }
+    return (r ^ cfg->xorout) & mask;
+}
+
+static const struct hwcrypto_crc_ops crc_ops =
+{
+    .update = _crc_update,
+};
+
+static rt_size_t _crc_size(void)
+{
+#ifdef RT_HWCRYPTO_SOFT_CRC_SLICE8
+    return sizeof(struct soft_crc) + (256 * 8 - 1) * sizeof(rt_uint32_t);
+#else
+    return sizeof(struct soft_crc) + (256 - 1) * sizeof(rt_uint32_t);
+#endif
+}
+#endif /* RT_HWCRYPTO_USING_CRC */
+
+#if defined(RT_HWCRYPTO_USING_AES)
+struct soft_aes
+{
+    rt_uint32_t rk[60];                 /**< The round keys */
+    rt_int32_t nr;                      /**< The number of rounds, 0 if the key is not expanded */
+    rt_uint8_t stream[16];              /**< The key stream of CTR */
+};
+
+static rt_uint8_t aes_sbox[256];
+static rt_uint8_t aes_rsbox[256];
+static rt_uint32_t aes_ft[256];         /**< The forward table, rotated for the other rows */
+static rt_uint8_t aes_rcon[10];
+
+#define AES_XTIME(x)    ((rt_uint8_t)(((x) << 1) ^ (((x) & 0x80) ? 0x1B : 0x00)))
+#define AES_ROR8(x)     (((x) >> 8) | ((x) << 24))
+
+static void _aes_gen_tables(void)
+{
+    rt_uint8_t gf_pow[256], gf_log[256];
+    rt_uint8_t x, y, s;
+    int i;
+
+    /* The powers and logarithms of the generator 3 in GF(2^8) */
+    for (i = 0, x = 1; i < 256; i++)
+    {
+        gf_pow[i] = x;
+        gf_log[x] = i;
+        x ^= AES_XTIME(x);
+    }
+    for (i = 0, x = 1; i < 10; i++)
+    {
+        aes_rcon[i] = x;
+        x = AES_XTIME(x);
+    }
+
+    /* The multiplicative inverse and the affine transformation */
+    aes_sbox[0x00] = 0x63;
+    aes_rsbox[0x63] = 0x00;
+    for (i = 1; i < 256; i++)
+    {
+        x = gf_pow[255 - gf_log[i]];
+        y = x;
+        y = (y << 1) | (y >> 7);
+        x ^= y;
+        y = (y << 1) | (y >> 7);
+        x ^= y;
+        y = (y << 1) | (y >> 7);
+        x ^= y;
+        y = (y << 1) | (y >> 7);
+        x ^= y ^ 0x63;
+
+        aes_sbox[i] = x;
+        aes_rsbox[x] = i;
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        s = aes_sbox[i];
+        x = AES_XTIME(s);
+        aes_ft[i] = (rt_uint32_t)x << 24 | (rt_uint32_t)s << 16 | (rt_uint32_t)s << 8 | (x ^ s);
+    }
+}
+
+static rt_err_t _aes_setkey(struct soft_aes *aes, const rt_uint8_t *key, int bitlen)
+{
+    rt_uint32_t *w = aes->rk;
+    rt_uint32_t temp;
+    int i, nk;
+
+    switch (bitlen)
+    {
+    case 128: aes->nr = 10; break;
+    case 192: aes->nr = 12; break;
+    case 256: aes->nr = 14; break;
+    default:
+        aes->nr = 0;
+        return -RT_EINVAL;
+    }
+
+    nk = bitlen / 32;
+    for (i = 0; i < nk; i++)
+    {
+        w[i] = SOFT_GET_U32(key + i * 4);
+    }
+    for (i = nk; i < 4 * (aes->nr + 1); i++)
+    {
+        temp = w[i - 1];
+        if (i % nk == 0)
+        {
+            temp = (rt_uint32_t)aes_sbox[(temp >> 16) & 0xff] << 24 |
+                   (rt_uint32_t)aes_sbox[(temp >> 8) & 0xff] << 16 |
+                   (rt_uint32_t)aes_sbox[temp & 0xff] << 8 |
+                   (rt_uint32_t)aes_sbox[temp >> 24];
+            temp ^= (rt_uint32_t)aes_rcon[i / nk - 1] << 24;
+        }
+        else if (nk > 6 && i % nk == 4)
+        {
+            temp = (rt_uint32_t)aes_sbox[temp >> 24] << 24 |
+                   (rt_uint32_t)aes_sbox[(temp >> 16) & 0xff] << 16 |
+                   (rt_uint32_t)aes_sbox[(temp >> 8) & 0xff] << 8 |
+                   (rt_uint32_t)aes_sbox[temp & 0xff];
+        }
+        w[i] = w[i - nk] ^ temp;
+    }
+
+    return RT_EOK;
+}
+
+static void _aes_encrypt(const struct soft_aes *aes, const rt_uint8_t in[16], rt_uint8_t out[16])
+{
+    const rt_uint32_t *rk = aes->rk;
+    rt_uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+    int round;
+
+    s0 = SOFT_GET_U32(in) ^ rk[0];
+    s1 = SOFT_GET_U32(in + 4) ^ rk[1];
+    s2 = SOFT_GET_U32(in + 8) ^ rk[2];
+    s3 = SOFT_GET_U32(in + 12) ^ rk[3];
+
+#define AES_FROUND(a, b, c, d)              \
+    (aes_ft[a >> 24] ^                      \
+     AES_ROR8(aes_ft[(b >> 16) & 0xff]) ^   \
+     AES_ROR8(AES_ROR8(aes_ft[(c >> 8) & 0xff])) ^ \
+     AES_ROR8(AES_ROR8(AES_ROR8(aes_ft[d & 0xff]))))
+
+    for (round = 1; round < aes->nr; round++)
+    {
+        rk += 4;
+        t0 = AES_FROUND(s0, s1, s2, s3) ^ rk[0];
+        t1 = AES_FROUND(s1, s2, s3, s0) ^ rk[1];
+        t2 = AES_FROUND(s2, s3, s0, s1) ^ rk[2];
+        t3 = AES_FROUND(s3, s0, s1, s2) ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+#undef AES_FROUND
+
+#define AES_FLAST(a, b, c, d)                               \
+    ((rt_uint32_t)aes_sbox[a >> 24] << 24 |                 \
+     (rt_uint32_t)aes_sbox[(b >> 16) & 0xff] << 16 |        \
+     (rt_uint32_t)aes_sbox[(c >> 8) & 0xff] << 8 |          \
+     (rt_uint32_t)aes_sbox[d & 0xff])
+
+    rk += 4;
+    t0 = AES_FLAST(s0, s1, s2, s3) ^ rk[0];
+    t1 = AES_FLAST(s1, s2, s3, s0) ^ rk[1];
+    t2 = AES_FLAST(s2, s3, s0, s1) ^ rk[2];
+    t3 = AES_FLAST(s3, s0, s1, s2) ^ rk[3];
+#undef AES_FLAST
+
+    SOFT_PUT_U32(out, t0);
+    SOFT_PUT_U32(out + 4, t1);
+    SOFT_PUT_U32(out + 8, t2);
+    SOFT_PUT_U32(out + 12, t3);
+}
+
+static rt_uint8_t _aes_mul(rt_uint8_t a, rt_uint8_t b)
+{
+    rt_uint8_t r = 0;
+
+    while (b)
+    {
+        if (b & 0x1)
+            r ^= a;
+        a = AES_XTIME(a);
+        b >>= 1;
+    }
+    return r;
+}
+
+/* The decryption is byte oriented, it is used by ECB and CBC only */
+static void _aes_decrypt(const struct soft_aes *aes, const rt_uint8_t in[16], rt_uint8_t out[16])
+{
+    rt_uint8_t s[16], t[16];
+    int round, c, i;
+
+    for (i = 0; i < 16; i += 4)
+    {
+        SOFT_PUT_U32(s + i, SOFT_GET_U32(in + i) ^ aes->rk[aes->nr * 4 + i / 4]);
+    }
+
+    for (round = aes->nr - 1; round >= 0; round--)
+    {
+        /* InvShiftRows and InvSubBytes, the row r of column c is from column c - r */
+        for (c = 0; c < 4; c++)
+        {
+            for (i = 0; i < 4; i++)
+            {
+                t[c * 4 + i] = aes_rsbox[s[((c - i + 4) & 0x3) * 4 + i]];
+            }
+        }
+        /* AddRoundKey */
+        for (i = 0; i < 16; i += 4)
+        {
+            SOFT_PUT_U32(t + i, SOFT_GET_U32(t + i) ^ aes->rk[round * 4 + i / 4]);
+        }
+        if (round == 0)
+            break;
+        /* InvMixColumns */
+        for (c = 0; c < 16; c += 4)
+        {
+            s[c + 0] = _aes_mul(t[c], 14) ^ _aes_mul(t[c + 1], 11) ^ _aes_mul(t[c + 2], 13) ^ _aes_mul(t[c + 3], 9);
+            s[c + 1] = _aes_mul(t[c], 9) ^ _aes_mul(t[c + 1], 14) ^ _aes_mul(t[c + 2], 11) ^ _aes_mul(t[c + 3], 13);
+            s[c + 2] = _aes_mul(t[c], 13) ^ _aes_mul(t[c + 1], 9) ^ _aes_mul(t[c + 2], 14) ^ _aes_mul(t[c + 3], 11);
+            s[c + 3] = _aes_mul(t[c], 11) ^ _aes_mul(t[c + 1], 13) ^ _aes_mul(t[c + 2], 9) ^ _aes_mul(t[c + 3], 14);
+        }
+    }
+
+    rt_memcpy(out, t, 16);
+}
+
+static void _aes_ctr_next(struct hwcrypto_symmetric *ctx, struct soft_aes *aes)
+{
+    int i;
+
+    _aes_encrypt(aes, ctx->iv, aes->stream);
+    for (i = 15; i >= 0; i--)
+    {
+        if (++ctx->iv[i] != 0)
+            break;
+    }
+}
+
+/*
+ * The iv is the counter of the next block in CTR mode, iv_off is the offset
+ * in the key stream of the current block. If a new iv is set with a non-zero
+ * offset, the iv is the counter of the current block.
+ */
+static rt_err_t _aes_crypt(struct hwcrypto_symmetric *ctx, struct hwcrypto_symmetric_info *info)
+{
+    struct soft_aes *aes = (struct soft_aes *)ctx->parent.contex;
+    const rt_uint8_t *in = info->in;
+    rt_uint8_t *out = info->out;
+    rt_uint8_t temp[16];
+    rt_size_t len = info->length;
+    int i, n;
+
+    if ((ctx->flags & SYMMTRIC_MODIFY_KEY) || aes->nr == 0)
+    {
+        if (_aes_setkey(aes, ctx->key, ctx->key_bitlen) != RT_EOK)
+        {
+            return -RT_EINVAL;
+        }
+    }
+
+    switch (ctx->parent.type)
+    {
+    case HWCRYPTO_TYPE_AES_ECB:
+        if (len % 16 != 0)
+            return -RT_EINVAL;
+        for (; len > 0; len -= 16, in += 16, out += 16)
+        {
+            if (info->mode == HWCRYPTO_MODE_ENCRYPT)
+                _aes_encrypt(aes, in, out);
+            else
+                _aes_decrypt(aes, in, out);
+        }
+        break;
+
+    case HWCRYPTO_TYPE_AES_CBC:
+        if (len % 16 != 0)
+            return -RT_EINVAL;
+        for (; len > 0; len -= 16, in += 16, out += 16)
+        {
+            if (info->mode == HWCRYPTO_MODE_ENCRYPT)
+            {
+                for (i = 0; i < 16; i++)
+                    temp[i] = in[i] ^ ctx->iv[i];
+                _aes_encrypt(aes, temp, out);
+                rt_memcpy(ctx->iv, out, 16);
+            }
+            else
+            {
+                rt_memcpy(temp, in, 16);
+                _aes_decrypt(aes, in, out);
+                for (i = 0; i < 16; i++)
+                    out[i] ^= ctx->iv[i];
+                rt_memcpy(ctx->iv, temp, 16);
+            }
+        }
+        ctx->iv_len = 16;
+        break;
+
+    case HWCRYPTO_TYPE_AES_CTR:
+        n = ctx->iv_off & 0xf;
+        if (n != 0 && (ctx->flags & SYMMTRIC_MODIFY_IV))
+        {
+            _aes_ctr_next(ctx, aes);
+        }
+        /* The whole blocks */
+        while (n == 0 && len >= 16)
+        {
+            _aes_ctr_next(ctx, aes);
+            for (i = 0; i < 16; i++)
+                out[i] = in[i] ^ aes->stream[i];
+            in += 16;
+            out += 16;
+            len -= 16;
+        }
+        while (len--)
+        {
+            if (n == 0)
+                _aes_ctr_next(ctx, aes);
+            *out++ = *in++ ^ aes->stream[n];
+            n = (n + 1) & 0xf;
+        }
+        ctx->iv_off = n;
+        ctx->iv_len = 16;
+        break;
+
+    default:
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+
+static const struct hwcrypto_symmetric_ops aes_ops =
+{
+    .crypt = _aes_crypt,
+};
+#endif /* RT_HWCRYPTO_USING_AES */
+
+#if defined(RT_HWCRYPTO_USING_SHA2)
+struct soft_sha256
+{
+    rt_uint32_t state[8];
+    rt_uint32_t total;                  /**< The length of message in bytes */
+    rt_uint8_t buffer[64];
+};
+
+static const rt_uint32_t sha256_k[64] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+static const rt_uint32_t sha224_iv[8] =
+{
+    0xC1059ED8, 0x367CD507, 0x3070DD17, 0xF70E5939, 0xFFC00B31, 0x68581511, 0x64F98FA7, 0xBEFA4FA4,
+};
+
+static const rt_uint32_t sha256_iv[8] =
+{
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+#define SHA_ROTR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void _sha256_start(struct soft_sha256 *sha, hwcrypto_type type)
+{
+    rt_memcpy(sha->state, type == HWCRYPTO_TYPE_SHA224 ? sha224_iv : sha256_iv, sizeof(sha->state));
+    sha->total = 0;
+}
+
+static void _sha256_process(struct soft_sha256 *sha, const rt_uint8_t *data)
+{
+    rt_uint32_t w[64];
+    rt_uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        w[i] = SOFT_GET_U32(data + i * 4);
+    }
+    for (i = 16; i < 64; i++)
+    {
+        t1 = SHA_ROTR(w[i - 2], 17) ^ SHA_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        t2 = SHA_ROTR(w[i - 15], 7) ^ SHA_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        w[i] = t1 + w[i - 7] + t2 + w[i - 16];
+    }
+
+    a = sha->state[0]; b = sha->state[1]; c = sha->state[2]; d = sha->state[3];
+    e = sha->state[4]; f = sha->state[5]; g = sha->state[6]; h = sha->state[7];
+    for (i = 0; i < 64; i++)
+    {
+        t1 = h + (SHA_ROTR(e, 6) ^ SHA_ROTR(e, 11) ^ SHA_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        t2 = (SHA_ROTR(a, 2) ^ SHA_ROTR(a, 13) ^ SHA_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    sha->state[0] += a; sha->state[1] += b; sha->state[2] += c; sha->state[3] += d;
+    sha->state[4] += e; sha->state[5] += f; sha->state[6] += g; sha->state[7] += h;
+}
+
+static rt_err_t _sha256_update(struct hwcrypto_hash *ctx, const rt_uint8_t *in, rt_size_t length)
+{
+    struct soft_sha256 *sha = (struct soft_sha256 *)ctx->parent.contex;
+    rt_size_t left, fill;
+
+    left = sha->total & 0x3f;
+    sha->total += length;
+
+    if (left && length >= (fill = 64 - left))
+    {
+        rt_memcpy(sha->buffer + left, in, fill);
+        _sha256_process(sha, sha->buffer);
+        in += fill;
+        length -= fill;
+        left = 0;
+    }
+    while (length >= 64)
+    {
+        _sha256_process(sha, in);
+        in += 64;
+        length -= 64;
+    }
+    if (length > 0)
+    {
+        rt_memcpy(sha->buffer + left, in, length);
+    }
+
+    return RT_EOK;
+}
+
+static rt_err_t _sha256_finish(struct hwcrypto_hash *ctx, rt_uint8_t *out, rt_size_t length)
+{
+    struct soft_sha256 *sha = (struct soft_sha256 *)ctx->parent.contex;
+    rt_size_t size = ctx->parent.type == HWCRYPTO_TYPE_SHA224 ? 28 : 32;
+    rt_uint32_t left = sha->total & 0x3f;
+    rt_uint32_t bits = sha->total << 3;
+    rt_size_t i;
+
+    if (out == RT_NULL || length < size)
+    {
+        return -RT_EINVAL;
+    }
+
+    /* Padding with 0x80, zeros and the length of message in bits */
+    sha->buffer[left++] = 0x80;
+    if (left > 56)
+    {
+        rt_memset(sha->buffer + left, 0, 64 - left);
+        _sha256_process(sha, sha->buffer);
+        left = 0;
+    }
+    rt_memset(sha->buffer + left, 0, 56 - left);
+    SOFT_PUT_U32(sha->buffer + 56, sha->total >> 29);
+    SOFT_PUT_U32(sha->buffer + 60, bits);
+    _sha256_process(sha, sha->buffer);
+
+    for (i = 0; i < size; i += 4)
+    {
+        SOFT_PUT_U32(out + i, sha->state[i / 4]);
+    }
+
+    /* Ready for the next message */
+    _sha256_start(sha, ctx->parent.type);
+    return RT_EOK;
+}
+
+static const struct hwcrypto_hash_ops sha256_ops =
+{
+    .update = _sha256_update,
+    .finish = _sha256_finish,
+};
+#endif /* RT_HWCRYPTO_USING_SHA2 */
+
+static rt_size_t _soft_ctx_size(hwcrypto_type type)
+{
+    switch (type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(RT_HWCRYPTO_USING_CRC)
+    case HWCRYPTO_TYPE_CRC:
+        return _crc_size();
+#endif
+#if defined(RT_HWCRYPTO_USING_AES)
+    case HWCRYPTO_TYPE_AES:
+        return sizeof(struct soft_aes);
+#endif
+#if defined(RT_HWCRYPTO_USING_SHA2)
+    case HWCRYPTO_TYPE_SHA2:
+        if (type == HWCRYPTO_TYPE_SHA224 || type == HWCRYPTO_TYPE_SHA256)
+            return sizeof(struct soft_sha256);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static void _soft_ctx_reset(struct rt_hwcrypto_ctx *ctx)
+{
+    switch (ctx->type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(RT_HWCRYPTO_USING_CRC)
+    case HWCRYPTO_TYPE_CRC:
+        /* The register is crc_cfg.last_val, the table is kept for the same configure */
+        break;
+#endif
+#if defined(RT_HWCRYPTO_USING_AES)
+    case HWCRYPTO_TYPE_AES:
+        ((struct soft_aes *)ctx->contex)->nr = 0;
+        break;
+#endif
+#if defined(RT_HWCRYPTO_USING_SHA2)
+    case HWCRYPTO_TYPE_SHA2:
+        _sha256_start((struct soft_sha256 *)ctx->contex, ctx->type);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+static rt_err_t _soft_create(struct rt_hwcrypto_ctx *ctx)
+{
+    rt_size_t size = _soft_ctx_size(ctx->type);
+
+    if (size == 0)
+    {
+        return -RT_ERROR;
+    }
+    ctx->contex = rt_calloc(1, size);
+    if (ctx->contex == RT_NULL)
+    {
+        return -RT_ENOMEM;
+    }
+
+    switch (ctx->type & HWCRYPTO_MAIN_TYPE_MASK)
+    {
+#if defined(RT_HWCRYPTO_USING_CRC)
+    case HWCRYPTO_TYPE_CRC:
+#ifdef RT_HWCRYPTO_SOFT_CRC_SLICE8
+        ((struct soft_crc *)ctx->contex)->slices = 8;
+#else
+        ((struct soft_crc *)ctx->contex)->slices = 1;
+#endif
+        ((struct hwcrypto_crc *)ctx)->ops = &crc_ops;
+        break;
+#endif
+#if defined(RT_HWCRYPTO_USING_AES)
+    case HWCRYPTO_TYPE_AES:
+        ((struct hwcrypto_symmetric *)ctx)->ops = &aes_ops;
+        break;
+#endif
+#if defined(RT_HWCRYPTO_USING_SHA2)
+    case HWCRYPTO_TYPE_SHA2:
+        ((struct hwcrypto_hash *)ctx)->ops = &sha256_ops;
+        break;
+#endif
+    default:
+        break;
+    }
+    _soft_ctx_reset(ctx);
+
+    return RT_EOK;
+}
+
+static void _soft_destroy(struct rt_hwcrypto_ctx *ctx)
+{
+    rt_free(ctx->contex);
+    ctx->contex = RT_NULL;
+}
+
+static rt_err_t _soft_copy(struct rt_hwcrypto_ctx *des, const struct rt_hwcrypto_ctx *src)
+{
+    rt_size_t size = _soft_ctx_size(src->type);
+
+    if (des->contex == RT_NULL || src->contex == RT_NULL || size == 0)
+    {
+        return -RT_ERROR;
+    }
+    rt_memcpy(des->contex, src->contex, size);
+
+    return RT_EOK;
+}
+
+static const struct rt_hwcrypto_ops _soft_ops =
+{
+    .create = _soft_create,
+    .destroy = _soft_destroy,
+    .copy = _soft_copy,
+    .reset = _soft_ctx_reset,
+};
+
+static struct rt_hwcrypto_device _soft_dev;
+
+/**
+ * @brief           Get the software crypto device
+ *
+ * @return          Software crypto device, RT_NULL if it is not registered
+ */
+struct rt_hwcrypto_device *rt_hwcrypto_dev_soft(void)
+{
+    return _soft_dev.ops ? &_soft_dev : RT_NULL;
+}
+
+/**
+ * @brief           Register the software crypto device
+ *
+ * @return          RT_EOK on success.
+ */
+int rt_hwcrypto_soft_init(void)
+{
+    if (_soft_dev.ops != RT_NULL)
+    {
+        return RT_EOK;
+    }
+
+#if defined(RT_HWCRYPTO_USING_AES)
+    _aes_gen_tables();
+#endif
+
+    _soft_dev.ops = &_soft_ops;
+    _soft_dev.id = 0;
+    _soft_dev.user_data = RT_NULL;
+    if (rt_hwcrypto_register(&_soft_dev, RT_HWCRYPTO_SOFT_NAME) != RT_EOK)
+    {
+        LOG_E("register %s failed", RT_HWCRYPTO_SOFT_NAME);
+        _soft_dev.ops = RT_NULL;
+        return -RT_ERROR;
+    }
+
+    return RT_EOK;
+}
+INIT_DEVICE_EXPORT(rt_hwcrypto_soft_init);
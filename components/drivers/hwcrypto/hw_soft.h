@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2006-2019, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-10     RT-Thread    the first version
+ */
+
+#ifndef __HW_SOFT_H__
+#define __HW_SOFT_H__
+
+#include <hwcrypto.h>
+
+#ifndef RT_HWCRYPTO_SOFT_NAME
+#define RT_HWCRYPTO_SOFT_NAME   ("swcrypto")
+#endif
+#ifndef RT_HWCRYPTO_SOFT_DEPTH
+#define RT_HWCRYPTO_SOFT_DEPTH  (1)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief           Register the software crypto device
+ *
+ * @return          RT_EOK on success.
+ */
+int rt_hwcrypto_soft_init(void);
+
+/**
+ * @brief           Get the software crypto device
+ *
+ * @return          Software crypto device, RT_NULL if it is not registered
+ */
+struct rt_hwcrypto_device *rt_hwcrypto_dev_soft(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
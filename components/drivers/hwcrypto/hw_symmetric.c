@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-04-25     tyx          the first version
+ * 2019-10-10     RT-Thread    count the requests in progress
  */
 
 #include <rtthread.h>
@@ -76,7 +77,9 @@ rt_err_t rt_hwcrypto_symmetric_crypt(struct rt_hwcrypto_ctx *ctx, hwcrypto_mode
     symmetric_info.length = length;
 
     /* Calling Hardware Encryption and Decryption Function */
+    rt_hwcrypto_dev_enter(ctx->device);
     err = symmetric_ctx->ops->crypt(symmetric_ctx, &symmetric_info);
+    rt_hwcrypto_dev_leave(ctx->device);
 
     /* clean up flags */
     symmetric_ctx->flags &= ~(SYMMTRIC_MODIFY_KEY | SYMMTRIC_MODIFY_IV | SYMMTRIC_MODIFY_IVOFF);
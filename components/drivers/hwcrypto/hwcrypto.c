@@ -6,11 +6,16 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-04-23     tyx          the first version
+ * 2019-10-10     RT-Thread    add the depth of device and the software fallback
  */
 
+#include <rthw.h>
 #include <rtthread.h>
 #include <rtdevice.h>
 #include <hwcrypto.h>
+#ifdef RT_HWCRYPTO_USING_SOFT
+#include <hw_soft.h>
+#endif
 
 /**
  * @brief           Setting context type (Direct calls are not recommended)
@@ -111,6 +116,14 @@ struct rt_hwcrypto_ctx *rt_hwcrypto_ctx_create(struct rt_hwcrypto_device *device
     rt_memset(ctx, 0, obj_size);
     /* Init context */
     err = rt_hwcrypto_ctx_init(ctx, device, type);
+#ifdef RT_HWCRYPTO_USING_SOFT
+    /* The type is not supported by the device, do it by software */
+    if (err != RT_EOK && rt_hwcrypto_dev_soft() != RT_NULL && device != rt_hwcrypto_dev_soft())
+    {
+        rt_memset(ctx, 0, obj_size);
+        err = rt_hwcrypto_ctx_init(ctx, rt_hwcrypto_dev_soft(), type);
+    }
+#endif
     if (err != RT_EOK)
     {
         rt_free(ctx);
@@ -182,9 +195,64 @@ struct rt_hwcrypto_device *rt_hwcrypto_dev_default(void)
     }
     /* Find by default device name */
     hwcrypto_dev = (struct rt_hwcrypto_device *)rt_device_find(RT_HWCRYPTO_DEFAULT_NAME);
+#ifdef RT_HWCRYPTO_USING_SOFT
+    /* There is no hardware, use the software device */
+    if (hwcrypto_dev == RT_NULL)
+    {
+        return rt_hwcrypto_dev_soft();
+    }
+#endif
     return hwcrypto_dev;
 }
 
+/**
+ * @brief           Select the device for a request, the software device is
+ *                  selected when the hardware is absent or busy
+ *
+ * @return          Crypto device
+ */
+struct rt_hwcrypto_device *rt_hwcrypto_dev_select(void)
+{
+    struct rt_hwcrypto_device *device = rt_hwcrypto_dev_default();
+
+#ifdef RT_HWCRYPTO_USING_SOFT
+    /* The hardware has RT_HWCRYPTO_SOFT_DEPTH requests, the new one is not queued */
+    if (device == RT_NULL || device->depth >= RT_HWCRYPTO_SOFT_DEPTH)
+    {
+        device = rt_hwcrypto_dev_soft();
+    }
+#endif
+    return device;
+}
+
+/**
+ * @brief           A request enters the device
+ *
+ * @param device    Crypto device
+ */
+void rt_hwcrypto_dev_enter(struct rt_hwcrypto_device *device)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    device->depth ++;
+    rt_hw_interrupt_enable(level);
+}
+
+/**
+ * @brief           A request leaves the device
+ *
+ * @param device    Crypto device
+ */
+void rt_hwcrypto_dev_leave(struct rt_hwcrypto_device *device)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    device->depth --;
+    rt_hw_interrupt_enable(level);
+}
+
 /**
  * @brief           Get the unique ID of the device
  *
@@ -247,6 +315,7 @@ rt_err_t rt_hwcrypto_register(struct rt_hwcrypto_device *device, const char *nam
 
     device->parent.user_data  = RT_NULL;
     device->parent.type = RT_Device_Class_Miscellaneous;
+    device->depth = 0;
 
     /* Register device */
     err = rt_device_register(&device->parent, name, RT_DEVICE_FLAG_RDWR);
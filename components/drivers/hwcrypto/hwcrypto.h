@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-04-23     tyx          the first version
+ * 2019-10-10     RT-Thread    add the depth of device and the software fallback
  */
 
 #ifndef __HWCRYPTO_H__
@@ -91,6 +92,7 @@ struct rt_hwcrypto_device
     const struct rt_hwcrypto_ops *ops;                  /**< Hardware crypto ops */
     rt_uint64_t id;                                     /**< Unique id */
     void *user_data;                                    /**< Device user data */
+    volatile rt_uint32_t depth;                         /**< The requests in progress or waiting */
 };
 
 struct rt_hwcrypto_ctx
@@ -177,6 +179,28 @@ rt_err_t rt_hwcrypto_register(struct rt_hwcrypto_device *device, const char *nam
  */
 struct rt_hwcrypto_device *rt_hwcrypto_dev_default(void);
 
+/**
+ * @brief           Select the device for a request, the software device is
+ *                  selected when the hardware is absent or busy
+ *
+ * @return          Crypto device
+ */
+struct rt_hwcrypto_device *rt_hwcrypto_dev_select(void);
+
+/**
+ * @brief           A request enters the device (Direct calls are not recommended)
+ *
+ * @param device    Crypto device
+ */
+void rt_hwcrypto_dev_enter(struct rt_hwcrypto_device *device);
+
+/**
+ * @brief           A request leaves the device (Direct calls are not recommended)
+ *
+ * @param device    Crypto device
+ */
+void rt_hwcrypto_dev_leave(struct rt_hwcrypto_device *device);
+
 /**
  * @brief           Get the unique ID of the device
  *
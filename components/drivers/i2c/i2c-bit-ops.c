@@ -6,8 +6,10 @@
  * Change Logs:
  * Date           Author        Notes
  * 2012-04-25     weety         first version
+ * 2019-10-17     RT-Thread     add timer driven state machine
  */
 
+#include <rthw.h>
 #include <rtdevice.h>
 
 #ifdef RT_I2C_BIT_DEBUG
@@ -427,11 +429,560 @@ out:
     return ret;
 }
 
+#ifdef RT_USING_I2C_ASYNC
+/*
+ * The asynchronous transfer is a state machine, every step drives one edge of
+ * SCL or SDA and it's stepped by a timer every half of delay_us, instead of
+ * spinning in i2c_delay() between the edges.
+ */
+enum
+{
+    BIT_STATE_IDLE = 0,
+    BIT_STATE_START,
+    BIT_STATE_RESTART,
+    BIT_STATE_ADDR,
+    BIT_STATE_WRITE,
+    BIT_STATE_READ,
+    BIT_STATE_STOP,
+};
+
+/* the byte or the edge is not finished */
+#define BIT_PENDING         (-RT_EBUSY)
+
+struct i2c_bit_fsm
+{
+    struct rt_i2c_bus_device *bus;
+    struct rt_timer timer;
+#ifdef RT_USING_HWTIMER
+    rt_device_t hwtimer;
+    struct i2c_bit_fsm *next;       /* the state machines stepped by hwtimer */
+#endif
+
+    struct rt_i2c_msg *msgs;
+    rt_uint32_t num;
+    rt_uint32_t index;              /* the message in transfer */
+    rt_uint32_t pos;                /* the byte of message */
+    rt_int32_t result;
+
+    rt_uint8_t state;
+    rt_uint8_t phase;               /* the edge in state */
+    rt_uint8_t addr[3];             /* the 10-bit read address is 3 bytes */
+    rt_uint8_t addr_num;
+    rt_uint8_t addr_pos;
+    rt_uint8_t retry;               /* the address is sent again after stop and start */
+    rt_uint32_t retries;
+    rt_bool_t stretched;
+    rt_tick_t scl_start;
+};
+
+#ifdef RT_USING_HWTIMER
+static struct i2c_bit_fsm *hwtimer_fsm_list = RT_NULL;
+#endif
+
+/**
+ * release scl line, BIT_PENDING when it's stretched by slave.
+ */
+static rt_err_t fsm_scl_h(struct i2c_bit_fsm *fsm, struct rt_i2c_bit_ops *ops)
+{
+    SET_SCL(ops, 1);
+
+    if (!ops->get_scl || GET_SCL(ops))
+    {
+        fsm->stretched = RT_FALSE;
+        return RT_EOK;
+    }
+
+    if (!fsm->stretched)
+    {
+        fsm->stretched = RT_TRUE;
+        fsm->scl_start = rt_tick_get();
+    }
+    else if ((rt_tick_get() - fsm->scl_start) > ops->timeout)
+    {
+        bit_dbg("wait scl pin high timeout\n");
+
+        return -RT_ETIMEOUT;
+    }
+
+    return BIT_PENDING;
+}
+
+/* return 1 on ACK, 0 on NACK */
+static rt_int32_t fsm_writeb(struct i2c_bit_fsm *fsm, struct rt_i2c_bit_ops *ops, rt_uint8_t data)
+{
+    rt_uint8_t phase = fsm->phase;
+    rt_int32_t ret;
+
+    if (phase < 16)
+    {
+        if (phase & 1)
+        {
+            ret = fsm_scl_h(fsm, ops);
+            if (ret != RT_EOK)
+                return ret;
+        }
+        else
+        {
+            SCL_L(ops);
+            SET_SDA(ops, (data >> (7 - (phase >> 1))) & 1);
+        }
+    }
+    else if (phase == 16)
+    {
+        SCL_L(ops);
+    }
+    else if (phase == 17)
+    {
+        SDA_H(ops);
+    }
+    else if (phase == 18)
+    {
+        ret = fsm_scl_h(fsm, ops);
+        if (ret != RT_EOK)
+            return ret;
+    }
+    else
+    {
+        ret = !GET_SDA(ops);    /* ACK : SDA pin is pulled low */
+        SCL_L(ops);
+        fsm->phase = 0;
+
+        return ret;
+    }
+    fsm->phase ++;
+
+    return BIT_PENDING;
+}
+
+/* the byte is received into buf, ACK or NACK is sent unless ack < 0 */
+static rt_int32_t fsm_readb(struct i2c_bit_fsm *fsm, struct rt_i2c_bit_ops *ops, rt_uint8_t *buf, rt_int32_t ack)
+{
+    rt_uint8_t phase = fsm->phase;
+    rt_int32_t ret;
+
+    if (phase == 0)
+    {
+        SDA_H(ops);
+        *buf = 0;
+    }
+    else if (phase <= 16)
+    {
+        if (phase & 1)
+        {
+            ret = fsm_scl_h(fsm, ops);
+            if (ret != RT_EOK)
+                return ret;
+        }
+        else
+        {
+            *buf = (*buf << 1) | (GET_SDA(ops) ? 1 : 0);
+            SCL_L(ops);
+            if (phase == 16 && ack < 0)
+            {
+                fsm->phase = 0;
+                return RT_EOK;
+            }
+        }
+    }
+    else if (phase == 17)
+    {
+        if (ack)
+            SDA_L(ops);
+    }
+    else if (phase == 18)
+    {
+        ret = fsm_scl_h(fsm, ops);
+        if (ret != RT_EOK)
+            return ret;
+    }
+    else
+    {
+        SCL_L(ops);
+        fsm->phase = 0;
+
+        return RT_EOK;
+    }
+    fsm->phase ++;
+
+    return BIT_PENDING;
+}
+
+static void fsm_stop(struct i2c_bit_fsm *fsm, rt_int32_t result)
+{
+    bit_dbg("send stop condition\n");
+    fsm->result = result;
+    fsm->state = BIT_STATE_STOP;
+    fsm->phase = 0;
+}
+
+static void fsm_begin(struct i2c_bit_fsm *fsm, rt_uint32_t index);
+
+/* the data of message after the address */
+static void fsm_data(struct i2c_bit_fsm *fsm)
+{
+    struct rt_i2c_msg *msg = &fsm->msgs[fsm->index];
+
+    fsm->pos = 0;
+    fsm->phase = 0;
+    if (msg->len == 0)
+        fsm_begin(fsm, fsm->index + 1);
+    else
+        fsm->state = (msg->flags & RT_I2C_RD) ? BIT_STATE_READ : BIT_STATE_WRITE;
+}
+
+static void fsm_begin(struct i2c_bit_fsm *fsm, rt_uint32_t index)
+{
+    struct rt_i2c_msg *msg;
+
+    fsm->index = index;
+    fsm->phase = 0;
+    if (index == fsm->num)
+    {
+        fsm_stop(fsm, index);
+        return;
+    }
+
+    msg = &fsm->msgs[index];
+    if (msg->flags & RT_I2C_NO_START)
+    {
+        fsm_data(fsm);
+        return;
+    }
+
+    if (msg->flags & RT_I2C_ADDR_10BIT)
+    {
+        fsm->addr[0] = 0xf0 | ((msg->addr >> 7) & 0x06);
+        fsm->addr[1] = msg->addr & 0xff;
+        fsm->addr[2] = fsm->addr[0] | 0x01;
+        fsm->addr_num = (msg->flags & RT_I2C_RD) ? 3 : 2;
+    }
+    else
+    {
+        fsm->addr[0] = (msg->addr << 1) | ((msg->flags & RT_I2C_RD) ? 1 : 0);
+        fsm->addr_num = 1;
+    }
+    fsm->addr_pos = 0;
+    fsm->retries = (msg->flags & RT_I2C_IGNORE_NACK) ? 0 : fsm->bus->retries;
+    fsm->state = index ? BIT_STATE_RESTART : BIT_STATE_ADDR;
+}
+
+static void fsm_timer_stop(struct i2c_bit_fsm *fsm)
+{
+#ifdef RT_USING_HWTIMER
+    if (fsm->hwtimer)
+    {
+        rt_device_control(fsm->hwtimer, HWTIMER_CTRL_STOP, RT_NULL);
+        return;
+    }
+#endif
+    rt_timer_stop(&fsm->timer);
+}
+
+static rt_err_t fsm_timer_start(struct i2c_bit_fsm *fsm)
+{
+#ifdef RT_USING_HWTIMER
+    if (fsm->hwtimer)
+    {
+        struct rt_i2c_bit_ops *ops = (struct rt_i2c_bit_ops *)fsm->bus->priv;
+        rt_hwtimerval_t val;
+
+        val.sec = 0;
+        val.usec = (ops->delay_us + 1) >> 1;
+        if (val.usec == 0)
+            val.usec = 1;
+
+        return rt_device_write(fsm->hwtimer, 0, &val, sizeof(val)) == sizeof(val) ? RT_EOK : -RT_EIO;
+    }
+#endif
+    return rt_timer_start(&fsm->timer);
+}
+
+static void fsm_step(struct i2c_bit_fsm *fsm)
+{
+    struct rt_i2c_bit_ops *ops = (struct rt_i2c_bit_ops *)fsm->bus->priv;
+    struct rt_i2c_msg *msg = &fsm->msgs[fsm->index];
+    rt_int32_t ret;
+
+    switch (fsm->state)
+    {
+    case BIT_STATE_START:
+        if (fsm->phase == 0)
+        {
+            bit_dbg("send start condition\n");
+            SDA_L(ops);
+            fsm->phase ++;
+            break;
+        }
+
+        SCL_L(ops);
+        if (fsm->retry)
+        {
+            /* send the address again */
+            fsm->retry = 0;
+            fsm->addr_pos = 0;
+            fsm->phase = 0;
+            fsm->state = BIT_STATE_ADDR;
+        }
+        else
+        {
+            fsm_begin(fsm, 0);
+        }
+        break;
+
+    case BIT_STATE_RESTART:
+        if (fsm->phase == 0)
+        {
+            SDA_H(ops);
+        }
+        else if (fsm->phase == 1)
+        {
+            ret = fsm_scl_h(fsm, ops);
+            if (ret == BIT_PENDING)
+                break;
+            if (ret < 0)
+            {
+                fsm_stop(fsm, ret);
+                break;
+            }
+        }
+        else if (fsm->phase == 2)
+        {
+            SDA_L(ops);
+        }
+        else
+        {
+            SCL_L(ops);
+            fsm->phase = 0;
+            fsm->state = BIT_STATE_ADDR;
+            break;
+        }
+        fsm->phase ++;
+        break;
+
+    case BIT_STATE_ADDR:
+        ret = fsm_writeb(fsm, ops, fsm->addr[fsm->addr_pos]);
+        if (ret == BIT_PENDING)
+            break;
+        if (ret < 0)
+        {
+            fsm_stop(fsm, ret);
+            break;
+        }
+
+        if (ret == 0 && !(msg->flags & RT_I2C_IGNORE_NACK))
+        {
+            /* the second byte of 10-bit address is not sent again */
+            if (fsm->addr_pos != 1 && fsm->retries > 0)
+            {
+                fsm->retries --;
+                fsm->retry = 1;
+                fsm_stop(fsm, 0);
+            }
+            else
+            {
+                bit_dbg("receive NACK from device addr 0x%02x msg %d\n",
+                        msg->addr, fsm->index);
+                fsm_stop(fsm, -RT_EIO);
+            }
+            break;
+        }
+
+        fsm->addr_pos ++;
+        if (fsm->addr_pos == fsm->addr_num)
+        {
+            fsm_data(fsm);
+        }
+        else if (fsm->addr_pos == 2)
+        {
+            bit_dbg("send repeated start condition\n");
+            fsm->state = BIT_STATE_RESTART;
+        }
+        break;
+
+    case BIT_STATE_WRITE:
+        ret = fsm_writeb(fsm, ops, msg->buf[fsm->pos]);
+        if (ret == BIT_PENDING)
+            break;
+        if (ret < 0)
+        {
+            fsm_stop(fsm, ret);
+            break;
+        }
+        if (ret == 0 && !(msg->flags & RT_I2C_IGNORE_NACK))
+        {
+            i2c_dbg("send bytes: NACK.\n");
+            fsm_stop(fsm, -RT_ERROR);
+            break;
+        }
+
+        fsm->pos ++;
+        if (fsm->pos == msg->len)
+            fsm_begin(fsm, fsm->index + 1);
+        break;
+
+    case BIT_STATE_READ:
+        ret = fsm_readb(fsm, ops, &msg->buf[fsm->pos],
+                        (msg->flags & RT_I2C_NO_READ_ACK) ? -1 : (fsm->pos + 1 < msg->len));
+        if (ret == BIT_PENDING)
+            break;
+        if (ret < 0)
+        {
+            fsm_stop(fsm, ret);
+            break;
+        }
+
+        fsm->pos ++;
+        if (fsm->pos == msg->len)
+            fsm_begin(fsm, fsm->index + 1);
+        break;
+
+    case BIT_STATE_STOP:
+        if (fsm->phase == 0)
+        {
+            SDA_L(ops);
+        }
+        else if (fsm->phase == 1)
+        {
+            /* the stop is sent even if the clock is held by slave */
+            if (fsm_scl_h(fsm, ops) == BIT_PENDING)
+                break;
+            fsm->stretched = RT_FALSE;
+        }
+        else if (fsm->phase == 2)
+        {
+            SDA_H(ops);
+        }
+        else if (fsm->retry)
+        {
+            fsm->phase = 0;
+            fsm->state = BIT_STATE_START;
+            break;
+        }
+        else
+        {
+            fsm->state = BIT_STATE_IDLE;
+            fsm_timer_stop(fsm);
+            rt_i2c_bus_xfer_done(fsm->bus, fsm->result);
+            break;
+        }
+        fsm->phase ++;
+        break;
+
+    default:
+        fsm_timer_stop(fsm);
+        break;
+    }
+}
+
+static void fsm_timeout(void *parameter)
+{
+    fsm_step((struct i2c_bit_fsm *)parameter);
+}
+
+#ifdef RT_USING_HWTIMER
+static rt_err_t fsm_hwtimeout(rt_device_t dev, rt_size_t size)
+{
+    struct i2c_bit_fsm *fsm;
+
+    for (fsm = hwtimer_fsm_list; fsm != RT_NULL; fsm = fsm->next)
+    {
+        if (fsm->hwtimer == dev)
+        {
+            fsm_step(fsm);
+            break;
+        }
+    }
+
+    return RT_EOK;
+}
+
+static rt_device_t fsm_hwtimer_open(const char *name)
+{
+    rt_hwtimer_mode_t mode = HWTIMER_MODE_PERIOD;
+    rt_device_t dev;
+
+    dev = rt_device_find(name);
+    if (dev == RT_NULL || rt_device_open(dev, RT_DEVICE_OFLAG_RDWR) != RT_EOK)
+    {
+        bit_dbg("hwtimer %s is not available\n", name);
+
+        return RT_NULL;
+    }
+    rt_device_control(dev, HWTIMER_CTRL_MODE_SET, &mode);
+    rt_device_set_rx_indicate(dev, fsm_hwtimeout);
+
+    return dev;
+}
+#endif /* RT_USING_HWTIMER */
+
+static rt_err_t i2c_bit_xfer_async(struct rt_i2c_bus_device *bus,
+                                   struct rt_i2c_msg         msgs[],
+                                   rt_uint32_t               num)
+{
+    struct rt_i2c_bit_ops *ops = (struct rt_i2c_bit_ops *)bus->priv;
+    struct i2c_bit_fsm *fsm = (struct i2c_bit_fsm *)ops->fsm;
+
+    if (fsm == RT_NULL || fsm->state != BIT_STATE_IDLE || num == 0)
+        return -RT_EBUSY;
+
+    fsm->msgs = msgs;
+    fsm->num = num;
+    fsm->index = 0;
+    fsm->result = 0;
+    fsm->retry = 0;
+    fsm->stretched = RT_FALSE;
+    fsm->phase = 0;
+    fsm->state = BIT_STATE_START;
+
+    if (fsm_timer_start(fsm) != RT_EOK)
+    {
+        fsm->state = BIT_STATE_IDLE;
+        return -RT_EIO;
+    }
+
+    return RT_EOK;
+}
+
+static void i2c_bit_fsm_init(struct rt_i2c_bus_device *bus, const char *bus_name)
+{
+    struct rt_i2c_bit_ops *ops = (struct rt_i2c_bit_ops *)bus->priv;
+    struct i2c_bit_fsm *fsm;
+
+    /* the transfers are done by i2c_bit_xfer without state machine */
+    fsm = (struct i2c_bit_fsm *)rt_malloc(sizeof(struct i2c_bit_fsm));
+    if (fsm == RT_NULL)
+        return;
+    rt_memset(fsm, 0, sizeof(struct i2c_bit_fsm));
+    fsm->bus = bus;
+    rt_timer_init(&fsm->timer, bus_name, fsm_timeout, fsm, 1,
+                  RT_TIMER_FLAG_PERIODIC | RT_TIMER_FLAG_HARD_TIMER);
+
+#ifdef RT_USING_HWTIMER
+    if (ops->timer_name != RT_NULL)
+    {
+        fsm->hwtimer = fsm_hwtimer_open(ops->timer_name);
+        if (fsm->hwtimer != RT_NULL)
+        {
+            rt_base_t level = rt_hw_interrupt_disable();
+            fsm->next = hwtimer_fsm_list;
+            hwtimer_fsm_list = fsm;
+            rt_hw_interrupt_enable(level);
+        }
+    }
+#endif
+
+    ops->fsm = fsm;
+}
+#endif /* RT_USING_I2C_ASYNC */
+
 static const struct rt_i2c_bus_device_ops i2c_bit_bus_ops =
 {
     i2c_bit_xfer,
     RT_NULL,
-    RT_NULL
+    RT_NULL,
+#ifdef RT_USING_I2C_ASYNC
+    i2c_bit_xfer_async,
+#endif
 };
 
 rt_err_t rt_i2c_bit_add_bus(struct rt_i2c_bus_device *bus,
@@ -439,5 +990,9 @@ rt_err_t rt_i2c_bit_add_bus(struct rt_i2c_bus_device *bus,
 {
     bus->ops = &i2c_bit_bus_ops;
 
+#ifdef RT_USING_I2C_ASYNC
+    i2c_bit_fsm_init(bus, bus_name);
+#endif
+
     return rt_i2c_bus_device_register(bus, bus_name);
 }
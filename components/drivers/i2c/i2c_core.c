@@ -6,10 +6,80 @@
  * Change Logs:
  * Date           Author        Notes
  * 2012-04-25     weety         first version
+ * 2019-10-17     RT-Thread     add asynchronous transfer queue
+ * 2019-10-26     RT-Thread     no blocking transfer in interrupt, queue in interrupt
+ * 2019-10-28     RT-Thread     start the transfers queued in interrupt after unlock
  */
 
+#include <rthw.h>
 #include <rtdevice.h>
 
+#ifdef RT_USING_I2C_ASYNC
+/* take the bus lock, the interrupt queues the transfers until it's released */
+static rt_err_t _i2c_bus_take(struct rt_i2c_bus_device *bus)
+{
+    rt_err_t result;
+    rt_base_t level;
+
+    result = rt_mutex_take(&bus->lock, RT_WAITING_FOREVER);
+    if (result == RT_EOK)
+    {
+        level = rt_hw_interrupt_disable();
+        bus->async_locked ++;
+        rt_hw_interrupt_enable(level);
+    }
+
+    return result;
+}
+
+static void _i2c_async_start(struct rt_i2c_bus_device *bus);
+#endif
+
+/* take the bus lock, the asynchronous transfers on bus are waited */
+static rt_err_t _i2c_bus_lock(struct rt_i2c_bus_device *bus)
+{
+    rt_err_t result;
+
+#ifdef RT_USING_I2C_ASYNC
+    result = _i2c_bus_take(bus);
+    if (result == RT_EOK)
+    {
+        while (bus->async_current != RT_NULL)
+        {
+            rt_completion_wait(&bus->async_idle, RT_WAITING_FOREVER);
+        }
+    }
+#else
+    result = rt_mutex_take(&bus->lock, RT_WAITING_FOREVER);
+#endif
+
+    return result;
+}
+
+/*
+ * release the bus lock, the transfers queued in interrupt meanwhile are
+ * started after it. The queue keeps the bus until it's empty, so they are
+ * started without the lock.
+ */
+static void _i2c_bus_unlock(struct rt_i2c_bus_device *bus)
+{
+#ifdef RT_USING_I2C_ASYNC
+    rt_bool_t unlocked;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    unlocked = (-- bus->async_locked == 0);
+    rt_hw_interrupt_enable(level);
+#endif
+
+    rt_mutex_release(&bus->lock);
+
+#ifdef RT_USING_I2C_ASYNC
+    if (unlocked)
+        _i2c_async_start(bus);
+#endif
+}
+
 rt_err_t rt_i2c_bus_device_register(struct rt_i2c_bus_device *bus,
                                     const char               *bus_name)
 {
@@ -19,6 +89,13 @@ rt_err_t rt_i2c_bus_device_register(struct rt_i2c_bus_device *bus,
 
     if (bus->timeout == 0) bus->timeout = RT_TICK_PER_SECOND;
 
+#ifdef RT_USING_I2C_ASYNC
+    rt_list_init(&bus->async_queue);
+    bus->async_current = RT_NULL;
+    rt_completion_init(&bus->async_idle);
+    bus->async_locked = 0;
+#endif
+
     res = rt_i2c_bus_device_device_init(bus, bus_name);
 
     i2c_dbg("I2C bus [%s] registered\n", bus_name);
@@ -59,9 +136,9 @@ rt_size_t rt_i2c_transfer(struct rt_i2c_bus_device *bus,
         }
 #endif
 
-        rt_mutex_take(&bus->lock, RT_WAITING_FOREVER);
+        _i2c_bus_lock(bus);
         ret = bus->ops->master_xfer(bus, msgs, num);
-        rt_mutex_release(&bus->lock);
+        _i2c_bus_unlock(bus);
 
         return ret;
     }
@@ -113,6 +190,186 @@ rt_size_t rt_i2c_master_recv(struct rt_i2c_bus_device *bus,
     return (ret > 0) ? count : ret;
 }
 
+#ifdef RT_USING_I2C_ASYNC
+static void _i2c_async_result(struct rt_i2c_async *async, rt_int32_t ret)
+{
+    if (ret < 0)
+    {
+        async->count = 0;
+        async->result = ret;
+    }
+    else
+    {
+        async->count = ret;
+        async->result = (async->count == async->num) ? RT_EOK : -RT_EIO;
+    }
+}
+
+static void _i2c_async_notify(struct rt_i2c_async *async)
+{
+    rt_i2c_async_callback_t callback = async->callback;
+    struct rt_completion *completion = async->completion;
+
+    /* it can be queued again from now */
+    async->bus = RT_NULL;
+
+    if (callback != RT_NULL)
+        callback(async);
+    if (completion != RT_NULL)
+        rt_completion_done(completion);
+}
+
+/* take the next transfer in queue, it's on bus */
+static struct rt_i2c_async *_i2c_async_next(struct rt_i2c_bus_device *bus)
+{
+    struct rt_i2c_async *async = RT_NULL;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    if (!rt_list_isempty(&bus->async_queue))
+    {
+        async = rt_list_first_entry(&bus->async_queue, struct rt_i2c_async, list);
+        rt_list_remove(&async->list);
+    }
+    bus->async_current = async;
+    rt_hw_interrupt_enable(level);
+
+    return async;
+}
+
+/*
+ * start the transfers on bus until a transaction is in progress or the queue
+ * is empty, the async is the transfer which is on bus. The transfers which the
+ * driver can't start are transferred by master_xfer with the bus lock taken,
+ * or they are failed in interrupt.
+ */
+static void _i2c_async_run(struct rt_i2c_bus_device *bus, struct rt_i2c_async *async, rt_bool_t in_isr)
+{
+    struct rt_i2c_async *next;
+    rt_base_t level;
+    rt_err_t result;
+
+    while (async != RT_NULL)
+    {
+        /* the done interrupt must be after the starting returns */
+        level = rt_hw_interrupt_disable();
+        result = bus->ops->master_xfer_async(bus, async->msgs, async->num);
+        rt_hw_interrupt_enable(level);
+        if (result == RT_EOK)
+            return;
+
+        if (in_isr)
+            _i2c_async_result(async, result);
+        else
+            _i2c_async_result(async, bus->ops->master_xfer(bus, async->msgs, async->num));
+        next = _i2c_async_next(bus);
+        _i2c_async_notify(async);
+        async = next;
+    }
+
+    if (bus->async_current == RT_NULL)
+        rt_completion_done(&bus->async_idle);
+}
+
+/* start the queue if the bus is idle and not locked, the lock waits for the queue from now */
+static void _i2c_async_start(struct rt_i2c_bus_device *bus)
+{
+    struct rt_i2c_async *async = RT_NULL;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    if (bus->async_current == RT_NULL && bus->async_locked == 0 &&
+        !rt_list_isempty(&bus->async_queue))
+    {
+        async = rt_list_first_entry(&bus->async_queue, struct rt_i2c_async, list);
+        rt_list_remove(&async->list);
+        bus->async_current = async;
+    }
+    rt_hw_interrupt_enable(level);
+
+    if (async != RT_NULL)
+        _i2c_async_run(bus, async, RT_FALSE);
+}
+
+void rt_i2c_bus_xfer_done(struct rt_i2c_bus_device *bus, rt_int32_t ret)
+{
+    struct rt_i2c_async *async, *next;
+
+    RT_ASSERT(bus != RT_NULL);
+    RT_ASSERT(bus->async_current != RT_NULL);
+
+    async = bus->async_current;
+    _i2c_async_result(async, ret);
+    next = _i2c_async_next(bus);
+    _i2c_async_notify(async);
+
+    /* the next transaction is started in interrupt, the bus is kept busy */
+    _i2c_async_run(bus, next, RT_TRUE);
+}
+
+rt_err_t rt_i2c_transfer_async(struct rt_i2c_bus_device *bus,
+                               struct rt_i2c_async      *async)
+{
+    rt_err_t result;
+    rt_base_t level;
+    rt_bool_t start = RT_FALSE;
+    rt_bool_t in_isr = (rt_interrupt_get_nest() != 0);
+
+    RT_ASSERT(bus != RT_NULL);
+    RT_ASSERT(async != RT_NULL);
+    RT_ASSERT(async->msgs != RT_NULL);
+
+    if (async->bus != RT_NULL)
+        return -RT_EBUSY;
+
+    if (bus->ops->master_xfer_async == RT_NULL)
+    {
+        /* the bus lock can't be taken in interrupt */
+        if (in_isr)
+            return -RT_ENOSYS;
+
+        /* the bus driver doesn't support, it's transferred now */
+        _i2c_async_result(async, rt_i2c_transfer(bus, async->msgs, async->num));
+        _i2c_async_notify(async);
+
+        return RT_EOK;
+    }
+
+    /* the bus is not taken by synchronous transfers */
+    if (!in_isr)
+    {
+        result = _i2c_bus_take(bus);
+        if (result != RT_EOK)
+            return -RT_EBUSY;
+    }
+
+    async->bus = bus;
+    async->result = RT_EOK;
+    async->count = 0;
+
+    level = rt_hw_interrupt_disable();
+    /* in interrupt, it's started when the synchronous transfer releases the bus */
+    if (bus->async_current == RT_NULL && (!in_isr || bus->async_locked == 0))
+    {
+        bus->async_current = async;
+        start = RT_TRUE;
+    }
+    else
+    {
+        rt_list_insert_before(&bus->async_queue, &async->list);
+    }
+    rt_hw_interrupt_enable(level);
+
+    if (start)
+        _i2c_async_run(bus, async, in_isr);
+
+    if (!in_isr)
+        _i2c_bus_unlock(bus);
+
+    return RT_EOK;
+}
+#endif /* RT_USING_I2C_ASYNC */
+
 int rt_i2c_core_init(void)
 {
     return 0;
@@ -7,6 +7,8 @@
  * Date           Author       Notes
  * 2017-05-09     Urey         first version
  * 2019-07-09     Zero-Free    improve device ops interface and data flows
+ * 2019-10-14     RT-Thread    add the period ring and mixer of replay
+ * 2019-10-26     RT-Thread    add the lock of mixer channel
  *
  */
 
@@ -23,6 +25,7 @@
 #define AUDIO_CTL_START                     _AUDIO_CTL(3)
 #define AUDIO_CTL_STOP                      _AUDIO_CTL(4)
 #define AUDIO_CTL_GETBUFFERINFO             _AUDIO_CTL(5)
+#define AUDIO_CTL_GETSTAT                   _AUDIO_CTL(6)
 
 /* Audio Device Types */
 #define AUDIO_TYPE_QUERY                    0x00
@@ -79,6 +82,13 @@
 
 #define CFG_AUDIO_REPLAY_QUEUE_COUNT        4
 
+#ifndef RT_AUDIO_REPLAY_PERIOD_COUNT
+#define RT_AUDIO_REPLAY_PERIOD_COUNT        2
+#endif
+#ifndef RT_AUDIO_MIXER_CHANNELS
+#define RT_AUDIO_MIXER_CHANNELS             1
+#endif
+
 enum
 {
     AUDIO_STREAM_REPLAY = 0,
@@ -130,6 +140,28 @@ struct rt_audio_caps
     } udata;
 };
 
+/* the statistics of replay, AUDIO_CTL_GETSTAT */
+struct rt_audio_replay_stat
+{
+    rt_uint32_t periods;                /* the periods sent to the hardware */
+    rt_uint32_t underrun;               /* the periods not filled by the stream */
+    rt_uint32_t queued;                 /* the bytes of stream waiting for the hardware */
+};
+
+#ifdef RT_AUDIO_USING_PERIOD
+/* a source of mixer, the ring of periods is written by thread and read by DMA interrupt */
+struct rt_audio_channel
+{
+    rt_uint8_t *buffer;
+    rt_uint32_t size;
+    volatile rt_uint32_t put_index;     /* in [0, 2 * size), the mirror bit tells full from empty */
+    volatile rt_uint32_t get_index;
+    rt_uint32_t gain;                   /* Q15, 0x8000 is 1.0 */
+    struct rt_completion cmp;           /* the ring has space, or the replay is stopped */
+    struct rt_mutex lock;               /* the writers of the ring */
+};
+#endif
+
 struct rt_audio_replay
 {
     struct rt_mempool *mp;
@@ -143,6 +175,12 @@ struct rt_audio_replay
     rt_uint32_t pos;
     rt_uint8_t event;
     rt_bool_t activated;
+#ifdef RT_AUDIO_USING_PERIOD
+    struct rt_audio_channel channel[RT_AUDIO_MIXER_CHANNELS];
+    rt_int16_t *mix;
+    rt_bool_t running;                  /* the stream has filled the last period */
+#endif
+    struct rt_audio_replay_stat stat;
 };
 
 struct rt_audio_record
@@ -162,6 +200,10 @@ struct rt_audio_device
 rt_err_t    rt_audio_register(struct rt_audio_device *audio, const char *name, rt_uint32_t flag, void *data);
 void        rt_audio_tx_complete(struct rt_audio_device *audio);
 void        rt_audio_rx_done(struct rt_audio_device *audio, rt_uint8_t *pbuf, rt_size_t len);
+#ifdef RT_AUDIO_USING_PERIOD
+rt_size_t   rt_audio_mixer_write(struct rt_audio_device *audio, int channel, const void *buffer, rt_size_t size);
+rt_err_t    rt_audio_mixer_volume(struct rt_audio_device *audio, int channel, int volume);
+#endif
 
 /* Device Control Commands */
 #define CODEC_CMD_RESET             0
@@ -7,6 +7,8 @@
  * Date           Author            Notes
  * 2015-05-14     aubrcool@qq.com   first version
  * 2015-07-06     Bernard           remove RT_CAN_USING_LED.
+ * 2019-10-03     RT-Thread         rx ring of messages and hash of filters.
+ * 2019-10-26     RT-Thread         document the mask and list mode of filter.
  */
 
 #ifndef CAN_H_
@@ -20,6 +22,9 @@
 #ifndef RT_CANSND_BOX_NUM
 #define RT_CANSND_BOX_NUM   1
 #endif
+#ifndef RT_CAN_FILTER_HASH_SZ
+#define RT_CAN_FILTER_HASH_SZ   16  /* power of 2 */
+#endif
 
 enum CANBAUD
 {
@@ -42,6 +47,20 @@ enum CANBAUD
 #define RT_CAN_MODE_PRIV                0x01
 #define RT_CAN_MODE_NOPRIV              0x00
 
+/*
+ * The filter item, the mode is the same as STM32 filter bank:
+ *
+ * mode 0, mask mode: the message is accepted when the bits of id which are
+ *         set in mask are the same, (msg.id ^ id) & mask == 0. The mask is of
+ *         the id bits (not shifted to the register layout), 0xFFFFFFFF
+ *         matches the id exactly.
+ * mode 1, list mode: the message is accepted when the id is the same. The
+ *         hardware may take the mask as the second id of the bank, the
+ *         software filter of RT_CAN_USING_HDR doesn't, it's not used, an
+ *         item is needed for the second id.
+ *
+ * The ide and rtr are always matched exactly.
+ */
 struct rt_can_filter_item
 {
     rt_uint32_t id  : 29;
@@ -170,9 +189,9 @@ struct rt_can_status
 struct rt_can_hdr
 {
     rt_uint32_t connected;
-    rt_uint32_t msgs;
     struct rt_can_filter_item filter;
-    struct rt_list_node list;
+    struct rt_can_rx_fifo *fifo;
+    rt_int8_t next;                     /* next hdr in the bucket of hash */
 };
 #endif
 struct rt_can_device;
@@ -197,6 +216,7 @@ struct rt_can_device
     struct rt_can_status_ind_type status_indicate;
 #ifdef RT_CAN_USING_HDR
     struct rt_can_hdr *hdr;
+    rt_int8_t *hdr_hash;                /* the software filter, id to hdr */
 #endif
 #ifdef RT_CAN_USING_BUS_HOOK
     rt_can_bus_hook bus_hook;
@@ -227,23 +247,13 @@ struct rt_can_msg
 };
 typedef struct rt_can_msg *rt_can_msg_t;
 
-struct rt_can_msg_list
-{
-    struct rt_list_node list;
-#ifdef RT_CAN_USING_HDR
-    struct rt_list_node hdrlist;
-    struct rt_can_hdr *owner;
-#endif
-    struct rt_can_msg data;
-};
-
+/* messages received, put by ISR and got by reader without lock */
 struct rt_can_rx_fifo
 {
-    /* software fifo */
-    struct rt_can_msg_list *buffer;
-    rt_uint32_t freenumbers;
-    struct rt_list_node freelist;
-    struct rt_list_node uselist;
+    struct rt_can_msg *buffer;
+    rt_uint32_t size;                   /* power of 2 */
+    volatile rt_uint32_t put_index;     /* only written by ISR */
+    volatile rt_uint32_t get_index;     /* only written by reader */
 };
 
 #define RT_CAN_SND_RESULT_OK        0
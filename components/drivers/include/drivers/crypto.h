@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-05-17     tyx          the first version
+ * 2019-10-10     RT-Thread    add the software engine and batch requests
  */
 
 #ifndef __CRYPTO_H__
@@ -19,5 +20,7 @@
 #include <hw_crc.h>
 #include <hw_gcm.h>
 #include <hw_bignum.h>
+#include <hw_soft.h>
+#include <hw_batch.h>
 
 #endif
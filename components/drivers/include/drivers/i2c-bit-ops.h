@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author        Notes
  * 2012-04-25     weety         first version
+ * 2019-10-17     RT-Thread     add timer driven state machine
  */
 
 #ifndef __I2C_BIT_OPS_H__
@@ -27,6 +28,13 @@ struct rt_i2c_bit_ops
 
     rt_uint32_t delay_us;  /* scl and sda line delay */
     rt_uint32_t timeout;   /* in tick */
+
+#ifdef RT_USING_I2C_ASYNC
+    /* the hwtimer device which steps the asynchronous transfer every half of
+     * delay_us, RT_NULL to step it every tick by a soft timer */
+    const char *timer_name;
+    void *fsm;             /* private, the state machine of asynchronous transfer */
+#endif
 };
 
 rt_err_t rt_i2c_bit_add_bus(struct rt_i2c_bus_device *bus,
@@ -6,12 +6,17 @@
  * Change Logs:
  * Date           Author        Notes
  * 2012-04-25     weety         first version
+ * 2019-10-17     RT-Thread     add asynchronous transfer queue
+ * 2019-10-26     RT-Thread     queue the asynchronous transfers in interrupt
  */
 
 #ifndef __I2C_H__
 #define __I2C_H__
 
 #include <rtthread.h>
+#ifdef RT_USING_I2C_ASYNC
+#include <ipc/completion.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +39,32 @@ struct rt_i2c_msg
 
 struct rt_i2c_bus_device;
 
+struct rt_i2c_async;
+typedef void (*rt_i2c_async_callback_t)(struct rt_i2c_async *async);
+
+/*
+ * I2C asynchronous transfer, the messages are combined in one transaction
+ * (repeated start between messages, stop at the end), it's queued on the bus
+ */
+struct rt_i2c_async
+{
+    struct rt_i2c_msg *msgs;
+    rt_uint32_t num;
+
+    /* called in interrupt when the transfer is finished, it can be RT_NULL */
+    rt_i2c_async_callback_t callback;
+    /* done when the transfer is finished, it can be RT_NULL */
+    struct rt_completion *completion;
+    void *user_data;
+
+    rt_err_t result;                    /* RT_EOK or the error of bus */
+    rt_uint32_t count;                  /* the number of messages transferred */
+
+    /* private, used by I2C bus */
+    struct rt_i2c_bus_device *bus;
+    rt_list_t list;
+};
+
 struct rt_i2c_bus_device_ops
 {
     rt_size_t (*master_xfer)(struct rt_i2c_bus_device *bus,
@@ -45,6 +76,14 @@ struct rt_i2c_bus_device_ops
     rt_err_t (*i2c_bus_control)(struct rt_i2c_bus_device *bus,
                                 rt_uint32_t,
                                 rt_uint32_t);
+#ifdef RT_USING_I2C_ASYNC
+    /* start the transaction and return, rt_i2c_bus_xfer_done() is called when it's
+     * done. It's called in interrupt too, an error makes it transferred by master_xfer
+     * in thread, or it fails the transaction in interrupt. */
+    rt_err_t (*master_xfer_async)(struct rt_i2c_bus_device *bus,
+                                  struct rt_i2c_msg msgs[],
+                                  rt_uint32_t num);
+#endif
 };
 
 /*for i2c bus driver*/
@@ -58,6 +97,13 @@ struct rt_i2c_bus_device
     rt_uint32_t  timeout;
     rt_uint32_t  retries;
     void *priv;
+
+#ifdef RT_USING_I2C_ASYNC
+    rt_list_t async_queue;              /* the pending transfers */
+    struct rt_i2c_async *async_current; /* the transfer on bus */
+    struct rt_completion async_idle;
+    rt_uint16_t async_locked;           /* the bus lock is held by threads, it's checked in interrupt */
+#endif
 };
 
 struct rt_i2c_client
@@ -91,6 +137,36 @@ rt_size_t rt_i2c_master_recv(struct rt_i2c_bus_device *bus,
                              rt_uint32_t               count);
 int rt_i2c_core_init(void);
 
+#ifdef RT_USING_I2C_ASYNC
+/**
+ * This function queues a transfer on the I2C bus, it returns without waiting.
+ * The queued transfers are started one after another in the interrupt of bus
+ * driver, the bus is kept busy without a thread switch between them.
+ *
+ * It can be called in interrupt and in the callback of transfer, the transfer
+ * is queued without taking the bus lock. A bus driver without master_xfer_async
+ * transfers it by rt_i2c_transfer(), which can't be called in interrupt.
+ *
+ * @param bus the I2C bus
+ * @param async the transfer, the msgs, num, callback, completion and user_data
+ *        must be set. It and the messages must be kept until it's finished.
+ *
+ * @return RT_EOK on queued successfully, -RT_EBUSY on the transfer is queued,
+ *         -RT_ENOSYS in interrupt on the bus without master_xfer_async.
+ */
+rt_err_t rt_i2c_transfer_async(struct rt_i2c_bus_device *bus,
+                               struct rt_i2c_async      *async);
+
+/**
+ * This function is called by I2C bus driver in interrupt when the transaction
+ * which is started by master_xfer_async is finished.
+ *
+ * @param bus the I2C bus
+ * @param ret the number of messages transferred, or a negative error code
+ */
+void rt_i2c_bus_xfer_done(struct rt_i2c_bus_device *bus, rt_int32_t ret);
+#endif /* RT_USING_I2C_ASYNC */
+
 #ifdef __cplusplus
 }
 #endif
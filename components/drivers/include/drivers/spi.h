@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2012-11-23     Bernard      Add extern "C"
+ * 2019-09-23     RT-Thread    Add asynchronous transfer queue
  */
 
 #ifndef __SPI_H__
@@ -13,6 +14,9 @@
 
 #include <stdlib.h>
 #include <rtthread.h>
+#ifdef RT_USING_SPI_ASYNC
+#include <ipc/completion.h>
+#endif
 
 #ifdef __cplusplus
 extern "C"{
@@ -79,6 +83,31 @@ struct rt_spi_configuration
     rt_uint32_t max_hz;
 };
 
+struct rt_spi_async;
+typedef void (*rt_spi_async_callback_t)(struct rt_spi_async *async);
+
+/**
+ * SPI asynchronous transfer of a message list, it's queued on the bus
+ */
+struct rt_spi_async
+{
+    struct rt_spi_message *message;             /* the message list */
+
+    /* called in interrupt or the SPI thread when the transfer is finished, it can be RT_NULL */
+    rt_spi_async_callback_t callback;
+    /* done when the transfer is finished, it can be RT_NULL */
+    struct rt_completion *completion;
+    void *user_data;
+
+    rt_err_t result;                            /* RT_EOK or -RT_EIO */
+    struct rt_spi_message *failed;              /* the failed message */
+
+    /* private, used by SPI bus */
+    struct rt_spi_device *device;
+    struct rt_spi_message *current;
+    rt_list_t list;
+};
+
 struct rt_spi_ops;
 struct rt_spi_bus
 {
@@ -88,6 +117,13 @@ struct rt_spi_bus
 
     struct rt_mutex lock;
     struct rt_spi_device *owner;
+
+#ifdef RT_USING_SPI_ASYNC
+    rt_list_t async_queue;                      /* the pending transfers */
+    struct rt_spi_async *async_current;         /* the transfer on bus */
+    struct rt_completion async_idle;
+    rt_list_t async_defer;                      /* in the list of SPI thread */
+#endif
 };
 
 /**
@@ -97,6 +133,11 @@ struct rt_spi_ops
 {
     rt_err_t (*configure)(struct rt_spi_device *device, struct rt_spi_configuration *configuration);
     rt_uint32_t (*xfer)(struct rt_spi_device *device, struct rt_spi_message *message);
+#ifdef RT_USING_SPI_ASYNC
+    /* start the transfer of message and return, rt_spi_bus_xfer_done() is called when it's done.
+     * It's called in interrupt too, an error makes the message transferred by xfer in the SPI thread. */
+    rt_err_t (*xfer_async)(struct rt_spi_device *device, struct rt_spi_message *message);
+#endif
 };
 
 /**
@@ -252,6 +293,50 @@ rt_size_t rt_spi_transfer(struct rt_spi_device *device,
 struct rt_spi_message *rt_spi_transfer_message(struct rt_spi_device  *device,
                                                struct rt_spi_message *message);
 
+#ifdef RT_USING_SPI_ASYNC
+/**
+ * This function initializes an asynchronous transfer, it must be called
+ * before the transfer is queued the first time.
+ *
+ * @param async the transfer
+ * @param message the message list
+ * @param callback called when the transfer is finished, it can be RT_NULL
+ * @param completion done when the transfer is finished, it can be RT_NULL
+ * @param user_data the user data of callback
+ */
+void rt_spi_async_init(struct rt_spi_async   *async,
+                       struct rt_spi_message *message,
+                       rt_spi_async_callback_t callback,
+                       struct rt_completion  *completion,
+                       void                  *user_data);
+
+/**
+ * This function queues a message list to be transferred to the SPI device,
+ * it returns without waiting. The transfers of all devices on the bus are
+ * transferred in order, the SPI bus is re-configured only when the device
+ * is changed.
+ *
+ * @param device the SPI device attached to SPI bus
+ * @param async the transfer which is initialized by rt_spi_async_init(). It
+ *        and the messages must be kept until it's finished.
+ *
+ * @return RT_EOK on queued successfully, -RT_EBUSY on the transfer is queued.
+ */
+rt_err_t rt_spi_transfer_async(struct rt_spi_device *device,
+                               struct rt_spi_async  *async);
+
+/**
+ * This function is called by SPI bus driver in interrupt when the message
+ * which is started by xfer_async is finished. The next message is started
+ * at once, unless the bus is re-configured or the message is transferred by
+ * the blocking xfer, which is done in the SPI thread.
+ *
+ * @param bus the SPI bus
+ * @param length the transferred length, 0 on failed
+ */
+void rt_spi_bus_xfer_done(struct rt_spi_bus *bus, rt_size_t length);
+#endif /* RT_USING_SPI_ASYNC */
+
 rt_inline rt_size_t rt_spi_recv(struct rt_spi_device *device,
                                 void                 *recv_buf,
                                 rt_size_t             length)
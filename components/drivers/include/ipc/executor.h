@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-24     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    the timeout of awaits is in ticks
+ * 2019-10-28     RT-Thread    the poll interval is 10 ticks by default
+ */
+#ifndef EXECUTOR_H__
+#define EXECUTOR_H__
+
+#include <rtthread.h>
+#include "completion.h"
+#include "waitqueue.h"
+
+#if defined(RT_USING_POSIX) && defined(SAL_USING_POSIX)
+#include <sys/socket.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The stackless tasks run on the thread of an executor one by one. A task is
+ * a function which is called again from the point of its last await, so the
+ * variables which are kept across the awaits are in the structure of task,
+ * not on the stack:
+ *
+ *     struct echo
+ *     {
+ *         struct rt_task task;
+ *         char buf[64];
+ *     };
+ *
+ *     static int echo_entry(struct rt_task *task)
+ *     {
+ *         struct echo *echo = rt_container_of(task, struct echo, task);
+ *
+ *         RT_TASK_BEGIN(task);
+ *         while (1)
+ *         {
+ *             RT_TASK_AWAIT(task, rt_task_device_read(task, uart, 0, echo->buf, sizeof(echo->buf),
+ *                                                     RT_WAITING_FOREVER));
+ *             rt_device_write(uart, 0, echo->buf, task->result);
+ *         }
+ *         RT_TASK_END(task);
+ *     }
+ *
+ * The kernel semaphore and message queue have no notification for the tasks,
+ * the tasks waiting for them are checked every RT_EXECUTOR_POLL_TICK ticks.
+ * While any task waits for them, the thread of executor is waked at this
+ * interval and the system never idles, and a task is resumed up to one
+ * interval after the semaphore is released. The wait queues, devices and
+ * sockets wake the tasks at once and cost nothing while waiting, so use a
+ * wait queue with rt_task_wqueue_wait() for the events from the threads and
+ * interrupts where the latency matters.
+ */
+
+#ifndef RT_EXECUTOR_POLL_TICK
+#define RT_EXECUTOR_POLL_TICK       10
+#endif
+
+/* the return value of task entry and awaits */
+#define RT_TASK_DONE                0
+#define RT_TASK_PENDING             1
+
+#define RT_TASK_FLAG_READY          0x01    /* in the ready list of executor */
+#define RT_TASK_FLAG_WAITING        0x02    /* in an await */
+#define RT_TASK_FLAG_TIMER          0x04    /* the await has a timeout */
+#define RT_TASK_FLAG_TIMEOUT        0x08
+#define RT_TASK_FLAG_WQUEUE         0x10    /* in a wait queue */
+#define RT_TASK_FLAG_WOKEN          0x20    /* waked by the wait queue */
+#define RT_TASK_FLAG_POLL           0x40    /* in the poll list of executor */
+#define RT_TASK_FLAG_DEVICE         0x80    /* in the device list, hooks the rx indicate of device */
+
+struct rt_executor;
+
+struct rt_task
+{
+    rt_list_t list;                         /* in the ready or poll list */
+    rt_list_t timer_list;
+
+    int (*entry)(struct rt_task *task);
+    void (*cleanup)(struct rt_task *task);  /* called when the task is done, it may free the task */
+    void *user_data;
+
+    rt_uint16_t line;                       /* the point of last await */
+    rt_uint16_t flags;
+    rt_base_t result;                       /* the result of last await, error code or size */
+    rt_tick_t timeout_tick;
+
+    struct rt_executor *executor;
+    struct rt_wqueue_node wait;             /* in a wait queue or the device list */
+    rt_device_t device;
+    rt_err_t (*rx_indicate)(rt_device_t dev, rt_size_t size);
+};
+
+struct rt_executor
+{
+    rt_list_t ready_list;
+    rt_list_t poll_list;                    /* the tasks waiting for kernel objects */
+    rt_list_t timer_list;                   /* sorted by timeout tick */
+    rt_tick_t poll_tick;
+
+    struct rt_completion wake;
+    rt_thread_t thread;
+    rt_uint32_t task_num;
+    rt_uint32_t resumes;                    /* the times of task entry is called */
+};
+
+#define RT_TASK_BEGIN(task)         switch ((task)->line) { case 0:
+#define RT_TASK_END(task)           } (task)->line = 0; return RT_TASK_DONE
+
+/* the expression is evaluated again when the task is resumed, until it's done */
+#define RT_TASK_AWAIT(task, expr)                                   \
+    do {                                                            \
+        (task)->line = __LINE__; case __LINE__:                     \
+        if ((expr) == RT_TASK_PENDING) return RT_TASK_PENDING;      \
+    } while (0)
+
+#define RT_TASK_YIELD(task)                                         \
+    do {                                                            \
+        (task)->line = __LINE__; return RT_TASK_PENDING;            \
+        case __LINE__:;                                             \
+    } while (0)
+
+void rt_executor_init(struct rt_executor *executor);
+void rt_executor_run(struct rt_executor *executor);
+#ifdef RT_USING_HEAP
+struct rt_executor *rt_executor_create(const char *name, rt_uint32_t stack_size, rt_uint8_t priority);
+#endif
+
+void rt_task_init(struct rt_task *task, int (*entry)(struct rt_task *task), void *user_data);
+rt_err_t rt_executor_spawn(struct rt_executor *executor, struct rt_task *task);
+
+/*
+ * the awaits, they are used by RT_TASK_AWAIT() in the task entry. The timeout
+ * is in ticks, not in milliseconds as rt_wqueue_wait(). As rt_wqueue_wait(),
+ * rt_task_wqueue_wait() is done by any wakeup of queue, the condition is
+ * checked again after it.
+ */
+int rt_task_sleep(struct rt_task *task, rt_tick_t ticks);
+int rt_task_wqueue_wait(struct rt_task *task, rt_wqueue_t *queue, int condition, rt_int32_t timeout);
+#ifdef RT_USING_SEMAPHORE
+int rt_task_sem_take(struct rt_task *task, rt_sem_t sem, rt_int32_t timeout);
+#endif
+#ifdef RT_USING_MESSAGEQUEUE
+int rt_task_mq_recv(struct rt_task *task, rt_mq_t mq, void *buffer, rt_size_t size, rt_int32_t timeout);
+#endif
+int rt_task_device_read(struct rt_task *task, rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size,
+                        rt_int32_t timeout);
+#if defined(RT_USING_POSIX) && defined(SAL_USING_POSIX)
+int rt_task_poll(struct rt_task *task, int fd, short events, rt_int32_t timeout);
+int rt_task_recv(struct rt_task *task, int s, void *mem, rt_size_t len, int flags, rt_int32_t timeout);
+int rt_task_send(struct rt_task *task, int s, const void *data, rt_size_t size, int flags, rt_int32_t timeout);
+int rt_task_accept(struct rt_task *task, int s, struct sockaddr *addr, socklen_t *addrlen, rt_int32_t timeout);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
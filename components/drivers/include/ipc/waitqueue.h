@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2018/06/26     Bernard      Fix the wait queue issue when wakeup a soon 
  *                             to blocked thread.
+ * 2019-10-24     RT-Thread    add C++ guards for the executor
  */
 
 #ifndef WAITQUEUE_H__
@@ -14,6 +15,10 @@
 
 #include <rtthread.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define RT_WQ_FLAG_CLEAN    0x00
 #define RT_WQ_FLAG_WAKEUP   0x01
 
@@ -56,4 +61,8 @@ void rt_wqueue_wakeup(rt_wqueue_t *queue, void *key);
 
 #define DEFINE_WAIT(name) DEFINE_WAIT_FUNC(name, __wqueue_default_wake)
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -5,12 +5,24 @@
  *
  * Change Logs:
  * Date           Author       Notes
+ * 2019-10-21     RT-Thread    add worker pool, work priority and timing wheel
+ * 2019-10-26     RT-Thread    count the idle workers
  */
 #ifndef WORKQUEUE_H__
 #define WORKQUEUE_H__
 
 #include <rtthread.h>
 
+/* the priority levels of work, 0 is the highest */
+#ifndef RT_WORKQUEUE_PRIORITY_NUM
+#define RT_WORKQUEUE_PRIORITY_NUM   4
+#endif
+#define RT_WORK_PRIORITY_DEFAULT    (RT_WORKQUEUE_PRIORITY_NUM / 2)
+
+#ifndef RT_SYSTEM_WORKQUEUE_WORKERS
+#define RT_SYSTEM_WORKQUEUE_WORKERS 1
+#endif
+
 enum
 {
     RT_WORK_STATE_PENDING    = 0x0001,     /* Work item pending state */
@@ -25,14 +37,46 @@ enum
     RT_WORK_TYPE_DELAYED     = 0x0001,
 };
 
+struct rt_workqueue;
+
+/* the thread of workqueue */
+struct rt_workqueue_worker
+{
+    struct rt_workqueue *queue;
+    rt_thread_t    thread;
+    struct rt_work *work_current; /* current work */
+};
+
+#ifdef RT_WORKQUEUE_USING_STAT
+/* the latency is from the work is submitted (or its delay is expired) to it runs */
+struct rt_workqueue_stat
+{
+    rt_uint32_t done;
+    rt_uint32_t latency_sum;      /* in tick */
+    rt_uint32_t latency_max;
+    rt_uint32_t exec_sum;         /* the time of work functions, in tick */
+    rt_uint32_t exec_max;
+    rt_uint32_t pending_max;
+};
+#endif
+
 /* workqueue implementation */
 struct rt_workqueue
 {
-    rt_list_t      work_list;
-    struct rt_work *work_current; /* current work */
+    rt_list_t      work_list[RT_WORKQUEUE_PRIORITY_NUM];
+    rt_uint32_t    work_ready;    /* the bitmap of work_list which is not empty */
+    rt_uint32_t    work_pending;
 
-    struct rt_semaphore sem;
-    rt_thread_t    work_thread;
+    struct rt_semaphore sem;      /* the completion of works */
+    struct rt_semaphore work_sem; /* the idle workers wait for works */
+
+    rt_uint16_t    worker_num;
+    rt_uint16_t    worker_idle;   /* the idle workers which are not waked */
+    struct rt_workqueue_worker *workers;
+
+#ifdef RT_WORKQUEUE_USING_STAT
+    struct rt_workqueue_stat stat;
+#endif
 };
 
 struct rt_work
@@ -43,12 +87,17 @@ struct rt_work
     void *work_data;
     rt_uint16_t flags;
     rt_uint16_t type;
+    rt_uint8_t priority;
+#ifdef RT_WORKQUEUE_USING_STAT
+    rt_tick_t ready_tick;
+#endif
 };
 
+/* the delayed work is in the timing wheel which is shared by all workqueues */
 struct rt_delayed_work
 {
     struct rt_work work;
-    struct rt_timer timer;
+    rt_tick_t timeout_tick;
     struct rt_workqueue *workqueue;
 };
 
@@ -57,15 +106,22 @@ struct rt_delayed_work
  * WorkQueue for DeviceDriver
  */
 struct rt_workqueue *rt_workqueue_create(const char *name, rt_uint16_t stack_size, rt_uint8_t priority);
+struct rt_workqueue *rt_workqueue_create_workers(const char *name, rt_uint16_t stack_size, rt_uint8_t priority,
+                                                 rt_uint16_t worker_num);
 rt_err_t rt_workqueue_destroy(struct rt_workqueue *queue);
 rt_err_t rt_workqueue_dowork(struct rt_workqueue *queue, struct rt_work *work);
 rt_err_t rt_workqueue_submit_work(struct rt_workqueue *queue, struct rt_work *work, rt_tick_t time);
 rt_err_t rt_workqueue_cancel_work(struct rt_workqueue *queue, struct rt_work *work);
 rt_err_t rt_workqueue_cancel_work_sync(struct rt_workqueue *queue, struct rt_work *work);
+#ifdef RT_WORKQUEUE_USING_STAT
+void rt_workqueue_get_stat(struct rt_workqueue *queue, struct rt_workqueue_stat *stat);
+void rt_workqueue_reset_stat(struct rt_workqueue *queue);
+#endif
 
 #ifdef RT_USING_SYSTEM_WORKQUEUE
 rt_err_t rt_work_submit(struct rt_work *work, rt_tick_t time);
 rt_err_t rt_work_cancel(struct rt_work *work);
+struct rt_workqueue *rt_work_sys_workqueue(void);
 #endif
 
 rt_inline void rt_work_init(struct rt_work *work, void (*work_func)(struct rt_work *work, void *work_data),
@@ -76,6 +132,13 @@ rt_inline void rt_work_init(struct rt_work *work, void (*work_func)(struct rt_wo
     work->work_data = work_data;
     work->flags = 0;
     work->type = 0;
+    work->priority = RT_WORK_PRIORITY_DEFAULT;
+}
+
+/* the work of lower priority number is done before, it's set before the work is submitted */
+rt_inline void rt_work_set_priority(struct rt_work *work, rt_uint8_t priority)
+{
+    work->priority = (priority < RT_WORKQUEUE_PRIORITY_NUM) ? priority : RT_WORKQUEUE_PRIORITY_NUM - 1;
 }
 
 void rt_delayed_work_init(struct rt_delayed_work *work, void (*work_func)(struct rt_work *work,
@@ -6,6 +6,9 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-01-31     flybreak     first version
+ * 2019-10-07     RT-Thread    add the stream of samples
+ * 2019-10-26     RT-Thread    wake all readers of stream, hold the stream while reading
+ * 2019-10-28     RT-Thread    the time of stream samples in a separate field
  */
 
 #include "sensor.h"
@@ -15,6 +18,9 @@
 #include <rtdbg.h>
 
 #include <string.h>
+#ifdef RT_SENSOR_USING_STREAM
+#include <rthw.h>
+#endif
 
 static char *const sensor_name_str[] =
 {
@@ -34,12 +40,483 @@ static char *const sensor_name_str[] =
     "forc_"      /* Force sensor      */
 };
 
+/* Fetch the data, the data in the buffer of module first */
+static rt_size_t _sensor_fetch(rt_sensor_t sensor, void *buf, rt_size_t len)
+{
+    rt_size_t result;
+
+    if (sensor->module)
+    {
+        rt_mutex_take(sensor->module->lock, RT_WAITING_FOREVER);
+    }
+
+    /* The buffer is not empty. Read the data in the buffer first */
+    if (sensor->data_len > 0)
+    {
+        if (len > sensor->data_len / sizeof(struct rt_sensor_data))
+        {
+            len = sensor->data_len / sizeof(struct rt_sensor_data);
+        }
+
+        rt_memcpy(buf, sensor->data_buf, len * sizeof(struct rt_sensor_data));
+
+        /* Clear the buffer */
+        sensor->data_len = 0;
+        result = len;
+    }
+    else
+    {
+        /* If the buffer is empty read the data */
+        result = sensor->ops->fetch_data(sensor, buf, len);
+    }
+
+    if (sensor->module)
+    {
+        rt_mutex_release(sensor->module->lock);
+    }
+
+    return result;
+}
+
+#ifdef RT_SENSOR_USING_STREAM
+/*
+ * The stream of samples. The interrupt sends the sensor to the "sensor"
+ * thread, the thread fetches the samples into the ring buffer of sensor.
+ * The oldest samples are overwritten, the readers find it by their cursor.
+ */
+#ifndef RT_SENSOR_STREAM_SIZE
+#define RT_SENSOR_STREAM_SIZE           64
+#endif
+#ifndef RT_SENSOR_STREAM_STK_SIZE
+#define RT_SENSOR_STREAM_STK_SIZE       1024
+#endif
+#ifndef RT_SENSOR_STREAM_THREAD_PRIO
+#define RT_SENSOR_STREAM_THREAD_PRIO    10
+#endif
+#define SENSOR_STREAM_MB_SIZE           8
+
+static struct rt_thread stream_thread;
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t stream_thread_stack[RT_SENSOR_STREAM_STK_SIZE];
+static struct rt_mailbox stream_mb;
+static rt_ubase_t stream_mb_pool[SENSOR_STREAM_MB_SIZE];
+/* The stream is not deleted while it is fetched */
+static struct rt_mutex stream_lock;
+
+/* The monotonic time in microsecond, wraps around at 2^32 */
+static rt_uint32_t _sensor_stream_time(void)
+{
+#ifdef RT_USING_CPUTIME
+    static rt_uint32_t last_cputime, time_us;
+    rt_uint32_t cputime, elapsed;
+    float res;
+    rt_base_t level;
+
+    /* called in the interrupt of every sensor, must be more often than the wrap around of cputime */
+    level = rt_hw_interrupt_disable();
+    cputime = clock_cpu_gettime();
+    res = clock_cpu_getres();
+    elapsed = (rt_uint32_t)((cputime - last_cputime) * res / 1000);
+    /* keep the fraction of microsecond */
+    last_cputime += (rt_uint32_t)(elapsed * 1000 / res);
+    time_us += elapsed;
+    cputime = time_us;
+    rt_hw_interrupt_enable(level);
+
+    return cputime;
+#else
+    return rt_tick_get() * (1000000 / RT_TICK_PER_SECOND);
+#endif
+}
+
+/* Called in the interrupt */
+static void _sensor_stream_post(rt_sensor_t sensor)
+{
+    struct rt_sensor_stream *stream = sensor->stream;
+
+    stream->irq_time = _sensor_stream_time();
+    if (!stream->pending)
+    {
+        stream->pending = 1;
+        if (rt_mb_send(&stream_mb, (rt_ubase_t)sensor) != RT_EOK)
+        {
+            /* try again on next interrupt */
+            stream->pending = 0;
+        }
+    }
+}
+
+/* Wake all the readers waiting for samples, every reader has its own cursor */
+static void _sensor_stream_wakeup(struct rt_sensor_stream *stream)
+{
+    struct rt_wqueue_node *node;
+    rt_bool_t need_schedule = RT_FALSE;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    while (!rt_list_isempty(&stream->wait.waiting_list))
+    {
+        node = rt_list_first_entry(&stream->wait.waiting_list, struct rt_wqueue_node, list);
+        rt_list_remove(&node->list);
+        rt_thread_resume(node->polling_thread);
+        need_schedule = RT_TRUE;
+    }
+    rt_hw_interrupt_enable(level);
+
+    if (need_schedule)
+    {
+        rt_schedule();
+    }
+}
+
+/* Hold the stream, it's not freed by closing until it's put */
+static struct rt_sensor_stream *_sensor_stream_get(rt_sensor_t sensor)
+{
+    struct rt_sensor_stream *stream;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    stream = sensor->stream;
+    if (stream != RT_NULL)
+    {
+        stream->ref ++;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return stream;
+}
+
+static void _sensor_stream_put(struct rt_sensor_stream *stream)
+{
+    rt_bool_t released;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    stream->ref --;
+    released = (stream->ref == 0 && stream->closed);
+    rt_hw_interrupt_enable(level);
+
+    if (released)
+    {
+        /* the closing waits for it */
+        rt_completion_done(&stream->released);
+    }
+}
+
+static void _sensor_stream_fetch(rt_sensor_t sensor)
+{
+    struct rt_sensor_stream *stream;
+    struct rt_sensor_data *data;
+    rt_uint32_t time, period = 0;
+    rt_size_t i, len;
+
+    rt_mutex_take(&stream_lock, RT_WAITING_FOREVER);
+
+    stream = sensor->stream;
+    if (stream == RT_NULL)
+    {
+        /* closed */
+        rt_mutex_release(&stream_lock);
+        return;
+    }
+    /* the interrupts from now on fetch again */
+    stream->pending = 0;
+    time = stream->irq_time;
+
+    data = stream->buffer + stream->size;
+    len = _sensor_fetch(sensor, data, stream->batch);
+    if (len > stream->batch)
+    {
+        len = stream->batch;
+    }
+
+    /* the last one is the sample of interrupt, the others are by the output data rate */
+    if (sensor->config.odr > 0)
+    {
+        period = 1000000 / sensor->config.odr;
+    }
+    for (i = 0; i < len; i++)
+    {
+        data[i].time_us = time - (len - 1 - i) * period;
+        if ((rt_int32_t)(data[i].time_us - stream->last_time) < 0)
+        {
+            data[i].time_us = stream->last_time;
+        }
+        stream->last_time = data[i].time_us;
+    }
+
+    rt_enter_critical();
+    for (i = 0; i < len; i++)
+    {
+        stream->buffer[(stream->head + i) & (stream->size - 1)] = data[i];
+    }
+    stream->head += len;
+    rt_exit_critical();
+
+    if (len > 0)
+    {
+        _sensor_stream_wakeup(stream);
+        if (sensor->parent.rx_indicate != RT_NULL)
+        {
+            len = stream->head - stream->reader.cursor;
+            sensor->parent.rx_indicate(&sensor->parent, len > stream->size ? stream->size : len);
+        }
+    }
+
+    rt_mutex_release(&stream_lock);
+}
+
+static void _sensor_stream_entry(void *parameter)
+{
+    rt_ubase_t sensor;
+
+    while (1)
+    {
+        if (rt_mb_recv(&stream_mb, &sensor, RT_WAITING_FOREVER) == RT_EOK)
+        {
+            _sensor_stream_fetch((rt_sensor_t)sensor);
+        }
+    }
+}
+
+static rt_err_t _sensor_stream_create(rt_sensor_t sensor)
+{
+    struct rt_sensor_stream *stream;
+    rt_uint32_t size = 1, batch = 1;
+
+    while (size < RT_SENSOR_STREAM_SIZE) size <<= 1;
+    if (sensor->config.mode == RT_SENSOR_MODE_FIFO && sensor->info.fifo_max > 0)
+    {
+        batch = sensor->info.fifo_max;
+    }
+
+    stream = rt_malloc(sizeof(struct rt_sensor_stream) + (size + batch) * sizeof(struct rt_sensor_data));
+    if (stream == RT_NULL)
+    {
+        return -RT_ENOMEM;
+    }
+    rt_memset(stream, 0, sizeof(struct rt_sensor_stream));
+    stream->buffer = (struct rt_sensor_data *)(stream + 1);
+    stream->size = size;
+    stream->batch = batch;
+    stream->reader.sensor = sensor;
+    rt_wqueue_init(&stream->wait);
+    rt_completion_init(&stream->released);
+
+    sensor->stream = stream;
+
+    return RT_EOK;
+}
+
+static void _sensor_stream_delete(rt_sensor_t sensor)
+{
+    struct rt_sensor_stream *stream;
+    rt_uint32_t ref;
+    rt_base_t level;
+
+    rt_mutex_take(&stream_lock, RT_WAITING_FOREVER);
+    level = rt_hw_interrupt_disable();
+    stream = sensor->stream;
+    sensor->stream = RT_NULL;
+    if (stream != RT_NULL)
+    {
+        stream->closed = 1;
+    }
+    rt_hw_interrupt_enable(level);
+    rt_mutex_release(&stream_lock);
+
+    if (stream == RT_NULL)
+    {
+        return;
+    }
+
+    /* the waiting readers return on closed, then they put the stream */
+    _sensor_stream_wakeup(stream);
+    level = rt_hw_interrupt_disable();
+    ref = stream->ref;
+    rt_hw_interrupt_enable(level);
+    if (ref > 0)
+    {
+        /* the last reader putting it is done even before the waiting */
+        rt_completion_wait(&stream->released, RT_WAITING_FOREVER);
+    }
+
+    rt_free(stream);
+}
+
+static rt_size_t _sensor_stream_read(struct rt_sensor_stream *stream, struct rt_sensor_reader *reader,
+                                     struct rt_sensor_data *buf, rt_size_t len)
+{
+    rt_uint32_t head, index, first;
+
+    rt_enter_critical();
+    head = stream->head;
+    if (head - reader->cursor > stream->size)
+    {
+        /* the samples are overwritten */
+        reader->overrun += head - reader->cursor - stream->size;
+        reader->cursor = head - stream->size;
+    }
+    if (len > head - reader->cursor)
+    {
+        len = head - reader->cursor;
+    }
+
+    index = reader->cursor & (stream->size - 1);
+    first = stream->size - index;
+    if (first > len)
+    {
+        first = len;
+    }
+    rt_memcpy(buf, &stream->buffer[index], first * sizeof(struct rt_sensor_data));
+    rt_memcpy(buf + first, stream->buffer, (len - first) * sizeof(struct rt_sensor_data));
+    reader->cursor += len;
+    rt_exit_critical();
+
+    return len;
+}
+
+/**
+ * This function initializes a reader of the stream, it reads the samples
+ * from now on. The sensor is opened in interrupt or fifo mode.
+ */
+void rt_sensor_reader_init(struct rt_sensor_reader *reader, rt_sensor_t sensor)
+{
+    rt_base_t level;
+
+    RT_ASSERT(reader != RT_NULL);
+    RT_ASSERT(sensor != RT_NULL);
+
+    reader->sensor = sensor;
+    level = rt_hw_interrupt_disable();
+    reader->cursor = sensor->stream ? sensor->stream->head : 0;
+    rt_hw_interrupt_enable(level);
+    reader->overrun = 0;
+}
+
+/**
+ * This function reads the samples of stream which are not read by the reader.
+ *
+ * @return the number of samples read.
+ */
+rt_size_t rt_sensor_reader_read(struct rt_sensor_reader *reader, struct rt_sensor_data *buf, rt_size_t len)
+{
+    struct rt_sensor_stream *stream;
+
+    RT_ASSERT(reader != RT_NULL);
+
+    if (buf == RT_NULL)
+    {
+        return 0;
+    }
+
+    stream = _sensor_stream_get(reader->sensor);
+    if (stream == RT_NULL)
+    {
+        return 0;
+    }
+    len = _sensor_stream_read(stream, reader, buf, len);
+    _sensor_stream_put(stream);
+
+    return len;
+}
+
+/**
+ * This function waits until there are samples for the reader. All the
+ * waiting readers are woken by the new samples.
+ *
+ * @return RT_EOK on samples, -RT_ETIMEOUT on timeout, -RT_ERROR on closed.
+ */
+rt_err_t rt_sensor_reader_wait(struct rt_sensor_reader *reader, rt_int32_t msec)
+{
+    struct rt_sensor_stream *stream;
+    struct rt_wqueue_node node;
+    rt_thread_t tid = rt_thread_self();
+    rt_tick_t tick;
+    rt_base_t level;
+    rt_err_t result;
+
+    RT_ASSERT(reader != RT_NULL);
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    stream = _sensor_stream_get(reader->sensor);
+    if (stream == RT_NULL)
+    {
+        return -RT_ERROR;
+    }
+
+    tick = rt_tick_from_millisecond(msec);
+    node.polling_thread = tid;
+    node.wakeup = __wqueue_default_wake;
+    node.key = 0;
+    rt_list_init(&node.list);
+
+    /* the samples are checked with the interrupt disabled, the wakeup is not lost */
+    level = rt_hw_interrupt_disable();
+    if (stream->head == reader->cursor && !stream->closed && tick != 0)
+    {
+        rt_list_insert_before(&stream->wait.waiting_list, &node.list);
+        rt_thread_suspend(tid);
+        if (tick != (rt_tick_t)RT_WAITING_FOREVER)
+        {
+            rt_timer_control(&tid->thread_timer, RT_TIMER_CTRL_SET_TIME, &tick);
+            rt_timer_start(&tid->thread_timer);
+        }
+        rt_hw_interrupt_enable(level);
+
+        rt_schedule();
+
+        level = rt_hw_interrupt_disable();
+        rt_list_remove(&node.list);
+    }
+
+    if (stream->head != reader->cursor)
+    {
+        result = RT_EOK;
+    }
+    else
+    {
+        result = stream->closed ? -RT_ERROR : -RT_ETIMEOUT;
+    }
+    rt_hw_interrupt_enable(level);
+
+    _sensor_stream_put(stream);
+
+    return result;
+}
+
+static int rt_sensor_stream_init(void)
+{
+    rt_mutex_init(&stream_lock, "sensor", RT_IPC_FLAG_FIFO);
+    rt_mb_init(&stream_mb, "sensor", stream_mb_pool, SENSOR_STREAM_MB_SIZE, RT_IPC_FLAG_FIFO);
+    rt_thread_init(&stream_thread, "sensor", _sensor_stream_entry, RT_NULL,
+                   stream_thread_stack, RT_SENSOR_STREAM_STK_SIZE, RT_SENSOR_STREAM_THREAD_PRIO, 10);
+
+    return rt_thread_startup(&stream_thread);
+}
+INIT_PREV_EXPORT(rt_sensor_stream_init);
+#endif /* RT_SENSOR_USING_STREAM */
+
 /* Sensor interrupt correlation function */
 /*
  * Sensor interrupt handler function
  */
 void rt_sensor_cb(rt_sensor_t sen)
 {
+#ifdef RT_SENSOR_USING_STREAM
+    if (sen->stream != RT_NULL)
+    {
+        if (sen->irq_handle != RT_NULL)
+        {
+            sen->irq_handle(sen);
+        }
+
+        /* The samples are fetched by the thread, then it indicates */
+        _sensor_stream_post(sen);
+        return;
+    }
+#endif /* RT_SENSOR_USING_STREAM */
+
     if (sen->parent.rx_indicate == RT_NULL)
     {
         return;
@@ -177,6 +654,17 @@ static rt_err_t rt_sensor_open(rt_device_t dev, rt_uint16_t oflag)
         goto __exit;
     }
 
+#ifdef RT_SENSOR_USING_STREAM
+    if (sensor->config.mode != RT_SENSOR_MODE_POLLING && sensor->stream == RT_NULL)
+    {
+        res = _sensor_stream_create(sensor);
+        if (res != RT_EOK)
+        {
+            goto __exit;
+        }
+    }
+#endif
+
     /* Configure power mode to normal mode */
     if (sensor->ops->control(sensor, RT_SENSOR_CTRL_SET_POWER, (void *)RT_SENSOR_POWER_NORMAL) == RT_EOK)
     {
@@ -200,6 +688,14 @@ static rt_err_t rt_sensor_close(rt_device_t dev)
 
     RT_ASSERT(dev != RT_NULL);
 
+#ifdef RT_SENSOR_USING_STREAM
+    /* Before the module lock, it is taken while the stream is fetched */
+    if (sensor->stream != RT_NULL)
+    {
+        _sensor_stream_delete(sensor);
+    }
+#endif
+
     if (sensor->module)
     {
         rt_mutex_take(sensor->module->lock, RT_WAITING_FOREVER);
@@ -248,7 +744,6 @@ __exit:
 static rt_size_t rt_sensor_read(rt_device_t dev, rt_off_t pos, void *buf, rt_size_t len)
 {
     rt_sensor_t sensor = (rt_sensor_t)dev;
-    rt_size_t result = 0;
     RT_ASSERT(dev != RT_NULL);
 
     if (buf == NULL || len == 0)
@@ -256,37 +751,21 @@ static rt_size_t rt_sensor_read(rt_device_t dev, rt_off_t pos, void *buf, rt_siz
         return 0;
     }
 
-    if (sensor->module)
+#ifdef RT_SENSOR_USING_STREAM
     {
-        rt_mutex_take(sensor->module->lock, RT_WAITING_FOREVER);
-    }
+        struct rt_sensor_stream *stream = _sensor_stream_get(sensor);
 
-    /* The buffer is not empty. Read the data in the buffer first */
-    if (sensor->data_len > 0)
-    {
-        if (len > sensor->data_len / sizeof(struct rt_sensor_data))
+        if (stream != RT_NULL)
         {
-            len = sensor->data_len / sizeof(struct rt_sensor_data);
+            /* The samples which are not read by rt_device_read */
+            len = _sensor_stream_read(stream, &stream->reader, buf, len);
+            _sensor_stream_put(stream);
+            return len;
         }
-
-        rt_memcpy(buf, sensor->data_buf, len * sizeof(struct rt_sensor_data));
-
-        /* Clear the buffer */
-        sensor->data_len = 0;
-        result = len;
-    }
-    else
-    {
-        /* If the buffer is empty read the data */
-        result = sensor->ops->fetch_data(sensor, buf, len);
-    }
-
-    if (sensor->module)
-    {
-        rt_mutex_release(sensor->module->lock);
     }
+#endif
 
-    return result;
+    return _sensor_fetch(sensor, buf, len);
 }
 
 static rt_err_t rt_sensor_control(rt_device_t dev, int cmd, void *args)
@@ -349,6 +828,14 @@ static rt_err_t rt_sensor_control(rt_device_t dev, int cmd, void *args)
         /* Device self-test */
         result = sensor->ops->control(sensor, RT_SENSOR_CTRL_SELF_TEST, args);
         break;
+#ifdef RT_SENSOR_USING_STREAM
+    case RT_SENSOR_CTRL_GET_OVERRUN:
+        if (args && sensor->stream)
+        {
+            *(rt_uint32_t *)args = sensor->stream->reader.overrun;
+        }
+        break;
+#endif
     default:
         return -RT_ERROR;
     }
@@ -426,6 +913,9 @@ int rt_hw_sensor_register(rt_sensor_t sensor,
     device->rx_indicate = RT_NULL;
     device->tx_complete = RT_NULL;
     device->user_data   = data;
+#ifdef RT_SENSOR_USING_STREAM
+    sensor->stream      = RT_NULL;
+#endif
 
     result = rt_device_register(device, device_name, flag | RT_DEVICE_FLAG_STANDALONE);
     if (result != RT_EOK)
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2019-01-31     flybreak     first version
+ * 2019-10-07     RT-Thread    add the stream of samples
  */
 
 #ifndef __SENSOR_H__
@@ -105,6 +106,7 @@ extern "C" {
 #define  RT_SENSOR_CTRL_SET_MODE       (4)  /* Set sensor's work mode. ex. RT_SENSOR_MODE_POLLING,RT_SENSOR_MODE_INT */
 #define  RT_SENSOR_CTRL_SET_POWER      (5)  /* Set power mode. args type of sensor power mode. ex. RT_SENSOR_POWER_DOWN,RT_SENSOR_POWER_NORMAL */
 #define  RT_SENSOR_CTRL_SELF_TEST      (6)  /* Take a self test */
+#define  RT_SENSOR_CTRL_GET_OVERRUN    (7)  /* Get the samples lost by rt_device_read in stream. args type of rt_uint32_t* */
 
 struct rt_sensor_info
 {
@@ -138,6 +140,35 @@ struct rt_sensor_config
 
 typedef struct rt_sensor_device *rt_sensor_t;
 
+#ifdef RT_SENSOR_USING_STREAM
+/* A reader of the stream, every reader has its own cursor */
+struct rt_sensor_reader
+{
+    rt_sensor_t                  sensor;    /* The sensor to read */
+    rt_uint32_t                  cursor;    /* The count of samples read */
+    rt_uint32_t                  overrun;   /* The samples overwritten before read */
+};
+
+/* The samples of interrupt and fifo mode, the time of samples is in microsecond */
+struct rt_sensor_stream
+{
+    struct rt_sensor_data       *buffer;    /* The ring buffer of samples, then the buffer to fetch */
+    rt_uint32_t                  size;      /* The samples in ring buffer, power of 2 */
+    rt_uint32_t                  batch;     /* The samples fetched at a time */
+    volatile rt_uint32_t         head;      /* The count of samples put */
+
+    rt_uint32_t                  irq_time;  /* The time of last interrupt */
+    rt_uint32_t                  last_time; /* The time of last sample */
+    volatile rt_uint8_t          pending;   /* The sensor is waiting for fetching */
+
+    struct rt_sensor_reader      reader;    /* The reader of rt_device_read */
+    rt_wqueue_t                  wait;      /* The readers waiting for samples, all are woken */
+    rt_uint32_t                  ref;       /* The readers holding the stream */
+    struct rt_completion         released;  /* Done by the last reader after closed */
+    volatile rt_uint8_t          closed;    /* The waiting readers return on closed */
+};
+#endif /* RT_SENSOR_USING_STREAM */
+
 struct rt_sensor_device
 {
     struct rt_device             parent;    /* The standard device */
@@ -151,7 +182,10 @@ struct rt_sensor_device
     const struct rt_sensor_ops  *ops;       /* The sensor ops */
 
     struct rt_sensor_module     *module;    /* The sensor module */
-    
+#ifdef RT_SENSOR_USING_STREAM
+    struct rt_sensor_stream     *stream;    /* The stream of samples, when opened in interrupt or fifo mode */
+#endif
+
     rt_err_t (*irq_handle)(rt_sensor_t sensor);             /* Called when an interrupt is generated, registered by the driver */
 };
 
@@ -174,6 +208,9 @@ struct sensor_3_axis
 struct rt_sensor_data
 {
     rt_uint32_t         timestamp;          /* The timestamp when the data was received */
+#ifdef RT_SENSOR_USING_STREAM
+    rt_uint32_t         time_us;            /* The time of sample in microsecond, set by the stream only */
+#endif
     rt_uint8_t          type;               /* The sensor type of the data */
     union
     {
@@ -203,6 +240,13 @@ int rt_hw_sensor_register(rt_sensor_t sensor,
                           const char              *name,
                           rt_uint32_t              flag,
                           void                    *data);
+void rt_sensor_cb(rt_sensor_t sen);
+
+#ifdef RT_SENSOR_USING_STREAM
+void rt_sensor_reader_init(struct rt_sensor_reader *reader, rt_sensor_t sensor);
+rt_size_t rt_sensor_reader_read(struct rt_sensor_reader *reader, struct rt_sensor_data *buf, rt_size_t len);
+rt_err_t rt_sensor_reader_wait(struct rt_sensor_reader *reader, rt_int32_t msec);
+#endif
 
 #ifdef __cplusplus
 }
@@ -11,13 +11,35 @@
  * 2012-05-18     bernard      Changed SPI message to message list.
  *                             Added take/release SPI device/bus interface.
  * 2012-09-28     aozima       fixed rt_spi_release_bus assert error.
+ * 2019-09-23     RT-Thread    add asynchronous transfer queue.
+ * 2019-10-26     RT-Thread    re-configure the bus in the SPI thread, not in interrupt.
  */
 
+#include <rthw.h>
 #include <drivers/spi.h>
 
 extern rt_err_t rt_spi_bus_device_init(struct rt_spi_bus *bus, const char *name);
 extern rt_err_t rt_spidev_device_init(struct rt_spi_device *dev, const char *name);
 
+/* take the bus lock, the asynchronous transfers on bus are waited */
+static rt_err_t _spi_bus_lock(struct rt_spi_bus *bus)
+{
+    rt_err_t result;
+
+    result = rt_mutex_take(&(bus->lock), RT_WAITING_FOREVER);
+#ifdef RT_USING_SPI_ASYNC
+    if (result == RT_EOK)
+    {
+        while (bus->async_current != RT_NULL)
+        {
+            rt_completion_wait(&(bus->async_idle), RT_WAITING_FOREVER);
+        }
+    }
+#endif
+
+    return result;
+}
+
 rt_err_t rt_spi_bus_register(struct rt_spi_bus       *bus,
                              const char              *name,
                              const struct rt_spi_ops *ops)
@@ -36,6 +58,12 @@ rt_err_t rt_spi_bus_register(struct rt_spi_bus       *bus,
     bus->owner = RT_NULL;
     /* set bus mode */
     bus->mode = RT_SPI_BUS_MODE_SPI;
+#ifdef RT_USING_SPI_ASYNC
+    rt_list_init(&(bus->async_queue));
+    bus->async_current = RT_NULL;
+    rt_completion_init(&(bus->async_idle));
+    rt_list_init(&(bus->async_defer));
+#endif
 
     return RT_EOK;
 }
@@ -83,7 +111,7 @@ rt_err_t rt_spi_configure(struct rt_spi_device        *device,
 
     if (device->bus != RT_NULL)
     {
-        result = rt_mutex_take(&(device->bus->lock), RT_WAITING_FOREVER);
+        result = _spi_bus_lock(device->bus);
         if (result == RT_EOK)
         {
             if (device->bus->owner == device)
@@ -111,7 +139,7 @@ rt_err_t rt_spi_send_then_send(struct rt_spi_device *device,
     RT_ASSERT(device != RT_NULL);
     RT_ASSERT(device->bus != RT_NULL);
 
-    result = rt_mutex_take(&(device->bus->lock), RT_WAITING_FOREVER);
+    result = _spi_bus_lock(device->bus);
     if (result == RT_EOK)
     {
         if (device->bus->owner != device)
@@ -186,7 +214,7 @@ rt_err_t rt_spi_send_then_recv(struct rt_spi_device *device,
     RT_ASSERT(device != RT_NULL);
     RT_ASSERT(device->bus != RT_NULL);
 
-    result = rt_mutex_take(&(device->bus->lock), RT_WAITING_FOREVER);
+    result = _spi_bus_lock(device->bus);
     if (result == RT_EOK)
     {
         if (device->bus->owner != device)
@@ -260,7 +288,7 @@ rt_size_t rt_spi_transfer(struct rt_spi_device *device,
     RT_ASSERT(device != RT_NULL);
     RT_ASSERT(device->bus != RT_NULL);
 
-    result = rt_mutex_take(&(device->bus->lock), RT_WAITING_FOREVER);
+    result = _spi_bus_lock(device->bus);
     if (result == RT_EOK)
     {
         if (device->bus->owner != device)
@@ -323,7 +351,7 @@ struct rt_spi_message *rt_spi_transfer_message(struct rt_spi_device  *device,
     if (index == RT_NULL)
         return index;
 
-    result = rt_mutex_take(&(device->bus->lock), RT_WAITING_FOREVER);
+    result = _spi_bus_lock(device->bus);
     if (result != RT_EOK)
     {
         rt_set_errno(-RT_EBUSY);
@@ -380,7 +408,7 @@ rt_err_t rt_spi_take_bus(struct rt_spi_device *device)
     RT_ASSERT(device != RT_NULL);
     RT_ASSERT(device->bus != RT_NULL);
 
-    result = rt_mutex_take(&(device->bus->lock), RT_WAITING_FOREVER);
+    result = _spi_bus_lock(device->bus);
     if (result != RT_EOK)
     {
         rt_set_errno(-RT_EBUSY);
@@ -458,3 +486,273 @@ rt_err_t rt_spi_release(struct rt_spi_device *device)
 
     return result;
 }
+
+#ifdef RT_USING_SPI_ASYNC
+#ifndef RT_SPI_ASYNC_STK_SIZE
+#define RT_SPI_ASYNC_STK_SIZE       1024
+#endif
+#ifndef RT_SPI_ASYNC_THREAD_PRIO
+#define RT_SPI_ASYNC_THREAD_PRIO    8
+#endif
+
+/* the SPI thread starts the buses which are stopped in interrupt */
+static struct rt_thread spi_async_thread;
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t spi_async_thread_stack[RT_SPI_ASYNC_STK_SIZE];
+static struct rt_semaphore spi_async_sem;
+static rt_list_t spi_async_list = RT_LIST_OBJECT_INIT(spi_async_list);
+
+/* finish the transfer on bus and take the next one in queue */
+static struct rt_spi_async *_spi_async_finish(struct rt_spi_bus *bus, rt_err_t result)
+{
+    struct rt_spi_async *async = bus->async_current;
+    rt_base_t level;
+
+    async->result = result;
+    async->failed = (result == RT_EOK) ? RT_NULL : async->current;
+
+    level = rt_hw_interrupt_disable();
+    if (rt_list_isempty(&(bus->async_queue)))
+    {
+        bus->async_current = RT_NULL;
+    }
+    else
+    {
+        bus->async_current = rt_list_first_entry(&(bus->async_queue), struct rt_spi_async, list);
+        rt_list_remove(&(bus->async_current->list));
+    }
+    rt_hw_interrupt_enable(level);
+
+    return async;
+}
+
+static void _spi_async_notify(struct rt_spi_bus *bus, struct rt_spi_async *async)
+{
+    rt_spi_async_callback_t callback = async->callback;
+    struct rt_completion *completion = async->completion;
+
+    /* it can be queued again from now */
+    async->device = RT_NULL;
+
+    if (callback != RT_NULL)
+        callback(async);
+    if (completion != RT_NULL)
+        rt_completion_done(completion);
+
+    if (bus->async_current == RT_NULL)
+        rt_completion_done(&(bus->async_idle));
+}
+
+/* the current message is transferred, return the finished transfer */
+static struct rt_spi_async *_spi_async_advance(struct rt_spi_bus *bus, rt_size_t length)
+{
+    struct rt_spi_async *async = bus->async_current;
+
+    if (length == 0 && async->current->length != 0)
+        return _spi_async_finish(bus, -RT_EIO);
+
+    async->current = async->current->next;
+    if (async->current == RT_NULL)
+        return _spi_async_finish(bus, RT_EOK);
+
+    return RT_NULL;
+}
+
+/* the bus is started by the SPI thread, the interrupt is disabled */
+static void _spi_async_defer(struct rt_spi_bus *bus)
+{
+    if (rt_list_isempty(&(bus->async_defer)))
+    {
+        rt_list_insert_before(&spi_async_list, &(bus->async_defer));
+        rt_sem_release(&spi_async_sem);
+    }
+}
+
+/*
+ * start the transfers on bus until a message is in progress or the queue is
+ * empty. In interrupt, the bus is not re-configured and the blocking xfer is
+ * not called, they are deferred to the SPI thread.
+ */
+static void _spi_async_run(struct rt_spi_bus *bus, rt_bool_t in_isr)
+{
+    struct rt_spi_async *async, *finished;
+    rt_base_t level;
+    rt_err_t result;
+
+    while ((async = bus->async_current) != RT_NULL)
+    {
+        finished = RT_NULL;
+
+        /* the consecutive transfers of same device are not re-configured */
+        if (bus->owner != async->device)
+        {
+            if (in_isr)
+            {
+                level = rt_hw_interrupt_disable();
+                _spi_async_defer(bus);
+                rt_hw_interrupt_enable(level);
+                return;
+            }
+
+            if (bus->ops->configure(async->device, &async->device->config) == RT_EOK)
+            {
+                bus->owner = async->device;
+            }
+            else
+            {
+                bus->owner = RT_NULL;
+                finished = _spi_async_finish(bus, -RT_EIO);
+            }
+        }
+
+        if (finished == RT_NULL)
+        {
+            /* the done interrupt must be after the starting returns */
+            level = rt_hw_interrupt_disable();
+            result = bus->ops->xfer_async(async->device, async->current);
+            if (result != RT_EOK && in_isr)
+                _spi_async_defer(bus);
+            rt_hw_interrupt_enable(level);
+            if (result == RT_EOK || in_isr)
+                return;
+
+            /* the driver can't transfer the message asynchronously */
+            finished = _spi_async_advance(bus, bus->ops->xfer(async->device, async->current));
+        }
+
+        if (finished != RT_NULL)
+            _spi_async_notify(bus, finished);
+    }
+}
+
+void rt_spi_bus_xfer_done(struct rt_spi_bus *bus, rt_size_t length)
+{
+    struct rt_spi_async *finished;
+
+    RT_ASSERT(bus != RT_NULL);
+    RT_ASSERT(bus->async_current != RT_NULL);
+
+    finished = _spi_async_advance(bus, length);
+    if (finished != RT_NULL)
+        _spi_async_notify(bus, finished);
+
+    /* the next message is started in interrupt, the bus is kept busy */
+    _spi_async_run(bus, RT_TRUE);
+}
+
+void rt_spi_async_init(struct rt_spi_async   *async,
+                       struct rt_spi_message *message,
+                       rt_spi_async_callback_t callback,
+                       struct rt_completion  *completion,
+                       void                  *user_data)
+{
+    RT_ASSERT(async != RT_NULL);
+
+    async->message = message;
+    async->callback = callback;
+    async->completion = completion;
+    async->user_data = user_data;
+    async->result = RT_EOK;
+    async->failed = RT_NULL;
+    /* it's not queued */
+    async->device = RT_NULL;
+    async->current = RT_NULL;
+    rt_list_init(&(async->list));
+}
+
+rt_err_t rt_spi_transfer_async(struct rt_spi_device *device,
+                               struct rt_spi_async  *async)
+{
+    rt_err_t result;
+    rt_base_t level;
+    rt_bool_t start = RT_FALSE;
+    struct rt_spi_bus *bus;
+
+    RT_ASSERT(device != RT_NULL);
+    RT_ASSERT(device->bus != RT_NULL);
+    RT_ASSERT(async != RT_NULL);
+    RT_ASSERT(async->message != RT_NULL);
+
+    bus = device->bus;
+    if (async->device != RT_NULL)
+        return -RT_EBUSY;
+
+    if (bus->ops->xfer_async == RT_NULL)
+    {
+        /* the bus driver doesn't support, it's transferred now */
+        async->failed = rt_spi_transfer_message(device, async->message);
+        async->result = (async->failed == RT_NULL) ? RT_EOK : -RT_EIO;
+
+        if (async->callback != RT_NULL)
+            async->callback(async);
+        if (async->completion != RT_NULL)
+            rt_completion_done(async->completion);
+
+        return RT_EOK;
+    }
+
+    /* the bus is not taken by synchronous transfers */
+    result = rt_mutex_take(&(bus->lock), RT_WAITING_FOREVER);
+    if (result != RT_EOK)
+        return -RT_EBUSY;
+
+    async->device = device;
+    async->current = async->message;
+    async->result = RT_EOK;
+    async->failed = RT_NULL;
+
+    level = rt_hw_interrupt_disable();
+    if (bus->async_current == RT_NULL)
+    {
+        bus->async_current = async;
+        start = RT_TRUE;
+    }
+    else
+    {
+        rt_list_insert_before(&(bus->async_queue), &(async->list));
+    }
+    rt_hw_interrupt_enable(level);
+
+    if (start)
+        _spi_async_run(bus, RT_FALSE);
+
+    rt_mutex_release(&(bus->lock));
+
+    return RT_EOK;
+}
+
+static void _spi_async_entry(void *parameter)
+{
+    struct rt_spi_bus *bus;
+    rt_base_t level;
+
+    while (1)
+    {
+        rt_sem_take(&spi_async_sem, RT_WAITING_FOREVER);
+
+        level = rt_hw_interrupt_disable();
+        while (!rt_list_isempty(&spi_async_list))
+        {
+            bus = rt_list_first_entry(&spi_async_list, struct rt_spi_bus, async_defer);
+            rt_list_remove(&(bus->async_defer));
+            rt_hw_interrupt_enable(level);
+
+            /* the bus is stopped, it's deferred again from the next done interrupt */
+            _spi_async_run(bus, RT_FALSE);
+
+            level = rt_hw_interrupt_disable();
+        }
+        rt_hw_interrupt_enable(level);
+    }
+}
+
+static int rt_spi_async_thread_init(void)
+{
+    rt_sem_init(&spi_async_sem, "spi", 0, RT_IPC_FLAG_FIFO);
+    rt_thread_init(&spi_async_thread, "spi", _spi_async_entry, RT_NULL,
+                   spi_async_thread_stack, RT_SPI_ASYNC_STK_SIZE, RT_SPI_ASYNC_THREAD_PRIO, 10);
+
+    return rt_thread_startup(&spi_async_thread);
+}
+INIT_PREV_EXPORT(rt_spi_async_thread_init);
+#endif /* RT_USING_SPI_ASYNC */
@@ -0,0 +1,637 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-24     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    check the wakeup flag of queue, the tasks are before the threads
+ * 2019-10-28     RT-Thread    hook the device before the read
+ */
+
+#include <rthw.h>
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <ipc/executor.h>
+
+#ifdef RT_USING_EXECUTOR
+
+#if defined(RT_USING_POSIX) && defined(SAL_USING_POSIX)
+#include <dfs.h>
+#include <dfs_file.h>
+#include <dfs_poll.h>
+#endif
+
+/* the tasks which hook the rx indicate of devices */
+static rt_list_t _task_device_list = RT_LIST_OBJECT_INIT(_task_device_list);
+
+/* put the task in the ready list, the interrupt is disabled */
+static void _task_ready(struct rt_task *task)
+{
+    struct rt_executor *executor = task->executor;
+
+    if (task->flags & RT_TASK_FLAG_READY)
+        return;
+
+    /* it's removed from the poll list */
+    rt_list_remove(&(task->list));
+    task->flags &= ~RT_TASK_FLAG_POLL;
+
+    rt_list_insert_before(&(executor->ready_list), &(task->list));
+    task->flags |= RT_TASK_FLAG_READY;
+}
+
+static int _task_wqueue_wake(struct rt_wqueue_node *wait, void *key)
+{
+    struct rt_task *task = rt_container_of(wait, struct rt_task, wait);
+
+    if (key && wait->key && !((rt_ubase_t)key & wait->key))
+        return -1;
+
+    task->flags |= RT_TASK_FLAG_WOKEN;
+    _task_ready(task);
+    rt_completion_done(&(task->executor->wake));
+
+    /*
+     * the node is kept until the await is done. rt_wqueue_wakeup() goes on with
+     * the other waiters and it stops at the first thread, so the tasks are put
+     * in front of the threads of queue.
+     */
+    return -1;
+}
+
+static rt_err_t _task_rx_ind(rt_device_t dev, rt_size_t size)
+{
+    rt_err_t (*rx_indicate)(rt_device_t dev, rt_size_t size) = RT_NULL;
+    struct rt_list_node *node;
+    struct rt_task *task;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    for (node = _task_device_list.next; node != &_task_device_list; node = node->next)
+    {
+        task = rt_list_entry(node, struct rt_task, wait.list);
+        if (task->device != dev)
+            continue;
+
+        if (task->rx_indicate)
+            rx_indicate = task->rx_indicate;
+        _task_ready(task);
+        rt_completion_done(&(task->executor->wake));
+    }
+    rt_hw_interrupt_enable(level);
+
+    /* the rx indicate before the tasks */
+    if (rx_indicate)
+        rx_indicate(dev, size);
+
+    return RT_EOK;
+}
+
+/* the task hooks the rx indicate of device, the interrupt is disabled */
+static void _task_device_hook(struct rt_task *task, rt_device_t dev)
+{
+    task->device = dev;
+    task->rx_indicate = (dev->rx_indicate == _task_rx_ind) ? RT_NULL : dev->rx_indicate;
+    rt_list_insert_before(&_task_device_list, &(task->wait.list));
+    task->flags |= RT_TASK_FLAG_DEVICE;
+    rt_device_set_rx_indicate(dev, _task_rx_ind);
+}
+
+/* the device is not hooked by this task any more */
+static void _task_device_unhook(struct rt_task *task)
+{
+    struct rt_list_node *node;
+    struct rt_task *other;
+    rt_device_t dev = task->device;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    task->device = RT_NULL;
+    for (node = _task_device_list.next; node != &_task_device_list; node = node->next)
+    {
+        other = rt_list_entry(node, struct rt_task, wait.list);
+        if (other->device == dev)
+        {
+            /* the other task hooks the device still, it has the rx indicate before */
+            if (other->rx_indicate == RT_NULL)
+                other->rx_indicate = task->rx_indicate;
+            rt_hw_interrupt_enable(level);
+            return;
+        }
+    }
+    rt_hw_interrupt_enable(level);
+
+    rt_device_set_rx_indicate(dev, task->rx_indicate);
+}
+
+static void _task_timer_add(struct rt_task *task, rt_tick_t ticks)
+{
+    struct rt_executor *executor = task->executor;
+    struct rt_list_node *node;
+    struct rt_task *entry;
+    rt_base_t level;
+
+    task->timeout_tick = rt_tick_get() + ticks;
+    for (node = executor->timer_list.next; node != &(executor->timer_list); node = node->next)
+    {
+        entry = rt_list_entry(node, struct rt_task, timer_list);
+        if ((rt_int32_t)(entry->timeout_tick - task->timeout_tick) > 0)
+            break;
+    }
+    rt_list_insert_before(node, &(task->timer_list));
+
+    level = rt_hw_interrupt_disable();
+    task->flags |= RT_TASK_FLAG_TIMER;
+    rt_hw_interrupt_enable(level);
+}
+
+/* the await is finished, the task leaves all waits */
+static void _task_disarm(struct rt_task *task)
+{
+    rt_base_t level;
+
+    if (task->flags & RT_TASK_FLAG_TIMER)
+        rt_list_remove(&(task->timer_list));
+
+    level = rt_hw_interrupt_disable();
+    if (task->flags & RT_TASK_FLAG_POLL)
+        rt_list_remove(&(task->list));
+    if (task->flags & (RT_TASK_FLAG_WQUEUE | RT_TASK_FLAG_DEVICE))
+        rt_list_remove(&(task->wait.list));
+    task->flags &= RT_TASK_FLAG_READY;
+    rt_hw_interrupt_enable(level);
+
+    if (task->device)
+        _task_device_unhook(task);
+}
+
+static int _task_finish(struct rt_task *task, rt_base_t result)
+{
+    _task_disarm(task);
+    task->result = result;
+
+    return RT_TASK_DONE;
+}
+
+/* wait for the object, the task is resumed by the object or the timeout */
+static int _task_wait(struct rt_task *task, rt_uint16_t type, void *object, rt_int32_t timeout)
+{
+    struct rt_executor *executor = task->executor;
+    rt_base_t level;
+
+    if (!(task->flags & RT_TASK_FLAG_WAITING))
+    {
+        if (timeout == 0)
+            return _task_finish(task, -RT_ETIMEOUT);
+
+        level = rt_hw_interrupt_disable();
+        task->flags |= RT_TASK_FLAG_WAITING;
+        rt_hw_interrupt_enable(level);
+        if (timeout > 0)
+            _task_timer_add(task, timeout);
+    }
+    else if (task->flags & RT_TASK_FLAG_TIMEOUT)
+    {
+        return _task_finish(task, -RT_ETIMEOUT);
+    }
+
+    level = rt_hw_interrupt_disable();
+    switch (type)
+    {
+    case RT_TASK_FLAG_POLL:
+        /* the task in ready list is checked again soon */
+        if (!(task->flags & (RT_TASK_FLAG_READY | RT_TASK_FLAG_POLL)))
+        {
+            if (rt_list_isempty(&(executor->poll_list)))
+                executor->poll_tick = rt_tick_get() + RT_EXECUTOR_POLL_TICK;
+            rt_list_insert_before(&(executor->poll_list), &(task->list));
+            task->flags |= RT_TASK_FLAG_POLL;
+        }
+        break;
+
+    case RT_TASK_FLAG_WQUEUE:
+        if (!(task->flags & RT_TASK_FLAG_WQUEUE) && object != RT_NULL)
+        {
+            rt_wqueue_t *queue = (rt_wqueue_t *)object;
+
+            /* it's waked after the condition is checked, as rt_wqueue_wait() */
+            if (queue->flag == RT_WQ_FLAG_WAKEUP)
+            {
+                queue->flag = 0;
+                rt_hw_interrupt_enable(level);
+
+                return _task_finish(task, RT_EOK);
+            }
+
+            task->wait.key = 0;
+            task->wait.polling_thread = executor->thread;
+            rt_list_insert_after(&(queue->waiting_list), &(task->wait.list));
+            task->flags |= RT_TASK_FLAG_WQUEUE;
+        }
+        break;
+
+    case RT_TASK_FLAG_DEVICE:
+        if (!(task->flags & RT_TASK_FLAG_DEVICE))
+            _task_device_hook(task, (rt_device_t)object);
+        break;
+
+    default:
+        break;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return RT_TASK_PENDING;
+}
+
+/* resume the tasks of timeout and the tasks waiting for kernel objects */
+static void _executor_check(struct rt_executor *executor)
+{
+    struct rt_task *task;
+    rt_tick_t now = rt_tick_get();
+    rt_base_t level;
+
+    while (!rt_list_isempty(&(executor->timer_list)))
+    {
+        task = rt_list_entry(executor->timer_list.next, struct rt_task, timer_list);
+        if ((rt_int32_t)(now - task->timeout_tick) < 0)
+            break;
+
+        rt_list_remove(&(task->timer_list));
+        level = rt_hw_interrupt_disable();
+        task->flags = (task->flags & ~RT_TASK_FLAG_TIMER) | RT_TASK_FLAG_TIMEOUT;
+        _task_ready(task);
+        rt_hw_interrupt_enable(level);
+    }
+
+    level = rt_hw_interrupt_disable();
+    if (!rt_list_isempty(&(executor->poll_list)) && (rt_int32_t)(now - executor->poll_tick) >= 0)
+    {
+        while (!rt_list_isempty(&(executor->poll_list)))
+        {
+            task = rt_list_entry(executor->poll_list.next, struct rt_task, list);
+            _task_ready(task);
+        }
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+/* the ticks to the next timeout or poll */
+static rt_int32_t _executor_next(struct rt_executor *executor)
+{
+    struct rt_task *task;
+    rt_int32_t ticks = RT_WAITING_FOREVER, left;
+    rt_tick_t now = rt_tick_get();
+    rt_base_t level;
+
+    if (!rt_list_isempty(&(executor->timer_list)))
+    {
+        task = rt_list_entry(executor->timer_list.next, struct rt_task, timer_list);
+        left = task->timeout_tick - now;
+        ticks = left > 0 ? left : 0;
+    }
+
+    level = rt_hw_interrupt_disable();
+    if (!rt_list_isempty(&(executor->poll_list)))
+    {
+        left = executor->poll_tick - now;
+        if (left < 0)
+            left = 0;
+        if (ticks == RT_WAITING_FOREVER || left < ticks)
+            ticks = left;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return ticks;
+}
+
+void rt_executor_init(struct rt_executor *executor)
+{
+    RT_ASSERT(executor != RT_NULL);
+
+    rt_memset(executor, 0, sizeof(struct rt_executor));
+    rt_list_init(&(executor->ready_list));
+    rt_list_init(&(executor->poll_list));
+    rt_list_init(&(executor->timer_list));
+    rt_completion_init(&(executor->wake));
+}
+
+/**
+ * This function runs the tasks of executor in current thread, it returns
+ * when all tasks are done.
+ *
+ * @param executor the executor
+ */
+void rt_executor_run(struct rt_executor *executor)
+{
+    struct rt_task *task;
+    rt_base_t level;
+    int ret;
+
+    RT_ASSERT(executor != RT_NULL);
+
+    executor->thread = rt_thread_self();
+    while (1)
+    {
+        _executor_check(executor);
+
+        level = rt_hw_interrupt_disable();
+        if (executor->task_num == 0)
+        {
+            rt_hw_interrupt_enable(level);
+            break;
+        }
+
+        if (rt_list_isempty(&(executor->ready_list)))
+        {
+            rt_hw_interrupt_enable(level);
+            /* the wake is done by the objects or spawn, the timeout is for timer and poll */
+            rt_completion_wait(&(executor->wake), _executor_next(executor));
+            continue;
+        }
+
+        task = rt_list_entry(executor->ready_list.next, struct rt_task, list);
+        rt_list_remove(&(task->list));
+        task->flags &= ~RT_TASK_FLAG_READY;
+        rt_hw_interrupt_enable(level);
+
+        ret = task->entry(task);
+        executor->resumes ++;
+
+        if (ret == RT_TASK_DONE)
+        {
+            _task_disarm(task);
+
+            level = rt_hw_interrupt_disable();
+            if (task->flags & RT_TASK_FLAG_READY)
+                rt_list_remove(&(task->list));
+            task->flags = 0;
+            task->executor = RT_NULL;
+            executor->task_num --;
+            rt_hw_interrupt_enable(level);
+
+            if (task->cleanup)
+                task->cleanup(task);
+        }
+        else
+        {
+            level = rt_hw_interrupt_disable();
+            /* it's not in an await, it yields */
+            if (!(task->flags & RT_TASK_FLAG_WAITING))
+                _task_ready(task);
+            rt_hw_interrupt_enable(level);
+        }
+    }
+}
+
+#ifdef RT_USING_HEAP
+static void _executor_thread_entry(void *parameter)
+{
+    struct rt_executor *executor = (struct rt_executor *)parameter;
+
+    while (1)
+    {
+        rt_executor_run(executor);
+        /* wait for spawn */
+        rt_completion_wait(&(executor->wake), RT_WAITING_FOREVER);
+    }
+}
+
+struct rt_executor *rt_executor_create(const char *name, rt_uint32_t stack_size, rt_uint8_t priority)
+{
+    struct rt_executor *executor;
+
+    executor = (struct rt_executor *)RT_KERNEL_MALLOC(sizeof(struct rt_executor));
+    if (executor == RT_NULL)
+        return RT_NULL;
+    rt_executor_init(executor);
+
+    executor->thread = rt_thread_create(name, _executor_thread_entry, executor, stack_size, priority, 10);
+    if (executor->thread == RT_NULL)
+    {
+        RT_KERNEL_FREE(executor);
+        return RT_NULL;
+    }
+    rt_thread_startup(executor->thread);
+
+    return executor;
+}
+#endif
+
+void rt_task_init(struct rt_task *task, int (*entry)(struct rt_task *task), void *user_data)
+{
+    RT_ASSERT(task != RT_NULL);
+    RT_ASSERT(entry != RT_NULL);
+
+    rt_memset(task, 0, sizeof(struct rt_task));
+    rt_list_init(&(task->list));
+    rt_list_init(&(task->timer_list));
+    rt_list_init(&(task->wait.list));
+    task->wait.wakeup = _task_wqueue_wake;
+    task->entry = entry;
+    task->user_data = user_data;
+}
+
+/**
+ * This function adds a task to executor, the task runs from the beginning
+ * of its entry.
+ *
+ * @param executor the executor
+ * @param task the task
+ *
+ * @return the error code, -RT_EBUSY if the task is not done.
+ */
+rt_err_t rt_executor_spawn(struct rt_executor *executor, struct rt_task *task)
+{
+    rt_base_t level;
+
+    RT_ASSERT(executor != RT_NULL);
+    RT_ASSERT(task != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    if (task->executor != RT_NULL)
+    {
+        rt_hw_interrupt_enable(level);
+        return -RT_EBUSY;
+    }
+    task->executor = executor;
+    task->line = 0;
+    task->flags = 0;
+    executor->task_num ++;
+    _task_ready(task);
+    rt_hw_interrupt_enable(level);
+
+    rt_completion_done(&(executor->wake));
+
+    return RT_EOK;
+}
+
+int rt_task_sleep(struct rt_task *task, rt_tick_t ticks)
+{
+    if (task->flags & RT_TASK_FLAG_WAITING)
+    {
+        return (task->flags & RT_TASK_FLAG_TIMEOUT) ? _task_finish(task, RT_EOK) : RT_TASK_PENDING;
+    }
+    if (ticks == 0)
+        return _task_finish(task, RT_EOK);
+
+    return _task_wait(task, 0, RT_NULL, ticks);
+}
+
+/* it's done when the condition is true or the queue is waked */
+int rt_task_wqueue_wait(struct rt_task *task, rt_wqueue_t *queue, int condition, rt_int32_t timeout)
+{
+    rt_base_t level;
+
+    if (condition)
+        return _task_finish(task, RT_EOK);
+
+    if (task->flags & RT_TASK_FLAG_WOKEN)
+    {
+        level = rt_hw_interrupt_disable();
+        queue->flag = 0;
+        rt_hw_interrupt_enable(level);
+
+        return _task_finish(task, RT_EOK);
+    }
+
+    return _task_wait(task, RT_TASK_FLAG_WQUEUE, queue, timeout);
+}
+
+#ifdef RT_USING_SEMAPHORE
+int rt_task_sem_take(struct rt_task *task, rt_sem_t sem, rt_int32_t timeout)
+{
+    if (rt_sem_trytake(sem) == RT_EOK)
+        return _task_finish(task, RT_EOK);
+
+    return _task_wait(task, RT_TASK_FLAG_POLL, RT_NULL, timeout);
+}
+#endif
+
+#ifdef RT_USING_MESSAGEQUEUE
+int rt_task_mq_recv(struct rt_task *task, rt_mq_t mq, void *buffer, rt_size_t size, rt_int32_t timeout)
+{
+    if (rt_mq_recv(mq, buffer, size, 0) == RT_EOK)
+        return _task_finish(task, RT_EOK);
+
+    return _task_wait(task, RT_TASK_FLAG_POLL, RT_NULL, timeout);
+}
+#endif
+
+/* the result is the size of read, the task is resumed by the rx indicate */
+int rt_task_device_read(struct rt_task *task, rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size,
+                        rt_int32_t timeout)
+{
+    rt_size_t length;
+    rt_base_t level;
+
+    /* it's hooked before the read, the data after the read wakes the task */
+    level = rt_hw_interrupt_disable();
+    if (!(task->flags & RT_TASK_FLAG_DEVICE))
+        _task_device_hook(task, dev);
+    rt_hw_interrupt_enable(level);
+
+    length = rt_device_read(dev, pos, buffer, size);
+    if (length > 0)
+        return _task_finish(task, length);
+
+    return _task_wait(task, RT_TASK_FLAG_DEVICE, dev, timeout);
+}
+
+#if defined(RT_USING_POSIX) && defined(SAL_USING_POSIX)
+struct task_pollreq
+{
+    rt_pollreq_t req;
+    struct rt_task *task;
+};
+
+static void _task_poll_add(rt_wqueue_t *wq, rt_pollreq_t *req)
+{
+    struct rt_task *task = rt_container_of(req, struct task_pollreq, req)->task;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    if (!(task->flags & RT_TASK_FLAG_WQUEUE))
+    {
+        task->wait.key = req->_key;
+        task->wait.polling_thread = task->executor->thread;
+        rt_list_insert_after(&(wq->waiting_list), &(task->wait.list));
+        task->flags |= RT_TASK_FLAG_WQUEUE;
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+/* the events of file, the task is put in the wait queue of file */
+static int _task_fd_events(struct rt_task *task, int fd, short events)
+{
+    struct task_pollreq pollreq;
+    struct dfs_fd *f;
+    int mask;
+
+    f = fd_get(fd);
+    if (f == RT_NULL)
+        return POLLNVAL;
+
+    mask = POLLMASK_DEFAULT;
+    if (f->fops->poll)
+    {
+        pollreq.req._proc = (task->flags & RT_TASK_FLAG_WQUEUE) ? RT_NULL : _task_poll_add;
+        pollreq.req._key = events | POLLERR | POLLHUP;
+        pollreq.task = task;
+        mask = f->fops->poll(f, &(pollreq.req));
+    }
+    fd_put(f);
+
+    return mask & (events | POLLERR | POLLHUP);
+}
+
+/* the result is the events of file */
+int rt_task_poll(struct rt_task *task, int fd, short events, rt_int32_t timeout)
+{
+    int mask;
+
+    mask = _task_fd_events(task, fd, events);
+    if (mask)
+        return _task_finish(task, mask);
+
+    return _task_wait(task, RT_TASK_FLAG_WQUEUE, RT_NULL, timeout);
+}
+
+/* the result is the size of received data, or -RT_ERROR and errno is set */
+int rt_task_recv(struct rt_task *task, int s, void *mem, rt_size_t len, int flags, rt_int32_t timeout)
+{
+    int ret;
+
+    if (_task_fd_events(task, s, POLLIN) == 0)
+        return _task_wait(task, RT_TASK_FLAG_WQUEUE, RT_NULL, timeout);
+
+    ret = recv(s, mem, len, flags);
+    return _task_finish(task, ret < 0 ? -RT_ERROR : ret);
+}
+
+int rt_task_send(struct rt_task *task, int s, const void *data, rt_size_t size, int flags, rt_int32_t timeout)
+{
+    int ret;
+
+    if (_task_fd_events(task, s, POLLOUT) == 0)
+        return _task_wait(task, RT_TASK_FLAG_WQUEUE, RT_NULL, timeout);
+
+    ret = send(s, data, size, flags);
+    return _task_finish(task, ret < 0 ? -RT_ERROR : ret);
+}
+
+/* the result is the new socket */
+int rt_task_accept(struct rt_task *task, int s, struct sockaddr *addr, socklen_t *addrlen, rt_int32_t timeout)
+{
+    int ret;
+
+    if (_task_fd_events(task, s, POLLIN) == 0)
+        return _task_wait(task, RT_TASK_FLAG_WQUEUE, RT_NULL, timeout);
+
+    ret = accept(s, addr, addrlen);
+    return _task_finish(task, ret < 0 ? -RT_ERROR : ret);
+}
+#endif /* RT_USING_POSIX && SAL_USING_POSIX */
+
+#endif /* RT_USING_EXECUTOR */
@@ -6,6 +6,9 @@
  * Change Logs:
  * Date           Author       Notes
  * 2017-02-27     bernard      fix the re-work issue.
+ * 2019-10-21     RT-Thread    add worker pool, work priority and timing wheel
+ * 2019-10-26     RT-Thread    submit the expired works atomically, unlink the works on destroy
+ * 2019-10-28     RT-Thread    move all the expired works to their queues in one section
  */
 
 #include <rthw.h>
@@ -14,7 +17,24 @@
 
 #ifdef RT_USING_HEAP
 
-static void _delayed_work_timeout_handler(void *parameter);
+/*
+ * The delayed works of all workqueues are in a timing wheel, a slot is a tick.
+ * The works of a slot are in different rounds, one timer wakes at the next
+ * slot which is not empty.
+ */
+#define WORK_WHEEL_SIZE     32
+#define WORK_WHEEL_MASK     (WORK_WHEEL_SIZE - 1)
+
+static struct
+{
+    rt_list_t slot[WORK_WHEEL_SIZE];
+    rt_uint32_t bitmap;             /* the slots which are not empty */
+    rt_tick_t last;                 /* the last tick which is checked */
+    rt_tick_t expire;               /* the timeout tick of timer */
+    rt_bool_t running;
+    rt_bool_t inited;
+    struct rt_timer timer;
+} _work_wheel;
 
 rt_inline rt_err_t _workqueue_work_completion(struct rt_workqueue *queue)
 {
@@ -47,37 +67,125 @@ rt_inline rt_err_t _workqueue_work_completion(struct rt_workqueue *queue)
     return result;
 }
 
+/* the interrupt is disabled */
+static rt_bool_t _workqueue_is_running(struct rt_workqueue *queue, struct rt_work *work)
+{
+    rt_uint16_t i;
+
+    for (i = 0; i < queue->worker_num; i++)
+    {
+        if (queue->workers[i].work_current == work)
+            return RT_TRUE;
+    }
+
+    return RT_FALSE;
+}
+
+/* put the work in list of its priority, the interrupt is disabled */
+static rt_bool_t _workqueue_link(struct rt_workqueue *queue, struct rt_work *work, rt_tick_t ready_tick)
+{
+    /* NOTE: the work MUST be initialized firstly */
+    rt_list_remove(&(work->list));
+
+    rt_list_insert_before(&(queue->work_list[work->priority]), &(work->list));
+    queue->work_ready |= 1ul << work->priority;
+    queue->work_pending ++;
+    work->flags |= RT_WORK_STATE_PENDING;
+#ifdef RT_WORKQUEUE_USING_STAT
+    work->ready_tick = ready_tick;
+    if (queue->work_pending > queue->stat.pending_max)
+        queue->stat.pending_max = queue->work_pending;
+#endif
+
+    /* an idle worker is waked, once */
+    if (queue->worker_idle > 0)
+    {
+        queue->worker_idle --;
+        return RT_TRUE;
+    }
+
+    return RT_FALSE;
+}
+
+/* link the work which is not pending or running, the interrupt is disabled */
+static rt_err_t _workqueue_link_work(struct rt_workqueue *queue, struct rt_work *work, rt_tick_t ready_tick,
+                                     rt_bool_t *wake)
+{
+    if (work->flags & RT_WORK_STATE_PENDING)
+        return -RT_EBUSY;
+
+    if (_workqueue_is_running(queue, work))
+        return -RT_EBUSY;
+
+    *wake = _workqueue_link(queue, work, ready_tick);
+
+    return RT_EOK;
+}
+
+/* remove the pending work, the interrupt is disabled */
+static void _workqueue_unlink(struct rt_workqueue *queue, struct rt_work *work)
+{
+    if (!(work->flags & RT_WORK_STATE_PENDING))
+        return;
+
+    rt_list_remove(&(work->list));
+    if (rt_list_isempty(&(queue->work_list[work->priority])))
+        queue->work_ready &= ~(1ul << work->priority);
+    queue->work_pending --;
+    work->flags &= ~RT_WORK_STATE_PENDING;
+}
+
 static void _workqueue_thread_entry(void *parameter)
 {
     rt_base_t level;
     struct rt_work *work;
     struct rt_workqueue *queue;
+    struct rt_workqueue_worker *worker;
+#ifdef RT_WORKQUEUE_USING_STAT
+    rt_tick_t start, elapsed;
+#endif
 
-    queue = (struct rt_workqueue *) parameter;
-    RT_ASSERT(queue != RT_NULL);
+    worker = (struct rt_workqueue_worker *) parameter;
+    RT_ASSERT(worker != RT_NULL);
+    queue = worker->queue;
 
     while (1)
     {
-        if (rt_list_isempty(&(queue->work_list)))
+        level = rt_hw_interrupt_disable();
+        if (queue->work_ready == 0)
         {
-            /* no software timer exist, suspend self. */
-            rt_thread_suspend(rt_thread_self());
-            rt_schedule();
+            queue->worker_idle ++;
+            rt_hw_interrupt_enable(level);
+            /* no work to do, wait for the submitting */
+            rt_sem_take(&(queue->work_sem), RT_WAITING_FOREVER);
+            continue;
         }
 
-        /* we have work to do with. */
-        level = rt_hw_interrupt_disable();
-        work = rt_list_entry(queue->work_list.next, struct rt_work, list);
-        rt_list_remove(&(work->list));
-        queue->work_current = work;
-        work->flags &= ~RT_WORK_STATE_PENDING;
+        /* we have work to do with, the highest priority one firstly. */
+        work = rt_list_entry(queue->work_list[__rt_ffs(queue->work_ready) - 1].next, struct rt_work, list);
+        _workqueue_unlink(queue, work);
+        worker->work_current = work;
+#ifdef RT_WORKQUEUE_USING_STAT
+        start = rt_tick_get();
+        elapsed = start - work->ready_tick;
+        queue->stat.latency_sum += elapsed;
+        if (elapsed > queue->stat.latency_max)
+            queue->stat.latency_max = elapsed;
+#endif
         rt_hw_interrupt_enable(level);
 
-        /* do work */
+        /* do work, it may be freed by itself */
         work->work_func(work, work->work_data);
         level = rt_hw_interrupt_disable();
         /* clean current work */
-        queue->work_current = RT_NULL;
+        worker->work_current = RT_NULL;
+#ifdef RT_WORKQUEUE_USING_STAT
+        elapsed = rt_tick_get() - start;
+        queue->stat.done ++;
+        queue->stat.exec_sum += elapsed;
+        if (elapsed > queue->stat.exec_max)
+            queue->stat.exec_max = elapsed;
+#endif
         rt_hw_interrupt_enable(level);
 
         /* ack work completion */
@@ -85,43 +193,150 @@ static void _workqueue_thread_entry(void *parameter)
     }
 }
 
-static rt_err_t _workqueue_submit_work(struct rt_workqueue *queue, struct rt_work *work)
+static void _work_wheel_start(rt_tick_t ticks)
+{
+    rt_timer_control(&(_work_wheel.timer), RT_TIMER_CTRL_SET_TIME, &ticks);
+    _work_wheel.expire = rt_tick_get() + ticks;
+    _work_wheel.running = RT_TRUE;
+    rt_timer_start(&(_work_wheel.timer));
+}
+
+/* the interrupt is disabled */
+static void _work_wheel_remove(struct rt_delayed_work *work)
+{
+    rt_uint32_t index = work->timeout_tick & WORK_WHEEL_MASK;
+
+    rt_list_remove(&(work->work.list));
+    if (rt_list_isempty(&(_work_wheel.slot[index])))
+        _work_wheel.bitmap &= ~(1ul << index);
+    work->work.flags &= ~RT_WORK_STATE_SUBMITTING;
+}
+
+/* the interrupt is disabled */
+static void _work_wheel_insert(struct rt_delayed_work *work, rt_tick_t ticks)
+{
+    rt_tick_t now = rt_tick_get();
+    rt_uint32_t index;
+
+    if (_work_wheel.bitmap == 0)
+        _work_wheel.last = now;
+
+    work->timeout_tick = now + ticks;
+    index = work->timeout_tick & WORK_WHEEL_MASK;
+    rt_list_remove(&(work->work.list));
+    rt_list_insert_before(&(_work_wheel.slot[index]), &(work->work.list));
+    _work_wheel.bitmap |= 1ul << index;
+    work->work.flags |= RT_WORK_STATE_SUBMITTING;
+
+    if (!_work_wheel.running || (rt_int32_t)(work->timeout_tick - _work_wheel.expire) < 0)
+        _work_wheel_start(ticks);
+}
+
+static void _work_wheel_timeout(void *parameter)
 {
+    struct rt_workqueue *queue;
+    struct rt_delayed_work *work;
+    struct rt_list_node *node, *next;
+    rt_tick_t now, tick;
+    rt_uint32_t i, count, index, bitmap;
     rt_base_t level;
+    rt_bool_t wake;
 
+    /*
+     * the expired works are moved to their queues in one section, so a cancel
+     * or a destroy always finds them in the wheel or in the queue. The workers
+     * are waked with the scheduler locked and run after the section.
+     */
+    rt_enter_critical();
     level = rt_hw_interrupt_disable();
-    if (work->flags & RT_WORK_STATE_PENDING)
+    now = rt_tick_get();
+    _work_wheel.running = RT_FALSE;
+
+    /* the slots from the last checked tick, all slots at most */
+    count = now - _work_wheel.last;
+    if (count > WORK_WHEEL_SIZE)
+        count = WORK_WHEEL_SIZE;
+    tick = now - count + 1;
+    for (i = 0; i < count; i++)
     {
-        rt_hw_interrupt_enable(level);
-        return -RT_EBUSY;
+        index = (tick + i) & WORK_WHEEL_MASK;
+        if (!(_work_wheel.bitmap & (1ul << index)))
+            continue;
+
+        for (node = _work_wheel.slot[index].next; node != &(_work_wheel.slot[index]); node = next)
+        {
+            next = node->next;
+            work = rt_list_entry(node, struct rt_delayed_work, work.list);
+            /* the work of later rounds is kept */
+            if ((rt_int32_t)(now - work->timeout_tick) < 0)
+                continue;
+
+            _work_wheel_remove(work);
+            queue = work->workqueue;
+            wake = RT_FALSE;
+            if (queue != RT_NULL)
+                _workqueue_link_work(queue, &(work->work), work->timeout_tick, &wake);
+            if (wake)
+                rt_sem_release(&(queue->work_sem));
+        }
     }
+    _work_wheel.last = now;
 
-    if (queue->work_current == work)
+    /* wake at the next slot which is not empty */
+    bitmap = _work_wheel.bitmap;
+    if (bitmap != 0)
     {
-        rt_hw_interrupt_enable(level);
-        return -RT_EBUSY;
+        index = (now + 1) & WORK_WHEEL_MASK;
+        if (index != 0)
+            bitmap = (bitmap >> index) | (bitmap << (WORK_WHEEL_SIZE - index));
+        _work_wheel_start(__rt_ffs(bitmap));
     }
+    else
+    {
+        rt_timer_stop(&(_work_wheel.timer));
+    }
+    rt_hw_interrupt_enable(level);
+    rt_exit_critical();
+}
 
-    /* NOTE: the work MUST be initialized firstly */
-    rt_list_remove(&(work->list));
-
-    rt_list_insert_after(queue->work_list.prev, &(work->list));
-    work->flags |= RT_WORK_STATE_PENDING;
+static void _work_wheel_init(void)
+{
+    rt_base_t level;
+    int i;
 
-    /* whether the workqueue is doing work */
-    if (queue->work_current == RT_NULL)
+    level = rt_hw_interrupt_disable();
+    if (_work_wheel.inited)
     {
         rt_hw_interrupt_enable(level);
-        /* resume work thread */
-        rt_thread_resume(queue->work_thread);
-        rt_schedule();
+        return;
     }
-    else
+    _work_wheel.inited = RT_TRUE;
+    rt_hw_interrupt_enable(level);
+
+    for (i = 0; i < WORK_WHEEL_SIZE; i++)
     {
-        rt_hw_interrupt_enable(level);
+        rt_list_init(&(_work_wheel.slot[i]));
     }
+    /* it's restarted in timeout with the ticks to next slot, or stopped */
+    rt_timer_init(&(_work_wheel.timer), "work", _work_wheel_timeout, RT_NULL, 1,
+                  RT_TIMER_FLAG_PERIODIC | RT_TIMER_FLAG_SOFT_TIMER);
+}
 
-    return RT_EOK;
+static rt_err_t _workqueue_submit_work(struct rt_workqueue *queue, struct rt_work *work, rt_tick_t ready_tick)
+{
+    rt_base_t level;
+    rt_bool_t wake = RT_FALSE;
+    rt_err_t result;
+
+    level = rt_hw_interrupt_disable();
+    result = _workqueue_link_work(queue, work, ready_tick, &wake);
+    rt_hw_interrupt_enable(level);
+
+    /* resume a work thread */
+    if (wake)
+        rt_sem_release(&(queue->work_sem));
+
+    return result;
 }
 
 static rt_err_t _workqueue_cancel_work(struct rt_workqueue *queue, struct rt_work *work)
@@ -129,13 +344,12 @@ static rt_err_t _workqueue_cancel_work(struct rt_workqueue *queue, struct rt_wor
     rt_base_t level;
 
     level = rt_hw_interrupt_disable();
-    if (queue->work_current == work)
+    if (_workqueue_is_running(queue, work))
     {
         rt_hw_interrupt_enable(level);
         return -RT_EBUSY;
     }
-    rt_list_remove(&(work->list));
-    work->flags &= ~RT_WORK_STATE_PENDING;
+    _workqueue_unlink(queue, work);
     rt_hw_interrupt_enable(level);
 
     return RT_EOK;
@@ -155,7 +369,7 @@ static rt_err_t _workqueue_cancel_delayed_work(struct rt_delayed_work *work)
     if (work->work.flags & RT_WORK_STATE_PENDING)
     {
         /* Remove from the queue if already submitted */
-        ret = rt_workqueue_cancel_work(work->workqueue, &(work->work));
+        ret = _workqueue_cancel_work(work->workqueue, &(work->work));
         if (ret)
         {
             goto __exit;
@@ -163,14 +377,13 @@ static rt_err_t _workqueue_cancel_delayed_work(struct rt_delayed_work *work)
     }
     else
     {
+        level = rt_hw_interrupt_disable();
         if (work->work.flags & RT_WORK_STATE_SUBMITTING)
         {
-            level = rt_hw_interrupt_disable();
-            rt_timer_stop(&(work->timer));
-            rt_timer_detach(&(work->timer));
-            work->work.flags &= ~RT_WORK_STATE_SUBMITTING;
-            rt_hw_interrupt_enable(level);
+            /* Remove from the timing wheel */
+            _work_wheel_remove(work);
         }
+        rt_hw_interrupt_enable(level);
     }
 
     level = rt_hw_interrupt_disable();
@@ -215,68 +428,137 @@ static rt_err_t _workqueue_submit_delayed_work(struct rt_workqueue *queue,
     if (!ticks)
     {
         /* Submit work if no ticks is 0 */
-        _workqueue_submit_work(work->workqueue, &(work->work));
+        _workqueue_submit_work(work->workqueue, &(work->work), rt_tick_get());
     }
     else
     {
         level = rt_hw_interrupt_disable();
         /* Add timeout */
-        work->work.flags |= RT_WORK_STATE_SUBMITTING;
-        rt_timer_init(&(work->timer), "work", _delayed_work_timeout_handler, work, ticks,
-                      RT_TIMER_FLAG_ONE_SHOT | RT_TIMER_FLAG_SOFT_TIMER);
+        _work_wheel_insert(work, ticks);
         rt_hw_interrupt_enable(level);
-        rt_timer_start(&(work->timer));
     }
 
 __exit:
     return ret;
 }
 
-static void _delayed_work_timeout_handler(void *parameter)
-{
-    struct rt_delayed_work *delayed_work;
-    rt_base_t level;
-
-    delayed_work = (struct rt_delayed_work *)parameter;
-    level = rt_hw_interrupt_disable();
-    rt_timer_stop(&(delayed_work->timer));
-    rt_timer_detach(&(delayed_work->timer));
-    delayed_work->work.flags &= ~RT_WORK_STATE_SUBMITTING;
-    rt_hw_interrupt_enable(level);
-    _workqueue_submit_work(delayed_work->workqueue, &(delayed_work->work));
-}
-
-struct rt_workqueue *rt_workqueue_create(const char *name, rt_uint16_t stack_size, rt_uint8_t priority)
+struct rt_workqueue *rt_workqueue_create_workers(const char *name, rt_uint16_t stack_size, rt_uint8_t priority,
+                                                 rt_uint16_t worker_num)
 {
     struct rt_workqueue *queue = RT_NULL;
+    char thread_name[RT_NAME_MAX + 1];
+    rt_uint16_t i;
+
+    if (worker_num == 0)
+        worker_num = 1;
+    _work_wheel_init();
 
-    queue = (struct rt_workqueue *)RT_KERNEL_MALLOC(sizeof(struct rt_workqueue));
+    queue = (struct rt_workqueue *)RT_KERNEL_MALLOC(sizeof(struct rt_workqueue) +
+                                                    worker_num * sizeof(struct rt_workqueue_worker));
     if (queue != RT_NULL)
     {
+        rt_memset(queue, 0, sizeof(struct rt_workqueue) + worker_num * sizeof(struct rt_workqueue_worker));
+
         /* initialize work list */
-        rt_list_init(&(queue->work_list));
-        queue->work_current = RT_NULL;
+        for (i = 0; i < RT_WORKQUEUE_PRIORITY_NUM; i++)
+        {
+            rt_list_init(&(queue->work_list[i]));
+        }
         rt_sem_init(&(queue->sem), "wqueue", 0, RT_IPC_FLAG_FIFO);
+        rt_sem_init(&(queue->work_sem), "wqwork", 0, RT_IPC_FLAG_FIFO);
+        queue->workers = (struct rt_workqueue_worker *)(queue + 1);
+
+        /* create the work threads */
+        for (i = 0; i < worker_num; i++)
+        {
+            /* the name of other workers has the index at the end */
+            rt_strncpy(thread_name, name, RT_NAME_MAX);
+            thread_name[RT_NAME_MAX] = '\0';
+            if (i > 0)
+            {
+                thread_name[RT_NAME_MAX - 2] = '\0';
+                rt_snprintf(thread_name + rt_strlen(thread_name), 3, "%d", i);
+            }
+
+            queue->workers[i].queue = queue;
+            queue->workers[i].thread = rt_thread_create(thread_name, _workqueue_thread_entry, &(queue->workers[i]),
+                                                        stack_size, priority, 10);
+            if (queue->workers[i].thread == RT_NULL)
+                break;
+        }
+        queue->worker_num = i;
 
-        /* create the work thread */
-        queue->work_thread = rt_thread_create(name, _workqueue_thread_entry, queue, stack_size, priority, 10);
-        if (queue->work_thread == RT_NULL)
+        if (queue->worker_num == 0)
         {
+            rt_sem_detach(&(queue->sem));
+            rt_sem_detach(&(queue->work_sem));
             RT_KERNEL_FREE(queue);
             return RT_NULL;
         }
 
-        rt_thread_startup(queue->work_thread);
+        for (i = 0; i < queue->worker_num; i++)
+        {
+            rt_thread_startup(queue->workers[i].thread);
+        }
     }
 
     return queue;
 }
 
+struct rt_workqueue *rt_workqueue_create(const char *name, rt_uint16_t stack_size, rt_uint8_t priority)
+{
+    return rt_workqueue_create_workers(name, stack_size, priority, 1);
+}
+
 rt_err_t rt_workqueue_destroy(struct rt_workqueue *queue)
 {
+    struct rt_delayed_work *work;
+    struct rt_work *pending;
+    struct rt_list_node *node, *next;
+    rt_base_t level;
+    rt_uint16_t i;
+
     RT_ASSERT(queue != RT_NULL);
 
-    rt_thread_delete(queue->work_thread);
+    /* the delayed works of this queue are not submitted any more */
+    level = rt_hw_interrupt_disable();
+    for (i = 0; i < WORK_WHEEL_SIZE; i++)
+    {
+        for (node = _work_wheel.slot[i].next; node != &(_work_wheel.slot[i]); node = next)
+        {
+            next = node->next;
+            work = rt_list_entry(node, struct rt_delayed_work, work.list);
+            if (work->workqueue == queue)
+            {
+                _work_wheel_remove(work);
+                work->workqueue = RT_NULL;
+            }
+        }
+    }
+
+    /* the pending works are unlinked from the lists which are freed */
+    for (i = 0; i < RT_WORKQUEUE_PRIORITY_NUM; i++)
+    {
+        while (!rt_list_isempty(&(queue->work_list[i])))
+        {
+            pending = rt_list_first_entry(&(queue->work_list[i]), struct rt_work, list);
+            _workqueue_unlink(queue, pending);
+            if (pending->type & RT_WORK_TYPE_DELAYED)
+                ((struct rt_delayed_work *)pending)->workqueue = RT_NULL;
+        }
+    }
+    rt_hw_interrupt_enable(level);
+
+    /* the idle workers are resumed from the semaphore before they are deleted */
+    rt_enter_critical();
+    rt_sem_detach(&(queue->work_sem));
+    rt_sem_detach(&(queue->sem));
+    for (i = 0; i < queue->worker_num; i++)
+    {
+        rt_thread_delete(queue->workers[i].thread);
+    }
+    rt_exit_critical();
+
     RT_KERNEL_FREE(queue);
 
     return RT_EOK;
@@ -287,7 +569,7 @@ rt_err_t rt_workqueue_dowork(struct rt_workqueue *queue, struct rt_work *work)
     RT_ASSERT(queue != RT_NULL);
     RT_ASSERT(work != RT_NULL);
 
-    return _workqueue_submit_work(queue, work);
+    return _workqueue_submit_work(queue, work, rt_tick_get());
 }
 
 rt_err_t rt_workqueue_submit_work(struct rt_workqueue *queue, struct rt_work *work, rt_tick_t time)
@@ -301,35 +583,32 @@ rt_err_t rt_workqueue_submit_work(struct rt_workqueue *queue, struct rt_work *wo
     }
     else
     {
-        return _workqueue_submit_work(queue, work);
+        return _workqueue_submit_work(queue, work, rt_tick_get());
     }
 }
 
 rt_err_t rt_workqueue_critical_work(struct rt_workqueue *queue, struct rt_work *work)
 {
     rt_base_t level;
+    rt_bool_t wake;
     RT_ASSERT(queue != RT_NULL);
     RT_ASSERT(work != RT_NULL);
 
     level = rt_hw_interrupt_disable();
-    if (queue->work_current == work)
+    if (_workqueue_is_running(queue, work))
     {
         rt_hw_interrupt_enable(level);
         return -RT_EBUSY;
     }
 
-    /* NOTE: the work MUST be initialized firstly */
-    rt_list_remove(&(work->list));
+    /* the pending work is moved to the tail */
+    _workqueue_unlink(queue, work);
+    wake = _workqueue_link(queue, work, rt_tick_get());
+    rt_hw_interrupt_enable(level);
 
-    rt_list_insert_after(queue->work_list.prev, &(work->list));
-    if (queue->work_current == RT_NULL)
-    {
-        rt_hw_interrupt_enable(level);
-        /* resume work thread */
-        rt_thread_resume(queue->work_thread);
-        rt_schedule();
-    }
-    else rt_hw_interrupt_enable(level);
+    /* resume a work thread */
+    if (wake)
+        rt_sem_release(&(queue->work_sem));
 
     return RT_EOK;
 }
@@ -357,16 +636,21 @@ rt_err_t rt_workqueue_cancel_work_sync(struct rt_workqueue *queue, struct rt_wor
     RT_ASSERT(work != RT_NULL);
 
     level = rt_hw_interrupt_disable();
-    if (queue->work_current == work) /* it's current work in the queue */
+    while (_workqueue_is_running(queue, work)) /* it's current work in the queue */
     {
+        rt_hw_interrupt_enable(level);
         /* wait for work completion */
         rt_sem_take(&(queue->sem), RT_WAITING_FOREVER);
+        level = rt_hw_interrupt_disable();
     }
-    else
+    if (work->type & RT_WORK_TYPE_DELAYED)
     {
-        rt_list_remove(&(work->list));
+        /* the delayed work may be still in the timing wheel */
+        if (work->flags & RT_WORK_STATE_SUBMITTING)
+            _work_wheel_remove((struct rt_delayed_work *)work);
+        ((struct rt_delayed_work *)work)->workqueue = RT_NULL;
     }
-    work->flags &= ~RT_WORK_STATE_PENDING;
+    _workqueue_unlink(queue, work);
     rt_hw_interrupt_enable(level);
 
     return RT_EOK;
@@ -374,25 +658,59 @@ rt_err_t rt_workqueue_cancel_work_sync(struct rt_workqueue *queue, struct rt_wor
 
 rt_err_t rt_workqueue_cancel_all_work(struct rt_workqueue *queue)
 {
-    struct rt_list_node *node, *next;
+    struct rt_work *work;
+    rt_base_t level;
+    int i;
+
     RT_ASSERT(queue != RT_NULL);
 
-    rt_enter_critical();
-    for (node = queue->work_list.next; node != &(queue->work_list); node = next)
+    level = rt_hw_interrupt_disable();
+    for (i = 0; i < RT_WORKQUEUE_PRIORITY_NUM; i++)
     {
-        next = node->next;
-        rt_list_remove(node);
+        while (!rt_list_isempty(&(queue->work_list[i])))
+        {
+            work = rt_list_entry(queue->work_list[i].next, struct rt_work, list);
+            _workqueue_unlink(queue, work);
+        }
     }
-    rt_exit_critical();
+    rt_hw_interrupt_enable(level);
 
     return RT_EOK;
 }
 
+#ifdef RT_WORKQUEUE_USING_STAT
+void rt_workqueue_get_stat(struct rt_workqueue *queue, struct rt_workqueue_stat *stat)
+{
+    rt_base_t level;
+
+    RT_ASSERT(queue != RT_NULL);
+    RT_ASSERT(stat != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    *stat = queue->stat;
+    rt_hw_interrupt_enable(level);
+}
+
+void rt_workqueue_reset_stat(struct rt_workqueue *queue)
+{
+    rt_base_t level;
+
+    RT_ASSERT(queue != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    rt_memset(&(queue->stat), 0, sizeof(queue->stat));
+    queue->stat.pending_max = queue->work_pending;
+    rt_hw_interrupt_enable(level);
+}
+#endif /* RT_WORKQUEUE_USING_STAT */
+
 void rt_delayed_work_init(struct rt_delayed_work *work, void (*work_func)(struct rt_work *work,
                           void *work_data), void *work_data)
 {
     rt_work_init(&(work->work), work_func, work_data);
     work->work.type = RT_WORK_TYPE_DELAYED;
+    work->timeout_tick = 0;
+    work->workqueue = RT_NULL;
 }
 
 #ifdef RT_USING_SYSTEM_WORKQUEUE
@@ -408,10 +726,15 @@ rt_err_t rt_work_cancel(struct rt_work *work)
     return rt_workqueue_cancel_work(sys_workq, work);
 }
 
+struct rt_workqueue *rt_work_sys_workqueue(void)
+{
+    return sys_workq;
+}
+
 static int rt_work_sys_workqueue_init(void)
 {
-    sys_workq = rt_workqueue_create("sys_work", RT_SYSTEM_WORKQUEUE_STACKSIZE,
-                                    RT_SYSTEM_WORKQUEUE_PRIORITY);
+    sys_workq = rt_workqueue_create_workers("sys_work", RT_SYSTEM_WORKQUEUE_STACKSIZE,
+                                            RT_SYSTEM_WORKQUEUE_PRIORITY, RT_SYSTEM_WORKQUEUE_WORKERS);
 
     return RT_EOK;
 }
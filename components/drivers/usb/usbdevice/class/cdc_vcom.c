@@ -10,6 +10,9 @@
  * 2013-06-25     heyuanjie87  remove SOF mechinism
  * 2013-07-20     Yi Qiu       do more test
  * 2016-02-01     Urey         Fix some error
+ * 2019-09-30     RT-Thread    send to endpoint directly, add block mode
+ * 2019-10-26     RT-Thread    abort the timed out transfer in the soft timer
+ * 2019-10-28     RT-Thread    drop the completion of the aborted transfer
  */
 
 #include <rthw.h>
@@ -28,20 +31,14 @@
 #define VCOM_TX_TIMEOUT      1000
 #endif /*RT_VCOM_TX_TIMEOUT*/
 
+/* the size of the notice which finishes the aborted transfer, see _vcom_tx_timeout() */
+#define VCOM_TX_ABORT_SIZE   ((rt_size_t)-1)
+
 #define CDC_RX_BUFSIZE          128
+#define CDC_RX_FIFO_SIZE        512
 #define CDC_MAX_PACKET_SIZE     64
 #define VCOM_DEVICE             "vcom"
 
-#ifdef RT_VCOM_TASK_STK_SIZE
-#define VCOM_TASK_STK_SIZE      RT_VCOM_TASK_STK_SIZE
-#else /*!RT_VCOM_TASK_STK_SIZE*/
-#define VCOM_TASK_STK_SIZE      512
-#endif /*RT_VCOM_TASK_STK_SIZE*/
-
-#ifdef RT_VCOM_TX_USE_DMA
-#define VCOM_TX_USE_DMA
-#endif /*RT_VCOM_TX_USE_DMA*/
-
 #ifdef RT_VCOM_SERNO
 #define _SER_NO RT_VCOM_SERNO
 #else /*!RT_VCOM_SERNO*/
@@ -54,17 +51,11 @@
 #define _SER_NO_LEN 14 /*rt_strlen("32021919830108")*/
 #endif /*RT_VCOM_SER_LEN*/
 
-ALIGN(RT_ALIGN_SIZE)
-static rt_uint8_t vcom_thread_stack[VCOM_TASK_STK_SIZE];
-static struct rt_thread vcom_thread;
 static struct ucdc_line_coding line_coding;
 
 #define CDC_TX_BUFSIZE    1024
 #define CDC_BULKIN_MAXSIZE (CDC_TX_BUFSIZE / 8)
 
-#define CDC_TX_HAS_DATE   0x01
-#define CDC_TX_HAS_SPACE  0x02
-
 struct vcom
 {
     struct rt_serial_device serial;
@@ -73,19 +64,19 @@ struct vcom
     uep_t ep_cmd;
     rt_bool_t connected;
     rt_bool_t in_sending;
-    struct rt_completion wait;
     rt_uint8_t rx_rbp[CDC_RX_BUFSIZE];
     struct rt_ringbuffer rx_ringbuffer;
     rt_uint8_t tx_rbp[CDC_TX_BUFSIZE];
     struct rt_ringbuffer tx_ringbuffer;
-    struct rt_event  tx_event;
-};
-
-struct vcom_tx_msg
-{
-    struct rt_serial_device * serial;
-    const char *buf;
-    rt_size_t size;
+    /* the packet of tx ringbuffer in sending */
+    rt_uint8_t tx_buf[CDC_BULKIN_MAXSIZE];
+    /* the data of DMA tx mode, it's sent without copying */
+    rt_uint8_t *tx_block;
+    rt_size_t tx_block_size;
+    rt_bool_t tx_block_sending;
+    /* the completions of bulk in endpoint are dropped until the abort notice */
+    rt_bool_t tx_aborting;
+    struct rt_timer tx_timer;
 };
 
 ALIGN(4)
@@ -247,6 +238,190 @@ const static char* _ustring[] =
 };
 static void rt_usb_vcom_init(struct ufunction *func);
 
+/**
+ * This function will start the next transfer of bulk in endpoint if it's idle,
+ * the data of DMA tx mode goes first, then the data of tx ringbuffer.
+ *
+ * @param func the usb function object.
+ */
+static void _vcom_tx_start(ufunction_t func)
+{
+    struct vcom *data;
+    rt_uint8_t *buffer;
+    rt_size_t size;
+    rt_base_t level;
+
+    data = (struct vcom*)func->user_data;
+
+    level = rt_hw_interrupt_disable();
+    if (data->in_sending || !data->connected)
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+
+    if (data->tx_block != RT_NULL)
+    {
+        buffer = data->tx_block;
+        size = data->tx_block_size;
+        data->tx_block_sending = RT_TRUE;
+    }
+    else
+    {
+        buffer = data->tx_buf;
+        size = rt_ringbuffer_get(&data->tx_ringbuffer, data->tx_buf, CDC_BULKIN_MAXSIZE);
+        if (size == 0)
+        {
+            rt_hw_interrupt_enable(level);
+            return;
+        }
+    }
+    data->in_sending = RT_TRUE;
+    rt_hw_interrupt_enable(level);
+
+    rt_timer_start(&data->tx_timer);
+
+    data->ep_in->request.buffer = buffer;
+    data->ep_in->request.size = size;
+    data->ep_in->request.req_type = UIO_REQUEST_WRITE;
+    rt_usbd_io_request(func->device, data->ep_in, &data->ep_in->request);
+}
+
+/**
+ * This function will finish the transfer of bulk in endpoint, then the next
+ * one is started.
+ *
+ * @param func the usb function object.
+ */
+static void _vcom_tx_done(ufunction_t func)
+{
+    struct vcom *data;
+    rt_bool_t block;
+    rt_base_t level;
+
+    data = (struct vcom*)func->user_data;
+
+    level = rt_hw_interrupt_disable();
+    /* the aborted transfer is finished by the abort notice only */
+    if (!data->in_sending || data->tx_aborting)
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+    data->in_sending = RT_FALSE;
+    block = data->tx_block_sending;
+    if (block)
+    {
+        data->tx_block = RT_NULL;
+        data->tx_block_sending = RT_FALSE;
+    }
+    rt_hw_interrupt_enable(level);
+
+    rt_timer_stop(&data->tx_timer);
+
+#ifdef RT_SERIAL_USING_DMA
+    /* the next data of DMA tx mode may be submitted */
+    if (block && (data->serial.parent.open_flag & RT_DEVICE_FLAG_DMA_TX))
+    {
+        rt_hw_serial_isr(&data->serial, RT_SERIAL_EVENT_TX_DMADONE);
+    }
+#endif
+    if (!block && (data->serial.parent.open_flag & RT_DEVICE_FLAG_INT_TX))
+    {
+        rt_hw_serial_isr(&data->serial, RT_SERIAL_EVENT_TX_DONE);
+    }
+
+    _vcom_tx_start(func);
+}
+
+/**
+ * This function will drop the data not sent, the data of DMA tx mode is
+ * completed for recovering the resources.
+ *
+ * @param func the usb function object.
+ */
+static void _vcom_tx_flush(ufunction_t func)
+{
+    struct vcom *data;
+#ifdef RT_SERIAL_USING_DMA
+    rt_bool_t block;
+#endif
+    rt_base_t level;
+
+    data = (struct vcom*)func->user_data;
+
+    level = rt_hw_interrupt_disable();
+#ifdef RT_SERIAL_USING_DMA
+    block = (data->tx_block != RT_NULL);
+#endif
+    data->tx_block = RT_NULL;
+    data->tx_block_sending = RT_FALSE;
+    data->in_sending = RT_FALSE;
+    data->tx_aborting = RT_FALSE;
+    rt_ringbuffer_reset(&data->tx_ringbuffer);
+    rt_hw_interrupt_enable(level);
+
+    rt_timer_stop(&data->tx_timer);
+
+#ifdef RT_SERIAL_USING_DMA
+    if (block && (data->serial.parent.open_flag & RT_DEVICE_FLAG_DMA_TX))
+    {
+        rt_hw_serial_isr(&data->serial, RT_SERIAL_EVENT_TX_DMADONE);
+    }
+#endif
+    if (data->serial.parent.open_flag & RT_DEVICE_FLAG_INT_TX)
+    {
+        rt_hw_serial_isr(&data->serial, RT_SERIAL_EVENT_TX_DONE);
+    }
+}
+
+/*
+ * it's called in the timer thread (RT_USING_TIMER_SOFT is selected by the CDC
+ * class), the endpoint can be re-enabled. A completion of the aborted transfer
+ * may be already queued to the usb thread, so the transfer is finished by a
+ * notice queued after it, and the completions before the notice are dropped.
+ */
+static void _vcom_tx_timeout(void *parameter)
+{
+    ufunction_t func = (ufunction_t)parameter;
+    struct vcom *data;
+    struct udev_msg msg;
+    rt_bool_t aborted = RT_FALSE;
+    rt_base_t level;
+
+    data = (struct vcom*)func->user_data;
+
+    /* the transfer is not finished in interrupt while it's aborted */
+    level = rt_hw_interrupt_disable();
+    if (data->in_sending && !data->tx_aborting)
+    {
+        /* abort the transfer in progress, the buffer is not used after it */
+        dcd_ep_disable(func->device->dcd, data->ep_in);
+        dcd_ep_enable(func->device->dcd, data->ep_in);
+        /* the rest packets are not written by the completion queued before */
+        data->ep_in->request.remain_size = 0;
+        data->tx_aborting = RT_TRUE;
+        aborted = RT_TRUE;
+    }
+    rt_hw_interrupt_enable(level);
+
+    if (aborted)
+    {
+        RT_DEBUG_LOG(RT_DEBUG_USB, ("vcom tx timeout\n"));
+
+        msg.type = USB_MSG_DATA_NOTIFY;
+        msg.dcd = func->device->dcd;
+        msg.content.ep_msg.ep_addr = EP_ADDRESS(data->ep_in);
+        msg.content.ep_msg.size = VCOM_TX_ABORT_SIZE;
+        if (rt_usbd_event_signal(&msg) != RT_EOK)
+        {
+            /* the message queue is full, finish it here */
+            data->tx_aborting = RT_FALSE;
+            _vcom_tx_done(func);
+        }
+    }
+}
+
 static void _vcom_reset_state(ufunction_t func)
 {
     struct vcom* data;
@@ -258,9 +433,10 @@ static void _vcom_reset_state(ufunction_t func)
     
     lvl = rt_hw_interrupt_disable();
     data->connected = RT_FALSE;
-    data->in_sending = RT_FALSE;
     /*rt_kprintf("reset USB serial\n", cnt);*/
     rt_hw_interrupt_enable(lvl);
+
+    _vcom_tx_flush(func);
 }
 
 /**
@@ -275,10 +451,31 @@ static rt_err_t _ep_in_handler(ufunction_t func, rt_size_t size)
 {
     struct vcom *data;
     rt_size_t request_size;
+    rt_bool_t aborting;
+    rt_base_t level;
 
     RT_ASSERT(func != RT_NULL);
 
     data = (struct vcom*)func->user_data;
+
+    /* the completion of the aborted transfer is dropped, the notice finishes it */
+    level = rt_hw_interrupt_disable();
+    aborting = data->tx_aborting;
+    if (size == VCOM_TX_ABORT_SIZE)
+    {
+        data->tx_aborting = RT_FALSE;
+    }
+    rt_hw_interrupt_enable(level);
+
+    if (aborting || size == VCOM_TX_ABORT_SIZE)
+    {
+        if (aborting && size == VCOM_TX_ABORT_SIZE)
+        {
+            _vcom_tx_done(func);
+        }
+        return RT_EOK;
+    }
+
     request_size = data->ep_in->request.size;
     RT_DEBUG_LOG(RT_DEBUG_USB, ("_ep_in_handler %d\n", request_size));
     if ((request_size != 0) && ((request_size % EP_MAXPACKET(data->ep_in)) == 0))
@@ -288,8 +485,6 @@ static rt_err_t _ep_in_handler(ufunction_t func, rt_size_t size)
          *
          * FIXME: actually, this might not be the right place to send zlp.
          * Only the rt_device_write could know how much data is sending. */
-        data->in_sending = RT_TRUE;
-
         data->ep_in->request.buffer = RT_NULL;
         data->ep_in->request.size = 0;
         data->ep_in->request.req_type = UIO_REQUEST_WRITE;
@@ -298,11 +493,32 @@ static rt_err_t _ep_in_handler(ufunction_t func, rt_size_t size)
         return RT_EOK;
     }
     
-    rt_completion_done(&data->wait);
+    _vcom_tx_done(func);
     
     return RT_EOK;
 }
 
+#ifdef RT_SERIAL_USING_DMA
+/* the fifo is updated by the RT_SERIAL_EVENT_RX_DMADONE event */
+static void _vcom_rx_fifo_put(struct vcom *data, const rt_uint8_t *buf, rt_size_t size)
+{
+    struct rt_serial_rx_fifo *rx_fifo;
+    rt_size_t len;
+
+    rx_fifo = (struct rt_serial_rx_fifo*)data->serial.serial_rx;
+    RT_ASSERT(rx_fifo != RT_NULL);
+    RT_ASSERT(size <= data->serial.config.bufsz);
+
+    len = data->serial.config.bufsz - rx_fifo->put_index;
+    if (len > size)
+    {
+        len = size;
+    }
+    rt_memcpy(rx_fifo->buffer + rx_fifo->put_index, buf, len);
+    rt_memcpy(rx_fifo->buffer, buf + len, size - len);
+}
+#endif
+
 /**
  * This function will handle cdc bulk out endpoint request.
  *
@@ -325,6 +541,16 @@ static rt_err_t _ep_out_handler(ufunction_t func, rt_size_t size)
     if((data->serial.parent.flag & RT_DEVICE_FLAG_ACTIVATED)
         && (data->serial.parent.open_flag & RT_DEVICE_OFLAG_OPEN))
     {
+#ifdef RT_SERIAL_USING_DMA
+        if(data->serial.parent.open_flag & RT_DEVICE_FLAG_DMA_RX)
+        {
+            /* the packet is moved to the fifo of serial at once */
+            _vcom_rx_fifo_put(data, data->ep_out->buffer, size);
+            rt_hw_serial_isr(&data->serial, RT_SERIAL_EVENT_RX_DMADONE | (size << 8));
+
+            goto _next;
+        }
+#endif
         /* receive data from USB VCOM */
         level = rt_hw_interrupt_disable();
 
@@ -335,6 +561,9 @@ static rt_err_t _ep_out_handler(ufunction_t func, rt_size_t size)
         rt_hw_serial_isr(&data->serial,RT_SERIAL_EVENT_RX_IND);
     }
 
+#ifdef RT_SERIAL_USING_DMA
+_next:
+#endif
     data->ep_out->request.buffer = data->ep_out->buffer;
     data->ep_out->request.size = EP_MAXPACKET(data->ep_out);
     data->ep_out->request.req_type = UIO_REQUEST_READ_BEST;
@@ -458,6 +687,14 @@ static rt_err_t _interface_handler(ufunction_t func, ureq_t setup)
     case CDC_SET_CONTROL_LINE_STATE:
         data->connected = (setup->wValue & 0x01) > 0?RT_TRUE:RT_FALSE;
         RT_DEBUG_LOG(RT_DEBUG_USB, ("vcom state:%d \n", data->connected));
+        if (data->connected)
+        {
+            _vcom_tx_start(func);
+        }
+        else
+        {
+            _vcom_tx_flush(func);
+        }
         dcd_ep0_send_status(func->device->dcd);
         break;
     case CDC_SEND_BREAK:
@@ -695,43 +932,15 @@ static int _vcom_getc(struct rt_serial_device *serial)
     return result;
 }
 
-static rt_size_t _vcom_rb_block_put(struct vcom *data, const rt_uint8_t *buf, rt_size_t size)
-{
-    rt_uint32_t level;
-    rt_size_t   put_len = 0;
-    rt_size_t   w_ptr = 0;
-    rt_uint32_t res;
-    rt_size_t   remain_size = size;
-
-    while (remain_size)
-    {
-        level = rt_hw_interrupt_disable();
-        put_len = rt_ringbuffer_put(&data->tx_ringbuffer, (const rt_uint8_t *)&buf[w_ptr], remain_size);
-        rt_hw_interrupt_enable(level);
-        w_ptr += put_len;
-        remain_size -= put_len;
-        if (put_len == 0)
-        {
-            rt_event_recv(&data->tx_event, CDC_TX_HAS_SPACE,
-                    RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
-                    VCOM_TX_TIMEOUT, &res);
-        }
-        else
-        {
-            rt_event_send(&data->tx_event, CDC_TX_HAS_DATE);
-        }
-    }
-
-    return size;
-}
-
+/*
+ * The data of DMA tx mode is sent without copying, so it must be kept until
+ * the tx_complete callback of device. The '\n' isn't converted in this mode.
+ */
 static rt_size_t _vcom_tx(struct rt_serial_device *serial, rt_uint8_t *buf, rt_size_t size,int direction)
 {
     struct ufunction *func;
     struct vcom *data;
-    rt_uint32_t send_size = 0;
-    rt_size_t ptr = 0;
-    rt_uint8_t crlf[2] = {'\r', '\n',};
+    rt_base_t level;
 
     func = (struct ufunction*)serial->parent.user_data;
     data = (struct vcom*)func->user_data;
@@ -741,40 +950,19 @@ static rt_size_t _vcom_tx(struct rt_serial_device *serial, rt_uint8_t *buf, rt_s
 
     RT_DEBUG_LOG(RT_DEBUG_USB, ("%s\n",__func__));
 
+    if (direction != RT_SERIAL_DMA_TX)
+    {
+        return 0;
+    }
+
     if (data->connected)
     {
-        if((serial->parent.open_flag & RT_DEVICE_FLAG_STREAM))
-        {
-            while(send_size < size)
-            {
-                while(ptr < size && buf[ptr] != '\n')
-                {
-                    ptr++;
-                }
-                if(ptr < size)
-                {
-                    send_size += _vcom_rb_block_put(data, (const rt_uint8_t *)&buf[send_size], ptr - send_size);
-                    _vcom_rb_block_put(data, crlf, 2);
-                    send_size++;
-                    ptr++;
-                }
-                else if (ptr == size)
-                {
-                    send_size += _vcom_rb_block_put(data, (const rt_uint8_t *)&buf[send_size], ptr - send_size);
-                }
-                else
-                {
-                    break;
-                }
-            }
-        }
-        else
-        {
-            while (send_size < size)
-            {
-                send_size += _vcom_rb_block_put(data, (rt_uint8_t *)&buf[send_size], size - send_size);
-            }
-        }
+        level = rt_hw_interrupt_disable();
+        data->tx_block = buf;
+        data->tx_block_size = size;
+        rt_hw_interrupt_enable(level);
+
+        _vcom_tx_start(func);
     }
     else
     {
@@ -784,6 +972,7 @@ static rt_size_t _vcom_tx(struct rt_serial_device *serial, rt_uint8_t *buf, rt_s
 
     return size;
 }
+
 static int _vcom_putc(struct rt_serial_device *serial, char c)
 {
     rt_uint32_t level;
@@ -797,17 +986,24 @@ static int _vcom_putc(struct rt_serial_device *serial, char c)
 
     if (data->connected)
     {
+        level = rt_hw_interrupt_disable();
+        /* wait for the space in interrupt tx mode, or the oldest data is dropped */
+        if ((serial->parent.open_flag & RT_DEVICE_FLAG_INT_TX) &&
+            rt_ringbuffer_space_len(&data->tx_ringbuffer) < 2)
+        {
+            rt_hw_interrupt_enable(level);
+            _vcom_tx_start(func);
+            return -1;
+        }
         if(c == '\n' && (serial->parent.open_flag & RT_DEVICE_FLAG_STREAM))
         {
-            level = rt_hw_interrupt_disable();
             rt_ringbuffer_putchar_force(&data->tx_ringbuffer, '\r');
-            rt_hw_interrupt_enable(level);
-            rt_event_send(&data->tx_event, CDC_TX_HAS_DATE);
         }
-        level = rt_hw_interrupt_disable();
         rt_ringbuffer_putchar_force(&data->tx_ringbuffer, c);
         rt_hw_interrupt_enable(level);
-        rt_event_send(&data->tx_event, CDC_TX_HAS_DATE);
+
+        /* the characters put during a transfer are sent by the next one */
+        _vcom_tx_start(func);
     }
 
     return 1;
@@ -822,92 +1018,6 @@ static const struct rt_uart_ops usb_vcom_ops =
     _vcom_tx
 };
 
-/* Vcom Tx Thread */
-static void vcom_tx_thread_entry(void* parameter)
-{
-    rt_uint32_t level;
-    rt_uint32_t res;
-    struct ufunction *func = (struct ufunction *)parameter;
-    struct vcom *data = (struct vcom*)func->user_data;
-    rt_uint8_t ch[CDC_BULKIN_MAXSIZE];
-
-    while (1)
-    {
-        if
-        (
-            (rt_event_recv(&data->tx_event, CDC_TX_HAS_DATE,
-                    RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
-                    RT_WAITING_FOREVER, &res) != RT_EOK) ||
-                                 (!(res & CDC_TX_HAS_DATE))
-        )
-        {
-            continue;
-        }
-        if(!(res & CDC_TX_HAS_DATE))
-        {
-            continue;
-        }
-        while(rt_ringbuffer_data_len(&data->tx_ringbuffer))
-        {
-            level = rt_hw_interrupt_disable();
-            res = rt_ringbuffer_get(&data->tx_ringbuffer, ch, CDC_BULKIN_MAXSIZE);
-            rt_hw_interrupt_enable(level);
-
-            if(!res)
-            {
-                continue;
-            }
-            if (!data->connected)
-            {
-                if(data->serial.parent.open_flag &
-#ifndef VCOM_TX_USE_DMA
-                         RT_DEVICE_FLAG_INT_TX
-#else
-                         RT_DEVICE_FLAG_DMA_TX
-#endif
-                )
-                {
-                /* drop msg */
-#ifndef VCOM_TX_USE_DMA
-                    rt_hw_serial_isr(&data->serial,RT_SERIAL_EVENT_TX_DONE);
-#else
-                    rt_hw_serial_isr(&data->serial,RT_SERIAL_EVENT_TX_DMADONE);
-#endif
-                }
-                continue;
-            }
-            rt_completion_init(&data->wait);
-            data->ep_in->request.buffer     = ch;
-            data->ep_in->request.size       = res;
-
-            data->ep_in->request.req_type   = UIO_REQUEST_WRITE;
-
-            rt_usbd_io_request(func->device, data->ep_in, &data->ep_in->request);
-
-            if (rt_completion_wait(&data->wait, VCOM_TX_TIMEOUT) != RT_EOK)
-            {
-                RT_DEBUG_LOG(RT_DEBUG_USB, ("vcom tx timeout\n"));
-            }
-            if(data->serial.parent.open_flag &
-#ifndef VCOM_TX_USE_DMA
-                         RT_DEVICE_FLAG_INT_TX
-#else
-                         RT_DEVICE_FLAG_DMA_TX
-#endif
-            )
-            {
-#ifndef VCOM_TX_USE_DMA
-                rt_hw_serial_isr(&data->serial,RT_SERIAL_EVENT_TX_DONE);
-#else
-                rt_hw_serial_isr(&data->serial,RT_SERIAL_EVENT_TX_DMADONE);
-#endif
-                rt_event_send(&data->tx_event, CDC_TX_HAS_SPACE);
-            }
-        }
-
-    }
-}
-
 static void rt_usb_vcom_init(struct ufunction *func)
 {
     rt_err_t result = RT_EOK;
@@ -918,7 +1028,8 @@ static void rt_usb_vcom_init(struct ufunction *func)
     rt_ringbuffer_init(&data->rx_ringbuffer, data->rx_rbp, CDC_RX_BUFSIZE);
     rt_ringbuffer_init(&data->tx_ringbuffer, data->tx_rbp, CDC_TX_BUFSIZE);
 
-    rt_event_init(&data->tx_event, "vcom", RT_IPC_FLAG_FIFO);
+    rt_timer_init(&data->tx_timer, "vcom", _vcom_tx_timeout, func,
+                  VCOM_TX_TIMEOUT, RT_TIMER_FLAG_ONE_SHOT | RT_TIMER_FLAG_SOFT_TIMER);
 
     config.baud_rate    = BAUD_RATE_115200;
     config.data_bits    = DATA_BITS_8;
@@ -926,27 +1037,19 @@ static void rt_usb_vcom_init(struct ufunction *func)
     config.parity       = PARITY_NONE;
     config.bit_order    = BIT_ORDER_LSB;
     config.invert       = NRZ_NORMAL;
-    config.bufsz        = CDC_RX_BUFSIZE;
+    config.bufsz        = CDC_RX_FIFO_SIZE;
 
     data->serial.ops        = &usb_vcom_ops;
     data->serial.serial_rx  = RT_NULL;
     data->serial.config     = config;
 
-    /* register vcom device */
-    rt_hw_serial_register(&data->serial, VCOM_DEVICE,
-#ifndef VCOM_TX_USE_DMA
-                          RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX,
-#else
-                          RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_DMA_TX,
+    /* register vcom device, the DMA mode moves whole packets */
+    result = rt_hw_serial_register(&data->serial, VCOM_DEVICE,
+#ifdef RT_SERIAL_USING_DMA
+                          RT_DEVICE_FLAG_DMA_RX | RT_DEVICE_FLAG_DMA_TX |
 #endif
+                          RT_DEVICE_FLAG_RDWR | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX,
                           func);
-
-    /* init usb device thread */
-    rt_thread_init(&vcom_thread, "vcom",
-                   vcom_tx_thread_entry, func,
-                   vcom_thread_stack, VCOM_TASK_STK_SIZE,
-                   16, 20);
-    result = rt_thread_startup(&vcom_thread);
     RT_ASSERT(result == RT_EOK);       
 }
 struct udclass vcom_class = 
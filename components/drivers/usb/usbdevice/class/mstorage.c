@@ -9,6 +9,8 @@
  * 2012-11-25     Heyuanjie87  reduce the memory consumption
  * 2012-12-09     Heyuanjie87  change function and endpoint handler 
  * 2013-07-25     Yi Qiu       update for USB CV test
+ * 2019-09-26     RT-Thread    multi-sector and double-buffered data transfer
+ * 2019-10-26     RT-Thread    a msc thread for every function, hold the failed CSW until clear halt
  */
 
 #include <rtthread.h>
@@ -18,6 +20,21 @@
 
 #ifdef RT_USB_DEVICE_MSTORAGE
 
+#ifdef RT_USB_MSTORAGE_BUFFER_SECTORS
+#define MSTORAGE_BUFFER_SECTORS     RT_USB_MSTORAGE_BUFFER_SECTORS
+#else /*!RT_USB_MSTORAGE_BUFFER_SECTORS*/
+#define MSTORAGE_BUFFER_SECTORS     1
+#endif /*RT_USB_MSTORAGE_BUFFER_SECTORS*/
+
+#ifdef RT_USB_MSTORAGE_DOUBLE_BUFFER
+#ifdef RT_USB_MSTORAGE_TASK_STK_SIZE
+#define MSTORAGE_TASK_STK_SIZE      RT_USB_MSTORAGE_TASK_STK_SIZE
+#else /*!RT_USB_MSTORAGE_TASK_STK_SIZE*/
+#define MSTORAGE_TASK_STK_SIZE      1024
+#endif /*RT_USB_MSTORAGE_TASK_STK_SIZE*/
+
+#endif /*RT_USB_MSTORAGE_DOUBLE_BUFFER*/
+
 enum STAT
 {
     STAT_CBW,
@@ -53,6 +70,17 @@ struct scsi_cmd
     CB_DIR dir;
 };
 
+/* a disk access, it's done by the msc thread with double buffers */
+struct mstorage_job
+{
+    rt_bool_t write;
+    rt_bool_t pending;
+    rt_uint8_t *buffer;
+    rt_uint32_t block;
+    rt_size_t count;
+    rt_size_t result;
+};
+
 struct mstorage
 {    
     struct ustorage_csw csw_response;
@@ -66,6 +94,16 @@ struct mstorage
     rt_int32_t size;
     struct scsi_cmd* processing;
     struct rt_device_blk_geometry geometry;    
+    /* the data buffers, both are the same one without double buffers */
+    rt_uint8_t *buffer[2];
+    rt_uint8_t current;
+    rt_uint32_t chunk;
+    struct mstorage_job job;
+#ifdef RT_USB_MSTORAGE_DOUBLE_BUFFER
+    struct rt_semaphore job_sem;
+    struct rt_semaphore done_sem;
+    rt_thread_t thread;
+#endif
 };
 
 ALIGN(4)
@@ -172,6 +210,7 @@ static rt_size_t _read_capacity(ufunction_t func, ustorage_cbw_t cbw);
 static rt_size_t _read_10(ufunction_t func, ustorage_cbw_t cbw);
 static rt_size_t _write_10(ufunction_t func, ustorage_cbw_t cbw);
 static rt_size_t _verify_10(ufunction_t func, ustorage_cbw_t cbw);
+static rt_err_t _function_disable(ufunction_t func);
 
 ALIGN(4)
 static struct scsi_cmd cmd_data[] =
@@ -189,6 +228,102 @@ static struct scsi_cmd cmd_data[] =
     {SCSI_VERIFY_10,       _verify_10,       10, FIXED,       0, DIR_NONE},
 };
 
+static void _disk_job(struct mstorage *data)
+{
+    struct mstorage_job *job = &data->job;
+
+    if(job->write)
+    {
+        job->result = rt_device_write(data->disk, job->block, job->buffer, job->count);
+    }
+    else
+    {
+        job->result = rt_device_read(data->disk, job->block, job->buffer, job->count);
+    }
+}
+
+#ifdef RT_USB_MSTORAGE_DOUBLE_BUFFER
+static void _disk_thread_entry(void* parameter)
+{
+    struct mstorage *data = (struct mstorage*)parameter;
+
+    while(1)
+    {
+        rt_sem_take(&data->job_sem, RT_WAITING_FOREVER);
+        _disk_job(data);
+        rt_sem_release(&data->done_sem);
+    }
+}
+#endif
+
+/**
+ * This function will start a disk access. It's done by the msc thread with
+ * double buffers, or it's deferred to _disk_wait() without the thread.
+ */
+static void _disk_submit(struct mstorage *data, rt_bool_t write,
+    rt_uint8_t *buffer, rt_uint32_t block, rt_size_t count)
+{
+    RT_ASSERT(data->job.pending == RT_FALSE);
+
+    data->job.write = write;
+    data->job.buffer = buffer;
+    data->job.block = block;
+    data->job.count = count;
+    data->job.result = 0;
+    data->job.pending = RT_TRUE;
+#ifdef RT_USB_MSTORAGE_DOUBLE_BUFFER
+    if(data->thread != RT_NULL)
+    {
+        rt_sem_release(&data->job_sem);
+    }
+#endif
+}
+
+/**
+ * This function will wait for the submitted disk access.
+ *
+ * @return RT_EOK if no disk access or all sectors are done, -RT_EIO on failure.
+ */
+static rt_err_t _disk_wait(struct mstorage *data)
+{
+    if(data->job.pending == RT_FALSE)
+    {
+        return RT_EOK;
+    }
+
+#ifdef RT_USB_MSTORAGE_DOUBLE_BUFFER
+    if(data->thread != RT_NULL)
+    {
+        rt_sem_take(&data->done_sem, RT_WAITING_FOREVER);
+    }
+    else
+    {
+        _disk_job(data);
+    }
+#else
+    _disk_job(data);
+#endif
+    data->job.pending = RT_FALSE;
+
+    if(data->job.result != data->job.count)
+    {
+        rt_kprintf("disk %s error, block 0x%x count %d\n",
+            data->job.write ? "write" : "read", data->job.block, data->job.count);
+        return -RT_EIO;
+    }
+
+    return RT_EOK;
+}
+
+/* sectors of the next transfer, limited by the buffer and the data expected by host */
+static rt_uint32_t _chunk_sectors(struct mstorage *data, rt_uint32_t count, rt_uint32_t reside)
+{
+    rt_uint32_t sectors;
+
+    sectors = MIN(count, MSTORAGE_BUFFER_SECTORS);
+    return MIN(sectors, reside / data->geometry.bytes_per_sector);
+}
+
 static void _send_status(ufunction_t func)
 {
     struct mstorage *data;
@@ -205,6 +340,25 @@ static void _send_status(ufunction_t func)
     data->status = STAT_CSW;
 }
 
+/**
+ * The data of IN is failed, the ep_in is stalled and the failed CSW is held
+ * in the request list of ep_in, it's sent after the host clears the halt.
+ *
+ * @param func the usb function object.
+ */
+static void _send_in_failed(ufunction_t func)
+{
+    struct mstorage *data;
+
+    data = (struct mstorage*)func->user_data;
+    data->csw_response.status = 1;
+    if(rt_usbd_ep_set_stall(func->device, data->ep_in) != RT_EOK)
+    {
+        rt_kprintf("ep_in stall error\n");
+    }
+    _send_status(func);
+}
+
 static rt_size_t _test_unit_ready(ufunction_t func, ustorage_cbw_t cbw)
 {
     struct mstorage *data;
@@ -444,6 +598,54 @@ static rt_size_t _read_capacity(ufunction_t func, ustorage_cbw_t cbw)
     return data->cb_data_size;
 }
 
+/**
+ * This function will send the sectors in current buffer, then the next
+ * sectors are read to the other buffer.
+ *
+ * @param func the usb function object.
+ */
+static void _read_send(ufunction_t func)
+{
+    struct mstorage *data;
+    rt_uint32_t count, reside;
+
+    data = (struct mstorage*)func->user_data;
+
+    data->ep_in->request.buffer = data->buffer[data->current];
+    data->ep_in->request.size = data->chunk * data->geometry.bytes_per_sector;
+    data->ep_in->request.req_type = UIO_REQUEST_WRITE;
+    rt_usbd_io_request(func->device, data->ep_in, &data->ep_in->request);
+    data->status = STAT_SEND;
+
+    /* read ahead */
+    count = data->count - data->chunk;
+    reside = data->csw_response.data_reside - data->ep_in->request.size;
+    count = _chunk_sectors(data, count, reside);
+    if(count > 0)
+    {
+        _disk_submit(data, RT_FALSE, data->buffer[data->current ^ 1],
+            data->block + data->chunk, count);
+    }
+}
+
+/**
+ * This function will receive the sectors to current buffer.
+ *
+ * @param func the usb function object.
+ */
+static void _write_receive(ufunction_t func)
+{
+    struct mstorage *data;
+
+    data = (struct mstorage*)func->user_data;
+
+    data->ep_out->request.buffer = data->buffer[data->current];
+    data->ep_out->request.size = data->chunk * data->geometry.bytes_per_sector;
+    data->ep_out->request.req_type = UIO_REQUEST_READ_FULL;
+    rt_usbd_io_request(func->device, data->ep_out, &data->ep_out->request);
+    data->status = STAT_RECEIVE;
+}
+
 /**
  * This function will handle read_10 request.
  *
@@ -455,7 +657,6 @@ static rt_size_t _read_capacity(ufunction_t func, ustorage_cbw_t cbw)
 static rt_size_t _read_10(ufunction_t func, ustorage_cbw_t cbw)
 {
     struct mstorage *data;
-    rt_size_t size;
     
     RT_ASSERT(func != RT_NULL);
     RT_ASSERT(func->device != RT_NULL);    
@@ -469,19 +670,30 @@ static rt_size_t _read_10(ufunction_t func, ustorage_cbw_t cbw)
     RT_ASSERT(data->count < data->geometry.sector_count);
 
     data->csw_response.data_reside = data->cb_data_size;    
-    size = rt_device_read(data->disk, data->block, data->ep_in->buffer, 1);
-    if(size == 0)
+
+    /* the failure of write behind is reported by this command */
+    if(_disk_wait(data) != RT_EOK)
     {
-        rt_kprintf("read data error\n");
+        data->csw_response.status = 1;
     }
 
-    data->ep_in->request.buffer = data->ep_in->buffer;
-    data->ep_in->request.size = data->geometry.bytes_per_sector;    
-    data->ep_in->request.req_type = UIO_REQUEST_WRITE;    
-    rt_usbd_io_request(func->device, data->ep_in, &data->ep_in->request);
-    data->status = STAT_SEND;
+    data->current = 0;
+    data->chunk = _chunk_sectors(data, data->count, data->csw_response.data_reside);
+    if(data->chunk == 0)
+    {
+        return 0;
+    }
+
+    _disk_submit(data, RT_FALSE, data->buffer[data->current], data->block, data->chunk);
+    if(_disk_wait(data) != RT_EOK)
+    {
+        _send_in_failed(func);
+        return 0;
+    }
+
+    _read_send(func);
     
-    return data->geometry.bytes_per_sector;
+    return data->chunk * data->geometry.bytes_per_sector;
 }
 
 /**
@@ -512,14 +724,23 @@ static rt_size_t _write_10(ufunction_t func, ustorage_cbw_t cbw)
                                 data->count, data->block, data->geometry.sector_count));
 
     data->csw_response.data_reside = data->cb_data_size;
+
+    /* the failure of write behind is reported by this command */
+    if(_disk_wait(data) != RT_EOK)
+    {
+        data->csw_response.status = 1;
+    }
+
+    data->current = 0;
+    data->chunk = _chunk_sectors(data, data->count, data->csw_response.data_reside);
+    if(data->chunk == 0)
+    {
+        return 0;
+    }
+
+    _write_receive(func);
     
-    data->ep_out->request.buffer = data->ep_out->buffer;
-    data->ep_out->request.size = data->geometry.bytes_per_sector;    
-    data->ep_out->request.req_type = UIO_REQUEST_READ_FULL;
-    rt_usbd_io_request(func->device, data->ep_out, &data->ep_out->request);
-    data->status = STAT_RECEIVE;
-    
-    return data->geometry.bytes_per_sector;
+    return data->chunk * data->geometry.bytes_per_sector;
 }
 
 /**
@@ -616,21 +837,20 @@ static rt_err_t _ep_in_handler(ufunction_t func, rt_size_t size)
         break;
      case STAT_SEND:        
         data->csw_response.data_reside -= data->ep_in->request.size;
-        data->count--;    
-        data->block++;        
-        if(data->count > 0 && data->csw_response.data_reside > 0)
+        data->count -= data->chunk;
+        data->block += data->chunk;
+        data->chunk = _chunk_sectors(data, data->count, data->csw_response.data_reside);
+        if(data->chunk > 0)
         {
-            if(rt_device_read(data->disk, data->block, data->ep_in->buffer, 1) == 0)
+            /* the sectors have been read ahead to the other buffer */
+            if(_disk_wait(data) != RT_EOK)
             {
-                rt_kprintf("disk read error\n");
-                rt_usbd_ep_set_stall(func->device, data->ep_in);
+                _send_in_failed(func);
                 return -RT_ERROR;                
             }
 
-            data->ep_in->request.buffer = data->ep_in->buffer;
-            data->ep_in->request.size = data->geometry.bytes_per_sector;    
-            data->ep_in->request.req_type = UIO_REQUEST_WRITE;    
-            rt_usbd_io_request(func->device, data->ep_in, &data->ep_in->request);            
+            data->current ^= 1;
+            _read_send(func);
         }
         else
         {
@@ -837,7 +1057,8 @@ static rt_err_t _ep_out_handler(ufunction_t func, rt_size_t size)
         }
         
         len = _cbw_handler(func, cmd, cbw);
-        if(len == 0)
+        /* the failed CSW may be held by the stalled ep_in already */
+        if(len == 0 && data->status != STAT_CSW)
         {
             _send_status(func);
         }      
@@ -852,18 +1073,36 @@ static rt_err_t _ep_out_handler(ufunction_t func, rt_size_t size)
         data->size -= size;
         data->csw_response.data_reside -= size;
 
-        rt_device_write(data->disk, data->block, data->ep_out->buffer, 1);
+        /* the previous sectors have been written while receiving these */
+        if(_disk_wait(data) != RT_EOK)
+        {
+            data->csw_response.status = 1;
+        }
+        _disk_submit(data, RT_TRUE, data->buffer[data->current], data->block, data->chunk);
+#ifndef RT_USB_MSTORAGE_DOUBLE_BUFFER
+        /* the only buffer is written before receiving the next sectors */
+        if(_disk_wait(data) != RT_EOK)
+        {
+            data->csw_response.status = 1;
+        }
+#endif
 
-        if(data->csw_response.data_reside != 0)
+        data->count -= data->chunk;
+        data->block += data->chunk;
+        data->current ^= 1;
+        data->chunk = _chunk_sectors(data, data->count, data->csw_response.data_reside);
+        if(data->chunk > 0)
         {
-            data->ep_out->request.buffer = data->ep_out->buffer;
-            data->ep_out->request.size = data->geometry.bytes_per_sector;    
-            data->ep_out->request.req_type = UIO_REQUEST_READ_FULL;    
-            rt_usbd_io_request(func->device, data->ep_out, &data->ep_out->request);
-            data->block ++;                        
+            _write_receive(func);
         }
         else
         {
+#ifndef RT_USB_MSTORAGE_WRITE_BEHIND
+            if(_disk_wait(data) != RT_EOK)
+            {
+                data->csw_response.status = 1;
+            }
+#endif
             _send_status(func);
         }
 
@@ -990,6 +1229,19 @@ static rt_err_t _function_enable(ufunction_t func)
         rt_kprintf("no memory\n");
         return -RT_ENOMEM;
     }    
+
+    data->buffer[0] = (rt_uint8_t*)rt_malloc(MSTORAGE_BUFFER_SECTORS * data->geometry.bytes_per_sector);
+#ifdef RT_USB_MSTORAGE_DOUBLE_BUFFER
+    data->buffer[1] = (rt_uint8_t*)rt_malloc(MSTORAGE_BUFFER_SECTORS * data->geometry.bytes_per_sector);
+#else
+    data->buffer[1] = data->buffer[0];
+#endif
+    if(data->buffer[0] == RT_NULL || data->buffer[1] == RT_NULL)
+    {
+        _function_disable(func);
+        rt_kprintf("no memory\n");
+        return -RT_ENOMEM;
+    }
  
     /* prepare to read CBW request */
     data->ep_out->request.buffer = data->ep_out->buffer;
@@ -1015,6 +1267,21 @@ static rt_err_t _function_disable(ufunction_t func)
     RT_DEBUG_LOG(RT_DEBUG_USB, ("Mass storage function disabled\n"));
 
     data = (struct mstorage*)func->user_data;   
+
+    /* the disk access in progress is finished before freeing its buffer */
+    _disk_wait(data);
+
+    if(data->buffer[1] != RT_NULL && data->buffer[1] != data->buffer[0])
+    {
+        rt_free(data->buffer[1]);
+    }
+    data->buffer[1] = RT_NULL;
+    if(data->buffer[0] != RT_NULL)
+    {
+        rt_free(data->buffer[0]);
+        data->buffer[0] = RT_NULL;
+    }
+
     if(data->ep_in->buffer != RT_NULL)
     {
         rt_free(data->ep_in->buffer);
@@ -1110,6 +1377,23 @@ ufunction_t rt_usbd_function_mstorage_create(udevice_t device)
     /* add the interface to the mass storage function */
     rt_usbd_function_add_interface(func, intf);
 
+#ifdef RT_USB_MSTORAGE_DOUBLE_BUFFER
+    rt_sem_init(&data->job_sem, "msc_job", 0, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&data->done_sem, "msc_done", 0, RT_IPC_FLAG_FIFO);
+
+    /* create msc disk thread, every function has its own one */
+    data->thread = rt_thread_create("msc", _disk_thread_entry, data,
+                                    MSTORAGE_TASK_STK_SIZE, RT_USBD_THREAD_PRIO, 20);
+    if(data->thread != RT_NULL)
+    {
+        rt_thread_startup(data->thread);
+    }
+    else
+    {
+        rt_kprintf("msc thread create error\n");
+    }
+#endif
+
     return func;
 }
 struct udclass msc_class = 
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2010-03-22     Bernard      first version
+ * 2019-09-09     RT-Thread    add system call lookup by the sorted index
  */
 #ifndef FINSH_API_H__
 #define FINSH_API_H__
@@ -30,6 +31,12 @@ extern struct finsh_syscall *_syscall_table_begin, *_syscall_table_end;
 
 /* find out system call, which should be implemented in user program */
 struct finsh_syscall* finsh_syscall_lookup(const char* name);
+/* find out system call by the name of prefix + name[0..size) */
+struct finsh_syscall *finsh_syscall_find(const char *prefix, const char *name, rt_size_t size);
+#ifdef FINSH_USING_SYMTAB_INDEX
+int finsh_syscall_index_match(const char *prefix, const char *name, rt_size_t size,
+                              struct finsh_syscall ***first);
+#endif
 
 #ifdef FINSH_USING_SYMTAB
 
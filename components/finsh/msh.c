@@ -8,6 +8,7 @@
  * 2013-03-30     Bernard      the first verion for finsh
  * 2014-01-03     Bernard      msh can execute module.
  * 2017-07-19     Aubr.Cool    limit argc to RT_FINSH_ARG_MAX
+ * 2019-09-09     RT-Thread    look up command by the sorted index
  */
 #include <rtthread.h>
 
@@ -162,23 +163,12 @@ static int msh_split(char *cmd, rt_size_t length, char *argv[FINSH_ARG_MAX])
 static cmd_function_t msh_get_cmd(char *cmd, int size)
 {
     struct finsh_syscall *index;
-    cmd_function_t cmd_func = RT_NULL;
 
-    for (index = _syscall_table_begin;
-            index < _syscall_table_end;
-            FINSH_NEXT_SYSCALL(index))
-    {
-        if (strncmp(index->name, "__cmd_", 6) != 0) continue;
+    index = finsh_syscall_find("__cmd_", cmd, size);
+    if (index == RT_NULL)
+        return RT_NULL;
 
-        if (strncmp(&index->name[6], cmd, size) == 0 &&
-                index->name[6 + size] == '\0')
-        {
-            cmd_func = (cmd_function_t)index->func;
-            break;
-        }
-    }
-
-    return cmd_func;
+    return (cmd_function_t)index->func;
 }
 
 #if defined(RT_USING_MODULE) && defined(RT_USING_DFS)
@@ -533,10 +523,29 @@ void msh_auto_complete_path(char *path)
 }
 #endif
 
+static void msh_auto_complete_cmd(const char *cmd_name, const char **name_ptr, int *min_length)
+{
+    int length;
+
+    if (*min_length == 0)
+    {
+        /* set name_ptr */
+        *name_ptr = cmd_name;
+        /* set initial length */
+        *min_length = strlen(cmd_name);
+    }
+
+    length = str_common(*name_ptr, cmd_name);
+    if (length < *min_length)
+        *min_length = length;
+
+    rt_kprintf("%s\n", cmd_name);
+}
+
 void msh_auto_complete(char *prefix)
 {
-    int length, min_length;
-    const char *name_ptr, *cmd_name;
+    int min_length;
+    const char *name_ptr;
     struct finsh_syscall *index;
 
     min_length = 0;
@@ -578,27 +587,26 @@ void msh_auto_complete(char *prefix)
 
     /* checks in internal command */
     {
+#ifdef FINSH_USING_SYMTAB_INDEX
+        struct finsh_syscall **first;
+        int count, i;
+
+        /* the matched commands are adjacent in the index */
+        count = finsh_syscall_index_match("__cmd_", prefix, strlen(prefix), &first);
+        for (i = 0; i < count; i++)
+        {
+            msh_auto_complete_cmd(&first[i]->name[6], &name_ptr, &min_length);
+        }
+        if (count < 0)
+#endif
         for (index = _syscall_table_begin; index < _syscall_table_end; FINSH_NEXT_SYSCALL(index))
         {
             /* skip finsh shell function */
             if (strncmp(index->name, "__cmd_", 6) != 0) continue;
 
-            cmd_name = (const char *) &index->name[6];
-            if (strncmp(prefix, cmd_name, strlen(prefix)) == 0)
+            if (strncmp(prefix, &index->name[6], strlen(prefix)) == 0)
             {
-                if (min_length == 0)
-                {
-                    /* set name_ptr */
-                    name_ptr = cmd_name;
-                    /* set initial length */
-                    min_length = strlen(name_ptr);
-                }
-
-                length = str_common(name_ptr, cmd_name);
-                if (length < min_length)
-                    min_length = length;
-
-                rt_kprintf("%s\n", cmd_name);
+                msh_auto_complete_cmd(&index->name[6], &name_ptr, &min_length);
             }
         }
     }
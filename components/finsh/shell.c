@@ -16,6 +16,7 @@
  *                             initialization when use GNU GCC compiler.
  * 2016-11-26     armink       add password authentication
  * 2018-07-02     aozima       add custome prompt support.
+ * 2019-09-09     RT-Thread    add sorted index of system call table.
  */
 
 #include <rthw.h>
@@ -747,10 +748,197 @@ void finsh_thread_entry(void *parameter)
     } /* end of device read */
 }
 
+#ifdef FINSH_USING_SYMTAB_INDEX
+/* the system calls sorted by name */
+static struct finsh_syscall **_syscall_index = RT_NULL;
+static int _syscall_index_size = 0;
+
+/* compare the name with prefix + key[0..size), the longer one is greater */
+static int syscall_name_cmp(const char *name, const char *prefix, const char *key, rt_size_t size)
+{
+    for (; *prefix; name++, prefix++)
+    {
+        if (*name != *prefix)
+            return (unsigned char)*name - (unsigned char)*prefix;
+    }
+
+    for (; size; name++, key++, size--)
+    {
+        if (*name != *key)
+            return (unsigned char)*name - (unsigned char)*key;
+    }
+
+    return (unsigned char)*name;
+}
+
+/* the name begins with prefix + key[0..size) */
+static rt_bool_t syscall_name_match(const char *name, const char *prefix, const char *key, rt_size_t size)
+{
+    for (; *prefix; name++, prefix++)
+    {
+        if (*name != *prefix)
+            return RT_FALSE;
+    }
+
+    return rt_strncmp(name, key, size) == 0;
+}
+
+/* the order of index, the same names keep their order in table, so the lookup
+ * finds the same one as the linear search of table */
+static int syscall_index_cmp(struct finsh_syscall *call1, struct finsh_syscall *call2)
+{
+    int result = syscall_name_cmp(call1->name, "", call2->name, rt_strlen(call2->name));
+
+    if (result == 0)
+        result = (call1 < call2) ? -1 : (call1 > call2);
+
+    return result;
+}
+
+static void finsh_syscall_index_build(void)
+{
+    struct finsh_syscall *index, *call;
+    int count = 0, gap, i, j;
+
+    if (_syscall_index)
+    {
+        rt_free(_syscall_index);
+        _syscall_index = RT_NULL;
+        _syscall_index_size = 0;
+    }
+
+    for (index = _syscall_table_begin; index < _syscall_table_end; FINSH_NEXT_SYSCALL(index))
+        count ++;
+
+    if (count == 0)
+        return;
+
+    _syscall_index = (struct finsh_syscall **) rt_malloc(count * sizeof(struct finsh_syscall *));
+    if (_syscall_index == RT_NULL)
+    {
+        /* look up in the table */
+        return;
+    }
+
+    i = 0;
+    for (index = _syscall_table_begin; index < _syscall_table_end; FINSH_NEXT_SYSCALL(index))
+        _syscall_index[i++] = index;
+
+    /* shell sort */
+    for (gap = count / 2; gap > 0; gap /= 2)
+    {
+        for (i = gap; i < count; i++)
+        {
+            call = _syscall_index[i];
+            for (j = i; j >= gap && syscall_index_cmp(_syscall_index[j - gap], call) > 0; j -= gap)
+            {
+                _syscall_index[j] = _syscall_index[j - gap];
+            }
+            _syscall_index[j] = call;
+        }
+    }
+
+    _syscall_index_size = count;
+}
+
+/* the first one in index which is not less than prefix + key[0..size) */
+static int finsh_syscall_index_lower(const char *prefix, const char *key, rt_size_t size)
+{
+    int low = 0, high = _syscall_index_size, mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (syscall_name_cmp(_syscall_index[mid]->name, prefix, key, size) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+/**
+ * This function will find out the system calls which names begin with
+ * prefix + name[0..size) in the sorted index.
+ *
+ * @param prefix the prefix of name, such as "__cmd_"
+ * @param name the name
+ * @param size the length of name
+ * @param first the first matched system call in index
+ *
+ * @return the number of matched system calls, -1 on the index is not available.
+ */
+int finsh_syscall_index_match(const char *prefix, const char *name, rt_size_t size,
+                              struct finsh_syscall ***first)
+{
+    int low, high;
+
+    if (_syscall_index == RT_NULL)
+        return -1;
+
+    low = finsh_syscall_index_lower(prefix, name, size);
+    for (high = low; high < _syscall_index_size; high++)
+    {
+        if (!syscall_name_match(_syscall_index[high]->name, prefix, name, size))
+            break;
+    }
+
+    *first = &_syscall_index[low];
+    return high - low;
+}
+#endif /* FINSH_USING_SYMTAB_INDEX */
+
+/**
+ * This function will find out the system call which name is prefix + name[0..size).
+ *
+ * @param prefix the prefix of name, such as "__cmd_"
+ * @param name the name
+ * @param size the length of name
+ *
+ * @return the system call, RT_NULL on not found.
+ */
+struct finsh_syscall *finsh_syscall_find(const char *prefix, const char *name, rt_size_t size)
+{
+    struct finsh_syscall *index;
+    rt_size_t prefix_len = rt_strlen(prefix);
+
+#ifdef FINSH_USING_SYMTAB_INDEX
+    if (_syscall_index)
+    {
+        int low = finsh_syscall_index_lower(prefix, name, size);
+
+        if (low < _syscall_index_size &&
+                syscall_name_cmp(_syscall_index[low]->name, prefix, name, size) == 0)
+        {
+            return _syscall_index[low];
+        }
+
+        return RT_NULL;
+    }
+#endif
+
+    for (index = _syscall_table_begin; index < _syscall_table_end; FINSH_NEXT_SYSCALL(index))
+    {
+        if (rt_strncmp(index->name, prefix, prefix_len) == 0 &&
+                rt_strncmp(&index->name[prefix_len], name, size) == 0 &&
+                index->name[prefix_len + size] == '\0')
+        {
+            return index;
+        }
+    }
+
+    return RT_NULL;
+}
+
 void finsh_system_function_init(const void *begin, const void *end)
 {
     _syscall_table_begin = (struct finsh_syscall *) begin;
     _syscall_table_end = (struct finsh_syscall *) end;
+
+#ifdef FINSH_USING_SYMTAB_INDEX
+    finsh_syscall_index_build();
+#endif
 }
 
 void finsh_system_var_init(const void *begin, const void *end)
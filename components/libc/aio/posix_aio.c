@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2017/12/30     Bernard      The first version.
+ * 2019/08/08     RT-Thread    Use a worker pool engine, add lio_listio and aio_suspend.
  */
 
 #include <stdint.h>
@@ -19,7 +20,424 @@
 
 #include "posix_aio.h"
 
-struct rt_workqueue* aio_queue = NULL;
+#ifndef AIO_WORKER_NUM
+#define AIO_WORKER_NUM              2
+#endif
+
+#ifndef AIO_WORKER_STACK_SIZE
+#define AIO_WORKER_STACK_SIZE       2048
+#endif
+
+#ifndef AIO_WORKER_PRIORITY
+#define AIO_WORKER_PRIORITY         (RT_THREAD_PRIORITY_MAX / 2)
+#endif
+
+/* the maximal bytes of adjacent requests merged into one transfer */
+#ifndef AIO_MERGE_SIZE_MAX
+#define AIO_MERGE_SIZE_MAX          4096
+#endif
+
+#define AIO_MERGE_NUM_MAX           8
+
+/* internal opcode of aio_fsync() */
+#define AIO_OP_FSYNC                (LIO_NOP + 1)
+
+/* a group of requests submitted by lio_listio() */
+struct aio_lio
+{
+    int pending;                    /* requests not completed yet */
+    int mode;
+    struct sigevent sig;
+    rt_thread_t thread;
+    struct rt_completion done;
+};
+
+/* a thread blocked in aio_suspend() */
+struct aio_waiter
+{
+    rt_list_t node;
+    struct rt_completion done;
+};
+
+struct aio_engine
+{
+    struct rt_mutex lock;
+    struct rt_semaphore kick;
+
+    rt_list_t queue;                /* pending requests in submit order */
+    rt_list_t waiters;              /* threads in aio_suspend() */
+    int idle;                       /* idle workers waiting for a kick */
+
+    int busy_fd[AIO_WORKER_NUM];    /* the file each worker is working on */
+    rt_thread_t workers[AIO_WORKER_NUM];
+};
+
+static struct aio_engine _aio;
+
+static void aio_notify(const struct sigevent *sig, rt_thread_t thread)
+{
+    if (sig->sigev_notify == SIGEV_THREAD)
+    {
+        /* run the callback in the worker thread */
+        if (sig->sigev_notify_function)
+            sig->sigev_notify_function(sig->sigev_value);
+    }
+#ifdef RT_USING_SIGNALS
+    else if (sig->sigev_notify == SIGEV_SIGNAL)
+    {
+        if (thread)
+            rt_thread_kill(thread, sig->sigev_signo);
+    }
+#endif
+}
+
+static void aio_lio_put(struct aio_lio *lio)
+{
+    int pending;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    pending = -- lio->pending;
+    rt_hw_interrupt_enable(level);
+
+    if (pending)
+        return;
+
+    if (lio->mode == LIO_WAIT)
+    {
+        /* the lio is on the stack of the waiting thread */
+        rt_completion_done(&lio->done);
+    }
+    else
+    {
+        aio_notify(&lio->sig, lio->thread);
+        rt_free(lio);
+    }
+}
+
+static void aio_complete(struct aiocb *cb, int result)
+{
+    rt_base_t level;
+    struct aio_lio *lio;
+
+    lio = cb->aio_lio;
+
+    level = rt_hw_interrupt_disable();
+    cb->aio_result = result;
+    rt_hw_interrupt_enable(level);
+
+    aio_notify(&cb->aio_sigevent, cb->aio_thread);
+    if (lio)
+        aio_lio_put(lio);
+}
+
+/* wake up all threads in aio_suspend(), they check their lists again */
+static void aio_wakeup_waiters(void)
+{
+    struct rt_list_node *node;
+    struct aio_waiter *waiter;
+
+    rt_mutex_take(&_aio.lock, RT_WAITING_FOREVER);
+    for (node = _aio.waiters.next; node != &_aio.waiters; node = node->next)
+    {
+        waiter = rt_list_entry(node, struct aio_waiter, node);
+        rt_completion_done(&waiter->done);
+    }
+    rt_mutex_release(&_aio.lock);
+}
+
+/* must be called with the engine lock held */
+static void aio_kick(int count)
+{
+    while (count-- > 0 && _aio.idle > 0)
+    {
+        _aio.idle --;
+        rt_sem_release(&_aio.kick);
+    }
+}
+
+static rt_bool_t aio_fd_is_busy(int fd)
+{
+    int index;
+
+    for (index = 0; index < AIO_WORKER_NUM; index ++)
+    {
+        if (_aio.busy_fd[index] == fd)
+            return RT_TRUE;
+    }
+
+    return RT_FALSE;
+}
+
+static rt_bool_t aio_can_merge(struct aiocb *cb, struct aiocb *next, size_t total)
+{
+    return next->aio_fildes == cb->aio_fildes &&
+           next->aio_lio_opcode == cb->aio_lio_opcode &&
+           next->aio_offset == cb->aio_offset + (off_t)total &&
+           total + next->aio_nbytes <= AIO_MERGE_SIZE_MAX;
+}
+
+/*
+ * take the oldest request on a file no other worker is working on, together
+ * with the requests directly following it on the same file which continue it
+ * in the file. The per-file ordering is kept as a file is only served by one
+ * worker at a time. Must be called with the engine lock held.
+ */
+static int aio_pick(struct aiocb **batch)
+{
+    int num = 0;
+    size_t total = 0;
+    struct rt_list_node *node, *next;
+    struct aiocb *cb, *first = RT_NULL;
+
+    for (node = _aio.queue.next; node != &_aio.queue; node = next)
+    {
+        next = node->next;
+        cb = rt_list_entry(node, struct aiocb, aio_node);
+
+        if (first == RT_NULL)
+        {
+            if (aio_fd_is_busy(cb->aio_fildes))
+                continue;
+
+            first = cb;
+        }
+        else if (cb->aio_fildes != first->aio_fildes)
+        {
+            continue;
+        }
+        else if ((first->aio_lio_opcode != LIO_READ && first->aio_lio_opcode != LIO_WRITE) ||
+                 num >= AIO_MERGE_NUM_MAX || !aio_can_merge(first, cb, total))
+        {
+            /* the next request on this file breaks the run */
+            break;
+        }
+
+        rt_list_remove(&cb->aio_node);
+        batch[num ++] = cb;
+        total += cb->aio_nbytes;
+    }
+
+    return num;
+}
+
+static int aio_do_fsync(struct aiocb *cb)
+{
+    if (fsync(cb->aio_fildes) < 0)
+        return rt_get_errno();
+
+    return 0;
+}
+
+static int aio_do_read(struct aiocb *cb)
+{
+    int len;
+
+    len = pread(cb->aio_fildes, (void *)cb->aio_buf, cb->aio_nbytes, cb->aio_offset);
+    if (len < 0)
+        return rt_get_errno();
+
+    return len;
+}
+
+static int aio_do_write(struct aiocb *cb)
+{
+    int len, oflags;
+
+    oflags = fcntl(cb->aio_fildes, F_GETFL, 0);
+    if (oflags & O_APPEND)
+        len = write(cb->aio_fildes, (const void *)cb->aio_buf, cb->aio_nbytes);
+    else
+        len = pwrite(cb->aio_fildes, (const void *)cb->aio_buf, cb->aio_nbytes, cb->aio_offset);
+
+    if (len < 0)
+        return rt_get_errno();
+
+    return len;
+}
+
+/* serve adjacent requests with one transfer through a bounce buffer */
+static rt_bool_t aio_do_merged(struct aiocb **batch, int num)
+{
+    int index, len;
+    size_t total = 0, offset = 0, size;
+    uint8_t *buf;
+    struct aiocb *cb = batch[0];
+
+    /* appending writes don't go to aio_offset */
+    if (cb->aio_lio_opcode == LIO_WRITE && (fcntl(cb->aio_fildes, F_GETFL, 0) & O_APPEND))
+        return RT_FALSE;
+
+    for (index = 0; index < num; index ++)
+        total += batch[index]->aio_nbytes;
+
+    buf = (uint8_t *)rt_malloc(total);
+    if (buf == RT_NULL)
+        return RT_FALSE;
+
+    if (cb->aio_lio_opcode == LIO_WRITE)
+    {
+        for (index = 0; index < num; index ++)
+        {
+            rt_memcpy(buf + offset, (const void *)batch[index]->aio_buf, batch[index]->aio_nbytes);
+            offset += batch[index]->aio_nbytes;
+        }
+
+        len = pwrite(cb->aio_fildes, buf, total, cb->aio_offset);
+    }
+    else
+    {
+        len = pread(cb->aio_fildes, buf, total, cb->aio_offset);
+    }
+
+    if (len < 0)
+    {
+        len = rt_get_errno();
+        rt_free(buf);
+
+        for (index = 0; index < num; index ++)
+            aio_complete(batch[index], len);
+
+        return RT_TRUE;
+    }
+
+    /* split the result over the requests */
+    offset = 0;
+    for (index = 0; index < num; index ++)
+    {
+        size = batch[index]->aio_nbytes;
+        if (size > (size_t)len - offset)
+            size = (size_t)len - offset;
+
+        if (cb->aio_lio_opcode == LIO_READ && size)
+            rt_memcpy((void *)batch[index]->aio_buf, buf + offset, size);
+
+        offset += size;
+        aio_complete(batch[index], (int)size);
+    }
+    rt_free(buf);
+
+    return RT_TRUE;
+}
+
+static void aio_process(struct aiocb **batch, int num)
+{
+    int index;
+    struct aiocb *cb;
+
+    if (num > 1 && aio_do_merged(batch, num))
+        return;
+
+    for (index = 0; index < num; index ++)
+    {
+        cb = batch[index];
+
+        switch (cb->aio_lio_opcode)
+        {
+        case LIO_READ:
+            aio_complete(cb, aio_do_read(cb));
+            break;
+
+        case LIO_WRITE:
+            aio_complete(cb, aio_do_write(cb));
+            break;
+
+        case AIO_OP_FSYNC:
+            aio_complete(cb, aio_do_fsync(cb));
+            break;
+
+        default:
+            aio_complete(cb, 0);
+            break;
+        }
+    }
+}
+
+static void aio_worker_entry(void *parameter)
+{
+    int num;
+    int id = (int)(rt_ubase_t)parameter;
+    struct aiocb *batch[AIO_MERGE_NUM_MAX];
+
+    while (1)
+    {
+        rt_mutex_take(&_aio.lock, RT_WAITING_FOREVER);
+        num = aio_pick(batch);
+        if (num == 0)
+        {
+            _aio.idle ++;
+            rt_mutex_release(&_aio.lock);
+
+            rt_sem_take(&_aio.kick, RT_WAITING_FOREVER);
+            continue;
+        }
+        _aio.busy_fd[id] = batch[0]->aio_fildes;
+        rt_mutex_release(&_aio.lock);
+
+        aio_process(batch, num);
+
+        rt_mutex_take(&_aio.lock, RT_WAITING_FOREVER);
+        _aio.busy_fd[id] = -1;
+        /* requests on this file may be waiting for us */
+        if (!rt_list_isempty(&_aio.queue))
+            aio_kick(1);
+        rt_mutex_release(&_aio.lock);
+
+        aio_wakeup_waiters();
+    }
+}
+
+static void aio_prepare(struct aiocb *cb, int opcode, struct aio_lio *lio)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    cb->aio_result = -EINPROGRESS;
+    rt_hw_interrupt_enable(level);
+
+    cb->aio_lio_opcode = opcode;
+    cb->aio_lio = lio;
+    cb->aio_thread = rt_thread_self();
+    rt_list_init(&cb->aio_node);
+}
+
+/* queue prepared requests in one go, so adjacent ones can be merged */
+static void aio_submit(struct aiocb *const list[], int nent)
+{
+    int index, count = 0;
+
+    rt_mutex_take(&_aio.lock, RT_WAITING_FOREVER);
+    for (index = 0; index < nent; index ++)
+    {
+        if (list[index] && list[index]->aio_lio_opcode != LIO_NOP)
+        {
+            rt_list_insert_before(&_aio.queue, &list[index]->aio_node);
+            count ++;
+        }
+    }
+    aio_kick(count);
+    rt_mutex_release(&_aio.lock);
+}
+
+static int aio_check_access(struct aiocb *cb, int opcode)
+{
+    int oflags;
+
+    if (cb->aio_buf == NULL || cb->aio_offset < 0)
+        return -EINVAL;
+
+    oflags = fcntl(cb->aio_fildes, F_GETFL, 0);
+    if (oflags < 0)
+        return -EBADF;
+
+    if (opcode == LIO_READ && (oflags & O_ACCMODE) == O_WRONLY)
+        return -EBADF;
+
+    if (opcode == LIO_WRITE && (oflags & O_ACCMODE) == O_RDONLY)
+        return -EBADF;
+
+    return 0;
+}
 
 /**
  * The aio_cancel() function shall attempt to cancel one or more asynchronous I/O 
@@ -45,19 +463,53 @@ struct rt_workqueue* aio_queue = NULL;
  */
 int aio_cancel(int fd, struct aiocb *cb)
 {
-    rt_err_t ret;
+    int result = AIO_ALLDONE;
+    rt_list_t canceled;
+    struct rt_list_node *node, *next;
+    struct aiocb *item;
 
-    if (!cb) return -EINVAL;
-    if (cb->aio_fildes != fd) return -EINVAL;
+    if (cb && cb->aio_fildes != fd) return -EINVAL;
+
+    rt_list_init(&canceled);
 
-    ret = rt_workqueue_cancel_work_sync(aio_queue, &(cb->aio_work));
-    if (ret == RT_EOK)
+    rt_mutex_take(&_aio.lock, RT_WAITING_FOREVER);
+    for (node = _aio.queue.next; node != &_aio.queue; node = next)
     {
-        errno = -ECANCELED;
-        return -1;
+        next = node->next;
+        item = rt_list_entry(node, struct aiocb, aio_node);
+
+        if (item->aio_fildes == fd && (cb == RT_NULL || cb == item))
+        {
+            rt_list_remove(&item->aio_node);
+            rt_list_insert_before(&canceled, &item->aio_node);
+        }
     }
 
-    return 0;
+    if (!rt_list_isempty(&canceled))
+        result = AIO_CANCELED;
+
+    /* the requests in progress can't be canceled */
+    if (cb == RT_NULL)
+    {
+        if (aio_fd_is_busy(fd))
+            result = AIO_NOTCANCELED;
+    }
+    else if (result != AIO_CANCELED && cb->aio_result == -EINPROGRESS)
+    {
+        result = AIO_NOTCANCELED;
+    }
+    rt_mutex_release(&_aio.lock);
+
+    while (!rt_list_isempty(&canceled))
+    {
+        item = rt_list_entry(canceled.next, struct aiocb, aio_node);
+        rt_list_remove(&item->aio_node);
+
+        aio_complete(item, -ECANCELED);
+    }
+    aio_wakeup_waiters();
+
+    return result;
 }
 
 /**
@@ -70,7 +522,10 @@ int aio_error (const struct aiocb *cb)
 {
     if (cb)
     {
-        return cb->aio_result;
+        if (cb->aio_result < 0)
+            return cb->aio_result;
+
+        return 0;
     }
 
     return -EINVAL;
@@ -117,65 +572,16 @@ int aio_error (const struct aiocb *cb)
  * If the aio_fsync() function fails or aiocbp indicates an error condition, 
  * data is not guaranteed to have been successfully transferred.
  */
-static void aio_fync_work(struct rt_work* work, void* work_data)
-{
-    int result;
-    rt_ubase_t level;
-    struct aiocb *cb = (struct aiocb*)work_data;
-
-    RT_ASSERT(cb != RT_NULL);
-
-    result = fsync(cb->aio_fildes);
-    /* modify result */
-    level = rt_hw_interrupt_disable();
-    if (result < 0)
-        cb->aio_result = errno;
-    else
-        cb->aio_result = 0;
-    rt_hw_interrupt_enable(level);
-
-    return ;
-}
-
 int aio_fsync(int op, struct aiocb *cb)
 {
-    rt_ubase_t level;
     if (!cb) return -EINVAL;
 
-    level = rt_hw_interrupt_disable();
-    cb->aio_result = -EINPROGRESS;
-    rt_hw_interrupt_enable(level);
-
-    rt_work_init(&(cb->aio_work), aio_fync_work, cb);
-    rt_workqueue_dowork(aio_queue, &(cb->aio_work));
+    aio_prepare(cb, AIO_OP_FSYNC, RT_NULL);
+    aio_submit(&cb, 1);
 
     return 0;
 }
 
-static void aio_read_work(struct rt_work* work, void* work_data)
-{
-    int len;
-    rt_ubase_t level;
-    uint8_t *buf_ptr;
-    struct aiocb *cb = (struct aiocb*)work_data;
-
-    buf_ptr = (uint8_t*)cb->aio_buf;
-
-    /* seek to offset */
-    lseek(cb->aio_fildes, cb->aio_offset, SEEK_SET);
-    len = read(cb->aio_fildes, &buf_ptr[cb->aio_offset], cb->aio_nbytes);
-
-    /* modify result */
-    level = rt_hw_interrupt_disable();
-    if (len <= 0)
-        cb->aio_result = errno;
-    else 
-        cb->aio_result = len;
-    rt_hw_interrupt_enable(level);
-
-    return ;
-}
-
 /**
  * The aio_read() function shall read aiocbp->aio_nbytes from the file associated 
  * with aiocbp->aio_fildes into the buffer pointed to by aiocbp->aio_buf. The 
@@ -225,18 +631,16 @@ static void aio_read_work(struct rt_work* work, void* work_data)
  */
 int aio_read(struct aiocb *cb)
 {
-    rt_ubase_t level;
+    int result;
 
     if (!cb) return -EINVAL;
-    if (cb->aio_offset < 0) return -EINVAL;
 
-    level = rt_hw_interrupt_disable();
-    cb->aio_result = -EINPROGRESS;
-    rt_hw_interrupt_enable(level);
+    result = aio_check_access(cb, LIO_READ);
+    if (result < 0) return result;
 
-    /* en-queue read work */
-    rt_work_init(&(cb->aio_work), aio_read_work, cb);
-    rt_workqueue_dowork(aio_queue, &(cb->aio_work));
+    /* en-queue read request */
+    aio_prepare(cb, LIO_READ, RT_NULL);
+    aio_submit(&cb, 1);
 
     return 0;
 }
@@ -290,36 +694,61 @@ ssize_t  aio_return(struct aiocb *cb)
 int aio_suspend(const struct aiocb *const list[], int nent,
              const struct timespec *timeout)
 {
-    return -ENOSYS;
-}
-
-static void aio_write_work(struct rt_work* work, void* work_data)
-{
-    int len, oflags, level;
-    uint8_t *buf_ptr;
-    struct aiocb *cb = (struct aiocb*)work_data;
+    int index, result = -EAGAIN;
+    rt_int32_t tick = RT_WAITING_FOREVER;
+    rt_tick_t start;
+    struct aio_waiter waiter;
 
-    buf_ptr = (uint8_t*)cb->aio_buf;
+    if (list == RT_NULL || nent <= 0) return -EINVAL;
 
-    /* whether seek offset */
-    oflags = fcntl(cb->aio_fildes, F_GETFL, 0);
-    if ((oflags & O_APPEND) == 0)
+    if (timeout)
     {
-        lseek(cb->aio_fildes, SEEK_SET, cb->aio_offset);
+        tick = timeout->tv_sec * RT_TICK_PER_SECOND +
+               timeout->tv_nsec / (1000000000L / RT_TICK_PER_SECOND);
     }
+    start = rt_tick_get();
 
-    /* write data */
-    len = write(cb->aio_fildes, buf_ptr, cb->aio_nbytes);
+    rt_completion_init(&waiter.done);
+    rt_list_init(&waiter.node);
 
-    /* modify result */
-    level = rt_hw_interrupt_disable();
-    if (len <= 0)
-        cb->aio_result = errno;
-    else 
-        cb->aio_result = len;
-    rt_hw_interrupt_enable(level);
+    rt_mutex_take(&_aio.lock, RT_WAITING_FOREVER);
+    rt_list_insert_before(&_aio.waiters, &waiter.node);
+    rt_mutex_release(&_aio.lock);
+
+    while (1)
+    {
+        /* a completion after this point is not lost */
+        rt_completion_init(&waiter.done);
+
+        for (index = 0; index < nent; index ++)
+        {
+            if (list[index] && list[index]->aio_result != -EINPROGRESS)
+            {
+                result = 0;
+                break;
+            }
+        }
+        if (result == 0) break;
+
+        if (tick != RT_WAITING_FOREVER)
+        {
+            rt_tick_t delta = rt_tick_get() - start;
+
+            if (delta >= (rt_tick_t)tick) break;
+
+            if (rt_completion_wait(&waiter.done, tick - delta) != RT_EOK) break;
+        }
+        else
+        {
+            rt_completion_wait(&waiter.done, RT_WAITING_FOREVER);
+        }
+    }
 
-    return;
+    rt_mutex_take(&_aio.lock, RT_WAITING_FOREVER);
+    rt_list_remove(&waiter.node);
+    rt_mutex_release(&_aio.lock);
+
+    return result;
 }
 
 /**
@@ -363,23 +792,16 @@ static void aio_write_work(struct rt_work* work, void* work_data)
  */
 int aio_write(struct aiocb *cb)
 {
-    int oflags;
-    rt_ubase_t level;
+    int result;
 
-    if (!cb || (cb->aio_buf == NULL)) return -EINVAL;
+    if (!cb) return -EINVAL;
 
     /* check access mode */
-    oflags = fcntl(cb->aio_fildes, F_GETFL, 0);
-    if ((oflags & O_ACCMODE) != O_WRONLY ||
-        (oflags & O_ACCMODE) != O_RDWR)
-        return -EINVAL;
+    result = aio_check_access(cb, LIO_WRITE);
+    if (result < 0) return result;
 
-    level = rt_hw_interrupt_disable();
-    cb->aio_result = -EINPROGRESS;
-    rt_hw_interrupt_enable(level);
-
-    rt_work_init(&(cb->aio_work), aio_write_work, cb);
-    rt_workqueue_dowork(aio_queue, &(cb->aio_work));
+    aio_prepare(cb, LIO_WRITE, RT_NULL);
+    aio_submit(&cb, 1);
 
     return 0;
 }
@@ -452,13 +874,110 @@ int aio_write(struct aiocb *cb)
 int lio_listio(int mode, struct aiocb * const list[], int nent,
             struct sigevent *sig)
 {
-    return -ENOSYS;
+    int index, result;
+    struct aio_lio *lio = RT_NULL, lio_wait;
+
+    if (mode != LIO_WAIT && mode != LIO_NOWAIT) return -EINVAL;
+    if (list == RT_NULL || nent <= 0) return -EINVAL;
+
+    /* reject the whole list before anything is queued */
+    for (index = 0; index < nent; index ++)
+    {
+        if (list[index] == RT_NULL) continue;
+
+        switch (list[index]->aio_lio_opcode)
+        {
+        case LIO_READ:
+        case LIO_WRITE:
+            result = aio_check_access(list[index], list[index]->aio_lio_opcode);
+            if (result < 0) return result;
+            break;
+
+        case LIO_NOP:
+            break;
+
+        default:
+            return -EINVAL;
+        }
+    }
+
+    if (mode == LIO_WAIT)
+    {
+        lio = &lio_wait;
+    }
+    else if (sig && sig->sigev_notify != SIGEV_NONE)
+    {
+        lio = (struct aio_lio *)rt_malloc(sizeof(struct aio_lio));
+        if (lio == RT_NULL) return -EAGAIN;
+
+        lio->sig = *sig;
+    }
+
+    if (lio)
+    {
+        /* hold a reference until all requests are queued */
+        lio->pending = 1;
+        lio->mode = mode;
+        lio->thread = rt_thread_self();
+        rt_completion_init(&lio->done);
+    }
+
+    for (index = 0; index < nent; index ++)
+    {
+        if (list[index] == RT_NULL || list[index]->aio_lio_opcode == LIO_NOP)
+            continue;
+
+        if (lio)
+        {
+            rt_base_t level = rt_hw_interrupt_disable();
+            lio->pending ++;
+            rt_hw_interrupt_enable(level);
+        }
+        aio_prepare(list[index], list[index]->aio_lio_opcode, lio);
+    }
+
+    aio_submit(list, nent);
+
+    if (lio)
+        aio_lio_put(lio);
+
+    if (mode == LIO_NOWAIT)
+        return 0;
+
+    rt_completion_wait(&lio_wait.done, RT_WAITING_FOREVER);
+
+    for (index = 0; index < nent; index ++)
+    {
+        if (list[index] && list[index]->aio_lio_opcode != LIO_NOP &&
+            list[index]->aio_result < 0)
+            return -EIO;
+    }
+
+    return 0;
 }
 
 int aio_system_init(void)
 {
-    aio_queue = rt_workqueue_create("aio", 2048, RT_THREAD_PRIORITY_MAX/2);
-    RT_ASSERT(aio_queue != NULL);
+    int index;
+    char name[RT_NAME_MAX];
+
+    rt_memset(&_aio, 0x00, sizeof(_aio));
+    rt_mutex_init(&_aio.lock, "aio", RT_IPC_FLAG_FIFO);
+    rt_sem_init(&_aio.kick, "aio", 0, RT_IPC_FLAG_FIFO);
+    rt_list_init(&_aio.queue);
+    rt_list_init(&_aio.waiters);
+
+    for (index = 0; index < AIO_WORKER_NUM; index ++)
+    {
+        _aio.busy_fd[index] = -1;
+
+        rt_snprintf(name, sizeof(name), "aio%d", index);
+        _aio.workers[index] = rt_thread_create(name, aio_worker_entry, (void *)(rt_ubase_t)index,
+                AIO_WORKER_STACK_SIZE, AIO_WORKER_PRIORITY, 20);
+        RT_ASSERT(_aio.workers[index] != RT_NULL);
+
+        rt_thread_startup(_aio.workers[index]);
+    }
 
     return 0;
 }
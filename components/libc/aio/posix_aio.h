@@ -6,11 +6,36 @@
  * Change Logs:
  * Date           Author       Notes
  * 2017/12/30     Bernard      The first version.
+ * 2019/08/08     RT-Thread    Add lio_listio and aio_cancel definitions.
  */
 
 #ifndef POSIX_AIO_H__
 #define POSIX_AIO_H__
 
+#include <rtthread.h>
+
+/* aio_cancel() return values */
+#define AIO_CANCELED    0
+#define AIO_NOTCANCELED 1
+#define AIO_ALLDONE     2
+
+/* lio_listio() modes */
+#define LIO_WAIT        0
+#define LIO_NOWAIT      1
+
+/* aio_lio_opcode values */
+#define LIO_READ        0
+#define LIO_WRITE       1
+#define LIO_NOP         2
+
+#ifndef SIGEV_NONE
+#define SIGEV_NONE      1   /* no asynchronous notification */
+#define SIGEV_SIGNAL    2   /* send the signal to the submitting thread */
+#define SIGEV_THREAD    3   /* call the notification function in the AIO worker */
+#endif
+
+struct aio_lio;
+
 struct aiocb
 {
     int aio_fildes;         /* File descriptor. */
@@ -23,7 +48,9 @@ struct aiocb
     int aio_lio_opcode;     /* Operation to be performed. */
 
     int aio_result;
-    struct rt_work aio_work;
+    rt_list_t aio_node;             /* node in the AIO engine queue */
+    struct aio_lio *aio_lio;        /* the lio_listio() group */
+    rt_thread_t aio_thread;         /* the submitting thread */
 };
 
 int aio_cancel(int fd, struct aiocb *cb);
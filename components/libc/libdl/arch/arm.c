@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author      Notes
  * 2018/08/29     Bernard     first version
+ * 2019/09/12     RT-Thread   add PLT resolver for lazy binding
  */
 
 #include "../dlmodule.h"
@@ -118,4 +119,26 @@ int dlmodule_relocate(struct rt_dlmodule *module, Elf32_Rel *rel, Elf32_Addr sym
 
     return 0;
 }
+
+#ifdef DLMODULE_USING_LAZY_BIND
+/*
+ * PLT0 has pushed lr and jumped here with lr = &GOT[2], and the PLT entry
+ * has set ip = &GOT[n + 3]. GOT[1] is the module.
+ */
+__attribute__((naked)) void dlmodule_lazy_resolve(void)
+{
+    __asm volatile (
+        "push   {r0-r4}             \n"    /* r4 keeps the stack aligned to 8 bytes */
+        "ldr    r0, [lr, #-4]       \n"    /* GOT[1] */
+        "sub    r1, ip, lr          \n"
+        "sub    r1, r1, #4          \n"
+        "add    r1, r1, r1          \n"    /* n * sizeof(Elf32_Rel) */
+        "bl     dlmodule_lazy_fixup \n"
+        "mov    ip, r0              \n"
+        "pop    {r0-r4}             \n"
+        "pop    {lr}                \n"
+        "bx     ip                  \n"
+    );
+}
+#endif /* DLMODULE_USING_LAZY_BIND */
 #endif
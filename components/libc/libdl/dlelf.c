@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author      Notes
  * 2018/08/29     Bernard     first version
+ * 2019/09/12     RT-Thread   add symbol hash table and lazy binding
  */
 
 #include "dlmodule.h"
@@ -15,12 +16,101 @@
 #define DBG_LVL    DBG_INFO
 #include <rtdbg.h>          // must after of DEBUG_ENABLE or some other options
 
+#ifdef DLMODULE_USING_LAZY_BIND
+/* set up the GOT of PLT for resolving symbols on the first call */
+static rt_bool_t dlmodule_lazy_bind_init(struct rt_dlmodule *module, void *module_ptr)
+{
+    rt_uint32_t index;
+    Elf32_Dyn *dyn = RT_NULL;
+    Elf32_Addr *got = RT_NULL;
+    rt_uint8_t *base = (rt_uint8_t *)module->mem_space - module->vstart_addr;
+
+    for (index = 0; index < elf_module->e_phnum; index++)
+    {
+        if (phdr[index].p_type == PT_DYNAMIC)
+        {
+            dyn = (Elf32_Dyn *)(base + phdr[index].p_vaddr);
+            break;
+        }
+    }
+    if (dyn == RT_NULL)
+        return RT_FALSE;
+
+    for (; dyn->d_tag != DT_NULL; dyn++)
+    {
+        switch (dyn->d_tag)
+        {
+        case DT_PLTGOT:
+            got = (Elf32_Addr *)(base + dyn->d_un.d_ptr);
+            break;
+        case DT_JMPREL:
+            module->jmprel = base + dyn->d_un.d_ptr;
+            break;
+        case DT_SYMTAB:
+            module->dynsym = base + dyn->d_un.d_ptr;
+            break;
+        case DT_STRTAB:
+            module->dynstr = (const char *)(base + dyn->d_un.d_ptr);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (got == RT_NULL || module->jmprel == RT_NULL ||
+        module->dynsym == RT_NULL || module->dynstr == RT_NULL)
+        return RT_FALSE;
+
+    /* PLT0 jumps to GOT[2] with GOT[1] */
+    got[1] = (Elf32_Addr)module;
+    got[2] = (Elf32_Addr)dlmodule_lazy_resolve;
+
+    return RT_TRUE;
+}
+
+/**
+ * This function will resolve the symbol of a PLT entry on its first call.
+ *
+ * @param module the module
+ * @param rel_offset the offset of relocation in PLT relocations
+ *
+ * @return the address of symbol
+ */
+Elf32_Addr dlmodule_lazy_fixup(struct rt_dlmodule *module, rt_uint32_t rel_offset)
+{
+    Elf32_Rel *rel = (Elf32_Rel *)((rt_uint8_t *)module->jmprel + rel_offset);
+    Elf32_Sym *sym = &((Elf32_Sym *)module->dynsym)[ELF32_R_SYM(rel->r_info)];
+    Elf32_Addr addr;
+
+    addr = dlmodule_symbol_find(module->dynstr + sym->st_name);
+    if (addr == 0)
+    {
+        LOG_E("Module: can't find %s in kernel symbol table", module->dynstr + sym->st_name);
+
+        /* the module can't go on */
+        dlmodule_exit(-RT_ERROR);
+        while (1)
+        {
+            rt_thread_suspend(rt_thread_self());
+            rt_schedule();
+        }
+    }
+
+    dlmodule_relocate(module, rel, addr);
+
+    return addr;
+}
+#endif /* DLMODULE_USING_LAZY_BIND */
+
 rt_err_t dlmodule_load_shared_object(struct rt_dlmodule* module, void *module_ptr)
 {
     rt_bool_t linked   = RT_FALSE;
     rt_uint32_t index, module_size = 0;
     Elf32_Addr vstart_addr, vend_addr;
     rt_bool_t has_vstart;
+#ifdef DLMODULE_USING_LAZY_BIND
+    rt_bool_t lazy;
+#endif
 
     RT_ASSERT(module_ptr != RT_NULL);
 
@@ -116,6 +206,10 @@ rt_err_t dlmodule_load_shared_object(struct rt_dlmodule* module, void *module_pt
     /* set module entry */
     module->entry_addr = module->mem_space + elf_module->e_entry - vstart_addr;
 
+#ifdef DLMODULE_USING_LAZY_BIND
+    lazy = !linked && dlmodule_lazy_bind_init(module, module_ptr);
+#endif
+
     /* handle relocation section */
     for (index = 0; index < elf_module->e_shnum; index ++)
     {
@@ -152,6 +246,16 @@ rt_err_t dlmodule_load_shared_object(struct rt_dlmodule* module, void *module_pt
                 addr = (Elf32_Addr)(module->mem_space + sym->st_value - vstart_addr);
                 dlmodule_relocate(module, rel, addr);
             }
+#ifdef DLMODULE_USING_LAZY_BIND
+            else if (lazy && ELF32_R_TYPE(rel->r_info) == R_ARM_JUMP_SLOT)
+            {
+                /* the GOT entry points to PLT0 until the first call */
+                Elf32_Addr *where = (Elf32_Addr *)((rt_uint8_t *)module->mem_space
+                                                   + rel->r_offset - vstart_addr);
+
+                *where += (Elf32_Addr)module->mem_space - vstart_addr;
+            }
+#endif
             else if (!linked)
             {
                 Elf32_Addr addr;
@@ -226,6 +330,8 @@ rt_err_t dlmodule_load_shared_object(struct rt_dlmodule* module, void *module_pt
                       length);
             count ++;
         }
+
+        module->symhash = dlmodule_symhash_build(module->symtab, module->nsym, &module->nbucket);
     }
 
     return RT_EOK;
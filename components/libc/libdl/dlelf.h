@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author      Notes
  * 2018/08/29     Bernard     first version
+ * 2019/09/12     RT-Thread   add dynamic section for lazy binding
  */
 
 #ifndef DL_ELF_H__
@@ -126,6 +127,25 @@ typedef struct elf32_sym
     Elf32_Half    st_shndx;                    /* section header index */
 } Elf32_Sym;
 
+/* Dynamic Section Entry */
+typedef struct elf32_dyn
+{
+    Elf32_Sword   d_tag;                       /* entry type */
+    union
+    {
+        Elf32_Word d_val;                      /* integer value */
+        Elf32_Addr d_ptr;                      /* address value */
+    } d_un;
+} Elf32_Dyn;
+
+/* d_tag */
+#define DT_NULL                 0              /* end of dynamic section */
+#define DT_PLTRELSZ             2              /* size of PLT relocations */
+#define DT_PLTGOT               3              /* address of PLT GOT */
+#define DT_STRTAB               5              /* address of dynamic string table */
+#define DT_SYMTAB               6              /* address of dynamic symbol table */
+#define DT_JMPREL               23             /* address of PLT relocations */
+
 #define STB_LOCAL               0              /* BIND */
 #define STB_GLOBAL              1
 #define STB_WEAK                2
@@ -282,4 +302,10 @@ rt_err_t dlmodule_load_relocated_object(struct rt_dlmodule* module, void *module
 
 int dlmodule_relocate(struct rt_dlmodule *module, Elf32_Rel *rel, Elf32_Addr sym_val);
 
+#ifdef DLMODULE_USING_LAZY_BIND
+/* the resolver of PLT in arch, it calls dlmodule_lazy_fixup and jumps to the symbol */
+void dlmodule_lazy_resolve(void);
+Elf32_Addr dlmodule_lazy_fixup(struct rt_dlmodule *module, rt_uint32_t rel_offset);
+#endif
+
 #endif
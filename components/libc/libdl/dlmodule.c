@@ -6,6 +6,8 @@
  * Change Logs:
  * Date           Author      Notes
  * 2018/08/29     Bernard     first version
+ * 2019/09/12     RT-Thread   add symbol hash table
+ * 2019/09/16     RT-Thread   parse the ELF file in place of addressable storage
  */
 
 #include <rthw.h>
@@ -22,6 +24,9 @@
 
 static struct rt_module_symtab *_rt_module_symtab_begin = RT_NULL;
 static struct rt_module_symtab *_rt_module_symtab_end   = RT_NULL;
+/* hash table of kernel symbol table */
+static rt_uint16_t *_rt_module_symhash = RT_NULL;
+static rt_uint16_t _rt_module_nbucket = 0;
 
 #if defined(__IAR_SYSTEMS_ICC__) /* for IAR compiler */
     #pragma section="RTMSymTab"
@@ -386,6 +391,10 @@ rt_err_t dlmodule_destroy(struct rt_dlmodule* module)
     {
         rt_free(module->symtab);
     }
+    if (module->symhash != RT_NULL)
+    {
+        rt_free(module->symhash);
+    }
 
     /* destory module */
     rt_free(module->mem_space);
@@ -421,6 +430,8 @@ struct rt_dlmodule* dlmodule_load(const char* filename)
 {
     int fd, length = 0;
     rt_err_t ret = RT_EOK;
+    rt_ubase_t addr;
+    rt_bool_t in_place = RT_FALSE;
     rt_uint8_t *module_ptr = RT_NULL;
     struct rt_dlmodule *module = RT_NULL;
 
@@ -432,11 +443,20 @@ struct rt_dlmodule* dlmodule_load(const char* filename)
 
         if (length == 0) goto __exit;
 
-        module_ptr = (uint8_t*) rt_malloc (length);
-        if (!module_ptr) goto __exit;
+        /* the ELF file in addressable storage (such as romfs) is not read into RAM */
+        if (ioctl(fd, RT_FIOGETADDR, &addr) == 0 && (addr & 0x03) == 0)
+        {
+            module_ptr = (rt_uint8_t *)addr;
+            in_place = RT_TRUE;
+        }
+        else
+        {
+            module_ptr = (uint8_t*) rt_malloc (length);
+            if (!module_ptr) goto __exit;
 
-        if (read(fd, module_ptr, length) != length)
-            goto __exit;
+            if (read(fd, module_ptr, length) != length)
+                goto __exit;
+        }
 
         /* close file and release fd */
         close(fd);
@@ -488,7 +508,7 @@ struct rt_dlmodule* dlmodule_load(const char* filename)
     if (ret != RT_EOK) goto __exit;
 
     /* release module data */
-    rt_free(module_ptr);
+    if (!in_place) rt_free(module_ptr);
 
     /* increase module reference count */
     module->nref ++;
@@ -513,7 +533,7 @@ struct rt_dlmodule* dlmodule_load(const char* filename)
 
 __exit:
     if (fd >= 0) close(fd);
-    if (module_ptr) rt_free(module_ptr);
+    if (module_ptr && !in_place) rt_free(module_ptr);
     if (module) dlmodule_destroy(module);
 
     return RT_NULL;
@@ -600,11 +620,97 @@ void dlmodule_exit(int ret_code)
     rt_exit_critical();
 }
 
+/* the hash function of ELF .gnu.hash section */
+static rt_uint32_t dlmodule_hash(const char *name)
+{
+    rt_uint32_t h = 5381;
+
+    while (*name)
+    {
+        h = (h << 5) + h + (rt_uint8_t)*name++;
+    }
+
+    return h;
+}
+
+/**
+ * This function will build the hash table of symbol table. The table is
+ * bucket[nbucket] followed by chain[nsym], which are the index + 1 of
+ * symbols and 0 is the end of chain.
+ *
+ * @param symtab the symbol table
+ * @param nsym the number of symbols
+ * @param nbucket the number of buckets
+ *
+ * @return the hash table, RT_NULL on failed and the table should be searched linearly.
+ */
+rt_uint16_t *dlmodule_symhash_build(struct rt_module_symtab *symtab, rt_size_t nsym, rt_uint16_t *nbucket)
+{
+    rt_uint16_t *symhash, *chain;
+    rt_uint32_t bucket;
+    rt_size_t i, n;
+
+    if (nsym == 0 || nsym >= 0x8000)
+        return RT_NULL;
+
+    /* a power of 2 which is not less than the number of symbols */
+    for (n = 1; n < nsym; n <<= 1);
+
+    symhash = (rt_uint16_t *)rt_malloc((n + nsym) * sizeof(rt_uint16_t));
+    if (symhash == RT_NULL)
+        return RT_NULL;
+    rt_memset(symhash, 0, n * sizeof(rt_uint16_t));
+    chain = symhash + n;
+
+    /* the first one is found for the same names, as the linear search */
+    for (i = nsym; i > 0; i--)
+    {
+        bucket = dlmodule_hash(symtab[i - 1].name) & (n - 1);
+        chain[i - 1] = symhash[bucket];
+        symhash[bucket] = i;
+    }
+
+    *nbucket = n;
+    return symhash;
+}
+
+/**
+ * This function will find out the symbol by the hash table.
+ *
+ * @param symhash the hash table
+ * @param nbucket the number of buckets
+ * @param symtab the symbol table
+ * @param name the symbol name
+ *
+ * @return the symbol, RT_NULL on not found.
+ */
+struct rt_module_symtab *dlmodule_symhash_find(rt_uint16_t *symhash, rt_uint16_t nbucket,
+        struct rt_module_symtab *symtab, const char *name)
+{
+    rt_uint16_t *chain = symhash + nbucket;
+    rt_uint16_t i;
+
+    for (i = symhash[dlmodule_hash(name) & (nbucket - 1)]; i; i = chain[i - 1])
+    {
+        if (rt_strcmp(symtab[i - 1].name, name) == 0)
+            return &symtab[i - 1];
+    }
+
+    return RT_NULL;
+}
+
 rt_uint32_t dlmodule_symbol_find(const char *sym_str)
 {
     /* find in kernel symbol table */
     struct rt_module_symtab *index;
 
+    if (_rt_module_symhash)
+    {
+        index = dlmodule_symhash_find(_rt_module_symhash, _rt_module_nbucket,
+                                      _rt_module_symtab_begin, sym_str);
+        return index ? (rt_uint32_t)index->addr : 0;
+    }
+
     for (index = _rt_module_symtab_begin; index != _rt_module_symtab_end; index ++)
     {
         if (rt_strcmp(index->name, sym_str) == 0)
@@ -633,6 +739,9 @@ int rt_system_dlmodule_init(void)
     _rt_module_symtab_end   = __section_end("RTMSymTab");
 #endif
 
+    _rt_module_symhash = dlmodule_symhash_build(_rt_module_symtab_begin,
+                         _rt_module_symtab_end - _rt_module_symtab_begin, &_rt_module_nbucket);
+
     return 0;
 }
 INIT_COMPONENT_EXPORT(rt_system_dlmodule_init);
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018/08/11     Bernard      the first version
+ * 2019/09/12     RT-Thread    add symbol hash table and lazy binding
  */
 
 #ifndef RT_DL_MODULE_H__
@@ -57,6 +58,15 @@ struct rt_dlmodule
 
     rt_uint16_t nsym;       /* number of symbols in the module */
     struct rt_module_symtab *symtab;    /* module symbol table */
+    rt_uint16_t nbucket;    /* number of buckets in symbol hash table */
+    rt_uint16_t *symhash;   /* hash table of module symbol table */
+
+#ifdef DLMODULE_USING_LAZY_BIND
+    /* the PLT relocations and dynamic symbols, for resolving on the first call */
+    void *jmprel;
+    void *dynsym;
+    const char *dynstr;
+#endif
 };
 
 struct rt_dlmodule *dlmodule_create(void);
@@ -72,4 +82,8 @@ struct rt_dlmodule *dlmodule_find(const char *name);
 
 rt_uint32_t dlmodule_symbol_find(const char *sym_str);
 
+rt_uint16_t *dlmodule_symhash_build(struct rt_module_symtab *symtab, rt_size_t nsym, rt_uint16_t *nbucket);
+struct rt_module_symtab *dlmodule_symhash_find(rt_uint16_t *symhash, rt_uint16_t nbucket,
+        struct rt_module_symtab *symtab, const char *name);
+
 #endif
@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author      Notes
  * 2010-11-17     yi.qiu      first version
+ * 2019-09-12     RT-Thread   look up by symbol hash table
  */
 
 #include <rtthread.h>
@@ -22,6 +23,14 @@ void* dlsym(void *handle, const char* symbol)
 
     module = (struct rt_dlmodule *)handle;
 
+    if (module->symhash)
+    {
+        struct rt_module_symtab *sym;
+
+        sym = dlmodule_symhash_find(module->symhash, module->nbucket, module->symtab, symbol);
+        return sym ? (void*)sym->addr : RT_NULL;
+    }
+
     for(i=0; i<module->nsym; i++)
     {
         if (rt_strcmp(module->symtab[i].name, symbol) == 0)
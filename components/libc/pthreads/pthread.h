@@ -6,12 +6,15 @@
  * Change Logs:
  * Date           Author       Notes
  * 2010-10-26     Bernard      the first version
+ * 2019-08-19     RT-Thread    Use the atomic lock word in spinlock.
+ * 2019-08-22     RT-Thread    Use the kernel reader-writer lock in rwlock.
  */
 
 #ifndef __PTHREAD_H__
 #define __PTHREAD_H__
 
 #include <rtthread.h>
+#include <rtatomic.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,7 +26,7 @@ extern "C" {
 #define PTHREAD_KEY_MAX             8
 
 #define PTHREAD_COND_INITIALIZER    {-1, 0}
-#define PTHREAD_RWLOCK_INITIALIZER  {-1, 0}
+#define PTHREAD_RWLOCK_INITIALIZER  {-1, {{{{0}}}}}
 #define PTHREAD_MUTEX_INITIALIZER   {-1, 0}
 
 #define PTHREAD_CREATE_JOINABLE     0x00
@@ -112,20 +115,14 @@ struct pthread_rwlock
 {
     pthread_rwlockattr_t attr;
 
-    pthread_mutex_t      rw_mutex;          /* basic lock on this struct */
-    pthread_cond_t       rw_condreaders;    /* for reader threads waiting */
-    pthread_cond_t       rw_condwriters;    /* for writer threads waiting */
-
-    int rw_nwaitreaders;    /* the number of reader threads waiting */
-    int rw_nwaitwriters;    /* the number of writer threads waiting */
-    int rw_refcount;    /* 0: unlocked, -1: locked by writer, > 0 locked by n readers */
+    struct rt_rwlock     lock;
 };
 typedef struct pthread_rwlock pthread_rwlock_t;
 
 /* spinlock implementation, (ADVANCED REALTIME THREADS)*/
 struct pthread_spinlock
 {
-    int lock;
+    volatile rt_atomic_t lock;
 };
 typedef struct pthread_spinlock pthread_spinlock_t;
 
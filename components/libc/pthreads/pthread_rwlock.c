@@ -6,9 +6,12 @@
  * Change Logs:
  * Date           Author       Notes
  * 2010-10-26     Bernard      the first version
+ * 2019-08-22     RT-Thread    map on the kernel reader-writer lock
+ * 2019-10-26     RT-Thread    keep the lock out of the object container
  */
 
 #include <pthread.h>
+#include "pthread_internal.h"
 
 int pthread_rwlockattr_init(pthread_rwlockattr_t *attr)
 {
@@ -50,291 +53,170 @@ int pthread_rwlockattr_setpshared(pthread_rwlockattr_t *attr, int pshared)
 }
 RTM_EXPORT(pthread_rwlockattr_setpshared);
 
+static int pthread_rwlock_number = 0;
+
 int pthread_rwlock_init(pthread_rwlock_t           *rwlock,
                         const pthread_rwlockattr_t *attr)
 {
+    char name[RT_NAME_MAX];
+
     if (!rwlock)
         return EINVAL;
+    if (attr && *attr != PTHREAD_PROCESS_PRIVATE)
+        return EINVAL;
+
+    rt_snprintf(name, sizeof(name), "prwl%02d", pthread_rwlock_number ++);
+    /* the waiting writers block the new readers, in priority order */
+    if (rt_rwlock_init(&(rwlock->lock), name, RT_IPC_FLAG_PRIO) != RT_EOK)
+        return EINVAL;
 
-    rwlock->attr = PTHREAD_PROCESS_PRIVATE;
-    pthread_mutex_init(&(rwlock->rw_mutex), NULL);
-    pthread_cond_init(&(rwlock->rw_condreaders), NULL);
-    pthread_cond_init(&(rwlock->rw_condwriters), NULL);
-    
-    rwlock->rw_nwaitwriters = 0;
-    rwlock->rw_nwaitreaders = 0;
-    rwlock->rw_refcount = 0;
+    /* detach the object from system object container, so that initializing
+     * a lock again doesn't link it twice */
+    rt_object_detach(&(rwlock->lock.parent.parent));
+    rwlock->lock.parent.parent.type = RT_Object_Class_RWLock;
+
+    rwlock->attr = attr ? *attr : PTHREAD_PROCESS_PRIVATE;
 
     return 0;
 }
 RTM_EXPORT(pthread_rwlock_init);
 
+/* the lock of PTHREAD_RWLOCK_INITIALIZER is initialized on its first use */
+static void pthread_rwlock_check(pthread_rwlock_t *rwlock)
+{
+    rt_enter_critical();
+    if (rwlock->attr == -1)
+        pthread_rwlock_init(rwlock, NULL);
+    rt_exit_critical();
+}
+
 int pthread_rwlock_destroy (pthread_rwlock_t *rwlock)
 {
-    int result;
+    rt_base_t level;
 
     if (!rwlock)
         return EINVAL;
     if (rwlock->attr == -1)
         return 0; /* rwlock is not initialized */
 
-    if ( (result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
-
-    if (rwlock->rw_refcount != 0 ||
-        rwlock->rw_nwaitreaders != 0 ||
-        rwlock->rw_nwaitwriters != 0)
+    level = rt_hw_interrupt_disable();
+    /* check whether busy */
+    if (rwlock->lock.value != 0 ||
+        !rt_list_isempty(&(rwlock->lock.parent.suspend_thread)) ||
+        !rt_list_isempty(&(rwlock->lock.reader_thread)))
     {
-        result = EBUSY;
+        rt_hw_interrupt_enable(level);
 
-        return result;
-    }
-    else
-    {
-        /* check whether busy */
-        result = rt_sem_trytake(&(rwlock->rw_condreaders.sem));
-        if (result == RT_EOK)
-        {
-            result = rt_sem_trytake(&(rwlock->rw_condwriters.sem));
-            if (result == RT_EOK)
-            {
-                rt_sem_release(&(rwlock->rw_condreaders.sem));
-                rt_sem_release(&(rwlock->rw_condwriters.sem));
-
-                pthread_cond_destroy(&rwlock->rw_condreaders);
-                pthread_cond_destroy(&rwlock->rw_condwriters);
-            }
-            else
-            {
-                rt_sem_release(&(rwlock->rw_condreaders.sem));
-                result = EBUSY;
-            }
-        }
-        else
-            result = EBUSY;
+        return EBUSY;
     }
+    rt_hw_interrupt_enable(level);
 
-    pthread_mutex_unlock(&rwlock->rw_mutex);
-    if (result == 0)
-        pthread_mutex_destroy(&rwlock->rw_mutex);
-    
-    return result;
+    rt_memset(rwlock, 0, sizeof(pthread_rwlock_t));
+    rwlock->attr = -1;
+
+    return 0;
 }
 RTM_EXPORT(pthread_rwlock_destroy);
 
-int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock)
+static int pthread_rwlock_errno(rt_err_t result, int busy)
 {
-    int result;
+    if (result == RT_EOK)
+        return 0;
+    if (result == -RT_ETIMEOUT)
+        return busy;
+
+    return EINVAL;
+}
 
+int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock)
+{
     if (!rwlock)
         return EINVAL;
     if (rwlock->attr == -1)
-        pthread_rwlock_init(rwlock, NULL);
-
-    if ((result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
-
-    /* give preference to waiting writers */
-    while (rwlock->rw_refcount < 0 || rwlock->rw_nwaitwriters > 0)
-    {
-        rwlock->rw_nwaitreaders++;
-        /* rw_mutex will be released when waiting for rw_condreaders */
-        result = pthread_cond_wait(&rwlock->rw_condreaders, &rwlock->rw_mutex);
-        /* rw_mutex should have been taken again when returned from waiting */
-        rwlock->rw_nwaitreaders--;
-        if (result != 0) /* wait error */
-            break;
-    }
-
-    /* another reader has a read lock */
-    if (result == 0)
-        rwlock->rw_refcount++;
+        pthread_rwlock_check(rwlock);
 
-    pthread_mutex_unlock(&rwlock->rw_mutex);
-
-    return (result);
+    return pthread_rwlock_errno(rt_rwlock_take_read(&(rwlock->lock), RT_WAITING_FOREVER), EBUSY);
 }
 RTM_EXPORT(pthread_rwlock_rdlock);
 
 int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock)
 {
-    int result;
-
     if (!rwlock)
         return EINVAL;
     if (rwlock->attr == -1)
-        pthread_rwlock_init(rwlock, NULL);
-
-    if ((result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
-
-    if (rwlock->rw_refcount < 0 || rwlock->rw_nwaitwriters > 0)
-        result = EBUSY;                 /* held by a writer or waiting writers */
-    else
-        rwlock->rw_refcount++;          /* increment count of reader locks */
+        pthread_rwlock_check(rwlock);
 
-    pthread_mutex_unlock(&rwlock->rw_mutex);
-
-    return(result);
+    return pthread_rwlock_errno(rt_rwlock_take_read(&(rwlock->lock), 0), EBUSY);
 }
 RTM_EXPORT(pthread_rwlock_tryrdlock);
 
 int pthread_rwlock_timedrdlock(pthread_rwlock_t      *rwlock,
                                const struct timespec *abstime)
 {
-    int result;
+    rt_int32_t tick;
 
-    if (!rwlock)
+    if (!rwlock || !abstime)
         return EINVAL;
     if (rwlock->attr == -1)
-        pthread_rwlock_init(rwlock, NULL);
+        pthread_rwlock_check(rwlock);
 
-    if ( (result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
+    /* calculate os tick */
+    tick = clock_time_to_tick(abstime);
 
-    /* give preference to waiting writers */
-    while (rwlock->rw_refcount < 0 || rwlock->rw_nwaitwriters > 0)
-    {
-        rwlock->rw_nwaitreaders++;
-        /* rw_mutex will be released when waiting for rw_condreaders */
-        result = pthread_cond_timedwait(&rwlock->rw_condreaders, &rwlock->rw_mutex, abstime);
-        /* rw_mutex should have been taken again when returned from waiting */
-        rwlock->rw_nwaitreaders--;
-        if (result != 0)
-            break;
-    }
-
-    /* another reader has a read lock */
-    if (result == 0)
-        rwlock->rw_refcount++;
-
-    pthread_mutex_unlock(&rwlock->rw_mutex);
-
-    return (result);
+    return pthread_rwlock_errno(rt_rwlock_take_read(&(rwlock->lock), tick), ETIMEDOUT);
 }
 RTM_EXPORT(pthread_rwlock_timedrdlock);
 
 int pthread_rwlock_timedwrlock(pthread_rwlock_t      *rwlock,
                                const struct timespec *abstime)
 {
-    int result;
+    rt_int32_t tick;
 
-    if (!rwlock)
+    if (!rwlock || !abstime)
         return EINVAL;
     if (rwlock->attr == -1)
-        pthread_rwlock_init(rwlock, NULL);
-
-    if ((result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
-
-    while (rwlock->rw_refcount != 0)
-    {
-        rwlock->rw_nwaitwriters++;
-        /* rw_mutex will be released when waiting for rw_condwriters */
-        result = pthread_cond_timedwait(&rwlock->rw_condwriters, &rwlock->rw_mutex, abstime);
-        /* rw_mutex should have been taken again when returned from waiting */
-        rwlock->rw_nwaitwriters--;
-        
-        if (result != 0)
-            break;
-    }
-
-    if (result == 0)
-        rwlock->rw_refcount = -1;
+        pthread_rwlock_check(rwlock);
 
-    pthread_mutex_unlock(&rwlock->rw_mutex);
+    /* calculate os tick */
+    tick = clock_time_to_tick(abstime);
 
-    return(result);
+    return pthread_rwlock_errno(rt_rwlock_take_write(&(rwlock->lock), tick), ETIMEDOUT);
 }
 RTM_EXPORT(pthread_rwlock_timedwrlock);
 
 int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock)
 {
-    int result;
-
     if (!rwlock)
         return EINVAL;
     if (rwlock->attr == -1)
-        pthread_rwlock_init(rwlock, NULL);
-
-    if ((result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
+        pthread_rwlock_check(rwlock);
 
-    if (rwlock->rw_refcount != 0)
-        result = EBUSY;                 /* held by either writer or reader(s) */
-    else
-        rwlock->rw_refcount = -1;       /* available, indicate a writer has it */
-
-    pthread_mutex_unlock(&rwlock->rw_mutex);
-
-    return(result);
+    return pthread_rwlock_errno(rt_rwlock_take_write(&(rwlock->lock), 0), EBUSY);
 }
 RTM_EXPORT(pthread_rwlock_trywrlock);
 
 int pthread_rwlock_unlock(pthread_rwlock_t *rwlock)
 {
-    int result;
-
     if (!rwlock)
         return EINVAL;
     if (rwlock->attr == -1)
-        pthread_rwlock_init(rwlock, NULL);
+        pthread_rwlock_check(rwlock);
 
-    if ( (result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
+    /* the lock is not held by the current thread */
+    if (rt_rwlock_release(&(rwlock->lock)) != RT_EOK)
+        return EPERM;
 
-    if (rwlock->rw_refcount > 0)
-        rwlock->rw_refcount--;              /* releasing a reader */
-    else if (rwlock->rw_refcount == -1)
-        rwlock->rw_refcount = 0;            /* releasing a writer */
-
-    /* give preference to waiting writers over waiting readers */
-    if (rwlock->rw_nwaitwriters > 0)
-    {
-        if (rwlock->rw_refcount == 0)
-            result = pthread_cond_signal(&rwlock->rw_condwriters);
-    }
-    else if (rwlock->rw_nwaitreaders > 0)
-    {
-        result = pthread_cond_broadcast(&rwlock->rw_condreaders);
-    }
-
-    pthread_mutex_unlock(&rwlock->rw_mutex);
-
-    return(result);
+    return 0;
 }
 RTM_EXPORT(pthread_rwlock_unlock);
 
 int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock)
 {
-    int result;
-
     if (!rwlock)
         return EINVAL;
     if (rwlock->attr == -1)
-        pthread_rwlock_init(rwlock, NULL);
-
-    if ((result = pthread_mutex_lock(&rwlock->rw_mutex)) != 0)
-        return(result);
-
-    while (rwlock->rw_refcount != 0)
-    {
-        rwlock->rw_nwaitwriters++;
-        /* rw_mutex will be released when waiting for rw_condwriters */
-        result = pthread_cond_wait(&rwlock->rw_condwriters, &rwlock->rw_mutex);
-        /* rw_mutex should have been taken again when returned from waiting */
-        rwlock->rw_nwaitwriters--;
-        
-        if (result != 0)
-            break;
-    }
-
-    if (result == 0)
-        rwlock->rw_refcount = -1;
+        pthread_rwlock_check(rwlock);
 
-    pthread_mutex_unlock(&rwlock->rw_mutex);
-
-    return(result);
+    return pthread_rwlock_errno(rt_rwlock_take_write(&(rwlock->lock), RT_WAITING_FOREVER), EBUSY);
 }
 RTM_EXPORT(pthread_rwlock_wrlock);
-
@@ -6,16 +6,33 @@
  * Change Logs:
  * Date           Author       Notes
  * 2010-10-26     Bernard      the first version
+ * 2019-08-19     RT-Thread    Rebuild on rt_atomic with test-and-test-and-set.
  */
 
 #include <pthread.h>
 
+/*
+ * The waiter spins on a plain load (test) and only tries the atomic swap
+ * (test-and-set) when the lock looks free, the spin between two tests is
+ * doubled up to PTHREAD_SPIN_BACKOFF_MAX. After that the waiter sleeps a
+ * tick, so that a lower priority holder on the same core can go on and
+ * release the lock.
+ */
+#define PTHREAD_SPIN_BACKOFF_MAX    1024
+
+static void pthread_spin_pause(int count)
+{
+    volatile int loop;
+
+    for (loop = 0; loop < count; loop ++);
+}
+
 int pthread_spin_init (pthread_spinlock_t *lock, int pshared)
 {
     if (!lock)
         return EINVAL;
 
-    lock->lock = 0;
+    rt_atomic_store_explicit(&lock->lock, 0, RT_ATOMIC_RELAXED);
 
     return 0;
 }
@@ -30,12 +47,32 @@ int pthread_spin_destroy (pthread_spinlock_t *lock)
 
 int pthread_spin_lock (pthread_spinlock_t *lock)
 {
+    int backoff = 1;
+    rt_atomic_t expected;
+
     if (!lock)
         return EINVAL;
 
-    while (!(lock->lock))
+    while (1)
     {
-        lock->lock = 1;
+        /* test */
+        while (rt_atomic_load_explicit(&lock->lock, RT_ATOMIC_RELAXED) != 0)
+        {
+            if (backoff < PTHREAD_SPIN_BACKOFF_MAX)
+            {
+                pthread_spin_pause(backoff);
+                backoff <<= 1;
+            }
+            else
+            {
+                rt_thread_delay(1);
+            }
+        }
+
+        /* and set */
+        expected = 0;
+        if (rt_atomic_cas_explicit(&lock->lock, &expected, 1, RT_ATOMIC_ACQUIRE))
+            break;
     }
 
     return 0;
@@ -43,13 +80,14 @@ int pthread_spin_lock (pthread_spinlock_t *lock)
 
 int pthread_spin_trylock (pthread_spinlock_t *lock)
 {
+    rt_atomic_t expected = 0;
+
     if (!lock)
         return EINVAL;
 
-    if (!(lock->lock))
+    if (rt_atomic_load_explicit(&lock->lock, RT_ATOMIC_RELAXED) == 0 &&
+        rt_atomic_cas_explicit(&lock->lock, &expected, 1, RT_ATOMIC_ACQUIRE))
     {
-        lock->lock = 1;
-
         return 0;
     }
 
@@ -60,10 +98,10 @@ int pthread_spin_unlock (pthread_spinlock_t *lock)
 {
     if (!lock)
         return EINVAL;
-    if (!(lock->lock))
+    if (rt_atomic_load_explicit(&lock->lock, RT_ATOMIC_RELAXED) == 0)
         return EPERM;
 
-    lock->lock = 0;
+    rt_atomic_store_explicit(&lock->lock, 0, RT_ATOMIC_RELEASE);
 
     return 0;
 }
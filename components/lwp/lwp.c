@@ -7,6 +7,8 @@
  * Date           Author       Notes
  * 2006-03-12     Bernard      first version
  * 2018-11-02     heyuanjie    fix complie error in iar
+ * 2019-09-16     RT-Thread    execute the text in place and share it between lwps
+ * 2019-10-26     RT-Thread    check the content of shared text, serialize the loading
  */
 
 #include <rtthread.h>
@@ -80,6 +82,176 @@ static int lwp_argscopy(struct rt_lwp *lwp, int argc, char **argv)
     return 0;
 }
 
+#ifdef LWP_USING_SHARED_TEXT
+/*
+ * The text loaded into RAM is shared by the lwps of same file. The file is
+ * identified by the full path, size and modified time, so a replaced file is
+ * loaded again. Some file systems have no modified time (it's 0), then the
+ * text in file is compared with the shared one.
+ *
+ * The loading is serialized by lwp_text_lock from the lookup to the insert,
+ * so the same file is not loaded twice. The list is changed in the critical
+ * section, lwp_text_put() is called from the cleanup of thread.
+ */
+struct lwp_text
+{
+    rt_list_t list;
+
+    char *path;
+    off_t file_size;
+    time_t file_mtime;
+
+    uint8_t *text;
+    uint32_t text_size;
+    int ref;
+};
+
+static rt_list_t lwp_text_list = RT_LIST_OBJECT_INIT(lwp_text_list);
+static struct rt_mutex lwp_text_lock;
+
+static void lwp_text_put(struct lwp_text *text);
+
+static int lwp_text_init(void)
+{
+    rt_mutex_init(&lwp_text_lock, "lwptext", RT_IPC_FLAG_FIFO);
+
+    return 0;
+}
+INIT_COMPONENT_EXPORT(lwp_text_init);
+
+/* compare the text in file with the shared text, the file position is kept */
+static rt_bool_t lwp_text_same(int fd, struct lwp_text *text, uint32_t size)
+{
+    uint8_t buf[64];
+    uint32_t offset;
+    off_t pos;
+    int nbytes;
+
+    if (size > text->text_size)
+        return RT_FALSE;
+
+    pos = lseek(fd, 0, SEEK_CUR);
+    for (offset = 0; offset < size; offset += nbytes)
+    {
+        nbytes = size - offset > sizeof(buf) ? sizeof(buf) : size - offset;
+        if (read(fd, buf, nbytes) != nbytes ||
+            rt_memcmp(buf, text->text + offset, nbytes) != 0)
+            break;
+    }
+    lseek(fd, pos, SEEK_SET);
+
+    return offset >= size ? RT_TRUE : RT_FALSE;
+}
+
+/* the lwp_text_lock is taken by the caller */
+static struct lwp_text *lwp_text_get(const char *path, struct stat *st, int fd, uint32_t size)
+{
+    struct lwp_text *text;
+    rt_list_t *node;
+
+    rt_enter_critical();
+    for (node = lwp_text_list.next; node != &lwp_text_list; node = node->next)
+    {
+        text = rt_list_entry(node, struct lwp_text, list);
+        if (text->file_size == st->st_size && text->file_mtime == st->st_mtime &&
+            rt_strcmp(text->path, path) == 0)
+        {
+            /* hold the text, it's not freed when the file is compared */
+            text->ref ++;
+            rt_exit_critical();
+
+            if (st->st_mtime == 0 && lwp_text_same(fd, text, size) == RT_FALSE)
+            {
+                lwp_text_put(text);
+                return RT_NULL;
+            }
+
+            return text;
+        }
+    }
+    rt_exit_critical();
+
+    return RT_NULL;
+}
+
+static struct lwp_text *lwp_text_add(char *path, struct stat *st, uint8_t *entry, uint32_t size)
+{
+    struct lwp_text *text;
+
+    text = (struct lwp_text *)rt_malloc(sizeof(struct lwp_text));
+    if (text == RT_NULL)
+        return RT_NULL;
+
+    text->path = path;
+    text->file_size = st->st_size;
+    text->file_mtime = st->st_mtime;
+    text->text = entry;
+    text->text_size = size;
+    text->ref = 1;
+
+    rt_enter_critical();
+    rt_list_insert_after(&lwp_text_list, &text->list);
+    rt_exit_critical();
+
+    return text;
+}
+
+static void lwp_text_put(struct lwp_text *text)
+{
+    int ref;
+
+    rt_enter_critical();
+    ref = -- text->ref;
+    if (ref == 0)
+        rt_list_remove(&text->list);
+    rt_exit_critical();
+
+    if (ref == 0)
+    {
+        dbg_log(DBG_LOG, "lwp shared text free: %p\n", text->text);
+#ifdef RT_USING_CACHE
+        rt_free_align(text->text);
+#else
+        rt_free(text->text);
+#endif
+        rt_free(text->path);
+        rt_free(text);
+    }
+}
+#endif /* LWP_USING_SHARED_TEXT */
+
+/* release the text of dynamic loaded lwp */
+static void lwp_text_free(struct rt_lwp *lwp)
+{
+    if (lwp->text_entry == RT_NULL)
+        return;
+
+    switch (lwp->text_type)
+    {
+    case LWP_TEXT_XIP:
+        /* it's in the file */
+        break;
+
+#ifdef LWP_USING_SHARED_TEXT
+    case LWP_TEXT_SHARED:
+        lwp_text_put(lwp->text_shared);
+        lwp->text_shared = RT_NULL;
+        break;
+#endif
+
+    default:
+        dbg_log(DBG_LOG, "lwp text free: %p\n", lwp->text_entry);
+#ifdef RT_USING_CACHE
+        rt_free_align(lwp->text_entry);
+#else
+        rt_free(lwp->text_entry);
+#endif
+        break;
+    }
+
+    lwp->text_entry = RT_NULL;
+}
+
 static int lwp_load(const char *filename, struct rt_lwp *lwp, uint8_t *load_addr, size_t addr_size)
 {
     int fd;
@@ -88,6 +260,15 @@ static int lwp_load(const char *filename, struct rt_lwp *lwp, uint8_t *load_addr
     int nbytes;
     struct lwp_header header;
     struct lwp_chunk  chunk;
+#ifdef LWP_USING_XIP
+    rt_ubase_t addr;
+#endif
+#ifdef LWP_USING_SHARED_TEXT
+    char *fullpath = RT_NULL;
+    struct stat st;
+    struct lwp_text *text;
+    rt_bool_t text_locked = RT_FALSE;
+#endif
 
     /* check file name */
     RT_ASSERT(filename != RT_NULL);
@@ -150,6 +331,61 @@ static int lwp_load(const char *filename, struct rt_lwp *lwp, uint8_t *load_addr
             lwp->text_entry = ptr;
         else
         {
+#ifdef LWP_USING_XIP
+            /* the text in addressable storage is executed in place, the space must be in file */
+            if (chunk.total_len - sizeof(struct lwp_chunk) >= lwp->text_size &&
+                ioctl(fd, RT_FIOGETADDR, &addr) == 0)
+            {
+                addr += sizeof(struct lwp_header) + sizeof(struct lwp_chunk);
+                if ((addr & 0x03) == 0)
+                {
+                    lwp->text_entry = (uint8_t *)addr;
+                    lwp->text_type = LWP_TEXT_XIP;
+                    dbg_log(DBG_LOG, "lwp text in place: %p\n", lwp->text_entry);
+                }
+            }
+#endif
+
+#ifdef LWP_USING_SHARED_TEXT
+            if (lwp->text_entry == RT_NULL)
+            {
+                fullpath = dfs_normalize_path(RT_NULL, filename);
+                if (fullpath && stat(fullpath, &st) == 0)
+                {
+                    /* it's released when the text is added or the loading fails */
+                    rt_mutex_take(&lwp_text_lock, RT_WAITING_FOREVER);
+                    text_locked = RT_TRUE;
+
+                    text = lwp_text_get(fullpath, &st, fd, chunk.data_len);
+                    if (text)
+                    {
+                        lwp->text_entry = text->text;
+                        lwp->text_shared = text;
+                        lwp->text_type = LWP_TEXT_SHARED;
+                        dbg_log(DBG_LOG, "lwp text shared: %p, ref %d\n", text->text, text->ref);
+
+                        rt_mutex_release(&lwp_text_lock);
+                        text_locked = RT_FALSE;
+                    }
+                }
+                else if (fullpath)
+                {
+                    rt_free(fullpath);
+                    fullpath = RT_NULL;
+                }
+            }
+#endif
+        }
+
+        if (lwp->text_type != LWP_TEXT_PRIVATE)
+        {
+            /* the text is ready, skip the chunk */
+            lseek(fd, chunk.total_len - sizeof(struct lwp_chunk), SEEK_CUR);
+            goto _load_data;
+        }
+
+        if (load_addr == RT_NULL)
+        {
 #ifdef RT_USING_CACHE
             lwp->text_entry = (rt_uint8_t *)rt_malloc_align(lwp->text_size, RT_CPU_CACHE_LINE_SZ);
 #else
@@ -186,6 +422,25 @@ static int lwp_load(const char *filename, struct rt_lwp *lwp, uint8_t *load_addr
 
         if (ptr != RT_NULL) ptr += nbytes;
 
+#ifdef LWP_USING_SHARED_TEXT
+        if (fullpath)
+        {
+            /* the path is kept by the shared text */
+            text = lwp_text_add(fullpath, &st, lwp->text_entry, lwp->text_size);
+            if (text)
+            {
+                fullpath = RT_NULL;
+                lwp->text_shared = text;
+                lwp->text_type = LWP_TEXT_SHARED;
+            }
+        }
+        if (text_locked)
+        {
+            rt_mutex_release(&lwp_text_lock);
+            text_locked = RT_FALSE;
+        }
+#endif
+
         /* skip text hole */
         if ((chunk.total_len - sizeof(struct lwp_chunk) - chunk.data_len))
         {
@@ -194,6 +449,7 @@ static int lwp_load(const char *filename, struct rt_lwp *lwp, uint8_t *load_addr
         }
     }
 
+_load_data:
     /* load data */
     nbytes = read(fd, &chunk, sizeof(struct lwp_chunk));
     if (nbytes != sizeof(struct lwp_chunk))
@@ -239,21 +495,19 @@ static int lwp_load(const char *filename, struct rt_lwp *lwp, uint8_t *load_addr
 _exit:
     if (fd >= 0)
         close(fd);
+#ifdef LWP_USING_SHARED_TEXT
+    if (text_locked)
+        rt_mutex_release(&lwp_text_lock);
+    if (fullpath)
+        rt_free(fullpath);
+#endif
 
     if (result != RT_EOK)
     {
         if (lwp->lwp_type == LWP_TYPE_DYN_ADDR)
         {
             dbg_log(DBG_ERROR, "lwp dynamic load faild, %d\n", result);
-            if (lwp->text_entry)
-            {
-                dbg_log(DBG_LOG, "lwp text free: %p\n", lwp->text_entry);
-#ifdef RT_USING_CACHE
-                rt_free_align(lwp->text_entry);
-#else
-                rt_free(lwp->text_entry);
-#endif
-            }
+            lwp_text_free(lwp);
             if (lwp->data)
             {
                 dbg_log(DBG_LOG, "lwp data free: %p\n", lwp->data);
@@ -276,15 +530,7 @@ static void lwp_cleanup(struct rt_thread *tid)
     if (lwp->lwp_type == LWP_TYPE_DYN_ADDR)
     {
         dbg_log(DBG_INFO, "dynamic lwp\n");
-        if (lwp->text_entry)
-        {
-            dbg_log(DBG_LOG, "lwp text free: %p\n", lwp->text_entry);
-#ifdef RT_USING_CACHE
-            rt_free_align(lwp->text_entry);
-#else
-            rt_free(lwp->text_entry);
-#endif
-        }
+        lwp_text_free(lwp);
         if (lwp->data)
         {
             dbg_log(DBG_LOG, "lwp data free: %p\n", lwp->data);
@@ -362,11 +608,7 @@ int exec(char *filename, int argc, char **argv)
         }
         else
         {
-#ifdef RT_USING_CACHE
-            rt_free_align(lwp->text_entry);
-#else
-            rt_free(lwp->text_entry);
-#endif
+            lwp_text_free(lwp);
             rt_free(lwp->data);
         }
     }
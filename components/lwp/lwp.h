@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-06-29     heyuanjie    first version
+ * 2019-09-16     RT-Thread    add execute-in-place and shared text
  */
 
 #ifndef __LWP_H__
@@ -16,6 +17,11 @@
 #define LWP_TYPE_FIX_ADDR   0x01
 #define LWP_TYPE_DYN_ADDR   0x02
 
+/* the text of dynamic loaded lwp */
+#define LWP_TEXT_PRIVATE    0x00                        /**< loaded for the lwp */
+#define LWP_TEXT_XIP        0x01                        /**< executed in place of file */
+#define LWP_TEXT_SHARED     0x02                        /**< shared by the lwps of same file */
+
 #define LWP_ARG_MAX         8
 
 #include <stdint.h>
@@ -23,16 +29,20 @@
 #include <dfs.h>
 #include <lwp_memheap.h>
 
+struct lwp_text;
+
 struct rt_lwp
 {
     uint8_t lwp_type;
     uint8_t heap_cnt;
-    uint8_t reserv[2];
+    uint8_t text_type;
+    uint8_t reserv[1];
 
     rt_list_t hlist;                                    /**< headp list */
 
     uint8_t *text_entry;
     uint32_t text_size;
+    struct lwp_text *text_shared;                       /**< the shared text of LWP_TEXT_SHARED */
 
     uint8_t *data;
     uint32_t data_size;
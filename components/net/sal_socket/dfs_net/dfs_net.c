@@ -9,6 +9,7 @@
  * 2016-05-07     Bernard      Rename dfs_lwip to dfs_net
  * 2018-03-09     Bernard      Fix the last data issue in poll.
  * 2018-05-24     ChenYong     Add socket abstraction layer
+ * 2019-10-26     RT-Thread    Keep errno of the readv/writev errors.
  */
 
 #include <rtthread.h>
@@ -54,6 +55,46 @@ static int dfs_net_write(struct dfs_fd *file, const void *buf, size_t count)
     return sal_sendto(socket, buf, count, 0, NULL, 0);
 }
 
+/* readv/writev of dfs_posix set errno from the negative result again */
+static int dfs_net_error(int result)
+{
+    int error;
+
+    if (result >= 0)
+        return result;
+
+    error = rt_get_errno();
+    if (error == 0)
+        return -EIO;
+
+    return error < 0 ? error : -error;
+}
+
+static int dfs_net_readv(struct dfs_fd *file, const struct iovec *iov, int iovcnt)
+{
+    int socket = (int) file->data;
+    struct msghdr msg;
+
+    rt_memset(&msg, 0x00, sizeof(msg));
+    msg.msg_iov = (struct iovec *) iov;
+    msg.msg_iovlen = iovcnt;
+
+    return dfs_net_error(sal_recvmsg(socket, &msg, 0));
+}
+
+static int dfs_net_writev(struct dfs_fd *file, const struct iovec *iov, int iovcnt)
+{
+    int socket = (int) file->data;
+    struct msghdr msg;
+
+    rt_memset(&msg, 0x00, sizeof(msg));
+    msg.msg_iov = (struct iovec *) iov;
+    msg.msg_iovlen = iovcnt;
+
+    /* one protocol send for the whole vector */
+    return dfs_net_error(sal_sendmsg(socket, &msg, 0));
+}
+
 static int dfs_net_close(struct dfs_fd* file)
 {
     int socket = (int) file->data;
@@ -79,6 +120,8 @@ const struct dfs_file_ops _net_fops =
     NULL,    /* lseek    */
     NULL,    /* getdents */
     dfs_net_poll,
+    dfs_net_readv,
+    dfs_net_writev,
 };
 
 const struct dfs_file_ops *dfs_net_get_fops(void)
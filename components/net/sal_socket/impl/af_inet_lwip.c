@@ -6,6 +6,8 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-05-17     ChenYong     First version
+ * 2019-08-05     RT-Thread    Map sendmsg/recvmsg onto lwIP.
+ * 2019-08-15     RT-Thread    Add zero copy send for sendfile.
  */
 
 #include <rtthread.h>
@@ -281,7 +283,45 @@ static int inet_poll(struct dfs_fd *file, struct rt_pollreq *req)
 
     return mask;
 }
-#endif
+
+#if LWIP_VERSION >= 0x20000ff
+/* queue the data to TCP by reference (PBUF_ROM), no copy into the pbufs */
+static int inet_sendref(int socket, const void *data, size_t size, int flags)
+{
+    struct lwip_sock *sock;
+    size_t written = 0;
+    u8_t apiflags = 0;
+    err_t err;
+
+    sock = lwip_tryget_socket(socket);
+    if (sock == NULL || sock->conn == NULL)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_TCP)
+    {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    if (flags & MSG_DONTWAIT)
+        apiflags |= NETCONN_DONTBLOCK;
+    if (flags & MSG_MORE)
+        apiflags |= NETCONN_MORE;
+
+    err = netconn_write_partly(sock->conn, data, size, apiflags, &written);
+    if (err != ERR_OK)
+    {
+        errno = err_to_errno(err);
+        return -1;
+    }
+
+    return (int)written;
+}
+#endif /* LWIP_VERSION >= 0x20000ff */
+#endif /* SAL_USING_POSIX */
 
 static const struct sal_socket_ops lwip_socket_ops =
 {
@@ -303,6 +343,21 @@ static const struct sal_socket_ops lwip_socket_ops =
 #ifdef SAL_USING_POSIX
     inet_poll,
 #endif
+#if LWIP_VERSION >= 0x20000ff
+    (int (*)(int, const struct msghdr *, int))lwip_sendmsg,
+#else
+    NULL,
+#endif
+#if LWIP_VERSION >= 0x20100ff
+    (int (*)(int, struct msghdr *, int))lwip_recvmsg,
+#else
+    NULL,
+#endif
+#if defined(SAL_USING_POSIX) && (LWIP_VERSION >= 0x20000ff)
+    inet_sendref,
+#else
+    NULL,
+#endif
 };
 
 static const struct sal_netdb_ops lwip_netdb_ops =
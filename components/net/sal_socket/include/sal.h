@@ -6,6 +6,8 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-05-17     ChenYong     First version
+ * 2019-08-05     RT-Thread    Add sendmsg/recvmsg socket operations.
+ * 2019-08-15     RT-Thread    Add sendref socket operation.
  */
 
 #ifndef SAL_H__
@@ -25,6 +27,8 @@ extern "C" {
 typedef uint32_t socklen_t;
 #endif
 
+struct msghdr;
+
 /* SAL socket magic word */
 #define SAL_SOCKET_MAGIC               0x5A10
 
@@ -80,6 +84,12 @@ struct sal_socket_ops
 #ifdef SAL_USING_POSIX
     int (*poll)       (struct dfs_fd *file, struct rt_pollreq *req);
 #endif
+    /* optional, sal_sendmsg/sal_recvmsg fall back to sendto/recvfrom */
+    int (*sendmsg)    (int s, const struct msghdr *message, int flags);
+    int (*recvmsg)    (int s, struct msghdr *message, int flags);
+    /* optional, send the data without copying it, the data must stay valid
+     * after returning until the peer acknowledges it (stream socket only) */
+    int (*sendref)    (int s, const void *data, size_t size, int flags);
 };
 
 /* sal network database name resolving */
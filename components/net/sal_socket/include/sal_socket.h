@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-05-24     ChenYong     First version
+ * 2019-08-15     RT-Thread    Add sal_sendfile.
  */
 
 #ifndef SAL_SOCKET_H__
@@ -193,6 +194,31 @@ struct sockaddr_storage
 #endif /* NETDEV_IPV6 */
 };
 
+/* scatter/gather element, the same layout as lwIP and POSIX <sys/uio.h> */
+#if !defined(iovec)
+struct iovec
+{
+    void  *iov_base;
+    size_t iov_len;
+};
+#define iovec iovec
+#endif
+
+struct msghdr
+{
+    void         *msg_name;
+    socklen_t     msg_namelen;
+    struct iovec *msg_iov;
+    int           msg_iovlen;
+    void         *msg_control;
+    socklen_t     msg_controllen;
+    int           msg_flags;
+};
+
+/* struct msghdr->msg_flags bit field values */
+#define MSG_TRUNC       0x04
+#define MSG_CTRUNC      0x08
+
 int sal_accept(int socket, struct sockaddr *addr, socklen_t *addrlen);
 int sal_bind(int socket, const struct sockaddr *name, socklen_t namelen);
 int sal_shutdown(int socket, int how);
@@ -206,6 +232,12 @@ int sal_recvfrom(int socket, void *mem, size_t len, int flags,
       struct sockaddr *from, socklen_t *fromlen);
 int sal_sendto(int socket, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
+int sal_sendmsg(int socket, const struct msghdr *message, int flags);
+int sal_recvmsg(int socket, struct msghdr *message, int flags);
+#ifdef SAL_USING_POSIX
+struct dfs_fd;
+int sal_sendfile(int socket, struct dfs_fd *file, off_t *offset, size_t count);
+#endif
 int sal_socket(int domain, int type, int protocol);
 int sal_closesocket(int socket);
 int sal_ioctlsocket(int socket, long cmd, void *arg);
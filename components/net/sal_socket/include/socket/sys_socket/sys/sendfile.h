@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-15     RT-Thread    First version
+ */
+
+#ifndef SYS_SENDFILE_H_
+#define SYS_SENDFILE_H_
+
+/* sendfile() is declared with the socket APIs */
+#include <sys/socket.h>
+
+#endif /* SYS_SENDFILE_H_ */
@@ -7,6 +7,7 @@
  * Date           Author       Notes
  * 2015-02-17     Bernard      First version
  * 2018-05-17     ChenYong     Add socket abstraction layer
+ * 2019-08-15     RT-Thread    Add sendfile.
  */
 
 #ifndef SYS_SOCKET_H_
@@ -38,6 +39,9 @@ int recvfrom(int s, void *mem, size_t len, int flags,
 int send(int s, const void *dataptr, size_t size, int flags);
 int sendto(int s, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
+int sendmsg(int s, const struct msghdr *message, int flags);
+int recvmsg(int s, struct msghdr *message, int flags);
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
 int socket(int domain, int type, int protocol);
 int closesocket(int s);
 int ioctlsocket(int s, long cmd, void *arg);
@@ -55,6 +59,8 @@ int ioctlsocket(int s, long cmd, void *arg);
 #define recvfrom(s, mem, len, flags, from, fromlen)        sal_recvfrom(s, mem, len, flags, from, fromlen)
 #define send(s, dataptr, size, flags)                      sal_sendto(s, dataptr, size, flags, NULL, NULL)
 #define sendto(s, dataptr, size, flags, to, tolen)         sal_sendto(s, dataptr, size, flags, to, tolen)
+#define sendmsg(s, message, flags)                         sal_sendmsg(s, message, flags)
+#define recvmsg(s, message, flags)                         sal_recvmsg(s, message, flags)
 #define socket(domain, type, protocol)                     sal_socket(domain, type, protocol)
 #define closesocket(s)                                     sal_closesocket(s)
 #define ioctlsocket(s, cmd, arg)                           sal_ioctlsocket(s, cmd, arg)
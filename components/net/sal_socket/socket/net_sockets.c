@@ -7,11 +7,14 @@
  * Date           Author       Notes
  * 2015-02-17     Bernard      First version
  * 2018-05-17     ChenYong     Add socket abstraction layer
+ * 2019-08-01     RT-Thread    Release epoll registrations on closesocket.
+ * 2019-08-15     RT-Thread    Add sendfile.
  */
 
 #include <dfs.h>
 #include <dfs_file.h>
 #include <dfs_poll.h>
+#include <dfs_epoll.h>
 #include <dfs_net.h>
 
 #include <sys/socket.h>
@@ -196,6 +199,44 @@ int sendto(int s, const void *dataptr, size_t size, int flags,
 }
 RTM_EXPORT(sendto);
 
+int sendmsg(int s, const struct msghdr *message, int flags)
+{
+    int socket = dfs_net_getsocket(s);
+
+    return sal_sendmsg(socket, message, flags);
+}
+RTM_EXPORT(sendmsg);
+
+int recvmsg(int s, struct msghdr *message, int flags)
+{
+    int socket = dfs_net_getsocket(s);
+
+    return sal_recvmsg(socket, message, flags);
+}
+RTM_EXPORT(recvmsg);
+
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+    int result;
+    struct dfs_fd *d;
+    int socket = dfs_net_getsocket(out_fd);
+
+    d = fd_get(in_fd);
+    if (d == NULL)
+    {
+        rt_set_errno(-EBADF);
+
+        return -1;
+    }
+
+    result = sal_sendfile(socket, d, offset, count);
+
+    fd_put(d);
+
+    return result;
+}
+RTM_EXPORT(sendfile);
+
 int socket(int domain, int type, int protocol)
 {
     /* create a BSD socket */
@@ -268,6 +309,9 @@ int closesocket(int s)
         return -1;
     }
 
+    /* the wait queue of the socket goes away with it */
+    dfs_epoll_fd_release(d);
+
     if (sal_closesocket(socket) == 0)
     {
         error = 0;
@@ -7,6 +7,9 @@
  * Date           Author       Notes
  * 2018-05-23     ChenYong     First version
  * 2018-11-12     ChenYong     Add TLS support
+ * 2019-08-05     RT-Thread    Add sal_sendmsg/sal_recvmsg.
+ * 2019-08-15     RT-Thread    Add sal_sendfile.
+ * 2019-10-26     RT-Thread    Set errno on the errors of sendmsg/recvmsg/sendfile.
  */
 
 #include <rtthread.h>
@@ -34,6 +37,11 @@
 
 #define SOCKET_TABLE_STEP_LEN          4
 
+/* the bounce buffer size of sal_sendfile when the file can't be sent in place */
+#ifndef SAL_SENDFILE_CHUNK_SIZE
+#define SAL_SENDFILE_CHUNK_SIZE        1024
+#endif
+
 /* the socket table used to dynamic allocate sockets */
 struct sal_socket_table
 {
@@ -850,6 +858,291 @@ int sal_sendto(int socket, const void *dataptr, size_t size, int flags,
 #endif
 }
 
+static size_t sal_msg_length(const struct msghdr *message)
+{
+    int index;
+    size_t len = 0;
+
+    for (index = 0; index < message->msg_iovlen; index++)
+    {
+        len += message->msg_iov[index].iov_len;
+    }
+
+    return len;
+}
+
+/* the socket of sendmsg/recvmsg/sendfile, errno is set when it's not usable */
+static struct sal_socket *sal_vector_socket(int socket)
+{
+    struct sal_socket *sock;
+
+    sock = sal_get_socket(socket);
+    if (sock == RT_NULL)
+    {
+        rt_set_errno(-EBADF);
+        return RT_NULL;
+    }
+
+    if (!netdev_is_up(sock->netdev))
+    {
+        rt_set_errno(-ENETDOWN);
+        return RT_NULL;
+    }
+
+    return sock;
+}
+
+int sal_sendmsg(int socket, const struct msghdr *message, int flags)
+{
+    int index, result;
+    size_t len, offset = 0;
+    uint8_t *buf;
+    struct sal_socket *sock;
+    struct sal_proto_family *pf;
+
+    if (message == RT_NULL || (message->msg_iovlen > 0 && message->msg_iov == RT_NULL))
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+
+    if ((sock = sal_vector_socket(socket)) == RT_NULL)
+    {
+        return -1;
+    }
+
+    pf = (struct sal_proto_family *) sock->netdev->sal_user_data;
+#ifdef SAL_USING_TLS
+    if (pf->skt_ops->sendmsg && !SAL_SOCKOPS_PROTO_TLS_VALID(sock, send))
+#else
+    if (pf->skt_ops->sendmsg)
+#endif
+    {
+        return pf->skt_ops->sendmsg((int) sock->user_data, message, flags);
+    }
+
+    if (message->msg_iovlen == 1)
+    {
+        return sal_sendto(socket, message->msg_iov[0].iov_base, message->msg_iov[0].iov_len,
+                flags, (const struct sockaddr *) message->msg_name, message->msg_namelen);
+    }
+
+    /* gather into one buffer, so a datagram is still sent as one message */
+    len = sal_msg_length(message);
+    buf = (uint8_t *) rt_malloc(len > 0 ? len : 1);
+    if (buf == RT_NULL)
+    {
+        rt_set_errno(-ENOMEM);
+        return -1;
+    }
+
+    for (index = 0; index < message->msg_iovlen; index++)
+    {
+        rt_memcpy(buf + offset, message->msg_iov[index].iov_base, message->msg_iov[index].iov_len);
+        offset += message->msg_iov[index].iov_len;
+    }
+
+    result = sal_sendto(socket, buf, len, flags,
+            (const struct sockaddr *) message->msg_name, message->msg_namelen);
+    rt_free(buf);
+
+    return result;
+}
+
+int sal_recvmsg(int socket, struct msghdr *message, int flags)
+{
+    int index, result;
+    size_t len, offset = 0, size;
+    uint8_t *buf;
+    struct sal_socket *sock;
+    struct sal_proto_family *pf;
+
+    if (message == RT_NULL || (message->msg_iovlen > 0 && message->msg_iov == RT_NULL))
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+
+    if ((sock = sal_vector_socket(socket)) == RT_NULL)
+    {
+        return -1;
+    }
+
+    pf = (struct sal_proto_family *) sock->netdev->sal_user_data;
+#ifdef SAL_USING_TLS
+    if (pf->skt_ops->recvmsg && !SAL_SOCKOPS_PROTO_TLS_VALID(sock, recv))
+#else
+    if (pf->skt_ops->recvmsg)
+#endif
+    {
+        return pf->skt_ops->recvmsg((int) sock->user_data, message, flags);
+    }
+
+    message->msg_flags = 0;
+    if (message->msg_iovlen == 1)
+    {
+        return sal_recvfrom(socket, message->msg_iov[0].iov_base, message->msg_iov[0].iov_len,
+                flags, (struct sockaddr *) message->msg_name, &message->msg_namelen);
+    }
+
+    len = sal_msg_length(message);
+    buf = (uint8_t *) rt_malloc(len > 0 ? len : 1);
+    if (buf == RT_NULL)
+    {
+        rt_set_errno(-ENOMEM);
+        return -1;
+    }
+
+    result = sal_recvfrom(socket, buf, len, flags,
+            (struct sockaddr *) message->msg_name, &message->msg_namelen);
+
+    /* scatter the received data into the vector */
+    for (index = 0; result > 0 && index < message->msg_iovlen && offset < (size_t) result; index++)
+    {
+        size = message->msg_iov[index].iov_len;
+        if (size > (size_t) result - offset)
+        {
+            size = (size_t) result - offset;
+        }
+        rt_memcpy(message->msg_iov[index].iov_base, buf + offset, size);
+        offset += size;
+    }
+    rt_free(buf);
+
+    return result;
+}
+
+#ifdef SAL_USING_POSIX
+/**
+ * This function will send the data of a file to a socket. The data of the
+ * files stored in place (RT_FIOGETADDR) is passed to the stream sockets
+ * without copying when the protocol supports it, otherwise it is copied
+ * through a bounce buffer in chunks.
+ *
+ * @param socket the SAL socket descriptor
+ * @param file the file to be sent
+ * @param offset the file offset to start from and returns the offset after
+ *        the last sent byte, the file position is used and updated when it
+ *        is RT_NULL.
+ * @param count the number of bytes to be sent
+ *
+ * @return the number of bytes sent, -1 on failed
+ */
+int sal_sendfile(int socket, struct dfs_fd *file, off_t *offset, size_t count)
+{
+    int result = 0;
+    size_t total = 0;
+    off_t start;
+    rt_ubase_t addr;
+    uint8_t *buf;
+    struct sal_socket *sock;
+    struct sal_proto_family *pf;
+
+    if (file == RT_NULL || file->type != FT_REGULAR)
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+
+    if ((sock = sal_vector_socket(socket)) == RT_NULL)
+    {
+        return -1;
+    }
+
+    start = offset ? *offset : file->pos;
+    if (start < 0)
+    {
+        rt_set_errno(-EINVAL);
+        return -1;
+    }
+    if ((size_t)start >= file->size)
+    {
+        return 0;
+    }
+    if (count > file->size - start)
+    {
+        count = file->size - start;
+    }
+
+    pf = (struct sal_proto_family *) sock->netdev->sal_user_data;
+#ifdef SAL_USING_TLS
+    if (pf->skt_ops->sendref && sock->type == SOCK_STREAM && !SAL_SOCKOPS_PROTO_TLS_VALID(sock, send) &&
+#else
+    if (pf->skt_ops->sendref && sock->type == SOCK_STREAM &&
+#endif
+        dfs_file_ioctl(file, RT_FIOGETADDR, &addr) == 0)
+    {
+        /* zero copy, the file data is referenced by the protocol stack */
+        result = pf->skt_ops->sendref((int) sock->user_data, (const void *)(addr + start), count, 0);
+        if (result > 0)
+        {
+            total = result;
+        }
+    }
+    else
+    {
+        buf = (uint8_t *) rt_malloc(count < SAL_SENDFILE_CHUNK_SIZE ? count : SAL_SENDFILE_CHUNK_SIZE);
+        if (buf == RT_NULL)
+        {
+            rt_set_errno(-ENOMEM);
+            return -1;
+        }
+
+        while (total < count)
+        {
+            size_t length = count - total;
+
+            if (length > SAL_SENDFILE_CHUNK_SIZE)
+            {
+                length = SAL_SENDFILE_CHUNK_SIZE;
+            }
+
+            result = dfs_file_pread(file, buf, length, start + total);
+            if (result <= 0)
+            {
+                /* the sends below set errno themselves */
+                if (result < 0)
+                {
+                    rt_set_errno(result);
+                }
+                break;
+            }
+            length = result;
+
+            result = sal_sendto(socket, buf, length, 0, RT_NULL, 0);
+            if (result <= 0)
+            {
+                break;
+            }
+            total += result;
+
+            /* the socket buffer is full */
+            if ((size_t)result < length)
+            {
+                break;
+            }
+        }
+        rt_free(buf);
+    }
+
+    if (offset)
+    {
+        *offset = start + total;
+    }
+    else
+    {
+        dfs_file_lseek(file, start + total);
+    }
+
+    if (total == 0 && result < 0)
+    {
+        return -1;
+    }
+
+    return total;
+}
+#endif /* SAL_USING_POSIX */
+
 int sal_socket(int domain, int type, int protocol)
 {
     int retval;
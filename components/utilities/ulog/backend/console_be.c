@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-09-04     armink       the first version
+ * 2019-08-26     RT-Thread    output the binary log frame as it is
  */
 
 #include <rthw.h>
@@ -33,7 +34,12 @@ void ulog_console_backend_output(struct ulog_backend *backend, rt_uint32_t level
     {
         rt_uint16_t old_flag = dev->open_flag;
 
+#ifdef ULOG_BINARY_HOST_FORMAT
+        /* the binary log frame must not be changed by the stream mode */
+        dev->open_flag &= ~RT_DEVICE_FLAG_STREAM;
+#else
         dev->open_flag |= RT_DEVICE_FLAG_STREAM;
+#endif
         rt_device_write(dev, 0, log, len);
         dev->open_flag = old_flag;
     }
@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-05     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    write the file without the locker
+ * 2019-10-28     RT-Thread    check the rotation after the file is opened
+ * 2019-10-28     RT-Thread    wait for the running sync work on deinit
+ */
+
+#include <rthw.h>
+#include <ulog.h>
+
+#ifdef ULOG_BACKEND_USING_FILE
+
+#include <dfs_posix.h>
+#ifdef RT_USING_SYSTEM_WORKQUEUE
+#include <ipc/workqueue.h>
+#endif
+
+/* the batched records are written in blocks of the size, it's the sector size of most file systems */
+#define FILE_BE_BLOCK_SIZE             512
+
+#if ULOG_FILE_BE_BUF_SIZE < FILE_BE_BLOCK_SIZE || ULOG_FILE_BE_BUF_SIZE % FILE_BE_BLOCK_SIZE
+#error "The buffer size of file backend (ULOG_FILE_BE_BUF_SIZE) must be a multiple of 512"
+#endif
+
+#if ULOG_FILE_BE_MAX_FILES < 1
+#error "The file backend must have one log file at least (ULOG_FILE_BE_MAX_FILES)"
+#endif
+
+/* the flags of file_be_flush() */
+#define FILE_BE_ROTATE                 0x01
+#define FILE_BE_SYNC                   0x02
+
+struct ulog_file_be
+{
+    struct ulog_backend parent;
+    struct rt_mutex locker;
+    /* the thread which is writing the file without the locker, its logs are dropped */
+    rt_thread_t writer;
+    int fd;
+    /* the size of log file, the data in buffer is not included */
+    rt_size_t file_size;
+    /* the written data is not synced */
+    rt_bool_t dirty;
+    /* a sync is requested while the file is being written */
+    rt_bool_t sync_request;
+    rt_tick_t sync_tick;
+#ifdef RT_USING_SYSTEM_WORKQUEUE
+    struct rt_delayed_work sync_work;
+    rt_bool_t sync_pending;
+#endif
+    /* the logs are copied into one buffer while the other one is written */
+    rt_uint32_t *buf;
+    rt_size_t buf_len;
+    rt_uint32_t bufs[2][ULOG_FILE_BE_BUF_SIZE / sizeof(rt_uint32_t)];
+};
+
+static struct ulog_file_be file_be;
+
+static rt_bool_t file_be_open(struct ulog_file_be *be)
+{
+    off_t size;
+
+    if (be->fd >= 0)
+        return RT_TRUE;
+
+    be->fd = open(ULOG_FILE_BE_PATH, O_WRONLY | O_CREAT | O_APPEND, 0);
+    if (be->fd < 0)
+        return RT_FALSE;
+
+    size = lseek(be->fd, 0, SEEK_END);
+    be->file_size = size > 0 ? size : 0;
+
+    return RT_TRUE;
+}
+
+static void file_be_close(struct ulog_file_be *be)
+{
+    if (be->fd >= 0)
+    {
+        close(be->fd);
+        be->fd = -1;
+    }
+    be->dirty = RT_FALSE;
+}
+
+/* ulog.log -> ulog.log.1 -> ... -> ulog.log.(ULOG_FILE_BE_MAX_FILES - 1) */
+static void file_be_rotate(struct ulog_file_be *be)
+{
+    char src[sizeof(ULOG_FILE_BE_PATH) + 4], dst[sizeof(ULOG_FILE_BE_PATH) + 4];
+    int i;
+
+    file_be_close(be);
+
+    for (i = ULOG_FILE_BE_MAX_FILES - 1; i > 0; i--)
+    {
+        if (i == 1)
+            rt_strncpy(src, ULOG_FILE_BE_PATH, sizeof(src));
+        else
+            rt_snprintf(src, sizeof(src), "%s.%d", ULOG_FILE_BE_PATH, i - 1);
+        rt_snprintf(dst, sizeof(dst), "%s.%d", ULOG_FILE_BE_PATH, i);
+
+        /* the target must not exist on some file systems */
+        unlink(dst);
+        rename(src, dst);
+    }
+
+    if (ULOG_FILE_BE_MAX_FILES == 1)
+    {
+        unlink(ULOG_FILE_BE_PATH);
+    }
+
+    file_be_open(be);
+}
+
+/* write data to file, the data is dropped when the file is not ready */
+static void file_be_write(struct ulog_file_be *be, const char *buf, rt_size_t len)
+{
+    int result;
+
+    if (len == 0)
+        return;
+
+    if (be->fd < 0)
+    {
+        if (!file_be_open(be))
+            return;
+
+        /* the size of file is unknown to the rotation check of output until it's opened */
+        if (be->file_size > 0 && be->file_size + len > ULOG_FILE_BE_MAX_SIZE)
+        {
+            file_be_rotate(be);
+            if (be->fd < 0)
+                return;
+        }
+    }
+
+    while (len)
+    {
+        result = write(be->fd, buf, len);
+        if (result <= 0)
+        {
+            /* try to reopen the file on next writing */
+            file_be_close(be);
+            return;
+        }
+
+        be->file_size += result;
+        be->dirty = RT_TRUE;
+        buf += result;
+        len -= result;
+    }
+}
+
+/*
+ * write the first len bytes of buffer to file, the rest is moved to the other
+ * buffer. It's called with the locker taken and no writer, the locker is
+ * released while writing, so the logs of the file system itself never wait
+ * for it against a thread which holds the lock of ulog.
+ */
+static void file_be_flush(struct ulog_file_be *be, rt_size_t len, int flags)
+{
+    rt_uint32_t *buf;
+
+    be->writer = rt_thread_self();
+
+    while (1)
+    {
+        /* swap the buffers */
+        buf = be->buf;
+        be->buf = (buf == be->bufs[0]) ? be->bufs[1] : be->bufs[0];
+        be->buf_len -= len;
+        rt_memcpy(be->buf, (char *)buf + len, be->buf_len);
+
+        rt_mutex_release(&be->locker);
+
+        file_be_write(be, (const char *)buf, len);
+        if (flags & FILE_BE_ROTATE)
+        {
+            file_be_rotate(be);
+        }
+        if ((flags & FILE_BE_SYNC) && be->dirty)
+        {
+            fsync(be->fd);
+            be->dirty = RT_FALSE;
+        }
+
+        rt_mutex_take(&be->locker, RT_WAITING_FOREVER);
+
+        if (flags & FILE_BE_SYNC)
+        {
+            be->sync_tick = rt_tick_get();
+        }
+
+        if (!be->sync_request)
+            break;
+
+        /* requested by the flush while the file is being written */
+        be->sync_request = RT_FALSE;
+        len = be->buf_len;
+        flags = FILE_BE_SYNC;
+    }
+
+    be->writer = RT_NULL;
+}
+
+/* write all data in buffer and sync the file, the locker must be taken */
+static void file_be_sync(struct ulog_file_be *be)
+{
+    if (be->writer == RT_NULL)
+        file_be_flush(be, be->buf_len, FILE_BE_SYNC);
+    else
+        be->sync_request = RT_TRUE;
+}
+
+#ifdef RT_USING_SYSTEM_WORKQUEUE
+static void file_be_sync_work(struct rt_work *work, void *work_data)
+{
+    struct ulog_file_be *be = (struct ulog_file_be *)work_data;
+
+    rt_mutex_take(&be->locker, RT_WAITING_FOREVER);
+    be->sync_pending = RT_FALSE;
+    file_be_sync(be);
+    rt_mutex_release(&be->locker);
+}
+#endif /* RT_USING_SYSTEM_WORKQUEUE */
+
+static void ulog_file_backend_output(struct ulog_backend *backend, rt_uint32_t level, const char *tag,
+        rt_bool_t is_raw, const char *log, size_t len)
+{
+    struct ulog_file_be *be = (struct ulog_file_be *)backend;
+    rt_size_t copy_len;
+
+    /* the file can't be written in interrupt, and the logs of file system itself are dropped */
+    if (rt_interrupt_get_nest() != 0 || be->writer == rt_thread_self())
+        return;
+
+    rt_mutex_take(&be->locker, RT_WAITING_FOREVER);
+
+    /* the file is rotated by whole records */
+    if (be->writer == RT_NULL && be->file_size + be->buf_len + len > ULOG_FILE_BE_MAX_SIZE &&
+        be->file_size + be->buf_len > 0)
+    {
+        file_be_flush(be, be->buf_len, FILE_BE_ROTATE);
+    }
+
+    while (len)
+    {
+        copy_len = sizeof(be->bufs[0]) - be->buf_len;
+        if (copy_len > len)
+            copy_len = len;
+
+        /* the buffer is full while the other one is being written, the rest is dropped */
+        if (copy_len == 0)
+            break;
+
+        rt_memcpy((char *)be->buf + be->buf_len, log, copy_len);
+        be->buf_len += copy_len;
+        log += copy_len;
+        len -= copy_len;
+
+        if (be->buf_len == sizeof(be->bufs[0]) && be->writer == RT_NULL)
+        {
+            /* write until the end of the last whole block in file, the rest is kept */
+            file_be_flush(be, ((be->file_size + be->buf_len) & ~(FILE_BE_BLOCK_SIZE - 1)) - be->file_size, 0);
+        }
+    }
+
+    if (be->writer == RT_NULL &&
+        rt_tick_get() - be->sync_tick >= rt_tick_from_millisecond(ULOG_FILE_BE_SYNC_PERIOD))
+    {
+        file_be_flush(be, be->buf_len, FILE_BE_SYNC);
+    }
+#ifdef RT_USING_SYSTEM_WORKQUEUE
+    else if (!be->sync_pending)
+    {
+        /* sync the file when there are no more logs */
+        be->sync_pending = RT_TRUE;
+        if (rt_work_submit(&be->sync_work.work, rt_tick_from_millisecond(ULOG_FILE_BE_SYNC_PERIOD)) != RT_EOK)
+        {
+            be->sync_pending = RT_FALSE;
+        }
+    }
+#endif
+
+    rt_mutex_release(&be->locker);
+}
+
+static void ulog_file_backend_flush(struct ulog_backend *backend)
+{
+    struct ulog_file_be *be = (struct ulog_file_be *)backend;
+
+    if (rt_interrupt_get_nest() != 0 || be->writer == rt_thread_self())
+        return;
+
+    rt_mutex_take(&be->locker, RT_WAITING_FOREVER);
+    file_be_sync(be);
+    rt_mutex_release(&be->locker);
+}
+
+static void ulog_file_backend_deinit(struct ulog_backend *backend)
+{
+    struct ulog_file_be *be = (struct ulog_file_be *)backend;
+
+#ifdef RT_USING_SYSTEM_WORKQUEUE
+    /* the running sync work takes the locker, it's waited without the locker */
+    rt_workqueue_cancel_work_sync(rt_work_sys_workqueue(), &be->sync_work.work);
+#endif
+    rt_mutex_take(&be->locker, RT_WAITING_FOREVER);
+#ifdef RT_USING_SYSTEM_WORKQUEUE
+    be->sync_pending = RT_FALSE;
+#endif
+    /* wait for the writer without the locker */
+    while (be->writer != RT_NULL)
+    {
+        rt_mutex_release(&be->locker);
+        rt_thread_mdelay(1);
+        rt_mutex_take(&be->locker, RT_WAITING_FOREVER);
+    }
+    file_be_sync(be);
+    file_be_close(be);
+    rt_mutex_release(&be->locker);
+}
+
+/**
+ * The log file is opened on the first output, so the backend can be
+ * registered before the file system is mounted. The logs before it are
+ * buffered until the buffer is full.
+ */
+int ulog_file_backend_init(void)
+{
+    ulog_init();
+
+    rt_mutex_init(&file_be.locker, "ulog_fbe", RT_IPC_FLAG_FIFO);
+    file_be.fd = -1;
+    file_be.buf = file_be.bufs[0];
+    file_be.sync_tick = rt_tick_get();
+#ifdef RT_USING_SYSTEM_WORKQUEUE
+    rt_delayed_work_init(&file_be.sync_work, file_be_sync_work, &file_be);
+#endif
+
+    file_be.parent.output = ulog_file_backend_output;
+    file_be.parent.flush = ulog_file_backend_flush;
+    file_be.parent.deinit = ulog_file_backend_deinit;
+
+    ulog_backend_register(&file_be.parent, "file", RT_FALSE);
+
+    return 0;
+}
+INIT_PREV_EXPORT(ulog_file_backend_init);
+
+#endif /* ULOG_BACKEND_USING_FILE */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-05     RT-Thread    the first version
+ */
+
+#include <rthw.h>
+#include <ulog.h>
+
+#ifdef ULOG_BACKEND_USING_RAM
+
+/* "ULOG" */
+#define RAM_BE_MAGIC                   0x554C4F47
+
+/*
+ * The ring is placed in the .noinit section which is not cleared by the
+ * startup code, so the logs before a warm reset (such as the watchdog or a
+ * fault) can be read after it. The linker script must have the section.
+ */
+struct ulog_ram_ring
+{
+    rt_uint32_t magic;
+    rt_uint32_t size;
+    /* the position of next writing */
+    rt_uint32_t index;
+    /* the ring has been wrapped */
+    rt_uint32_t full;
+    /* check word of the above fields */
+    rt_uint32_t check;
+    char buf[ULOG_RAM_BE_BUF_SIZE];
+};
+
+static struct ulog_ram_ring ram_ring SECTION(".noinit");
+static struct ulog_backend ram_be;
+
+#define RAM_RING_CHECK(ring)           ((ring)->magic ^ (ring)->size ^ (ring)->index ^ (ring)->full ^ 0xFFFFFFFF)
+
+static void ram_ring_put(struct ulog_ram_ring *ring, const char *log, rt_size_t len)
+{
+    rt_size_t copy_len;
+
+    /* only keep the last part of log */
+    if (len > ring->size)
+    {
+        log += len - ring->size;
+        len = ring->size;
+    }
+
+    while (len)
+    {
+        copy_len = ring->size - ring->index;
+        if (copy_len > len)
+            copy_len = len;
+
+        rt_memcpy(ring->buf + ring->index, log, copy_len);
+        ring->index += copy_len;
+        log += copy_len;
+        len -= copy_len;
+
+        if (ring->index == ring->size)
+        {
+            ring->index = 0;
+            ring->full = 1;
+        }
+    }
+    ring->check = RAM_RING_CHECK(ring);
+}
+
+static void ulog_ram_backend_output(struct ulog_backend *backend, rt_uint32_t level, const char *tag,
+        rt_bool_t is_raw, const char *log, size_t len)
+{
+    rt_base_t irq_level;
+
+    /* it can be used in interrupt and keeps the ring valid on any reset */
+    irq_level = rt_hw_interrupt_disable();
+    ram_ring_put(&ram_ring, log, len);
+    rt_hw_interrupt_enable(irq_level);
+}
+
+/**
+ * read the logs in RAM ring backend, the oldest log is at the position 0
+ *
+ * @param pos the position of logs
+ * @param buf the buffer
+ * @param size the buffer size
+ *
+ * @return the read size, 0 is the end
+ */
+rt_size_t ulog_ram_backend_read(rt_size_t pos, void *buf, rt_size_t size)
+{
+    rt_base_t level;
+    rt_size_t len, start, copy_len, read_len = 0;
+
+    level = rt_hw_interrupt_disable();
+
+    len = ram_ring.full ? ram_ring.size : ram_ring.index;
+    start = ram_ring.full ? ram_ring.index : 0;
+    if (pos >= len)
+    {
+        rt_hw_interrupt_enable(level);
+        return 0;
+    }
+    if (size > len - pos)
+        size = len - pos;
+
+    pos = (start + pos) % ram_ring.size;
+    while (read_len < size)
+    {
+        copy_len = ram_ring.size - pos;
+        if (copy_len > size - read_len)
+            copy_len = size - read_len;
+
+        rt_memcpy((char *)buf + read_len, ram_ring.buf + pos, copy_len);
+        read_len += copy_len;
+        pos = 0;
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    return read_len;
+}
+
+/**
+ * clean all logs in RAM ring backend
+ */
+void ulog_ram_backend_clean(void)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    ram_ring.magic = RAM_BE_MAGIC;
+    ram_ring.size = sizeof(ram_ring.buf);
+    ram_ring.index = 0;
+    ram_ring.full = 0;
+    ram_ring.check = RAM_RING_CHECK(&ram_ring);
+    rt_hw_interrupt_enable(level);
+}
+
+int ulog_ram_backend_init(void)
+{
+    ulog_init();
+
+    if (ram_ring.magic != RAM_BE_MAGIC || ram_ring.size != sizeof(ram_ring.buf)
+            || ram_ring.index >= ram_ring.size || ram_ring.check != RAM_RING_CHECK(&ram_ring))
+    {
+        /* power on reset, or the section is cleared */
+        ulog_ram_backend_clean();
+    }
+    else
+    {
+        /* the logs before it are kept */
+        ram_ring_put(&ram_ring, ULOG_NEWLINE_SIGN "--- reset ---" ULOG_NEWLINE_SIGN,
+                sizeof(ULOG_NEWLINE_SIGN "--- reset ---" ULOG_NEWLINE_SIGN) - 1);
+    }
+
+    ram_be.output = ulog_ram_backend_output;
+
+    ulog_backend_register(&ram_be, "ram", RT_FALSE);
+
+    return 0;
+}
+INIT_PREV_EXPORT(ulog_ram_backend_init);
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+
+static void ulog_ram(uint8_t argc, char **argv)
+{
+    char buf[64];
+    rt_size_t pos = 0, len;
+
+    if (argc > 1 && !rt_strcmp(argv[1], "-c"))
+    {
+        ulog_ram_backend_clean();
+        return;
+    }
+
+    while ((len = ulog_ram_backend_read(pos, buf, sizeof(buf) - 1)) > 0)
+    {
+        buf[len] = '\0';
+        rt_kprintf("%s", buf);
+        pos += len;
+    }
+}
+MSH_CMD_EXPORT(ulog_ram, Show the logs in RAM ring backend. Clean them by '-c'.);
+#endif /* RT_USING_FINSH */
+
+#endif /* ULOG_BACKEND_USING_RAM */
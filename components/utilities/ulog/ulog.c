@@ -6,6 +6,10 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-08-25     armink       the first version
+ * 2019-08-26     RT-Thread    add binary log mode
+ * 2019-10-26     RT-Thread    copy the tag into the async frame
+ * 2019-08-29     RT-Thread    line buffer for every priority band
+ * 2019-09-02     RT-Thread    cache the filter result on every callsite
  */
 
 #include <stdarg.h>
@@ -26,14 +30,20 @@
 
 #ifdef ULOG_USING_ASYNC_OUTPUT
 #include <rtdevice.h>
+#include <rtatomic.h>
 #endif
 
 #ifdef RT_USING_ULOG
 
 /* the number which is max stored line logs */
 #ifndef ULOG_ASYNC_OUTPUT_STORE_LINES
+#ifdef ULOG_USING_BINARY
+/* the binary log frame is much smaller than a line */
+#define ULOG_ASYNC_OUTPUT_STORE_LINES  (ULOG_ASYNC_OUTPUT_BUF_SIZE / 32)
+#else
 #define ULOG_ASYNC_OUTPUT_STORE_LINES  (ULOG_ASYNC_OUTPUT_BUF_SIZE * 3 / 2 / ULOG_LINE_BUF_SIZE)
 #endif
+#endif
 
 #ifdef ULOG_USING_COLOR
 /**
@@ -74,14 +84,33 @@
 #error "the log line buffer size must more than 80"
 #endif
 
+#if defined(ULOG_USING_BINARY) && !defined(ULOG_USING_ASYNC_OUTPUT)
+#error "the binary log mode must using async output mode (ULOG_USING_ASYNC_OUTPUT)"
+#endif
+
+#ifndef ULOG_BINARY_ARGS_MAX_SIZE
+#define ULOG_BINARY_ARGS_MAX_SIZE      64
+#endif
+
+#ifndef ULOG_LINE_BUF_BANDS
+#define ULOG_LINE_BUF_BANDS            1
+#endif
+
+/* the line buffer band of thread, the priority inheritance doesn't change the init priority */
+#define ULOG_LINE_BUF_BAND(thread)     ((thread)->init_priority * ULOG_LINE_BUF_BANDS / RT_THREAD_PRIORITY_MAX)
+
 struct rt_ulog
 {
     rt_bool_t init_ok;
     struct rt_mutex output_locker;
     /* all backends */
     rt_slist_t backend_list;
-    /* the thread log's line buffer */
-    char log_buf_th[ULOG_LINE_BUF_SIZE];
+    /* the thread log's line buffers sharded by priority band, every shard has its own mutex */
+    struct
+    {
+        struct rt_mutex locker;
+        char log_buf[ULOG_LINE_BUF_SIZE];
+    } band[ULOG_LINE_BUF_BANDS];
 
 #ifdef ULOG_USING_ISR_LOG
     /* the ISR log's line buffer */
@@ -211,16 +240,21 @@ static void output_lock(void)
     }
 }
 
-static char *get_log_buf(void)
+/* lock and get the line buffer of current context */
+static char *log_buf_lock(void)
 {
     /* is in thread context */
     if (rt_interrupt_get_nest() == 0)
     {
-        return ulog.log_buf_th;
+        int band = ULOG_LINE_BUF_BAND(rt_thread_self());
+
+        rt_mutex_take(&ulog.band[band].locker, RT_WAITING_FOREVER);
+        return ulog.band[band].log_buf;
     }
     else
     {
 #ifdef ULOG_USING_ISR_LOG
+        ulog.output_locker_isr_lvl = rt_hw_interrupt_disable();
         return ulog.log_buf_isr;
 #else
         rt_kprintf("Error: Current mode not supported run in ISR. Please enable ULOG_USING_ISR_LOG.\n");
@@ -229,12 +263,27 @@ static char *get_log_buf(void)
     }
 }
 
+static void log_buf_unlock(void)
+{
+    /* is in thread context */
+    if (rt_interrupt_get_nest() == 0)
+    {
+        rt_mutex_release(&ulog.band[ULOG_LINE_BUF_BAND(rt_thread_self())].locker);
+    }
+    else
+    {
+#ifdef ULOG_USING_ISR_LOG
+        rt_hw_interrupt_enable(ulog.output_locker_isr_lvl);
+#endif
+    }
+}
+
 RT_WEAK rt_size_t ulog_formater(char *log_buf, rt_uint32_t level, const char *tag, rt_bool_t newline,
         const char *format, va_list args)
 {
-    /* the caller has locker, so it can use static variable for reduce stack usage */
-    static rt_size_t log_len, newline_len;
-    static int fmt_result;
+    /* the line buffers of different priority band are formatted at the same time */
+    rt_size_t log_len, newline_len;
+    int fmt_result;
 
     RT_ASSERT(log_buf);
     RT_ASSERT(level <= LOG_LVL_DBG);
@@ -257,8 +306,8 @@ RT_WEAK rt_size_t ulog_formater(char *log_buf, rt_uint32_t level, const char *ta
     /* add time info */
     {
 #ifdef ULOG_TIME_USING_TIMESTAMP
-        static time_t now;
-        static struct tm *tm, tm_tmp;
+        time_t now;
+        struct tm *tm, tm_tmp;
 
         now = time(NULL);
         tm = gmtime_r(&now, &tm_tmp);
@@ -272,7 +321,7 @@ RT_WEAK rt_size_t ulog_formater(char *log_buf, rt_uint32_t level, const char *ta
 #endif /* RT_USING_SOFT_RTC */
 
 #else
-        static rt_size_t tick_len = 0;
+        rt_size_t tick_len = 0;
 
         log_buf[log_len] = '[';
         tick_len = ulog_ultoa(log_buf + log_len + 1, rt_tick_get());
@@ -417,14 +466,43 @@ void ulog_output_to_all_backend(rt_uint32_t level, const char *tag, rt_bool_t is
     }
 }
 
-static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, const char *log_buf, rt_size_t log_len)
+#ifdef ULOG_USING_ASYNC_OUTPUT
+/* the length of tag which is copied into the async frame, the raw log has no tag */
+static rt_size_t ulog_tag_len(const char *tag)
+{
+    rt_size_t len;
+
+    if (tag == RT_NULL)
+        return 0;
+
+    len = rt_strlen(tag);
+
+    return len > ULOG_FILTER_TAG_MAX_LEN ? ULOG_FILTER_TAG_MAX_LEN : len;
+}
+
+static const char *ulog_tag_copy(char *buf, const char *tag, rt_size_t len)
+{
+    if (tag == RT_NULL)
+        return RT_NULL;
+
+    rt_memcpy(buf, tag, len);
+    buf[len] = '\0';
+
+    return buf;
+}
+#endif /* ULOG_USING_ASYNC_OUTPUT */
+
+static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, const char *log_buf,
+        rt_size_t log_len)
 {
 #ifdef ULOG_USING_ASYNC_OUTPUT
     rt_rbb_blk_t log_blk;
     ulog_frame_t log_frame;
+    rt_size_t tag_len = ulog_tag_len(tag);
 
     /* allocate log frame */
-    log_blk = rt_rbb_blk_alloc(ulog.async_rbb, RT_ALIGN(sizeof(struct ulog_frame) + log_len, RT_ALIGN_SIZE));
+    log_blk = rt_rbb_blk_alloc(ulog.async_rbb,
+            RT_ALIGN(sizeof(struct ulog_frame) + log_len + tag_len + 1, RT_ALIGN_SIZE));
     if (log_blk)
     {
         /* package the log frame */
@@ -433,10 +511,11 @@ static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, cons
         log_frame->is_raw = is_raw;
         log_frame->level = level;
         log_frame->log_len = log_len;
-        log_frame->tag = tag;
         log_frame->log = (const char *)log_blk->buf + sizeof(struct ulog_frame);
         /* copy log data */
         rt_memcpy(log_blk->buf + sizeof(struct ulog_frame), log_buf, log_len);
+        /* copy tag, the tag of caller may be built at runtime */
+        log_frame->tag = ulog_tag_copy((char *)log_blk->buf + sizeof(struct ulog_frame) + log_len, tag, tag_len);
         /* put the block */
         rt_rbb_blk_put(log_blk);
         /* send a notice */
@@ -456,8 +535,11 @@ static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, cons
     /* is in thread context */
     if (rt_interrupt_get_nest() == 0)
     {
+        /* the line is formatted without this lock, only the backends are serialized */
+        output_lock();
         /* output to all backends */
         ulog_output_to_all_backend(level, tag, is_raw, log_buf, log_len);
+        output_unlock();
     }
     else
     {
@@ -472,6 +554,508 @@ static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, cons
 #endif /* ULOG_USING_ASYNC_OUTPUT */
 }
 
+#ifdef ULOG_USING_BINARY
+/* the argument type of a conversion specification */
+enum ulog_bin_arg
+{
+    ULOG_BIN_ARG_NONE,
+    ULOG_BIN_ARG_INT,
+    ULOG_BIN_ARG_LONG,
+    ULOG_BIN_ARG_LLONG,
+    ULOG_BIN_ARG_PTR,
+    ULOG_BIN_ARG_DOUBLE,
+    ULOG_BIN_ARG_STR,
+};
+
+/**
+ * parse a conversion specification of the format string
+ *
+ * @param fmt the position after '%'
+ * @param type the argument type
+ * @param stars the number of '*' in width and precision, they are int arguments
+ *
+ * @return the position after the conversion specification
+ */
+static const char *ulog_bin_parse_spec(const char *fmt, int *type, int *stars)
+{
+    int qualifier = 0;
+
+    *stars = 0;
+
+    /* flags */
+    while (*fmt == '-' || *fmt == '+' || *fmt == ' ' || *fmt == '#' || *fmt == '0')
+        fmt++;
+    /* width and precision */
+    while ((*fmt >= '0' && *fmt <= '9') || *fmt == '.' || *fmt == '*')
+    {
+        if (*fmt++ == '*')
+            (*stars)++;
+    }
+    /* qualifier */
+    while (*fmt == 'h' || *fmt == 'l' || *fmt == 'z')
+    {
+        if (*fmt == 'l')
+            qualifier = (qualifier == 'l') ? 'q' : 'l';
+        else if (*fmt == 'z')
+            qualifier = 'z';
+        fmt++;
+    }
+
+    switch (*fmt)
+    {
+    case 'd': case 'i': case 'c':
+    case 'u': case 'x': case 'X': case 'o':
+        if (qualifier == 'l')
+            *type = ULOG_BIN_ARG_LONG;
+        else if (qualifier == 'q')
+            *type = ULOG_BIN_ARG_LLONG;
+        else if (qualifier == 'z')
+            *type = ULOG_BIN_ARG_PTR;
+        else
+            *type = ULOG_BIN_ARG_INT;
+        break;
+    case 'p':
+        *type = ULOG_BIN_ARG_PTR;
+        break;
+    case 's':
+        *type = ULOG_BIN_ARG_STR;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+        *type = ULOG_BIN_ARG_DOUBLE;
+        break;
+    default:
+        *type = ULOG_BIN_ARG_NONE;
+        break;
+    }
+
+    if (*fmt != '\0')
+        fmt++;
+
+    return fmt;
+}
+
+#define ULOG_BIN_PUT(buf, size, len, value)                             \
+    do                                                                  \
+    {                                                                   \
+        if ((len) + sizeof(value) > (size))                             \
+            return (len);                                               \
+        rt_memcpy((buf) + (len), &(value), sizeof(value));              \
+        (len) += sizeof(value);                                         \
+    } while (0)
+
+/* copy the raw arguments, it stops on the buffer is full */
+static rt_size_t ulog_bin_args_encode(rt_uint8_t *buf, rt_size_t size, const char *format, va_list args)
+{
+    rt_size_t len = 0;
+    int type, stars;
+
+    while (*format != '\0')
+    {
+        if (*format++ != '%')
+            continue;
+
+        format = ulog_bin_parse_spec(format, &type, &stars);
+        for (; stars > 0; stars--)
+        {
+            int star = va_arg(args, int);
+            ULOG_BIN_PUT(buf, size, len, star);
+        }
+
+        switch (type)
+        {
+        case ULOG_BIN_ARG_INT:
+        {
+            int value = va_arg(args, int);
+            ULOG_BIN_PUT(buf, size, len, value);
+            break;
+        }
+        case ULOG_BIN_ARG_LONG:
+        {
+            long value = va_arg(args, long);
+            ULOG_BIN_PUT(buf, size, len, value);
+            break;
+        }
+        case ULOG_BIN_ARG_LLONG:
+        {
+            long long value = va_arg(args, long long);
+            ULOG_BIN_PUT(buf, size, len, value);
+            break;
+        }
+        case ULOG_BIN_ARG_PTR:
+        {
+            void *value = va_arg(args, void *);
+            ULOG_BIN_PUT(buf, size, len, value);
+            break;
+        }
+        case ULOG_BIN_ARG_DOUBLE:
+        {
+            double value = va_arg(args, double);
+            ULOG_BIN_PUT(buf, size, len, value);
+            break;
+        }
+        case ULOG_BIN_ARG_STR:
+        {
+            /* the string may be gone before output, save it as length + string + '\0' */
+            const char *str = va_arg(args, const char *);
+            rt_uint8_t str_len;
+
+            if (str == NULL)
+                str = "(null)";
+            if (len + sizeof(str_len) + 1 > size)
+                return len;
+            if (size - len - sizeof(str_len) - 1 > 255)
+                str_len = rt_strnlen(str, 255);
+            else
+                str_len = rt_strnlen(str, size - len - sizeof(str_len) - 1);
+            buf[len++] = str_len;
+            rt_memcpy(buf + len, str, str_len);
+            len += str_len;
+            buf[len++] = '\0';
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    return len;
+}
+
+#ifndef ULOG_BINARY_HOST_FORMAT
+#define ULOG_BIN_GET(buf, size, pos, value)                             \
+    do                                                                  \
+    {                                                                   \
+        if ((pos) + sizeof(value) > (size))                             \
+            goto __exit;                                                \
+        rt_memcpy(&(value), (buf) + (pos), sizeof(value));              \
+        (pos) += sizeof(value);                                         \
+    } while (0)
+
+#ifdef ULOG_OUTPUT_FLOAT
+#define ulog_bin_snprintf              snprintf
+#else
+#define ulog_bin_snprintf              rt_snprintf
+#endif
+
+/* format the message of binary log by the raw arguments */
+static rt_size_t ulog_bin_args_format(char *log_buf, rt_size_t log_len, const char *format,
+        const rt_uint8_t *args, rt_size_t args_len)
+{
+    rt_size_t pos = 0;
+    char spec[16];
+    int type, stars, fmt_result = 0;
+
+    while (*format != '\0' && log_len < ULOG_LINE_BUF_SIZE)
+    {
+        const char *start = format;
+        rt_size_t spec_len;
+
+        if (*format != '%')
+        {
+            log_buf[log_len++] = *format++;
+            continue;
+        }
+
+        format = ulog_bin_parse_spec(format + 1, &type, &stars);
+        if (format - start >= (int) sizeof(spec))
+            break;
+
+        /* the width and precision from the arguments are filled into the specification */
+        for (spec_len = 0; start < format; start++)
+        {
+            if (*start == '*')
+            {
+                int star;
+
+                ULOG_BIN_GET(args, args_len, pos, star);
+                spec_len += rt_snprintf(spec + spec_len, sizeof(spec) - spec_len, "%d", star);
+                if (spec_len >= sizeof(spec))
+                    goto __exit;
+            }
+            else if (spec_len < sizeof(spec) - 1)
+            {
+                spec[spec_len++] = *start;
+            }
+        }
+        spec[spec_len] = '\0';
+
+        switch (type)
+        {
+        case ULOG_BIN_ARG_INT:
+        {
+            int value;
+            ULOG_BIN_GET(args, args_len, pos, value);
+            fmt_result = ulog_bin_snprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, spec, value);
+            break;
+        }
+        case ULOG_BIN_ARG_LONG:
+        {
+            long value;
+            ULOG_BIN_GET(args, args_len, pos, value);
+            fmt_result = ulog_bin_snprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, spec, value);
+            break;
+        }
+        case ULOG_BIN_ARG_LLONG:
+        {
+            long long value;
+            ULOG_BIN_GET(args, args_len, pos, value);
+            fmt_result = ulog_bin_snprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, spec, value);
+            break;
+        }
+        case ULOG_BIN_ARG_PTR:
+        {
+            void *value;
+            ULOG_BIN_GET(args, args_len, pos, value);
+            fmt_result = ulog_bin_snprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, spec, value);
+            break;
+        }
+        case ULOG_BIN_ARG_DOUBLE:
+        {
+            double value;
+            ULOG_BIN_GET(args, args_len, pos, value);
+#ifdef ULOG_OUTPUT_FLOAT
+            fmt_result = ulog_bin_snprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, spec, value);
+#else
+            /* rt_vsnprintf does not support float number */
+            fmt_result = ulog_strcpy(log_len, log_buf + log_len, "(float)");
+#endif
+            break;
+        }
+        case ULOG_BIN_ARG_STR:
+        {
+            rt_uint8_t str_len;
+            ULOG_BIN_GET(args, args_len, pos, str_len);
+            if (pos + str_len + 1 > args_len)
+                goto __exit;
+            fmt_result = ulog_bin_snprintf(log_buf + log_len, ULOG_LINE_BUF_SIZE - log_len, spec,
+                    (const char *)args + pos);
+            pos += str_len + 1;
+            break;
+        }
+        default:
+            /* "%%" */
+            fmt_result = (spec[spec_len - 1] == '%') ? ulog_strcpy(log_len, log_buf + log_len, "%") : 0;
+            break;
+        }
+
+        if (fmt_result > -1)
+            log_len += fmt_result;
+    }
+
+__exit:
+    return log_len > ULOG_LINE_BUF_SIZE ? ULOG_LINE_BUF_SIZE : log_len;
+}
+
+/* format the binary log as ulog_formater, the time is always the tick */
+static rt_size_t ulog_bin_formater(char *log_buf, ulog_bin_frame_t frame)
+{
+    rt_size_t log_len = 0, newline_len = rt_strlen(ULOG_NEWLINE_SIGN);
+    rt_uint32_t level = frame->level;
+
+#ifdef ULOG_USING_COLOR
+    /* add CSI start sign and color info */
+    if (color_output_info[level])
+    {
+        log_len += ulog_strcpy(log_len, log_buf + log_len, CSI_START);
+        log_len += ulog_strcpy(log_len, log_buf + log_len, color_output_info[level]);
+    }
+#endif /* ULOG_USING_COLOR */
+
+#ifdef ULOG_OUTPUT_TIME
+    /* add time info */
+    log_buf[log_len] = '[';
+    log_len += ulog_ultoa(log_buf + log_len + 1, frame->tick) + 1;
+    log_buf[log_len++] = ']';
+#endif /* ULOG_OUTPUT_TIME */
+
+#ifdef ULOG_OUTPUT_LEVEL
+
+#ifdef ULOG_OUTPUT_TIME
+    log_len += ulog_strcpy(log_len, log_buf + log_len, " ");
+#endif
+
+    /* add level info */
+    log_len += ulog_strcpy(log_len, log_buf + log_len, level_output_info[level]);
+#endif /* ULOG_OUTPUT_LEVEL */
+
+#ifdef ULOG_OUTPUT_TAG
+
+#if !defined(ULOG_OUTPUT_LEVEL) && defined(ULOG_OUTPUT_TIME)
+    log_len += ulog_strcpy(log_len, log_buf + log_len, " ");
+#endif
+
+    /* add tag info */
+    log_len += ulog_strcpy(log_len, log_buf + log_len, frame->tag);
+#endif /* ULOG_OUTPUT_TAG */
+
+    log_len += ulog_strcpy(log_len, log_buf + log_len, ": ");
+
+    log_len = ulog_bin_args_format(log_buf, log_len, frame->format,
+            (const rt_uint8_t *)frame + sizeof(struct ulog_bin_frame), frame->args_len);
+
+    /* overflow check and reserve some space for CSI end sign and newline sign */
+#ifdef ULOG_USING_COLOR
+    if (log_len + (sizeof(CSI_END) - 1) + newline_len > ULOG_LINE_BUF_SIZE)
+    {
+        log_len = ULOG_LINE_BUF_SIZE - (sizeof(CSI_END) - 1) - newline_len;
+    }
+#else
+    if (log_len + newline_len > ULOG_LINE_BUF_SIZE)
+    {
+        log_len = ULOG_LINE_BUF_SIZE - newline_len;
+    }
+#endif /* ULOG_USING_COLOR */
+
+    /* package newline sign */
+    if (frame->newline)
+    {
+        log_len += ulog_strcpy(log_len, log_buf + log_len, ULOG_NEWLINE_SIGN);
+    }
+
+#ifdef ULOG_USING_COLOR
+    /* add CSI end sign  */
+    if (color_output_info[level])
+    {
+        log_len += ulog_strcpy(log_len, log_buf + log_len, CSI_END);
+    }
+#endif /* ULOG_USING_COLOR */
+
+    return log_len;
+}
+#endif /* ULOG_BINARY_HOST_FORMAT */
+
+/* record the binary log into the async buffer, it's lock free and can be used in ISR */
+static void ulog_bin_record(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
+{
+    rt_uint8_t args_buf[ULOG_BINARY_ARGS_MAX_SIZE];
+    rt_size_t args_len, tag_len;
+    rt_rbb_blk_t log_blk;
+    ulog_bin_frame_t log_frame;
+
+    args_len = ulog_bin_args_encode(args_buf, sizeof(args_buf), format, args);
+    tag_len = ulog_tag_len(tag);
+
+    /* allocate log frame */
+    log_blk = rt_rbb_blk_alloc(ulog.async_rbb,
+            RT_ALIGN(sizeof(struct ulog_bin_frame) + args_len + tag_len + 1, RT_ALIGN_SIZE));
+    if (log_blk)
+    {
+        /* package the log frame */
+        log_frame = (ulog_bin_frame_t) log_blk->buf;
+        log_frame->magic = ULOG_BIN_FRAME_MAGIC;
+        log_frame->level = level;
+        log_frame->newline = newline;
+        log_frame->tag_len = tag_len;
+        log_frame->args_len = args_len;
+        log_frame->tick = rt_tick_get();
+        log_frame->format = format;
+        rt_memcpy(log_blk->buf + sizeof(struct ulog_bin_frame), args_buf, args_len);
+        /* copy tag, the tag of caller may be built at runtime */
+        log_frame->tag = ulog_tag_copy((char *)log_blk->buf + sizeof(struct ulog_bin_frame) + args_len, tag,
+                tag_len);
+        /* put the block */
+        rt_rbb_blk_put(log_blk);
+        /* send a notice */
+        rt_sem_release(&ulog.async_notice);
+    }
+    else
+    {
+        static rt_bool_t already_output = RT_FALSE;
+        if (already_output == RT_FALSE)
+        {
+            rt_kprintf("Warning: There is no enough buffer for saving async log,"
+                    " please increase the ULOG_ASYNC_OUTPUT_BUF_SIZE option.\n");
+            already_output = RT_TRUE;
+        }
+    }
+}
+
+/* output the binary log in the async output */
+static void ulog_bin_output(ulog_bin_frame_t frame)
+{
+#ifdef ULOG_BINARY_HOST_FORMAT
+    /* output the frame directly, it's formatted on host */
+    ulog_output_to_all_backend(frame->level, frame->tag, RT_TRUE, (const char *) frame,
+            sizeof(struct ulog_bin_frame) + frame->args_len + frame->tag_len);
+#else
+    char *log_buf = NULL;
+    rt_size_t log_len = 0;
+
+    /* lock and get log buffer */
+    log_buf = log_buf_lock();
+
+    log_len = ulog_bin_formater(log_buf, frame);
+
+#ifdef ULOG_USING_FILTER
+    /* keyword filter */
+    if (ulog.filter.keyword[0] != '\0')
+    {
+        /* add string end sign */
+        log_buf[log_len] = '\0';
+        /* find the keyword */
+        if (!rt_strstr(log_buf, ulog.filter.keyword))
+        {
+            /* unlock log buffer */
+            log_buf_unlock();
+            return;
+        }
+    }
+#endif /* ULOG_USING_FILTER */
+
+    /* output to all backends */
+    ulog_output_to_all_backend(frame->level, frame->tag, RT_FALSE, log_buf, log_len);
+
+    /* unlock log buffer */
+    log_buf_unlock();
+#endif /* ULOG_BINARY_HOST_FORMAT */
+}
+#endif /* ULOG_USING_BINARY */
+
+/* format and output the log which has passed the level and tag filter */
+static void do_voutput(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
+{
+#ifndef ULOG_USING_BINARY
+    char *log_buf = NULL;
+    rt_size_t log_len = 0;
+#endif
+
+#ifdef ULOG_USING_BINARY
+    /* only record it, the format is deferred to async output or host */
+    ulog_bin_record(level, tag, newline, format, args);
+#else
+    /* lock and get log buffer */
+    log_buf = log_buf_lock();
+
+#ifndef ULOG_USING_SYSLOG
+    log_len = ulog_formater(log_buf, level, tag, newline, format, args);
+#else
+    extern rt_size_t syslog_formater(char *log_buf, rt_uint8_t level, const char *tag, rt_bool_t newline, const char *format, va_list args);
+    log_len = syslog_formater(log_buf, level, tag, newline, format, args);
+#endif /* ULOG_USING_SYSLOG */
+
+#ifdef ULOG_USING_FILTER
+    /* keyword filter */
+    if (ulog.filter.keyword[0] != '\0')
+    {
+        /* add string end sign */
+        log_buf[log_len] = '\0';
+        /* find the keyword */
+        if (!rt_strstr(log_buf, ulog.filter.keyword))
+        {
+            /* unlock log buffer */
+            log_buf_unlock();
+            return;
+        }
+    }
+#endif /* ULOG_USING_FILTER */
+    /* do log output */
+    do_output(level, tag, RT_FALSE, log_buf, log_len);
+
+    /* unlock log buffer */
+    log_buf_unlock();
+#endif /* ULOG_USING_BINARY */
+}
+
 /**
  * output the log by variable argument list
  *
@@ -483,9 +1067,6 @@ static void do_output(rt_uint32_t level, const char *tag, rt_bool_t is_raw, cons
  */
 void ulog_voutput(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, va_list args)
 {
-    char *log_buf = NULL;
-    rt_size_t log_len = 0;
-
 #ifndef ULOG_USING_SYSLOG
     RT_ASSERT(level <= LOG_LVL_DBG);
 #else
@@ -521,43 +1102,33 @@ void ulog_voutput(rt_uint32_t level, const char *tag, rt_bool_t newline, const c
     }
 #endif /* ULOG_USING_FILTER */
 
-    /* get log buffer */
-    log_buf = get_log_buf();
+    do_voutput(level, tag, newline, format, args);
+}
 
-    /* lock output */
-    output_lock();
+/**
+ * output the log
+ *
+ * @param level level
+ * @param tag tag
+ * @param newline has newline
+ * @param format output format
+ * @param ... args
+ */
+void ulog_output(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...)
+{
+    va_list args;
 
-#ifndef ULOG_USING_SYSLOG
-    log_len = ulog_formater(log_buf, level, tag, newline, format, args);
-#else
-    extern rt_size_t syslog_formater(char *log_buf, rt_uint8_t level, const char *tag, rt_bool_t newline, const char *format, va_list args);
-    log_len = syslog_formater(log_buf, level, tag, newline, format, args);
-#endif /* ULOG_USING_SYSLOG */
+    /* args point to the first variable parameter */
+    va_start(args, format);
 
-#ifdef ULOG_USING_FILTER
-    /* keyword filter */
-    if (ulog.filter.keyword[0] != '\0')
-    {
-        /* add string end sign */
-        log_buf[log_len] = '\0';
-        /* find the keyword */
-        if (!rt_strstr(log_buf, ulog.filter.keyword))
-        {
-            /* unlock output */
-            output_unlock();
-            return;
-        }
-    }
-#endif /* ULOG_USING_FILTER */
-    /* do log output */
-    do_output(level, tag, RT_FALSE, log_buf, log_len);
+    ulog_voutput(level, tag, newline, format, args);
 
-    /* unlock output */
-    output_unlock();
+    va_end(args);
 }
 
+#ifdef ULOG_USING_FILTER
 /**
- * output the log
+ * output the log on the callsite which has checked the filter by ulog_callsite_update
  *
  * @param level level
  * @param tag tag
@@ -565,17 +1136,26 @@ void ulog_voutput(rt_uint32_t level, const char *tag, rt_bool_t newline, const c
  * @param format output format
  * @param ... args
  */
-void ulog_output(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...)
+void ulog_callsite_output(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...)
 {
     va_list args;
 
+    RT_ASSERT(tag);
+    RT_ASSERT(format);
+
+    if (!ulog.init_ok)
+    {
+        return;
+    }
+
     /* args point to the first variable parameter */
     va_start(args, format);
 
-    ulog_voutput(level, tag, newline, format, args);
+    do_voutput(level, tag, newline, format, args);
 
     va_end(args);
 }
+#endif /* ULOG_USING_FILTER */
 
 /**
  * output RAW string format log
@@ -592,11 +1172,8 @@ void ulog_raw(const char *format, ...)
 
     RT_ASSERT(ulog.init_ok);
 
-    /* get log buffer */
-    log_buf = get_log_buf();
-
-    /* lock output */
-    output_lock();
+    /* lock and get log buffer */
+    log_buf = log_buf_lock();
     /* args point to the first variable parameter */
     va_start(args, format);
 
@@ -621,8 +1198,8 @@ void ulog_raw(const char *format, ...)
     /* do log output */
     do_output(LOG_LVL_DBG, NULL, RT_TRUE, log_buf, log_len);
 
-    /* unlock output */
-    output_unlock();
+    /* unlock log buffer */
+    log_buf_unlock();
 }
 
 /**
@@ -664,11 +1241,8 @@ void ulog_hexdump(const char *tag, rt_size_t width, rt_uint8_t *buf, rt_size_t s
     }
 #endif /* ULOG_USING_FILTER */
 
-    /* get log buffer */
-    log_buf = get_log_buf();
-
-    /* lock output */
-    output_lock();
+    /* lock and get log buffer */
+    log_buf = log_buf_lock();
 
     for (i = 0, log_len = 0; i < size; i += width)
     {
@@ -731,11 +1305,69 @@ void ulog_hexdump(const char *tag, rt_size_t width, rt_uint8_t *buf, rt_size_t s
         /* do log output */
         do_output(LOG_LVL_DBG, NULL, RT_TRUE, log_buf, log_len);
     }
-    /* unlock output */
-    output_unlock();
+    /* unlock log buffer */
+    log_buf_unlock();
 }
 
 #ifdef ULOG_USING_FILTER
+/* the generation of filter settings, the cached filter result of callsite is expired when it's changed */
+volatile rt_uint32_t ulog_filter_generation = 1;
+
+static void filter_changed(void)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    ulog_filter_generation++;
+    rt_hw_interrupt_enable(level);
+}
+
+/**
+ * update the cached filter result of the callsite
+ *
+ * @param callsite the callsite
+ * @param tag log tag
+ *
+ * @return the mask of levels which can be output, such as ULOG_LVL_MASK(LOG_LVL_INFO)
+ */
+rt_uint32_t ulog_callsite_update(ulog_callsite_t callsite, const char *tag)
+{
+    rt_uint32_t generation, mask;
+
+    if (!ulog.init_ok)
+        return 0;
+
+    /* the result is expired when the settings are changed during the update */
+    generation = ulog_filter_generation;
+
+#ifndef ULOG_USING_SYSLOG
+    {
+        rt_uint32_t level = ulog_tag_lvl_filter_get(tag);
+
+        if (level > ulog.filter.level)
+            level = ulog.filter.level;
+        /* all levels not more than it */
+        mask = (ULOG_LVL_MASK(level) << 1) - 1;
+    }
+#else
+    mask = ulog.filter.level & ulog_tag_lvl_filter_get(tag);
+#endif /* ULOG_USING_SYSLOG */
+
+    /* tag filter */
+    if (!rt_strstr(tag, ulog.filter.tag))
+    {
+        mask = 0;
+    }
+
+    /* expire it first, the callsite may be updated for other tag at the same time */
+    callsite->generation = 0;
+    callsite->tag = tag;
+    callsite->mask = mask;
+    callsite->generation = generation;
+
+    return mask;
+}
+
 /**
  * Set the filter's level by different tag.
  * The log on this tag which level is less than it will stop output.
@@ -822,6 +1454,8 @@ int ulog_tag_lvl_filter_set(const char *tag, rt_uint32_t level)
     /* unlock output */
     output_unlock();
 
+    filter_changed();
+
     return result;
 }
 
@@ -882,6 +1516,7 @@ void ulog_global_filter_lvl_set(rt_uint32_t level)
     RT_ASSERT(level <= LOG_FILTER_LVL_ALL);
 
     ulog.filter.level = level;
+    filter_changed();
 }
 
 /**
@@ -906,6 +1541,7 @@ void ulog_global_filter_tag_set(const char *tag)
     RT_ASSERT(tag);
 
     rt_strncpy(ulog.filter.tag, tag, ULOG_FILTER_TAG_MAX_LEN);
+    filter_changed();
 }
 
 /**
@@ -1151,6 +1787,32 @@ rt_err_t ulog_backend_unregister(ulog_backend_t backend)
 }
 
 #ifdef ULOG_USING_ASYNC_OUTPUT
+/*
+ * get the committed log frame at the head of the ring, the frames are output
+ * in the order they are reserved. A frame still being copied holds back the
+ * frames reserved after it until its put.
+ */
+static rt_rbb_blk_t async_blk_get(void)
+{
+    rt_base_t level;
+    rt_rbb_blk_t block = NULL;
+
+    level = rt_hw_interrupt_disable();
+
+    if (!rt_slist_isempty(&ulog.async_rbb->blk_list))
+    {
+        block = rt_slist_first_entry(&ulog.async_rbb->blk_list, struct rt_rbb_blk, list);
+        if (block->status == RT_RBB_BLK_PUT)
+            block->status = RT_RBB_BLK_GET;
+        else
+            block = NULL;
+    }
+
+    rt_hw_interrupt_enable(level);
+
+    return block;
+}
+
 /**
  * asynchronous output logs to all backends
  *
@@ -1161,7 +1823,7 @@ void ulog_async_output(void)
     rt_rbb_blk_t log_blk;
     ulog_frame_t log_frame;
 
-    while ((log_blk = rt_rbb_blk_get(ulog.async_rbb)) != NULL)
+    while ((log_blk = async_blk_get()) != NULL)
     {
         log_frame = (ulog_frame_t) log_blk->buf;
         if (log_frame->magic == ULOG_FRAME_MAGIC)
@@ -1170,6 +1832,12 @@ void ulog_async_output(void)
             ulog_output_to_all_backend(log_frame->level, log_frame->tag, log_frame->is_raw, log_frame->log,
                     log_frame->log_len);
         }
+#ifdef ULOG_USING_BINARY
+        else if (((ulog_bin_frame_t) log_blk->buf)->magic == ULOG_BIN_FRAME_MAGIC)
+        {
+            ulog_bin_output((ulog_bin_frame_t) log_blk->buf);
+        }
+#endif
         rt_rbb_blk_free(ulog.async_rbb, log_blk);
     }
 }
@@ -1225,6 +1893,8 @@ void ulog_flush(void)
 
 int ulog_init(void)
 {
+    int i;
+
     if (ulog.init_ok)
         return 0;
 
@@ -1266,6 +1936,14 @@ int ulog_init(void)
     ulog_global_filter_lvl_set(LOG_FILTER_LVL_ALL);
 #endif
 
+    for (i = 0; i < ULOG_LINE_BUF_BANDS; i++)
+    {
+        char name[RT_NAME_MAX];
+
+        rt_snprintf(name, sizeof(name), "ulog%d", i);
+        rt_mutex_init(&ulog.band[i].locker, name, RT_IPC_FLAG_PRIO);
+    }
+
     ulog.init_ok = RT_TRUE;
 
     return 0;
@@ -1276,6 +1954,7 @@ void ulog_deinit(void)
 {
     rt_slist_t *node;
     ulog_backend_t backend;
+    int i;
 
     if (!ulog.init_ok)
         return;
@@ -1303,6 +1982,10 @@ void ulog_deinit(void)
 #endif /* ULOG_USING_FILTER */
 
     rt_mutex_detach(&ulog.output_locker);
+    for (i = 0; i < ULOG_LINE_BUF_BANDS; i++)
+    {
+        rt_mutex_detach(&ulog.band[i].locker);
+    }
 
 #ifdef ULOG_USING_ASYNC_OUTPUT
     rt_rbb_destroy(ulog.async_rbb);
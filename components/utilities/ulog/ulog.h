@@ -6,6 +6,9 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-08-25     armink       the first version
+ * 2019-09-02     RT-Thread    add callsite filter cache
+ * 2019-09-05     RT-Thread    add RAM ring backend API
+ * 2019-10-28     RT-Thread    note the log order across priority bands
  */
 
 #ifndef _ULOG_H_
@@ -39,6 +42,10 @@ void ulog_deinit(void);
  *
  * LOG_D("this is a debug log!");
  * LOG_E("this is a error log!");
+ *
+ * NOTE: The threads in different priority bands (ULOG_LINE_BUF_BANDS) format their logs at the same time, so the logs
+ * are not globally ordered across bands. A log of a preempted thread can be output after the logs called later by the
+ * threads of other bands. The logs of one band and the logs of one thread are always output in the order of calls.
  */
 #define LOG_E(...)                     ulog_e(LOG_TAG, __VA_ARGS__)
 #define LOG_W(...)                     ulog_w(LOG_TAG, __VA_ARGS__)
@@ -66,6 +73,13 @@ void ulog_global_filter_tag_set(const char *tag);
 const char *ulog_global_filter_tag_get(void);
 void ulog_global_filter_kw_set(const char *keyword);
 const char *ulog_global_filter_kw_get(void);
+
+/*
+ * callsite filter cache, it's used by LOG_X API
+ */
+extern volatile rt_uint32_t ulog_filter_generation;
+rt_uint32_t ulog_callsite_update(ulog_callsite_t callsite, const char *tag);
+void ulog_callsite_output(rt_uint32_t level, const char *tag, rt_bool_t newline, const char *format, ...);
 #endif /* ULOG_USING_FILTER */
 
 /*
@@ -81,6 +95,14 @@ void ulog_async_output(void);
 void ulog_async_waiting_log(rt_int32_t time);
 #endif
 
+#ifdef ULOG_BACKEND_USING_RAM
+/*
+ * read the logs in RAM ring backend, they are kept on warm reset
+ */
+rt_size_t ulog_ram_backend_read(rt_size_t pos, void *buf, rt_size_t size);
+void ulog_ram_backend_clean(void);
+#endif
+
 /*
  * dump the hex format data to log
  */
@@ -6,6 +6,8 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-08-25     armink       the first version
+ * 2019-08-26     RT-Thread    add binary log frame
+ * 2019-09-02     RT-Thread    add callsite filter cache
  */
 
 #ifndef _ULOG_DEF_H_
@@ -47,9 +49,9 @@ extern "C" {
 #define DBG_INFO                       LOG_LVL_INFO
 #define DBG_LOG                        LOG_LVL_DBG
 #define dbg_log(level, ...)                                \
-    if ((level) <= LOG_LVL)                                \
+    if (ULOG_LVL_ENABLED(level))                           \
     {                                                      \
-        ulog_output(level, LOG_TAG, RT_FALSE, __VA_ARGS__);\
+        ulog_callsite(level, LOG_TAG, RT_FALSE, __VA_ARGS__);\
     }
 
 #if !defined(LOG_TAG)
@@ -74,35 +76,69 @@ extern "C" {
     #endif
 #endif /* !defined(LOG_LVL) */
 
-#if (LOG_LVL >= LOG_LVL_DBG) && (ULOG_OUTPUT_LVL >= LOG_LVL_DBG)
-    #define ulog_d(TAG, ...)           ulog_output(LOG_LVL_DBG, TAG, RT_TRUE, __VA_ARGS__)
+/* setting static output log level */
+#ifndef ULOG_OUTPUT_LVL
+#define ULOG_OUTPUT_LVL                LOG_LVL_DBG
+#endif
+
+/* the level is compiled in by the file's LOG_LVL and the static output level, it's usable in #if */
+#define ULOG_LVL_ENABLED(level)        (((level) <= LOG_LVL) && ((level) <= ULOG_OUTPUT_LVL))
+
+#ifdef ULOG_USING_FILTER
+/* the bit of level in the cached filter result */
+#define ULOG_LVL_MASK(level)           (1UL << ((level) & 0x07))
+
+/*
+ * Every callsite caches the filter result of its tag, the filter is only
+ * checked again after the filter settings are changed or the callsite is
+ * called with another tag.
+ */
+#define ulog_callsite(level, TAG, newline, ...)                                        \
+    do                                                                                 \
+    {                                                                                  \
+        static struct ulog_callsite __ulog_callsite;                                   \
+        if (((__ulog_callsite.generation == ulog_filter_generation &&                  \
+                __ulog_callsite.tag == (TAG)) ?                                        \
+                __ulog_callsite.mask : ulog_callsite_update(&__ulog_callsite, TAG))    \
+                & ULOG_LVL_MASK(level))                                                \
+        {                                                                              \
+            ulog_callsite_output(level, TAG, newline, __VA_ARGS__);                    \
+        }                                                                              \
+    } while (0)
+#else
+#define ulog_callsite(level, TAG, newline, ...)                                        \
+    ulog_output(level, TAG, newline, __VA_ARGS__)
+#endif /* ULOG_USING_FILTER */
+
+#if ULOG_LVL_ENABLED(LOG_LVL_DBG)
+    #define ulog_d(TAG, ...)           ulog_callsite(LOG_LVL_DBG, TAG, RT_TRUE, __VA_ARGS__)
 #else
     #define ulog_d(TAG, ...)
-#endif /* (LOG_LVL >= LOG_LVL_DBG) && (ULOG_OUTPUT_LVL >= LOG_LVL_DBG) */
+#endif /* ULOG_LVL_ENABLED(LOG_LVL_DBG) */
 
-#if (LOG_LVL >= LOG_LVL_INFO) && (ULOG_OUTPUT_LVL >= LOG_LVL_INFO)
-    #define ulog_i(TAG, ...)           ulog_output(LOG_LVL_INFO, TAG, RT_TRUE, __VA_ARGS__)
+#if ULOG_LVL_ENABLED(LOG_LVL_INFO)
+    #define ulog_i(TAG, ...)           ulog_callsite(LOG_LVL_INFO, TAG, RT_TRUE, __VA_ARGS__)
 #else
     #define ulog_i(TAG, ...)
-#endif /* (LOG_LVL >= LOG_LVL_INFO) && (ULOG_OUTPUT_LVL >= LOG_LVL_INFO) */
+#endif /* ULOG_LVL_ENABLED(LOG_LVL_INFO) */
 
-#if (LOG_LVL >= LOG_LVL_WARNING) && (ULOG_OUTPUT_LVL >= LOG_LVL_WARNING)
-    #define ulog_w(TAG, ...)           ulog_output(LOG_LVL_WARNING, TAG, RT_TRUE, __VA_ARGS__)
+#if ULOG_LVL_ENABLED(LOG_LVL_WARNING)
+    #define ulog_w(TAG, ...)           ulog_callsite(LOG_LVL_WARNING, TAG, RT_TRUE, __VA_ARGS__)
 #else
     #define ulog_w(TAG, ...)
-#endif /* (LOG_LVL >= LOG_LVL_WARNING) && (ULOG_OUTPUT_LVL >= LOG_LVL_WARNING) */
+#endif /* ULOG_LVL_ENABLED(LOG_LVL_WARNING) */
 
-#if (LOG_LVL >= LOG_LVL_ERROR) && (ULOG_OUTPUT_LVL >= LOG_LVL_ERROR)
-    #define ulog_e(TAG, ...)           ulog_output(LOG_LVL_ERROR, TAG, RT_TRUE, __VA_ARGS__)
+#if ULOG_LVL_ENABLED(LOG_LVL_ERROR)
+    #define ulog_e(TAG, ...)           ulog_callsite(LOG_LVL_ERROR, TAG, RT_TRUE, __VA_ARGS__)
 #else
     #define ulog_e(TAG, ...)
-#endif /* (LOG_LVL >= LOG_LVL_ERROR) && (ULOG_OUTPUT_LVL >= LOG_LVL_ERROR) */
+#endif /* ULOG_LVL_ENABLED(LOG_LVL_ERROR) */
 
-#if (LOG_LVL >= LOG_LVL_DBG) && (ULOG_OUTPUT_LVL >= LOG_LVL_DBG)
+#if ULOG_LVL_ENABLED(LOG_LVL_DBG)
     #define ulog_hex(TAG, width, buf, size)     ulog_hexdump(TAG, width, buf, size)
 #else
     #define ulog_hex(TAG, width, buf, size)
-#endif /* (LOG_LVL >= LOG_LVL_DBG) && (ULOG_OUTPUT_LVL >= LOG_LVL_DBG) */    
+#endif /* ULOG_LVL_ENABLED(LOG_LVL_DBG) */
     
 /* assert for developer. */
 #ifdef ULOG_ASSERT_ENABLE
@@ -150,11 +186,6 @@ extern "C" {
 #define ELOG_LVL_DEBUG                 LOG_LVL_DBG
 #define ELOG_LVL_VERBOSE               LOG_LVL_DBG
 
-/* setting static output log level */
-#ifndef ULOG_OUTPUT_LVL
-#define ULOG_OUTPUT_LVL                LOG_LVL_DBG
-#endif
-
 /* buffer size for every line's log */
 #ifndef ULOG_LINE_BUF_SIZE
 #define ULOG_LINE_BUF_SIZE             128
@@ -185,6 +216,18 @@ struct ulog_tag_lvl_filter
 };
 typedef struct ulog_tag_lvl_filter *ulog_tag_lvl_filter_t;
 
+/* the cached filter result of a log callsite */
+struct ulog_callsite
+{
+    /* it's expired when it isn't the ulog_filter_generation */
+    volatile rt_uint32_t generation;
+    /* the tag which the result is checked for, the tag may be given at runtime */
+    const char *volatile tag;
+    /* the mask of levels which can be output */
+    volatile rt_uint32_t mask;
+};
+typedef struct ulog_callsite *ulog_callsite_t;
+
 struct ulog_frame
 {
     /* magic word is 0x10 ('lo') */
@@ -193,10 +236,29 @@ struct ulog_frame
     rt_uint32_t log_len:23;
     rt_uint32_t level;
     const char *log;
+    /* the copy of tag following the log, the tag of caller may be gone */
     const char *tag;
 };
 typedef struct ulog_frame *ulog_frame_t;
 
+#define ULOG_BIN_FRAME_MAGIC           0x11
+
+/* binary log frame, the raw arguments and the tag_len bytes of tag are following it */
+struct ulog_bin_frame
+{
+    rt_uint8_t magic;
+    rt_uint8_t level;
+    rt_uint8_t newline;
+    rt_uint8_t tag_len;
+    rt_uint32_t args_len;
+    rt_uint32_t tick;
+    /* the copy of tag following the arguments, the tag of caller may be gone */
+    const char *tag;
+    /* the address of format string, it's resolved by the ELF file on host */
+    const char *format;
+};
+typedef struct ulog_bin_frame *ulog_bin_frame_t;
+
 struct ulog_backend
 {
     char name[RT_NAME_MAX];
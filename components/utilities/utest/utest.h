@@ -6,6 +6,7 @@
  * Change Logs:
  * Date           Author       Notes
  * 2018-11-19     MurphyZhao   the first version
+ * 2019-09-19     RT-Thread    add benchmark mode
  */
 
 #ifndef __UTEST_H__
@@ -14,6 +15,7 @@
 #include <rtthread.h>
 #include "utest_log.h"
 #include "utest_assert.h"
+#include "utest_bench.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-19     RT-Thread    the first version
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#include "utest.h"
+
+#ifdef UTEST_USING_BENCH
+
+#undef DBG_TAG
+#undef DBG_LVL
+
+#define DBG_TAG          "utest"
+#define DBG_LVL          DBG_INFO
+#include <rtdbg.h>
+
+/* the minimal cycles of reading CPU time back to back */
+static rt_uint32_t utest_bench_overhead(void)
+{
+    rt_uint32_t start, cycles, overhead = ~0UL;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        start = clock_cpu_gettime();
+        cycles = clock_cpu_gettime() - start;
+        if (cycles < overhead)
+            overhead = cycles;
+    }
+
+    return overhead;
+}
+
+rt_err_t utest_bench_init(utest_bench_t bench, const char *name, rt_uint32_t warmup, rt_uint32_t iterations)
+{
+    RT_ASSERT(bench != RT_NULL);
+
+    rt_memset(bench, 0x00, sizeof(struct utest_bench));
+    bench->name = name;
+
+    if (clock_cpu_getres() == 0)
+    {
+        LOG_E("[  BENCH   ] (%s) no CPU time of the BSP", name);
+        return -RT_ENOSYS;
+    }
+
+    bench->samples = (rt_uint32_t *)rt_malloc(sizeof(rt_uint32_t) * iterations);
+    if (bench->samples == RT_NULL && iterations > 0)
+    {
+        LOG_E("[  BENCH   ] (%s) no memory for %u samples", name, iterations);
+        return -RT_ENOMEM;
+    }
+
+    bench->warmup = warmup;
+    bench->iterations = iterations;
+    bench->overhead = utest_bench_overhead();
+
+    return RT_EOK;
+}
+
+void utest_bench_deinit(utest_bench_t bench)
+{
+    RT_ASSERT(bench != RT_NULL);
+
+    if (bench->samples)
+    {
+        rt_free(bench->samples);
+        bench->samples = RT_NULL;
+    }
+    bench->count = 0;
+}
+
+void utest_bench_add(utest_bench_t bench, rt_uint32_t cycles)
+{
+    /* the samples more than iterations are dropped */
+    if (bench->count < bench->iterations)
+    {
+        bench->samples[bench->count ++] = cycles;
+    }
+}
+
+void utest_bench_start(utest_bench_t bench)
+{
+    bench->start = clock_cpu_gettime();
+}
+
+void utest_bench_stop(utest_bench_t bench)
+{
+    rt_uint32_t cycles = clock_cpu_gettime() - bench->start;
+
+    utest_bench_add(bench, cycles > bench->overhead ? cycles - bench->overhead : 0);
+}
+
+rt_bool_t utest_bench_next(utest_bench_t bench)
+{
+    rt_uint32_t cycles = clock_cpu_gettime() - bench->start;
+
+    if (bench->samples == RT_NULL)
+        return RT_FALSE;
+
+    /* the previous iteration is finished */
+    if (bench->round > bench->warmup)
+    {
+        utest_bench_add(bench, cycles > bench->overhead ? cycles - bench->overhead : 0);
+    }
+
+    if (bench->round == bench->warmup + bench->iterations)
+    {
+        utest_bench_report(bench);
+        utest_bench_deinit(bench);
+        return RT_FALSE;
+    }
+
+    bench->round ++;
+    bench->start = clock_cpu_gettime();
+
+    return RT_TRUE;
+}
+
+static int utest_bench_cmp(const void *a, const void *b)
+{
+    rt_uint32_t x = *(const rt_uint32_t *)a;
+    rt_uint32_t y = *(const rt_uint32_t *)b;
+
+    return x < y ? -1 : (x > y);
+}
+
+/* the nearest rank of percentile */
+static rt_uint32_t utest_bench_percentile(utest_bench_t bench, rt_uint32_t percent)
+{
+    rt_uint32_t rank = (bench->count * percent + 99) / 100;
+
+    return bench->samples[rank > 0 ? rank - 1 : 0];
+}
+
+void utest_bench_report(utest_bench_t bench)
+{
+    RT_ASSERT(bench != RT_NULL);
+
+    if (bench->count == 0)
+    {
+        LOG_E("[  BENCH   ] (%s) no samples", bench->name);
+        return;
+    }
+
+    qsort(bench->samples, bench->count, sizeof(rt_uint32_t), utest_bench_cmp);
+
+    /* one line for each benchmark, the results can be compared by tools/utest_bench_diff.py */
+    rt_kprintf("{\"bench\":\"%s\",\"unit\":\"cycle\",\"res_ps\":%u,\"warmup\":%u,\"iterations\":%u,"
+               "\"overhead\":%u,\"min\":%u,\"median\":%u,\"p99\":%u,\"max\":%u}\n",
+               bench->name, (rt_uint32_t)(clock_cpu_getres() * 1000), bench->warmup, bench->count,
+               bench->overhead, bench->samples[0], utest_bench_percentile(bench, 50),
+               utest_bench_percentile(bench, 99), bench->samples[bench->count - 1]);
+}
+
+#endif /* UTEST_USING_BENCH */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-19     RT-Thread    the first version
+ */
+
+#ifndef __UTEST_BENCH_H__
+#define __UTEST_BENCH_H__
+
+#include <rtthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef UTEST_USING_BENCH
+
+/**
+ * utest_bench
+ *
+ * @brief Benchmark data structure, the time is measured by the cycles of
+ *        CPU time (RT_USING_CPUTIME).
+ *
+ * @member name       Benchmark name, such as "kernel.sem_round_trip".
+ * @member warmup     Number of iterations before measuring.
+ * @member iterations Number of measured iterations.
+ * @member round      Number of started iterations of `UTEST_BENCH`.
+ * @member overhead   Cycles of reading the CPU time, it's removed from samples.
+ * @member start      CPU time of the current measuring.
+ * @member count      Number of samples.
+ * @member samples    Cycles of each measured iteration.
+ *
+*/
+struct utest_bench
+{
+    const char  *name;
+    rt_uint32_t  warmup;
+    rt_uint32_t  iterations;
+    rt_uint32_t  round;
+    rt_uint32_t  overhead;
+    rt_uint32_t  start;
+    rt_uint32_t  count;
+    rt_uint32_t *samples;
+};
+typedef struct utest_bench *utest_bench_t;
+
+/**
+ * utest_bench_init
+ *
+ * @brief Initialize a benchmark, the memory of samples is allocated.
+ *
+ * @param bench      The benchmark.
+ * @param name       The benchmark name, it must be kept until the report.
+ * @param warmup     Number of iterations before measuring.
+ * @param iterations Number of measured iterations.
+ *
+ * @return RT_EOK, -RT_ENOMEM or -RT_ENOSYS if no CPU time.
+ *
+*/
+rt_err_t utest_bench_init(utest_bench_t bench, const char *name, rt_uint32_t warmup, rt_uint32_t iterations);
+
+/**
+ * utest_bench_deinit
+ *
+ * @brief Release the memory of samples.
+ *
+ * @param bench The benchmark.
+ *
+ * @return void
+ *
+*/
+void utest_bench_deinit(utest_bench_t bench);
+
+/**
+ * utest_bench_start, utest_bench_stop
+ *
+ * @brief Measure a sample by hand, for the code which can't be an
+ *        iteration of `UTEST_BENCH`.
+ *
+ * @param bench The benchmark.
+ *
+ * @return void
+ *
+*/
+void utest_bench_start(utest_bench_t bench);
+void utest_bench_stop(utest_bench_t bench);
+
+/**
+ * utest_bench_add
+ *
+ * @brief Add a sample which is measured in other place, such as another thread.
+ *
+ * @param bench  The benchmark.
+ * @param cycles Cycles of the sample.
+ *
+ * @return void
+ *
+*/
+void utest_bench_add(utest_bench_t bench, rt_uint32_t cycles);
+
+/**
+ * utest_bench_report
+ *
+ * @brief Output the statistics of samples as a JSON line:
+ *        {"bench":"name","unit":"cycle","res_ps":5952,"warmup":100,
+ *         "iterations":1000,"overhead":8,"min":1,"median":2,"p99":3,"max":4}
+ *        The "res_ps" is picoseconds per cycle.
+ *
+ * @param bench The benchmark.
+ *
+ * @return void
+ *
+*/
+void utest_bench_report(utest_bench_t bench);
+
+/* No need for the user to use this function directly */
+rt_bool_t utest_bench_next(utest_bench_t bench);
+
+/**
+ * UTEST_BENCH
+ *
+ * @brief Run the following statement as benchmark iterations, every
+ *        iteration is a sample. The report is output and the samples
+ *        are released after the last one, so don't break the loop. The
+ *        test case fails and no iteration runs when the benchmark can't
+ *        be initialized.
+ *
+ *        struct utest_bench bench;
+ *        UTEST_BENCH(&bench, "kernel.malloc_free", 100, 1000)
+ *        {
+ *            rt_free(rt_malloc(64));
+ *        }
+ *
+ * @param bench      The benchmark.
+ * @param name       The benchmark name.
+ * @param warmup     Number of iterations before measuring.
+ * @param iterations Number of measured iterations.
+ *
+*/
+#define UTEST_BENCH(bench, name, warmup, iterations)                           \
+    for (uassert_int_equal(utest_bench_init(bench, name, warmup, iterations),  \
+                           RT_EOK);                                            \
+         utest_bench_next(bench); )
+
+#endif /* UTEST_USING_BENCH */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UTEST_BENCH_H__ */
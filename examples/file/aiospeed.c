@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-08     RT-Thread    first version
+ */
+
+/*
+ * compare the read throughput of a file with synchronous read(), one
+ * aio_read() per block and lio_listio() batches, e.g.
+ *     aiospeed /sd/test.dat 512 8
+ */
+
+#include <rtthread.h>
+#include <dfs_posix.h>
+#include <posix_aio.h>
+
+static rt_size_t aiospeed_sync(int fd, char *buff_ptr, int block_size, int batch)
+{
+    int length;
+    rt_size_t total_length = 0;
+
+    lseek(fd, 0, SEEK_SET);
+    while (1)
+    {
+        length = read(fd, buff_ptr, block_size);
+        if (length <= 0) break;
+
+        total_length += length;
+    }
+
+    return total_length;
+}
+
+static rt_size_t aiospeed_aio(int fd, char *buff_ptr, int block_size, int batch)
+{
+    struct aiocb cb;
+    const struct aiocb *list[1];
+    rt_size_t total_length = 0;
+
+    rt_memset(&cb, 0x00, sizeof(cb));
+    cb.aio_fildes = fd;
+    cb.aio_buf = buff_ptr;
+    cb.aio_nbytes = block_size;
+    list[0] = &cb;
+
+    while (1)
+    {
+        cb.aio_offset = total_length;
+        if (aio_read(&cb) < 0) break;
+
+        aio_suspend(list, 1, RT_NULL);
+        if (aio_return(&cb) <= 0) break;
+
+        total_length += cb.aio_result;
+    }
+
+    return total_length;
+}
+
+static rt_size_t aiospeed_lio(int fd, char *buff_ptr, int block_size, int batch)
+{
+    int index, length;
+    struct aiocb *cbs, **list;
+    rt_size_t total_length = 0;
+
+    cbs = rt_calloc(batch, sizeof(struct aiocb));
+    list = rt_calloc(batch, sizeof(struct aiocb *));
+    if (cbs == RT_NULL || list == RT_NULL)
+    {
+        rt_free(cbs);
+        rt_free(list);
+        return 0;
+    }
+
+    while (1)
+    {
+        /* adjacent blocks, the engine merges them into one transfer */
+        for (index = 0; index < batch; index ++)
+        {
+            cbs[index].aio_fildes = fd;
+            cbs[index].aio_buf = buff_ptr + index * block_size;
+            cbs[index].aio_nbytes = block_size;
+            cbs[index].aio_offset = total_length + index * block_size;
+            cbs[index].aio_lio_opcode = LIO_READ;
+            list[index] = &cbs[index];
+        }
+
+        lio_listio(LIO_WAIT, list, batch, RT_NULL);
+
+        length = 0;
+        for (index = 0; index < batch; index ++)
+        {
+            if (cbs[index].aio_result > 0)
+                length += cbs[index].aio_result;
+        }
+        if (length <= 0) break;
+
+        total_length += length;
+        if (length < batch * block_size) break;
+    }
+
+    rt_free(list);
+    rt_free(cbs);
+
+    return total_length;
+}
+
+static void aiospeed_run(const char *name, rt_size_t (*func)(int, char *, int, int),
+                         int fd, char *buff_ptr, int block_size, int batch)
+{
+    rt_tick_t tick;
+    rt_size_t total_length;
+
+    tick = rt_tick_get();
+    total_length = func(fd, buff_ptr, block_size, batch);
+    tick = rt_tick_get() - tick;
+    if (tick == 0) tick = 1;
+
+    rt_kprintf("%-6s: %d bytes in %d ticks, %d byte/s\n", name, total_length, tick,
+               total_length / tick * RT_TICK_PER_SECOND);
+}
+
+void aiospeed(const char *filename, int block_size, int batch)
+{
+    int fd;
+    char *buff_ptr;
+
+    if (block_size <= 0) block_size = 512;
+    if (batch <= 0) batch = 8;
+
+    fd = open(filename, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        rt_kprintf("open file:%s failed\n", filename);
+        return;
+    }
+
+    buff_ptr = rt_malloc(block_size * batch);
+    if (buff_ptr == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        close(fd);
+
+        return;
+    }
+
+    aiospeed_run("read", aiospeed_sync, fd, buff_ptr, block_size, batch);
+    aiospeed_run("aio", aiospeed_aio, fd, buff_ptr, block_size, batch);
+    aiospeed_run("lio", aiospeed_lio, fd, buff_ptr, block_size, batch);
+
+    close(fd);
+    rt_free(buff_ptr);
+}
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+FINSH_FUNCTION_EXPORT(aiospeed, compare read/aio/lio_listio throughput);
+#endif
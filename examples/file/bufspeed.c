@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-12     RT-Thread    the first version
+ */
+
+/*
+ * Small block read/write speed of a file, run it with and without the dfs
+ * file buffer (DFS_USING_FILE_BUFFER) to compare:
+ *
+ *     msh />bufspeed /test.dat 16 65536
+ */
+
+#include <rtthread.h>
+#include <dfs_posix.h>
+
+static void bufspeed_report(const char *name, rt_size_t length, rt_tick_t tick)
+{
+    if (tick == 0)
+        tick = 1;
+
+    rt_kprintf("%s: %d bytes in %d ticks, %d byte/s\n", name, length, tick,
+               length / tick * RT_TICK_PER_SECOND);
+}
+
+void bufspeed(const char *filename, int block_size, int file_size)
+{
+    int fd;
+    char *buff_ptr;
+    rt_size_t total_length;
+    rt_tick_t tick;
+
+    if (block_size <= 0 || file_size <= 0)
+    {
+        rt_kprintf("usage: bufspeed file block_size file_size\n");
+        return;
+    }
+
+    buff_ptr = rt_malloc(block_size);
+    if (buff_ptr == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    rt_memset(buff_ptr, 0x5a, block_size);
+
+    /* small block write */
+    fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0);
+    if (fd < 0)
+    {
+        rt_kprintf("open file:%s failed\n", filename);
+        rt_free(buff_ptr);
+        return;
+    }
+
+    tick = rt_tick_get();
+    total_length = 0;
+    while (total_length < file_size)
+    {
+        int length;
+
+        length = write(fd, buff_ptr, block_size);
+        if (length <= 0) break;
+        total_length += length;
+    }
+    /* the pending data is written back in close */
+    close(fd);
+    tick = rt_tick_get() - tick;
+    bufspeed_report("write", total_length, tick);
+
+    /* small block sequential read */
+    fd = open(filename, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        rt_kprintf("open file:%s failed\n", filename);
+        rt_free(buff_ptr);
+        return;
+    }
+
+    tick = rt_tick_get();
+    total_length = 0;
+    while (1)
+    {
+        int length;
+
+        length = read(fd, buff_ptr, block_size);
+        if (length <= 0) break;
+        total_length += length;
+    }
+    tick = rt_tick_get() - tick;
+    bufspeed_report("read", total_length, tick);
+
+    /* small block read, stepping back half a block each time */
+    lseek(fd, 0, SEEK_SET);
+    tick = rt_tick_get();
+    total_length = 0;
+    while (1)
+    {
+        int length;
+
+        length = read(fd, buff_ptr, block_size);
+        if (length <= 0) break;
+        total_length += length;
+        if (length < block_size) break;
+
+        lseek(fd, - block_size / 2, SEEK_CUR);
+    }
+    tick = rt_tick_get() - tick;
+    bufspeed_report("read-back", total_length, tick);
+
+    close(fd);
+    rt_free(buff_ptr);
+}
+
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+FINSH_FUNCTION_EXPORT(bufspeed, perform file small block read/write test);
+#endif
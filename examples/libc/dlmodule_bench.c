@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-12     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    support the symbol table of Keil and IAR
+ */
+
+/*
+ * The cost of resolving the kernel symbols for module loading, the hash
+ * table against the linear search over RTMSymTab. With a module, the time
+ * of dlopen/dlclose is measured too, a module calling many kernel functions
+ * shows the difference of lazy binding (DLMODULE_USING_LAZY_BIND):
+ *
+ *     msh />dlmodule_bench /modules/big.so
+ */
+
+#include <rtthread.h>
+#include <rtm.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include "dlmodule.h"
+
+#define DLMODULE_BENCH_LOOPS    16
+
+#if defined(__IAR_SYSTEMS_ICC__) /* for IAR compiler */
+    #pragma section="RTMSymTab"
+#endif
+
+static rt_uint32_t linear_symbol_find(struct rt_module_symtab *begin,
+                                      struct rt_module_symtab *end, const char *name)
+{
+    struct rt_module_symtab *index;
+
+    for (index = begin; index != end; index ++)
+    {
+        if (rt_strcmp(index->name, name) == 0)
+            return (rt_uint32_t)index->addr;
+    }
+
+    return 0;
+}
+
+static void dlmodule_bench(int argc, char **argv)
+{
+#if defined(__GNUC__) && !defined(__CC_ARM)
+    extern int __rtmsymtab_start;
+    extern int __rtmsymtab_end;
+    struct rt_module_symtab *begin = (struct rt_module_symtab *)&__rtmsymtab_start;
+    struct rt_module_symtab *end = (struct rt_module_symtab *)&__rtmsymtab_end;
+#elif defined (__CC_ARM)
+    extern int RTMSymTab$$Base;
+    extern int RTMSymTab$$Limit;
+    struct rt_module_symtab *begin = (struct rt_module_symtab *)&RTMSymTab$$Base;
+    struct rt_module_symtab *end = (struct rt_module_symtab *)&RTMSymTab$$Limit;
+#elif defined (__IAR_SYSTEMS_ICC__)
+    struct rt_module_symtab *begin = __section_begin("RTMSymTab");
+    struct rt_module_symtab *end = __section_end("RTMSymTab");
+#endif
+    struct rt_module_symtab *index;
+    rt_tick_t linear, hash;
+    int i, nsym = end - begin;
+
+    /* every exported symbol is looked up, as the relocations of a large module */
+    linear = rt_tick_get();
+    for (i = 0; i < DLMODULE_BENCH_LOOPS; i++)
+    {
+        for (index = begin; index != end; index ++)
+        {
+            if (linear_symbol_find(begin, end, index->name) != (rt_uint32_t)index->addr)
+                rt_kprintf("linear: wrong address of %s\n", index->name);
+        }
+    }
+    linear = rt_tick_get() - linear;
+
+    hash = rt_tick_get();
+    for (i = 0; i < DLMODULE_BENCH_LOOPS; i++)
+    {
+        for (index = begin; index != end; index ++)
+        {
+            if (dlmodule_symbol_find(index->name) != (rt_uint32_t)index->addr)
+                rt_kprintf("hash: wrong address of %s\n", index->name);
+        }
+    }
+    hash = rt_tick_get() - hash;
+
+    rt_kprintf("%d symbols x %d: linear %d ticks, hash %d ticks\n",
+               nsym, DLMODULE_BENCH_LOOPS, linear, hash);
+
+    if (argc > 1)
+    {
+        void *handle;
+        rt_tick_t tick;
+
+        tick = rt_tick_get();
+        for (i = 0; i < DLMODULE_BENCH_LOOPS; i++)
+        {
+            handle = dlopen(argv[1], RTLD_NOW);
+            if (handle == RT_NULL)
+            {
+                rt_kprintf("open %s failed\n", argv[1]);
+                return;
+            }
+            dlclose(handle);
+        }
+        tick = rt_tick_get() - tick;
+
+        rt_kprintf("%s: dlopen/dlclose %d times in %d ticks\n", argv[1], DLMODULE_BENCH_LOOPS, tick);
+    }
+}
+MSH_CMD_EXPORT(dlmodule_bench, measure the symbol resolving of module loading);
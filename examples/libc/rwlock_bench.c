@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-22     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    add the writer timeout case
+ */
+
+/* Read-mostly contention of pthread_rwlock against pthread_mutex, one write
+   every RWLOCK_WRITE_RATIO accesses. The writer keeps a pair of counters
+   equal, a reader finding them different means the lock is broken.
+
+   The writer timeout case: a reader queued behind a waiting writer takes the
+   read-held lock as soon as the writer gives up, not at its own timeout. */
+
+#include <stdio.h>
+#include "pthread.h"
+
+#define RWLOCK_THREADS      4
+#define RWLOCK_LOOPS        50000
+#define RWLOCK_WRITE_RATIO  100
+#define RWLOCK_TIMEOUT      10
+
+static pthread_rwlock_t rwlock;
+static pthread_mutex_t mutex;
+static volatile long value_a, value_b;
+static volatile int broken;
+
+static void *rwlock_worker(void *arg)
+{
+	int i;
+
+	for (i = 0; i < RWLOCK_LOOPS; i++)
+	{
+		if (i % RWLOCK_WRITE_RATIO == 0)
+		{
+			pthread_rwlock_wrlock(&rwlock);
+			value_a = value_a + 1;
+			rt_thread_yield();
+			value_b = value_b + 1;
+			pthread_rwlock_unlock(&rwlock);
+		}
+		else
+		{
+			pthread_rwlock_rdlock(&rwlock);
+			if (value_a != value_b)
+				broken = 1;
+			pthread_rwlock_unlock(&rwlock);
+		}
+	}
+
+	return NULL;
+}
+
+static void *mutex_worker(void *arg)
+{
+	int i;
+
+	for (i = 0; i < RWLOCK_LOOPS; i++)
+	{
+		pthread_mutex_lock(&mutex);
+		if (i % RWLOCK_WRITE_RATIO == 0)
+		{
+			value_a = value_a + 1;
+			rt_thread_yield();
+			value_b = value_b + 1;
+		}
+		else if (value_a != value_b)
+		{
+			broken = 1;
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+
+	return NULL;
+}
+
+static int rwlock_run(const char *name, void *(*worker)(void *))
+{
+	int i, ret = 0;
+	pthread_t th[RWLOCK_THREADS];
+	rt_tick_t tick;
+
+	value_a = value_b = 0;
+	broken = 0;
+
+	tick = rt_tick_get();
+	for (i = 0; i < RWLOCK_THREADS; i++)
+		ret += pthread_create(&th[i], NULL, worker, NULL);
+	for (i = 0; i < RWLOCK_THREADS; i++)
+		ret += pthread_join(th[i], NULL);
+	tick = rt_tick_get() - tick;
+
+	printf("%s: %d accesses in %d ticks\n", name,
+		RWLOCK_THREADS * RWLOCK_LOOPS, (int)tick);
+
+	return (ret != 0 || broken || value_a != value_b) ? -1 : 0;
+}
+
+static struct rt_rwlock timeout_lock;
+static volatile rt_err_t writer_result, reader_result;
+static volatile rt_tick_t reader_tick;
+
+static void *timeout_writer(void *arg)
+{
+	/* the lock is held for reading, the writer gives up */
+	writer_result = rt_rwlock_take_write(&timeout_lock, RWLOCK_TIMEOUT);
+
+	return NULL;
+}
+
+static void *timeout_reader(void *arg)
+{
+	rt_tick_t tick = rt_tick_get();
+
+	/* queued behind the waiting writer */
+	reader_result = rt_rwlock_take_read(&timeout_lock, RWLOCK_TIMEOUT * 10);
+	reader_tick = rt_tick_get() - tick;
+	if (reader_result == RT_EOK)
+		rt_rwlock_release(&timeout_lock);
+
+	return NULL;
+}
+
+static int rwlock_timeout_run(void)
+{
+	int ret = 0;
+	pthread_t writer, reader;
+
+	rt_rwlock_init(&timeout_lock, "rwto", RT_IPC_FLAG_PRIO);
+	rt_rwlock_take_read(&timeout_lock, RT_WAITING_FOREVER);
+
+	ret += pthread_create(&writer, NULL, timeout_writer, NULL);
+	rt_thread_delay(RWLOCK_TIMEOUT / 2);
+	ret += pthread_create(&reader, NULL, timeout_reader, NULL);
+	ret += pthread_join(writer, NULL);
+	ret += pthread_join(reader, NULL);
+
+	rt_rwlock_release(&timeout_lock);
+	rt_rwlock_detach(&timeout_lock);
+
+	printf("writer timeout: writer %d, reader %d in %d ticks\n",
+		(int)writer_result, (int)reader_result, (int)reader_tick);
+
+	return (ret != 0 || writer_result != -RT_ETIMEOUT || reader_result != RT_EOK) ? -1 : 0;
+}
+
+int libc_rwlock_bench(void)
+{
+	int ret = 0;
+
+	pthread_rwlock_init(&rwlock, NULL);
+	pthread_mutex_init(&mutex, NULL);
+
+	ret += rwlock_run("rwlock", rwlock_worker);
+	ret += rwlock_run("mutex", mutex_worker);
+	ret += rwlock_timeout_run();
+
+	pthread_rwlock_destroy(&rwlock);
+	pthread_mutex_destroy(&mutex);
+
+	if (ret != 0)
+	{
+		printf("rwlock bench failed\n");
+		return -1;
+	}
+
+	printf("rwlock bench passed\n");
+	return 0;
+}
+#include <finsh.h>
+FINSH_FUNCTION_EXPORT(libc_rwlock_bench, read-mostly contention of pthread rwlock);
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-19     RT-Thread    the first version
+ */
+
+/* Contention stress of pthread_spin_lock and rt_atomic_add, the threads of
+   the same priority are preempted by the time slice inside the critical
+   section. It runs on the boards and on the host simulator. */
+
+#include <stdio.h>
+#include <rtatomic.h>
+#include "pthread.h"
+
+#define SPIN_THREADS    4
+#define SPIN_LOOPS      100000
+
+static pthread_spinlock_t spin;
+static volatile long spin_counter;
+static volatile rt_atomic_t atomic_counter;
+
+static void *spin_worker(void *arg)
+{
+	int i;
+
+	for (i = 0; i < SPIN_LOOPS; i++)
+	{
+		pthread_spin_lock(&spin);
+		/* non-atomic read-modify-write protected by the lock */
+		spin_counter = spin_counter + 1;
+		pthread_spin_unlock(&spin);
+
+		rt_atomic_add(&atomic_counter, 1);
+	}
+
+	return NULL;
+}
+
+int libc_spin_stress(void)
+{
+	int i, ret = 0;
+	pthread_t th[SPIN_THREADS];
+	rt_tick_t tick;
+
+	spin_counter = 0;
+	rt_atomic_store(&atomic_counter, 0);
+	pthread_spin_init(&spin, PTHREAD_PROCESS_PRIVATE);
+
+	tick = rt_tick_get();
+	for (i = 0; i < SPIN_THREADS; i++)
+		ret += pthread_create(&th[i], NULL, spin_worker, NULL);
+	for (i = 0; i < SPIN_THREADS; i++)
+		ret += pthread_join(th[i], NULL);
+	tick = rt_tick_get() - tick;
+
+	pthread_spin_destroy(&spin);
+
+	printf("spin counter %ld, atomic counter %ld, expected %d, %d ticks\n",
+		spin_counter, (long)rt_atomic_load(&atomic_counter),
+		SPIN_THREADS * SPIN_LOOPS, (int)tick);
+	if (ret != 0 || spin_counter != SPIN_THREADS * SPIN_LOOPS ||
+		rt_atomic_load(&atomic_counter) != SPIN_THREADS * SPIN_LOOPS)
+	{
+		printf("spin stress failed\n");
+		return -1;
+	}
+
+	printf("spin stress passed\n");
+	return 0;
+}
+#include <finsh.h>
+FINSH_FUNCTION_EXPORT(libc_spin_stress, contention stress of pthread spinlock);
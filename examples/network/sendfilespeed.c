@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-15     RT-Thread    the first version
+ */
+
+/*
+ * Compare the read()+send() loop with sendfile() when a file is served over
+ * TCP. Start a sink on the host, e.g. "nc -l 5001 > /dev/null", then:
+ *
+ *     msh />sendfilespeed /romfs/test.bin 192.168.1.10 5001
+ *
+ * The files on romfs are sent without copying, the others through the
+ * bounce buffer of sendfile.
+ */
+
+#include <rtthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(SAL_USING_POSIX)
+#error "Please enable SAL_USING_POSIX!"
+#endif
+
+#include <dfs_posix.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include "netdb.h"
+
+#define BUFSZ   1024
+
+static int sendfile_connect(const char *url, int port)
+{
+    int sock;
+    struct hostent *host;
+    struct sockaddr_in server_addr;
+
+    host = gethostbyname(url);
+    if (host == RT_NULL)
+    {
+        rt_kprintf("get host by name failed\n");
+        return -1;
+    }
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        rt_kprintf("create socket failed\n");
+        return -1;
+    }
+
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr = *((struct in_addr *)host->h_addr);
+    rt_memset(&(server_addr.sin_zero), 0, sizeof(server_addr.sin_zero));
+
+    if (connect(sock, (struct sockaddr *)&server_addr, sizeof(struct sockaddr)) < 0)
+    {
+        rt_kprintf("connect failed\n");
+        closesocket(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+static void sendfile_report(const char *name, rt_size_t length, rt_tick_t tick)
+{
+    if (tick == 0)
+        tick = 1;
+
+    rt_kprintf("%s: %d bytes in %d ticks, %d byte/s\n", name, length, tick,
+               length / tick * RT_TICK_PER_SECOND);
+}
+
+static rt_size_t read_send(int sock, int fd)
+{
+    char *buf;
+    rt_size_t total = 0;
+
+    buf = rt_malloc(BUFSZ);
+    if (buf == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return 0;
+    }
+
+    while (1)
+    {
+        int length, sent = 0;
+
+        length = read(fd, buf, BUFSZ);
+        if (length <= 0) break;
+
+        while (sent < length)
+        {
+            int result = send(sock, buf + sent, length - sent, 0);
+            if (result <= 0) goto __exit;
+            sent += result;
+        }
+        total += length;
+    }
+
+__exit:
+    rt_free(buf);
+    return total;
+}
+
+static rt_size_t send_file(int sock, int fd)
+{
+    rt_size_t total = 0;
+    off_t offset = 0;
+    struct stat st;
+
+    if (fstat(fd, &st) < 0)
+        return 0;
+
+    while (total < st.st_size)
+    {
+        ssize_t result = sendfile(sock, fd, &offset, st.st_size - total);
+        if (result <= 0) break;
+        total += result;
+    }
+
+    return total;
+}
+
+static void sendfilespeed(int argc, char **argv)
+{
+    int fd, sock;
+    rt_size_t length;
+    rt_tick_t tick;
+
+    if (argc != 4)
+    {
+        rt_kprintf("Usage: sendfilespeed file host port\n");
+        return;
+    }
+
+    fd = open(argv[1], O_RDONLY, 0);
+    if (fd < 0)
+    {
+        rt_kprintf("open file:%s failed\n", argv[1]);
+        return;
+    }
+
+    /* read() + send() */
+    sock = sendfile_connect(argv[2], atoi(argv[3]));
+    if (sock >= 0)
+    {
+        tick = rt_tick_get();
+        length = read_send(sock, fd);
+        tick = rt_tick_get() - tick;
+        closesocket(sock);
+        sendfile_report("read+send", length, tick);
+    }
+
+    /* sendfile() */
+    sock = sendfile_connect(argv[2], atoi(argv[3]));
+    if (sock >= 0)
+    {
+        tick = rt_tick_get();
+        length = send_file(sock, fd);
+        tick = rt_tick_get() - tick;
+        closesocket(sock);
+        sendfile_report("sendfile", length, tick);
+    }
+
+    close(fd);
+}
+#ifdef RT_USING_FINSH
+#include <finsh.h>
+MSH_CMD_EXPORT(sendfilespeed, compare read+send with sendfile);
+#endif
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-14     RT-Thread    the first version
+ */
+
+/*
+ * A virtual sound card "vaudio" for the period ring of replay
+ * (RT_AUDIO_USING_PERIOD). The DMA buffer has two periods, a timer takes
+ * the place of the half and full complete interrupts, one period every tick.
+ * The first sample of every period written is its sequence number, the card
+ * checks the played periods and measures the latency from rt_device_write()
+ * to the DAC:
+ *
+ *     msh />audio_period 2000 100 50
+ *
+ * plays a stream for 2000 ms, the writer stalls 100 ms in the middle, and 50
+ * periods of prompt are mixed in by the channel 1 of mixer at half volume
+ * (RT_AUDIO_MIXER_CHANNELS > 1).
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#if defined(RT_USING_AUDIO) && defined(RT_AUDIO_USING_PERIOD)
+
+#define VAUDIO_NAME         "vaudio"
+#define VAUDIO_RATE         48000
+#define VAUDIO_SAMPLES      (VAUDIO_RATE / RT_TICK_PER_SECOND)  /* mono 16 bits samples of a period */
+#define VAUDIO_PERIOD       (VAUDIO_SAMPLES * 2)
+#define VAUDIO_PERIODS      2
+
+#define PROMPT_SAMPLE       1000
+#define LATENCY_SLOTS       64
+#define SEQ_MAX             30000
+
+struct vaudio
+{
+    struct rt_audio_device audio;
+    struct rt_timer timer;
+    rt_int16_t buffer[VAUDIO_SAMPLES * VAUDIO_PERIODS];
+    rt_uint32_t play_pos;
+
+    /* the checks of played periods */
+    rt_int32_t last_seq;
+    rt_uint32_t played, gaps, mixed;
+    rt_uint32_t latency_sum, latency_max;
+};
+static struct vaudio vaudio;
+static rt_tick_t write_tick[LATENCY_SLOTS];
+
+static void vaudio_check(struct vaudio *v, const rt_int16_t *period)
+{
+    rt_int32_t prompt = period[1];
+    rt_int32_t seq = period[0] - prompt;
+    rt_tick_t latency;
+
+    if (prompt != 0)
+        v->mixed ++;
+    if (seq == 0)
+        return;
+
+    if (v->last_seq != 0 && seq != v->last_seq % SEQ_MAX + 1)
+        v->gaps ++;
+    v->last_seq = seq;
+
+    latency = rt_tick_get() - write_tick[seq % LATENCY_SLOTS];
+    v->latency_sum += latency;
+    if (latency > v->latency_max)
+        v->latency_max = latency;
+    v->played ++;
+}
+
+/* the half or full complete interrupt of DMA */
+static void vaudio_dma_done(void *parameter)
+{
+    struct vaudio *v = (struct vaudio *)parameter;
+
+    /* the period has been played, the DMA goes on with the other one */
+    vaudio_check(v, &v->buffer[v->play_pos / 2]);
+    rt_audio_tx_complete(&v->audio);
+    v->play_pos = (v->play_pos + VAUDIO_PERIOD) % sizeof(v->buffer);
+}
+
+static rt_err_t vaudio_getcaps(struct rt_audio_device *audio, struct rt_audio_caps *caps)
+{
+    return RT_EOK;
+}
+
+static rt_err_t vaudio_configure(struct rt_audio_device *audio, struct rt_audio_caps *caps)
+{
+    return RT_EOK;
+}
+
+static rt_err_t vaudio_init(struct rt_audio_device *audio)
+{
+    rt_timer_init(&vaudio.timer, VAUDIO_NAME, vaudio_dma_done, &vaudio, 1, RT_TIMER_FLAG_PERIODIC);
+    return RT_EOK;
+}
+
+static rt_err_t vaudio_start(struct rt_audio_device *audio, int stream)
+{
+    if (stream == AUDIO_STREAM_REPLAY)
+    {
+        rt_memset(vaudio.buffer, 0, sizeof(vaudio.buffer));
+        vaudio.play_pos = 0;
+        rt_timer_start(&vaudio.timer);
+    }
+    return RT_EOK;
+}
+
+static rt_err_t vaudio_stop(struct rt_audio_device *audio, int stream)
+{
+    if (stream == AUDIO_STREAM_REPLAY)
+        rt_timer_stop(&vaudio.timer);
+    return RT_EOK;
+}
+
+static rt_size_t vaudio_transmit(struct rt_audio_device *audio, const void *writeBuf, void *readBuf, rt_size_t size)
+{
+    /* the period is in the circular DMA buffer already */
+    return size;
+}
+
+static void vaudio_buffer_info(struct rt_audio_device *audio, struct rt_audio_buf_info *info)
+{
+    info->buffer = (rt_uint8_t *)vaudio.buffer;
+    info->block_size = VAUDIO_PERIOD;
+    info->block_count = VAUDIO_PERIODS;
+    info->total_size = sizeof(vaudio.buffer);
+}
+
+static struct rt_audio_ops vaudio_ops =
+{
+    vaudio_getcaps,
+    vaudio_configure,
+    vaudio_init,
+    vaudio_start,
+    vaudio_stop,
+    vaudio_transmit,
+    vaudio_buffer_info,
+};
+
+static rt_device_t vaudio_get(void)
+{
+    if (vaudio.audio.ops == RT_NULL)
+    {
+        vaudio.audio.ops = &vaudio_ops;
+        rt_audio_register(&vaudio.audio, VAUDIO_NAME, RT_DEVICE_FLAG_WRONLY, RT_NULL);
+    }
+
+    return &vaudio.audio.parent;
+}
+
+#if RT_AUDIO_MIXER_CHANNELS > 1
+static struct rt_semaphore prompt_done;
+
+static void prompt_entry(void *parameter)
+{
+    static rt_int16_t period[VAUDIO_SAMPLES];
+    int i, count = (int)parameter;
+
+    for (i = 0; i < VAUDIO_SAMPLES; i++)
+    {
+        period[i] = PROMPT_SAMPLE;
+    }
+
+    rt_audio_mixer_volume(&vaudio.audio, 1, AUDIO_VOLUME_MAX / 2);
+    for (i = 0; i < count; i++)
+    {
+        rt_audio_mixer_write(&vaudio.audio, 1, period, sizeof(period));
+    }
+    rt_sem_release(&prompt_done);
+}
+#endif /* RT_AUDIO_MIXER_CHANNELS > 1 */
+
+static void audio_period(int argc, char **argv)
+{
+    static rt_int16_t period[VAUDIO_SAMPLES];
+    struct rt_audio_replay_stat stat;
+    rt_device_t dev;
+    rt_tick_t end;
+    int ms = 2000, stall = 0, prompt = 0, seq = 0;
+    rt_uint32_t queued_max = 0;
+
+    if (argc > 1) ms = atoi(argv[1]);
+    if (argc > 2) stall = atoi(argv[2]);
+    if (argc > 3) prompt = atoi(argv[3]);
+
+    dev = vaudio_get();
+    if (rt_device_open(dev, RT_DEVICE_OFLAG_WRONLY) != RT_EOK)
+    {
+        rt_kprintf("open %s failed\n", VAUDIO_NAME);
+        return;
+    }
+    vaudio.last_seq = 0;
+    vaudio.played = vaudio.gaps = vaudio.mixed = 0;
+    vaudio.latency_sum = vaudio.latency_max = 0;
+    rt_memset(period, 0, sizeof(period));
+
+#if RT_AUDIO_MIXER_CHANNELS > 1
+    rt_sem_init(&prompt_done, "prompt", 0, RT_IPC_FLAG_FIFO);
+    if (prompt > 0)
+    {
+        rt_thread_t tid = rt_thread_create("prompt", prompt_entry, (void *)prompt, 1024, RT_THREAD_PRIORITY_MAX / 2, 10);
+
+        if (tid != RT_NULL)
+            rt_thread_startup(tid);
+        else
+            prompt = 0;
+    }
+#else
+    if (prompt > 0)
+        rt_kprintf("no channel of mixer for the prompt\n");
+#endif
+
+    end = rt_tick_get() + rt_tick_from_millisecond(ms);
+    while ((rt_int32_t)(end - rt_tick_get()) > 0)
+    {
+        seq = seq % SEQ_MAX + 1;
+        period[0] = seq;
+        write_tick[seq % LATENCY_SLOTS] = rt_tick_get();
+        rt_device_write(dev, 0, period, sizeof(period));
+
+        rt_device_control(dev, AUDIO_CTL_GETSTAT, &stat);
+        if (stat.queued > queued_max)
+            queued_max = stat.queued;
+
+        /* the writer is late once */
+        if (stall > 0 && (rt_int32_t)(end - rt_tick_get()) < rt_tick_from_millisecond(ms / 2))
+        {
+            rt_thread_mdelay(stall);
+            stall = 0;
+        }
+    }
+
+#if RT_AUDIO_MIXER_CHANNELS > 1
+    if (prompt > 0)
+        rt_sem_take(&prompt_done, RT_WAITING_FOREVER);
+    rt_sem_detach(&prompt_done);
+#endif
+    rt_device_close(dev);
+    rt_device_control(dev, AUDIO_CTL_GETSTAT, &stat);
+
+    rt_kprintf("%d periods of %d bytes, %d underrun, %d played, %d gaps, %d mixed\n", stat.periods,
+               VAUDIO_PERIOD, stat.underrun, vaudio.played, vaudio.gaps, vaudio.mixed);
+    rt_kprintf("latency %d ms average, %d ms max, %d bytes queued at most\n",
+               vaudio.played ? vaudio.latency_sum * 1000 / RT_TICK_PER_SECOND / vaudio.played : 0,
+               vaudio.latency_max * 1000 / RT_TICK_PER_SECOND, queued_max);
+}
+MSH_CMD_EXPORT(audio_period, measure the latency of replay on a virtual sound card);
+
+#endif /* RT_USING_AUDIO && RT_AUDIO_USING_PERIOD */
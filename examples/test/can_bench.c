@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-03     RT-Thread    the first version
+ */
+
+/*
+ * A virtual CAN device "vcan" which loops every sent message back to the
+ * receiver, like the vcan of Linux. The messages are not matched by any
+ * hardware filter, the software filters of CAN framework (RT_CAN_USING_HDR)
+ * are used. The framework is measured without a bus:
+ *
+ *     msh />can_bench 10000 8
+ *
+ * sends 10000 messages to 8 filtered ids and 1 unfiltered id, reads them
+ * back in batches.
+ */
+
+#include <rthw.h>
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#ifdef RT_USING_CAN
+
+#define VCAN_NAME           "vcan"
+#define VCAN_SND_BOX_NUM    1
+#define VCAN_MAX_HDR        16
+
+#define CAN_BENCH_BATCH     8
+#define CAN_BENCH_BASE_ID   0x100
+
+static struct rt_can_device vcan;
+static struct rt_can_msg vcan_box[VCAN_SND_BOX_NUM];
+
+static rt_err_t vcan_configure(struct rt_can_device *can, struct can_configure *cfg)
+{
+    return RT_EOK;
+}
+
+static rt_err_t vcan_control(struct rt_can_device *can, int cmd, void *arg)
+{
+    /* there is no hardware filter and status */
+    return RT_EOK;
+}
+
+static int vcan_sendmsg(struct rt_can_device *can, const void *buf, rt_uint32_t boxno)
+{
+    rt_base_t level;
+
+    vcan_box[boxno] = *(const struct rt_can_msg *)buf;
+
+    /* the interrupts of receiving and sending */
+    level = rt_hw_interrupt_disable();
+    if (can->parent.open_flag & RT_DEVICE_FLAG_INT_RX)
+    {
+        rt_hw_can_isr(can, RT_CAN_EVENT_RX_IND | boxno << 8);
+    }
+    rt_hw_can_isr(can, RT_CAN_EVENT_TX_DONE | boxno << 8);
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+static int vcan_recvmsg(struct rt_can_device *can, void *buf, rt_uint32_t boxno)
+{
+    struct rt_can_msg *msg = (struct rt_can_msg *)buf;
+
+    *msg = vcan_box[boxno];
+    /* not matched by hardware */
+    msg->hdr = -1;
+
+    return RT_EOK;
+}
+
+static const struct rt_can_ops vcan_ops =
+{
+    vcan_configure,
+    vcan_control,
+    vcan_sendmsg,
+    vcan_recvmsg,
+};
+
+static rt_device_t vcan_get(void)
+{
+    struct can_configure config = CANDEFAULTCONFIG;
+
+    if (vcan.ops == RT_NULL)
+    {
+        config.ticks = RT_TICK_PER_SECOND;
+        config.sndboxnumber = VCAN_SND_BOX_NUM;
+#ifdef RT_CAN_USING_HDR
+        config.maxhdr = VCAN_MAX_HDR;
+#endif
+        vcan.config = config;
+        rt_hw_can_register(&vcan, VCAN_NAME, &vcan_ops, RT_NULL);
+    }
+
+    return &vcan.parent;
+}
+
+#ifdef RT_CAN_USING_HDR
+static volatile rt_uint32_t filter_ind;
+
+static rt_err_t can_bench_ind(rt_device_t dev, void *args, rt_int32_t hdr, rt_size_t size)
+{
+    filter_ind ++;
+    return RT_EOK;
+}
+
+static void can_bench_filter(rt_device_t dev, int ids, rt_bool_t actived)
+{
+    struct rt_can_filter_item items[VCAN_MAX_HDR];
+    struct rt_can_filter_config cfg;
+    int i;
+
+    rt_memset(items, 0, sizeof(items));
+    for (i = 0; i < ids; i++)
+    {
+        items[i].id = CAN_BENCH_BASE_ID + i;
+        items[i].mask = 0xFFFFFFFF;
+        items[i].hdr = i;
+        items[i].ind = can_bench_ind;
+    }
+    cfg.count = ids;
+    cfg.actived = actived;
+    cfg.items = items;
+
+    rt_device_control(dev, RT_CAN_CMD_SET_FILTER, &cfg);
+}
+#endif /* RT_CAN_USING_HDR */
+
+static void can_bench(int argc, char **argv)
+{
+    struct rt_can_msg msg[CAN_BENCH_BATCH];
+    struct rt_can_status status;
+    rt_device_t dev;
+    int i, count = 10000, ids = 8, sent = 0, received = 0;
+    rt_tick_t tick;
+
+    if (argc > 1) count = atoi(argv[1]);
+    if (argc > 2) ids = atoi(argv[2]);
+    if (ids > VCAN_MAX_HDR) ids = VCAN_MAX_HDR;
+
+    dev = vcan_get();
+    if (rt_device_open(dev, RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_INT_TX) != RT_EOK)
+    {
+        rt_kprintf("open %s failed\n", VCAN_NAME);
+        return;
+    }
+#ifdef RT_CAN_USING_HDR
+    filter_ind = 0;
+    can_bench_filter(dev, ids, RT_TRUE);
+#endif
+
+    tick = rt_tick_get();
+    while (sent < count)
+    {
+        /* the ids of filters and one more id without filter */
+        for (i = 0; i < CAN_BENCH_BATCH; i++)
+        {
+            rt_memset(&msg[i], 0, sizeof(struct rt_can_msg));
+            msg[i].id = CAN_BENCH_BASE_ID + (sent + i) % (ids + 1);
+            msg[i].len = 8;
+            rt_memcpy(msg[i].data, &sent, sizeof(sent));
+        }
+        sent += rt_device_write(dev, 0, msg, sizeof(msg)) / sizeof(struct rt_can_msg);
+
+        /* hdr -1 reads the messages of any filter */
+        for (i = 0; i < CAN_BENCH_BATCH; i++)
+        {
+            msg[i].hdr = -1;
+        }
+        received += rt_device_read(dev, 0, msg, sizeof(msg)) / sizeof(struct rt_can_msg);
+    }
+    tick = rt_tick_get() - tick;
+
+#ifdef RT_CAN_USING_HDR
+    can_bench_filter(dev, ids, RT_FALSE);
+#endif
+    status = vcan.status;
+    rt_device_close(dev);
+
+    rt_kprintf("%d sent, %d received, %d dropped in %d ticks, %d msgs/s\n", sent, received,
+               status.dropedrcvpkg, tick, tick ? received * RT_TICK_PER_SECOND / tick : 0);
+#ifdef RT_CAN_USING_HDR
+    rt_kprintf("%d messages are indicated by %d filters\n", filter_ind, ids);
+#endif
+}
+MSH_CMD_EXPORT(can_bench, measure the receiving of CAN framework on a virtual CAN);
+
+#endif /* RT_USING_CAN */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-24     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    detach the semaphore of failed thread
+ */
+
+/*
+ * The memory and the throughput of many mostly idle activities, a thread for
+ * every activity against the stackless tasks on one executor
+ * (RT_USING_EXECUTOR). Every activity waits for its events, the shell thread
+ * sends the events to the activities one by one and waits for the reply:
+ *
+ *     msh />executor_bench 32 100
+ *
+ * runs 32 activities, each of them gets 100 events.
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <ipc/executor.h>
+#include <stdlib.h>
+
+#if defined(RT_USING_HEAP) && defined(RT_USING_EXECUTOR)
+
+#define BENCH_STACK_SIZE    512
+#define BENCH_PRIORITY      (RT_THREAD_PRIORITY_MAX / 2)
+
+struct bench_thread
+{
+    rt_thread_t tid;
+    struct rt_semaphore event;
+    rt_bool_t stop;
+};
+
+struct bench_task
+{
+    struct rt_task task;
+    rt_wqueue_t queue;
+    rt_uint32_t events, done;
+    rt_bool_t stop;
+};
+
+static struct rt_semaphore bench_reply;
+
+static rt_uint32_t bench_used(void)
+{
+    rt_uint32_t total, used, max_used;
+
+    rt_memory_info(&total, &used, &max_used);
+    return used;
+}
+
+static void bench_thread_entry(void *parameter)
+{
+    struct bench_thread *thread = (struct bench_thread *)parameter;
+
+    while (1)
+    {
+        rt_sem_take(&thread->event, RT_WAITING_FOREVER);
+        if (thread->stop)
+            break;
+        rt_sem_release(&bench_reply);
+    }
+    rt_sem_release(&bench_reply);
+}
+
+static void bench_threads(int num, int count)
+{
+    struct bench_thread *threads;
+    rt_uint32_t used;
+    rt_tick_t tick;
+    int i, j;
+
+    used = bench_used();
+    threads = (struct bench_thread *)rt_calloc(num, sizeof(struct bench_thread));
+    if (threads == RT_NULL)
+        return;
+    for (i = 0; i < num; i++)
+    {
+        rt_sem_init(&threads[i].event, "bench", 0, RT_IPC_FLAG_FIFO);
+        threads[i].tid = rt_thread_create("bench", bench_thread_entry, &threads[i], BENCH_STACK_SIZE,
+                                          BENCH_PRIORITY, 10);
+        if (threads[i].tid == RT_NULL)
+        {
+            rt_sem_detach(&threads[i].event);
+            break;
+        }
+        rt_thread_startup(threads[i].tid);
+    }
+    num = i;
+    used = bench_used() - used;
+
+    tick = rt_tick_get();
+    for (j = 0; j < count; j++)
+    {
+        for (i = 0; i < num; i++)
+        {
+            rt_sem_release(&threads[i].event);
+            rt_sem_take(&bench_reply, RT_WAITING_FOREVER);
+        }
+    }
+    tick = rt_tick_get() - tick;
+
+    for (i = 0; i < num; i++)
+    {
+        threads[i].stop = RT_TRUE;
+        rt_sem_release(&threads[i].event);
+        rt_sem_take(&bench_reply, RT_WAITING_FOREVER);
+        rt_sem_detach(&threads[i].event);
+    }
+    rt_free(threads);
+
+    rt_kprintf("threads : %d with %d bytes of stack, %d bytes of memory, %d events in %d ticks\n", num,
+               BENCH_STACK_SIZE, used, num * count, tick);
+}
+
+static int bench_task_entry(struct rt_task *task)
+{
+    struct bench_task *bench = rt_container_of(task, struct bench_task, task);
+
+    RT_TASK_BEGIN(task);
+    while (1)
+    {
+        RT_TASK_AWAIT(task, rt_task_wqueue_wait(task, &bench->queue, bench->events != bench->done,
+                                                RT_WAITING_FOREVER));
+        if (bench->stop)
+            break;
+        /* the wakeup before the await is taken */
+        if (bench->done == bench->events)
+            continue;
+        bench->done = bench->events;
+        rt_sem_release(&bench_reply);
+    }
+    RT_TASK_END(task);
+}
+
+static void bench_executor_entry(void *parameter)
+{
+    rt_executor_run((struct rt_executor *)parameter);
+    rt_sem_release(&bench_reply);
+}
+
+static void bench_tasks(int num, int count)
+{
+    struct rt_executor *executor;
+    struct bench_task *tasks;
+    rt_thread_t tid;
+    rt_uint32_t used;
+    rt_tick_t tick;
+    int i, j;
+
+    used = bench_used();
+    executor = (struct rt_executor *)rt_malloc(sizeof(struct rt_executor));
+    tasks = (struct bench_task *)rt_calloc(num, sizeof(struct bench_task));
+    if (executor == RT_NULL || tasks == RT_NULL)
+    {
+        rt_free(executor);
+        rt_free(tasks);
+        return;
+    }
+    rt_executor_init(executor);
+    for (i = 0; i < num; i++)
+    {
+        rt_wqueue_init(&tasks[i].queue);
+        rt_task_init(&tasks[i].task, bench_task_entry, RT_NULL);
+        rt_executor_spawn(executor, &tasks[i].task);
+    }
+    /* the same stack as a thread of bench_threads() */
+    tid = rt_thread_create("executor", bench_executor_entry, executor, BENCH_STACK_SIZE, BENCH_PRIORITY, 10);
+    if (tid == RT_NULL)
+    {
+        rt_free(executor);
+        rt_free(tasks);
+        return;
+    }
+    used = bench_used() - used;
+    rt_thread_startup(tid);
+
+    tick = rt_tick_get();
+    for (j = 0; j < count; j++)
+    {
+        for (i = 0; i < num; i++)
+        {
+            tasks[i].events ++;
+            rt_wqueue_wakeup(&tasks[i].queue, RT_NULL);
+            rt_sem_take(&bench_reply, RT_WAITING_FOREVER);
+        }
+    }
+    tick = rt_tick_get() - tick;
+
+    /* the executor thread exits when all tasks are done */
+    for (i = 0; i < num; i++)
+    {
+        tasks[i].stop = RT_TRUE;
+        tasks[i].events ++;
+        rt_wqueue_wakeup(&tasks[i].queue, RT_NULL);
+    }
+    rt_sem_take(&bench_reply, RT_WAITING_FOREVER);
+
+    rt_kprintf("tasks   : %d on 1 executor, %d bytes of memory, %d events in %d ticks, %d resumes\n", num,
+               used, num * count, tick, executor->resumes);
+    rt_free(tasks);
+    rt_free(executor);
+}
+
+static void executor_bench(int argc, char **argv)
+{
+    int num = 32, count = 100;
+
+    if (argc > 1) num = atoi(argv[1]);
+    if (argc > 2) count = atoi(argv[2]);
+    if (num <= 0)
+        num = 1;
+
+    rt_sem_init(&bench_reply, "bench", 0, RT_IPC_FLAG_FIFO);
+    bench_threads(num, count);
+    bench_tasks(num, count);
+    rt_sem_detach(&bench_reply);
+}
+MSH_CMD_EXPORT(executor_bench, compare the threads and the stackless tasks);
+
+#endif /* RT_USING_HEAP && RT_USING_EXECUTOR */
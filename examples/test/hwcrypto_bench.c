@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-10     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    compare the results of batch with the single ones
+ */
+
+/*
+ * The throughput of crypto engines, the hardware device (if any) against the
+ * software device (RT_HWCRYPTO_USING_SOFT). The results of the engines are
+ * compared. The small packets are done one by one and by a batch
+ * (RT_HWCRYPTO_USING_BATCH):
+ *
+ *     msh />hwcrypto_bench 1024 256
+ *
+ * does 256 blocks of 1024 bytes by every engine.
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#if defined(RT_USING_HWCRYPTO) && defined(RT_HWCRYPTO_USING_SOFT)
+
+#define BENCH_PACKET_SIZE   64
+#define BENCH_PACKET_NUM    32
+
+struct bench_result
+{
+    rt_tick_t tick;
+    rt_uint8_t check[32];               /**< The result of engine is compared */
+    rt_bool_t done;
+};
+
+static const rt_uint8_t bench_key[16] =
+{
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+
+static const rt_uint8_t bench_iv[16] =
+{
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+};
+
+/* The context is created on the device, the fallback to software is not measured */
+static struct rt_hwcrypto_ctx *bench_ctx_check(struct rt_hwcrypto_ctx *ctx, struct rt_hwcrypto_device *device)
+{
+    if (ctx && ctx->device != device)
+    {
+        rt_hwcrypto_ctx_destroy(ctx);
+        ctx = RT_NULL;
+    }
+    return ctx;
+}
+
+#if defined(RT_HWCRYPTO_USING_CRC)
+static void bench_crc(struct rt_hwcrypto_device *device, rt_uint8_t *buf, int size, int count, struct bench_result *res)
+{
+    struct hwcrypto_crc_cfg cfg = HWCRYPTO_CRC32_CFG;
+    struct rt_hwcrypto_ctx *ctx;
+    rt_uint32_t crc = 0;
+    int i;
+
+    ctx = bench_ctx_check(rt_hwcrypto_crc_create(device, HWCRYPTO_CRC_CRC32), device);
+    if (ctx == RT_NULL)
+        return;
+
+    /* the configure of STM32F4 CRC unit */
+    cfg.last_val = 0xFFFFFFFF;
+    rt_hwcrypto_crc_cfg(ctx, &cfg);
+
+    res->tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        crc = rt_hwcrypto_crc_update(ctx, buf, size);
+    }
+    res->tick = rt_tick_get() - res->tick;
+
+    rt_memcpy(res->check, &crc, sizeof(crc));
+    res->done = RT_TRUE;
+    rt_hwcrypto_crc_destroy(ctx);
+}
+#endif /* RT_HWCRYPTO_USING_CRC */
+
+#if defined(RT_HWCRYPTO_USING_SHA2)
+static void bench_sha256(struct rt_hwcrypto_device *device, rt_uint8_t *buf, int size, int count, struct bench_result *res)
+{
+    struct rt_hwcrypto_ctx *ctx;
+    int i;
+
+    ctx = bench_ctx_check(rt_hwcrypto_hash_create(device, HWCRYPTO_TYPE_SHA256), device);
+    if (ctx == RT_NULL)
+        return;
+
+    res->tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        rt_hwcrypto_hash_update(ctx, buf, size);
+    }
+    rt_hwcrypto_hash_finish(ctx, res->check, sizeof(res->check));
+    res->tick = rt_tick_get() - res->tick;
+
+    res->done = RT_TRUE;
+    rt_hwcrypto_hash_destroy(ctx);
+}
+#endif /* RT_HWCRYPTO_USING_SHA2 */
+
+#if defined(RT_HWCRYPTO_USING_AES)
+static void bench_aes_ctr(struct rt_hwcrypto_device *device, rt_uint8_t *buf, int size, int count, struct bench_result *res)
+{
+    struct rt_hwcrypto_ctx *ctx;
+    rt_uint8_t *out;
+    int i;
+
+    out = rt_malloc(size);
+    if (out == RT_NULL)
+        return;
+    ctx = bench_ctx_check(rt_hwcrypto_symmetric_create(device, HWCRYPTO_TYPE_AES_CTR), device);
+    if (ctx == RT_NULL)
+    {
+        rt_free(out);
+        return;
+    }
+    rt_hwcrypto_symmetric_setkey(ctx, bench_key, 128);
+    rt_hwcrypto_symmetric_setiv(ctx, bench_iv, sizeof(bench_iv));
+
+    res->tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        rt_hwcrypto_symmetric_crypt(ctx, HWCRYPTO_MODE_ENCRYPT, size, buf, out);
+    }
+    res->tick = rt_tick_get() - res->tick;
+
+    /* the last block of key stream */
+    rt_memcpy(res->check, out + size - 16, 16);
+    res->done = RT_TRUE;
+    rt_hwcrypto_symmetric_destroy(ctx);
+    rt_free(out);
+}
+#endif /* RT_HWCRYPTO_USING_AES */
+
+static void bench_engines(const char *name, rt_uint8_t *buf, int size, int count,
+                          void (*bench)(struct rt_hwcrypto_device *, rt_uint8_t *, int, int, struct bench_result *))
+{
+    struct rt_hwcrypto_device *engine[2];
+    struct bench_result res[2];
+    int i, kbytes = size * count / 1024;
+
+    engine[0] = (struct rt_hwcrypto_device *)rt_device_find(RT_HWCRYPTO_DEFAULT_NAME);
+    engine[1] = rt_hwcrypto_dev_soft();
+    rt_memset(res, 0, sizeof(res));
+
+    for (i = 0; i < 2; i++)
+    {
+        if (engine[i] == RT_NULL)
+            continue;
+
+        bench(engine[i], buf, size, count, &res[i]);
+        if (!res[i].done)
+        {
+            rt_kprintf("%-12s %-8s: not supported\n", name, engine[i]->parent.parent.name);
+            continue;
+        }
+        rt_kprintf("%-12s %-8s: %d KB in %d ticks, %d KB/s\n", name, engine[i]->parent.parent.name, kbytes,
+                   res[i].tick, res[i].tick ? kbytes * RT_TICK_PER_SECOND / res[i].tick : 0);
+    }
+
+    if (res[0].done && res[1].done)
+    {
+        rt_kprintf("%-12s results %s\n", name,
+                   rt_memcmp(res[0].check, res[1].check, sizeof(res[0].check)) == 0 ? "match" : "MISMATCH");
+    }
+}
+
+#if defined(RT_HWCRYPTO_USING_BATCH) && defined(RT_HWCRYPTO_USING_CRC)
+#if defined(RT_HWCRYPTO_USING_SHA2)
+#define BENCH_REQ_NUM       (BENCH_PACKET_NUM * 2)
+#else
+#define BENCH_REQ_NUM       BENCH_PACKET_NUM
+#endif
+
+/* The CRC and the hash of every packet by a context of its own */
+struct bench_single
+{
+    rt_uint32_t crc;
+    rt_uint8_t hash[32];
+};
+
+static void bench_single_do(rt_uint8_t *buf, struct hwcrypto_crc_cfg *cfg, struct bench_single *single)
+{
+    struct rt_hwcrypto_ctx *ctx;
+
+    ctx = rt_hwcrypto_crc_create(rt_hwcrypto_dev_select(), HWCRYPTO_CRC_CUSTOM);
+    if (ctx != RT_NULL)
+    {
+        rt_hwcrypto_crc_cfg(ctx, cfg);
+        single->crc = rt_hwcrypto_crc_update(ctx, buf, BENCH_PACKET_SIZE);
+        rt_hwcrypto_crc_destroy(ctx);
+    }
+#if defined(RT_HWCRYPTO_USING_SHA2)
+    ctx = rt_hwcrypto_hash_create(rt_hwcrypto_dev_select(), HWCRYPTO_TYPE_SHA256);
+    if (ctx != RT_NULL)
+    {
+        rt_hwcrypto_hash_update(ctx, buf, BENCH_PACKET_SIZE);
+        rt_hwcrypto_hash_finish(ctx, single->hash, sizeof(single->hash));
+        rt_hwcrypto_hash_destroy(ctx);
+    }
+#endif
+}
+
+static void bench_batch(rt_uint8_t *buf, int count)
+{
+    static struct hwcrypto_request reqs[BENCH_REQ_NUM];
+    static struct hwcrypto_sg sg[BENCH_PACKET_NUM];
+    static struct bench_single single[BENCH_PACKET_NUM];
+#if defined(RT_HWCRYPTO_USING_SHA2)
+    static rt_uint8_t hash[BENCH_PACKET_NUM][32];
+#endif
+    struct hwcrypto_crc_cfg cfg = HWCRYPTO_CRC32_CFG;
+    struct hwcrypto_request *req;
+    int i, j, soft = 0, errors = 0, mismatch = 0;
+    rt_tick_t tick;
+
+    cfg.last_val = 0xFFFFFFFF;
+
+    /* a context of every packet */
+    rt_memset(single, 0, sizeof(single));
+    tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < BENCH_PACKET_NUM; j++)
+        {
+            bench_single_do(buf + j * BENCH_PACKET_SIZE, &cfg, &single[j]);
+        }
+    }
+    tick = rt_tick_get() - tick;
+    rt_kprintf("single       : %d x %d requests of %d bytes in %d ticks\n", count, BENCH_REQ_NUM,
+               BENCH_PACKET_SIZE, tick);
+
+    /* the contexts are shared by the batch, every result is the same as the single one */
+    tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        rt_memset(reqs, 0, sizeof(reqs));
+        for (j = 0; j < BENCH_PACKET_NUM; j++)
+        {
+            sg[j].buf = buf + j * BENCH_PACKET_SIZE;
+            sg[j].length = BENCH_PACKET_SIZE;
+
+            req = &reqs[j];
+            req->type = HWCRYPTO_TYPE_CRC;
+            req->sg = &sg[j];
+            req->sg_num = 1;
+            req->crc_cfg = cfg;
+#if defined(RT_HWCRYPTO_USING_SHA2)
+            req = &reqs[BENCH_PACKET_NUM + j];
+            req->type = HWCRYPTO_TYPE_SHA256;
+            req->sg = &sg[j];
+            req->sg_num = 1;
+            req->out = hash[j];
+            req->out_len = sizeof(hash[j]);
+#endif
+        }
+        if (rt_hwcrypto_batch(reqs, BENCH_REQ_NUM) != RT_EOK)
+            errors ++;
+        for (j = 0; j < BENCH_REQ_NUM; j++)
+        {
+            if (reqs[j].device == rt_hwcrypto_dev_soft())
+                soft ++;
+        }
+        for (j = 0; j < BENCH_PACKET_NUM; j++)
+        {
+            if (reqs[j].crc != single[j].crc)
+                mismatch ++;
+#if defined(RT_HWCRYPTO_USING_SHA2)
+            if (rt_memcmp(hash[j], single[j].hash, sizeof(hash[j])) != 0)
+                mismatch ++;
+#endif
+        }
+    }
+    tick = rt_tick_get() - tick;
+    rt_kprintf("batch        : %d x %d requests of %d bytes in %d ticks, %d by software, %d failed\n", count,
+               BENCH_REQ_NUM, BENCH_PACKET_SIZE, tick, soft, errors);
+    rt_kprintf("batch        results %s, %d mismatched\n", mismatch == 0 ? "match" : "MISMATCH", mismatch);
+}
+#endif /* RT_HWCRYPTO_USING_BATCH && RT_HWCRYPTO_USING_CRC */
+
+static void hwcrypto_bench(int argc, char **argv)
+{
+    rt_uint8_t *buf;
+    int i, size = 1024, count = 256;
+
+    if (argc > 1) size = atoi(argv[1]);
+    if (argc > 2) count = atoi(argv[2]);
+    /* the whole blocks of AES and the words of STM32F4 CRC unit */
+    size = (size + 15) & ~15;
+    if (size < BENCH_PACKET_SIZE * BENCH_PACKET_NUM)
+        size = BENCH_PACKET_SIZE * BENCH_PACKET_NUM;
+
+    buf = rt_malloc(size);
+    if (buf == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    for (i = 0; i < size; i++)
+    {
+        buf[i] = (rt_uint8_t)(i * 7 + 1);
+    }
+
+#if defined(RT_HWCRYPTO_USING_CRC)
+    bench_engines("crc32", buf, size, count, bench_crc);
+#endif
+#if defined(RT_HWCRYPTO_USING_SHA2)
+    bench_engines("sha256", buf, size, count, bench_sha256);
+#endif
+#if defined(RT_HWCRYPTO_USING_AES)
+    bench_engines("aes128-ctr", buf, size, count, bench_aes_ctr);
+#endif
+#if defined(RT_HWCRYPTO_USING_BATCH) && defined(RT_HWCRYPTO_USING_CRC)
+    bench_batch(buf, count);
+#endif
+
+    rt_free(buf);
+}
+MSH_CMD_EXPORT(hwcrypto_bench, compare the hardware and software crypto engines);
+
+#endif /* RT_USING_HWCRYPTO && RT_HWCRYPTO_USING_SOFT */
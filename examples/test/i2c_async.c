@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-17     RT-Thread    the first version
+ */
+
+/*
+ * A virtual GPIO simulated I2C bus "vi2c" with scripted register slaves at
+ * 0x40, 0x41..., the first one stretches the clock after its address. The
+ * registers of every slave are polled by the blocking rt_i2c_transfer() and
+ * by the queued transfers (RT_USING_I2C_ASYNC), a missing slave is probed in
+ * every cycle to check the NACK. The CPU time left to the thread while the
+ * queue is transferred is counted too:
+ *
+ *     msh />i2c_async 10 20 timer0
+ *
+ * polls 10 slaves 20 times, the state machine is stepped by the hwtimer
+ * "timer0" (or by a soft timer every tick without it).
+ */
+
+#include <rtthread.h>
+#include <rthw.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#if defined(RT_USING_I2C) && defined(RT_USING_I2C_BITOPS) && defined(RT_USING_I2C_ASYNC)
+
+#define VI2C_NAME           "vi2c"
+#define VI2C_SLAVE_MAX      10
+#define VI2C_SLAVE_ADDR     0x40
+#define VI2C_MISSING_ADDR   0x7F
+#define VI2C_STRETCH        1           /* get_scl polls of the stretched clock */
+#define VI2C_REG_SIZE       16
+#define VI2C_READ_SIZE      2
+
+enum
+{
+    VSLAVE_IDLE,
+    VSLAVE_ADDR,
+    VSLAVE_WRITE,
+    VSLAVE_READ,
+};
+
+/* the open drain lines and the slave which is selected */
+struct vi2c
+{
+    struct rt_i2c_bus_device bus;
+    struct rt_i2c_bit_ops ops;
+
+    rt_int32_t m_sda, m_scl;            /* driven by master */
+    rt_int32_t s_sda;                   /* driven by slave */
+    rt_int32_t hold;                    /* the clock is stretched */
+
+    rt_uint8_t state;
+    rt_int8_t bit;
+    rt_uint8_t shift;
+    rt_uint8_t read;                    /* the address is read */
+    rt_uint8_t nack;                    /* master NACK in read */
+    rt_uint8_t reg_set;                 /* the register pointer is written */
+    rt_int32_t slave;                   /* -1 when nothing is selected */
+    rt_uint8_t reg[VI2C_SLAVE_MAX];
+    rt_uint8_t mem[VI2C_SLAVE_MAX][VI2C_REG_SIZE];
+};
+static struct vi2c vi2c;
+
+#define SDA_LINE(v)     ((v)->m_sda & (v)->s_sda)
+#define SCL_LINE(v)     ((v)->m_scl && (v)->hold == 0)
+
+static void vi2c_byte_received(struct vi2c *v)
+{
+    if (v->state == VSLAVE_ADDR)
+    {
+        v->slave = (v->shift >> 1) - VI2C_SLAVE_ADDR;
+        if (v->slave < 0 || v->slave >= VI2C_SLAVE_MAX)
+        {
+            /* not selected, the address is NACK */
+            v->slave = -1;
+            v->state = VSLAVE_IDLE;
+            return;
+        }
+        v->read = v->shift & 1;
+        v->reg_set = 0;
+        if (v->slave == 0)
+            v->hold = VI2C_STRETCH;
+    }
+    else if (v->reg_set == 0)
+    {
+        v->reg[v->slave] = v->shift % VI2C_REG_SIZE;
+        v->reg_set = 1;
+    }
+    else
+    {
+        v->mem[v->slave][v->reg[v->slave]] = v->shift;
+        v->reg[v->slave] = (v->reg[v->slave] + 1) % VI2C_REG_SIZE;
+    }
+
+    /* ACK */
+    v->s_sda = 0;
+}
+
+static void vi2c_load(struct vi2c *v)
+{
+    v->shift = v->mem[v->slave][v->reg[v->slave]];
+    v->reg[v->slave] = (v->reg[v->slave] + 1) % VI2C_REG_SIZE;
+    v->s_sda = (v->shift >> 7) & 1;
+}
+
+static void vi2c_scl_falling(struct vi2c *v)
+{
+    if (v->state == VSLAVE_IDLE)
+        return;
+
+    v->bit ++;
+    if (v->bit == 8)
+    {
+        if (v->state == VSLAVE_READ)
+            v->s_sda = 1;               /* released for the ACK of master */
+        else
+            vi2c_byte_received(v);
+    }
+    else if (v->bit == 9)
+    {
+        v->bit = 0;
+        v->s_sda = 1;
+        if (v->state == VSLAVE_ADDR)
+            v->state = v->read ? VSLAVE_READ : VSLAVE_WRITE;
+        else if (v->state == VSLAVE_READ && v->nack)
+            v->state = VSLAVE_IDLE;     /* wait for stop */
+
+        v->shift = 0;
+        if (v->state == VSLAVE_READ)
+            vi2c_load(v);
+    }
+    else if (v->state == VSLAVE_READ && v->bit > 0)
+    {
+        v->s_sda = (v->shift >> (7 - v->bit)) & 1;
+    }
+}
+
+static void vi2c_scl_rising(struct vi2c *v)
+{
+    if (v->state == VSLAVE_IDLE || v->bit < 0)
+        return;
+
+    if (v->bit < 8)
+    {
+        if (v->state != VSLAVE_READ)
+            v->shift = (v->shift << 1) | SDA_LINE(v);
+    }
+    else if (v->state == VSLAVE_READ)
+    {
+        v->nack = SDA_LINE(v);
+    }
+}
+
+static void vi2c_set_sda(void *data, rt_int32_t state)
+{
+    struct vi2c *v = (struct vi2c *)data;
+    rt_int32_t old = SDA_LINE(v);
+
+    v->m_sda = state ? 1 : 0;
+    if (!SCL_LINE(v) || old == SDA_LINE(v))
+        return;
+
+    if (old)
+    {
+        /* start or repeated start */
+        v->state = VSLAVE_ADDR;
+        v->bit = -1;
+        v->shift = 0;
+        v->nack = 0;
+        v->s_sda = 1;
+    }
+    else
+    {
+        /* stop */
+        v->state = VSLAVE_IDLE;
+        v->slave = -1;
+        v->s_sda = 1;
+    }
+}
+
+static void vi2c_set_scl(void *data, rt_int32_t state)
+{
+    struct vi2c *v = (struct vi2c *)data;
+    rt_int32_t old = v->m_scl;
+
+    v->m_scl = state ? 1 : 0;
+    if (old && !v->m_scl)
+        vi2c_scl_falling(v);
+    else if (!old && v->m_scl)
+        vi2c_scl_rising(v);
+}
+
+static rt_int32_t vi2c_get_sda(void *data)
+{
+    return SDA_LINE((struct vi2c *)data);
+}
+
+static rt_int32_t vi2c_get_scl(void *data)
+{
+    struct vi2c *v = (struct vi2c *)data;
+
+    if (v->m_scl && v->hold > 0)
+    {
+        v->hold --;
+        return 0;
+    }
+    return v->m_scl;
+}
+
+static void vi2c_udelay(rt_uint32_t us)
+{
+    rt_hw_us_delay(us);
+}
+
+static struct rt_i2c_bus_device *vi2c_get(const char *timer_name)
+{
+    int i, j;
+
+    if (vi2c.bus.ops != RT_NULL)
+        return &vi2c.bus;
+
+    vi2c.ops.data = &vi2c;
+    vi2c.ops.set_sda = vi2c_set_sda;
+    vi2c.ops.set_scl = vi2c_set_scl;
+    vi2c.ops.get_sda = vi2c_get_sda;
+    vi2c.ops.get_scl = vi2c_get_scl;
+    vi2c.ops.udelay = vi2c_udelay;
+    vi2c.ops.delay_us = 10;
+    vi2c.ops.timeout = 10;
+    vi2c.ops.timer_name = timer_name;
+    vi2c.m_sda = vi2c.m_scl = vi2c.s_sda = 1;
+    vi2c.slave = -1;
+    for (i = 0; i < VI2C_SLAVE_MAX; i++)
+    {
+        for (j = 0; j < VI2C_REG_SIZE; j++)
+        {
+            vi2c.mem[i][j] = (rt_uint8_t)((VI2C_SLAVE_ADDR + i) * 3 + j);
+        }
+    }
+
+    vi2c.bus.priv = &vi2c.ops;
+    if (rt_i2c_bit_add_bus(&vi2c.bus, VI2C_NAME) != RT_EOK)
+        return RT_NULL;
+
+    return &vi2c.bus;
+}
+
+/* the messages of register read, write the register and read with repeated start */
+struct vi2c_poll
+{
+    struct rt_i2c_async async;
+    struct rt_i2c_msg msgs[2];
+    rt_uint8_t reg;
+    rt_uint8_t buf[VI2C_READ_SIZE];
+};
+
+static struct vi2c_poll poll[VI2C_SLAVE_MAX + 1];
+static struct rt_semaphore done_sem;
+
+static void vi2c_poll_init(struct vi2c_poll *p, rt_uint16_t addr, rt_uint8_t reg)
+{
+    p->reg = reg;
+    p->buf[0] = p->buf[1] = 0;
+    p->msgs[0].addr = addr;
+    p->msgs[0].flags = RT_I2C_WR;
+    p->msgs[0].len = 1;
+    p->msgs[0].buf = &p->reg;
+    p->msgs[1].addr = addr;
+    p->msgs[1].flags = RT_I2C_RD;
+    p->msgs[1].len = VI2C_READ_SIZE;
+    p->msgs[1].buf = p->buf;
+}
+
+static int vi2c_poll_check(struct vi2c_poll *p, int slave)
+{
+    int i;
+
+    for (i = 0; i < VI2C_READ_SIZE; i++)
+    {
+        if (p->buf[i] != vi2c.mem[slave][(p->reg + i) % VI2C_REG_SIZE])
+            return -1;
+    }
+    return 0;
+}
+
+static void vi2c_poll_done(struct rt_i2c_async *async)
+{
+    rt_sem_release(&done_sem);
+}
+
+static void i2c_async(int argc, char **argv)
+{
+    struct rt_i2c_bus_device *bus;
+    int i, n, slaves = VI2C_SLAVE_MAX, cycles = 10, failed = 0, nack = 0;
+    rt_uint32_t idle = 0;
+    rt_tick_t tick;
+
+    if (argc > 1) slaves = atoi(argv[1]);
+    if (argc > 2) cycles = atoi(argv[2]);
+    if (slaves < 1 || slaves > VI2C_SLAVE_MAX)
+        slaves = VI2C_SLAVE_MAX;
+
+    bus = vi2c_get(argc > 3 ? argv[3] : RT_NULL);
+    if (bus == RT_NULL)
+    {
+        rt_kprintf("register %s failed\n", VI2C_NAME);
+        return;
+    }
+
+    /* blocking transfers */
+    tick = rt_tick_get();
+    for (n = 0; n < cycles; n++)
+    {
+        for (i = 0; i < slaves; i++)
+        {
+            vi2c_poll_init(&poll[i], VI2C_SLAVE_ADDR + i, n + i);
+            if (rt_i2c_transfer(bus, poll[i].msgs, 2) != 2 || vi2c_poll_check(&poll[i], i) != 0)
+                failed ++;
+        }
+        vi2c_poll_init(&poll[slaves], VI2C_MISSING_ADDR, 0);
+        if ((rt_int32_t)rt_i2c_transfer(bus, poll[slaves].msgs, 2) == -RT_EIO)
+            nack ++;
+    }
+    tick = rt_tick_get() - tick;
+    rt_kprintf("sync : %d x %d slaves in %d ticks, %d failed, %d of %d NACK\n", cycles, slaves,
+               tick, failed, nack, cycles);
+
+    /* queued transfers, the thread counts while waiting */
+    rt_sem_init(&done_sem, "vi2c", 0, RT_IPC_FLAG_FIFO);
+    rt_memset(poll, 0, sizeof(poll));
+    failed = nack = 0;
+    tick = rt_tick_get();
+    for (n = 0; n < cycles; n++)
+    {
+        for (i = 0; i <= slaves; i++)
+        {
+            vi2c_poll_init(&poll[i], i < slaves ? VI2C_SLAVE_ADDR + i : VI2C_MISSING_ADDR, n + i);
+            poll[i].async.msgs = poll[i].msgs;
+            poll[i].async.num = 2;
+            poll[i].async.callback = vi2c_poll_done;
+            if (rt_i2c_transfer_async(bus, &poll[i].async) != RT_EOK)
+                rt_sem_release(&done_sem);
+        }
+
+        for (i = 0; i <= slaves; i++)
+        {
+            while (rt_sem_trytake(&done_sem) != RT_EOK)
+            {
+                idle ++;
+            }
+        }
+
+        for (i = 0; i < slaves; i++)
+        {
+            if (poll[i].async.result != RT_EOK || vi2c_poll_check(&poll[i], i) != 0)
+                failed ++;
+        }
+        if (poll[slaves].async.result == -RT_EIO && poll[slaves].async.count == 0)
+            nack ++;
+    }
+    tick = rt_tick_get() - tick;
+    rt_sem_detach(&done_sem);
+
+    rt_kprintf("async: %d x %d slaves in %d ticks, %d failed, %d of %d NACK, %d idle loops\n", cycles,
+               slaves, tick, failed, nack, cycles, idle);
+}
+MSH_CMD_EXPORT(i2c_async, poll the scripted slaves on a virtual I2C bus);
+
+#endif /* RT_USING_I2C && RT_USING_I2C_BITOPS && RT_USING_I2C_ASYNC */
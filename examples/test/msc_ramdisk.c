@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-26     RT-Thread    the first version
+ */
+
+/*
+ * A RAM disk for the USB mass storage class, every access of disk is delayed
+ * to behave like a SD card. Set RT_USB_MSTORAGE_DISK_NAME to "ramdisk", then
+ * create the disk before plugging in the USB cable:
+ *
+ *     msh />msc_ramdisk 128 2
+ *
+ * The throughput is measured by the host (dd, CrystalDiskMark...), then the
+ * accesses of disk are shown by:
+ *
+ *     msh />msc_ramdisk stat
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(RT_USING_USB_DEVICE) && defined(RT_USB_DEVICE_MSTORAGE)
+
+#define RAMDISK_NAME            "ramdisk"
+#define RAMDISK_SECTOR_SIZE     512
+
+struct ramdisk
+{
+    struct rt_device parent;
+    rt_uint8_t *pool;
+    rt_uint32_t sector_count;
+    rt_int32_t latency;
+
+    rt_uint32_t reads, writes;
+    rt_uint32_t read_sectors, write_sectors;
+};
+static struct ramdisk ramdisk;
+
+static rt_size_t ramdisk_read(rt_device_t dev, rt_off_t pos, void *buffer, rt_size_t size)
+{
+    struct ramdisk *disk = (struct ramdisk *)dev;
+
+    if (pos + size > disk->sector_count)
+        return 0;
+
+    if (disk->latency > 0)
+        rt_thread_delay(disk->latency);
+    rt_memcpy(buffer, disk->pool + pos * RAMDISK_SECTOR_SIZE, size * RAMDISK_SECTOR_SIZE);
+
+    disk->reads ++;
+    disk->read_sectors += size;
+    return size;
+}
+
+static rt_size_t ramdisk_write(rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    struct ramdisk *disk = (struct ramdisk *)dev;
+
+    if (pos + size > disk->sector_count)
+        return 0;
+
+    if (disk->latency > 0)
+        rt_thread_delay(disk->latency);
+    rt_memcpy(disk->pool + pos * RAMDISK_SECTOR_SIZE, buffer, size * RAMDISK_SECTOR_SIZE);
+
+    disk->writes ++;
+    disk->write_sectors += size;
+    return size;
+}
+
+static rt_err_t ramdisk_control(rt_device_t dev, int cmd, void *args)
+{
+    struct ramdisk *disk = (struct ramdisk *)dev;
+
+    if (cmd == RT_DEVICE_CTRL_BLK_GETGEOME)
+    {
+        struct rt_device_blk_geometry *geometry = (struct rt_device_blk_geometry *)args;
+
+        if (geometry == RT_NULL)
+            return -RT_ERROR;
+
+        geometry->bytes_per_sector = RAMDISK_SECTOR_SIZE;
+        geometry->block_size = RAMDISK_SECTOR_SIZE;
+        geometry->sector_count = disk->sector_count;
+    }
+
+    return RT_EOK;
+}
+
+#ifdef RT_USING_DEVICE_OPS
+const static struct rt_device_ops ramdisk_ops =
+{
+    RT_NULL,
+    RT_NULL,
+    RT_NULL,
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_control
+};
+#endif
+
+static void msc_ramdisk(int argc, char **argv)
+{
+    int sectors = 128;
+
+    if (argc == 2 && strcmp(argv[1], "stat") == 0)
+    {
+        rt_kprintf("read : %d requests, %d sectors\n", ramdisk.reads, ramdisk.read_sectors);
+        rt_kprintf("write: %d requests, %d sectors\n", ramdisk.writes, ramdisk.write_sectors);
+        ramdisk.reads = ramdisk.writes = 0;
+        ramdisk.read_sectors = ramdisk.write_sectors = 0;
+        return;
+    }
+
+    if (argc > 1) sectors = atoi(argv[1]);
+    if (argc > 2) ramdisk.latency = atoi(argv[2]);
+
+    if (ramdisk.pool != RT_NULL)
+    {
+        rt_kprintf("%s is created, the latency is %d ticks\n", RAMDISK_NAME, ramdisk.latency);
+        return;
+    }
+
+    ramdisk.pool = rt_malloc(sectors * RAMDISK_SECTOR_SIZE);
+    if (ramdisk.pool == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    rt_memset(ramdisk.pool, 0x00, sectors * RAMDISK_SECTOR_SIZE);
+    ramdisk.sector_count = sectors;
+
+    ramdisk.parent.type = RT_Device_Class_Block;
+#ifdef RT_USING_DEVICE_OPS
+    ramdisk.parent.ops = &ramdisk_ops;
+#else
+    ramdisk.parent.read = ramdisk_read;
+    ramdisk.parent.write = ramdisk_write;
+    ramdisk.parent.control = ramdisk_control;
+#endif
+    rt_device_register(&ramdisk.parent, RAMDISK_NAME, RT_DEVICE_FLAG_RDWR);
+
+    rt_kprintf("%s: %d sectors, the latency is %d ticks\n", RAMDISK_NAME, sectors, ramdisk.latency);
+}
+MSH_CMD_EXPORT(msc_ramdisk, create a RAM disk for USB mass storage);
+
+#endif /* RT_USING_USB_DEVICE && RT_USB_DEVICE_MSTORAGE */
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-07     RT-Thread    the first version
+ */
+
+/*
+ * A simulated accelerometer "acce_sim", the samples are made by a timer at
+ * the output data rate and kept in a simulated hardware FIFO. The sequence
+ * number of sample is in data.acce.x, so the readers of stream
+ * (RT_SENSOR_USING_STREAM) check the missing and duplicated samples:
+ *
+ *     msh />sensor_stream 3 1000 800
+ *
+ * reads the stream for 1000 ms with 3 readers, the reader n sleeps n*20 ms
+ * between the reads, at 800 Hz. The readers wait for the samples without
+ * timeout, a reader which is not woken by the samples hangs the test.
+ */
+
+#include <rthw.h>
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#if defined(RT_USING_SENSOR) && defined(RT_SENSOR_USING_STREAM)
+#include "sensor.h"
+
+#define SIM_NAME            "sim"
+#define SIM_FIFO_SIZE       32
+
+#define STREAM_READER_MAX   4
+#define STREAM_BATCH        16
+
+struct sensor_sim
+{
+    struct rt_sensor_device sensor;
+    struct rt_timer timer;
+
+    struct rt_sensor_data fifo[SIM_FIFO_SIZE];
+    rt_uint32_t put, get;
+    rt_uint32_t seq;                /* the sequence number of samples */
+    rt_uint32_t odr_count;          /* the samples to make in ticks */
+    rt_uint32_t lost;               /* the samples lost in hardware FIFO */
+};
+static struct sensor_sim sim;
+
+static void sim_make(struct sensor_sim *s, struct rt_sensor_data *data)
+{
+    data->timestamp = rt_sensor_get_ts();
+    data->type = RT_SENSOR_CLASS_ACCE;
+    data->data.acce.x = s->seq;
+    data->data.acce.y = -(rt_int32_t)s->seq;
+    data->data.acce.z = 1000;
+    s->seq ++;
+}
+
+static void sim_timeout(void *parameter)
+{
+    struct sensor_sim *s = (struct sensor_sim *)parameter;
+    rt_uint32_t count, fifo_size;
+    rt_base_t level;
+
+    /* the interrupt mode has only one data register */
+    fifo_size = s->sensor.config.mode == RT_SENSOR_MODE_FIFO ? SIM_FIFO_SIZE : 1;
+
+    s->odr_count += s->sensor.config.odr;
+    while (s->odr_count >= RT_TICK_PER_SECOND)
+    {
+        s->odr_count -= RT_TICK_PER_SECOND;
+
+        level = rt_hw_interrupt_disable();
+        if (s->put - s->get >= fifo_size)
+        {
+            s->get ++;
+            s->lost ++;
+        }
+        sim_make(s, &s->fifo[s->put % SIM_FIFO_SIZE]);
+        s->put ++;
+        count = s->put - s->get;
+        rt_hw_interrupt_enable(level);
+
+        /* the interrupt of data ready or FIFO watermark */
+        if (fifo_size == 1 || count == SIM_FIFO_SIZE / 2)
+        {
+            rt_sensor_cb(&s->sensor);
+        }
+    }
+}
+
+static rt_size_t sim_fetch_data(struct rt_sensor_device *sensor, void *buf, rt_size_t len)
+{
+    struct sensor_sim *s = (struct sensor_sim *)sensor;
+    struct rt_sensor_data *data = (struct rt_sensor_data *)buf;
+    rt_size_t i;
+    rt_base_t level;
+
+    if (sensor->config.mode == RT_SENSOR_MODE_POLLING)
+    {
+        sim_make(s, data);
+        return 1;
+    }
+
+    level = rt_hw_interrupt_disable();
+    for (i = 0; i < len && s->get != s->put; i++)
+    {
+        data[i] = s->fifo[s->get % SIM_FIFO_SIZE];
+        s->get ++;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return i;
+}
+
+static rt_err_t sim_control(struct rt_sensor_device *sensor, int cmd, void *args)
+{
+    struct sensor_sim *s = (struct sensor_sim *)sensor;
+
+    switch (cmd)
+    {
+    case RT_SENSOR_CTRL_GET_ID:
+        *(rt_uint8_t *)args = 0x5A;
+        break;
+    case RT_SENSOR_CTRL_SET_ODR:
+        /* the new rate is used by the timer */
+        break;
+    case RT_SENSOR_CTRL_SET_POWER:
+        if ((rt_uint32_t)args == RT_SENSOR_POWER_DOWN)
+        {
+            rt_timer_stop(&s->timer);
+            s->get = s->put;
+        }
+        else
+        {
+            rt_timer_start(&s->timer);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return RT_EOK;
+}
+
+static const struct rt_sensor_ops sim_ops =
+{
+    sim_fetch_data,
+    sim_control
+};
+
+static rt_device_t sim_get(void)
+{
+    if (sim.sensor.ops == RT_NULL)
+    {
+        sim.sensor.info.type = RT_SENSOR_CLASS_ACCE;
+        sim.sensor.info.vendor = RT_SENSOR_VENDOR_UNKNOWN;
+        sim.sensor.info.model = "sim";
+        sim.sensor.info.unit = RT_SENSOR_UNIT_MG;
+        sim.sensor.info.range_max = 16000;
+        sim.sensor.info.range_min = -16000;
+        sim.sensor.info.period_min = 1;
+        sim.sensor.info.fifo_max = SIM_FIFO_SIZE;
+        sim.sensor.config.irq_pin.pin = RT_PIN_NONE;
+        sim.sensor.config.odr = 100;
+        sim.sensor.ops = &sim_ops;
+
+        rt_timer_init(&sim.timer, "acce_sim", sim_timeout, &sim, 1, RT_TIMER_FLAG_PERIODIC);
+        rt_hw_sensor_register(&sim.sensor, SIM_NAME,
+                              RT_DEVICE_FLAG_RDONLY | RT_DEVICE_FLAG_INT_RX | RT_DEVICE_FLAG_FIFO_RX, RT_NULL);
+    }
+
+    return &sim.sensor.parent;
+}
+
+struct stream_reader
+{
+    struct rt_sensor_reader reader;
+    rt_int32_t delay;
+
+    rt_uint32_t samples;
+    rt_uint32_t missing;            /* the gaps of sequence number */
+    rt_uint32_t duplicated;
+    rt_uint32_t backwards;          /* the timestamps go backwards */
+};
+static struct stream_reader readers[STREAM_READER_MAX];
+static volatile rt_bool_t stream_exit;
+static struct rt_semaphore stream_done;
+
+static void stream_reader_entry(void *parameter)
+{
+    struct stream_reader *r = (struct stream_reader *)parameter;
+    struct rt_sensor_data data[STREAM_BATCH];
+    rt_uint32_t last_seq = 0, last_time = 0;
+    rt_bool_t first = RT_TRUE;
+    rt_size_t i, len;
+
+    while (!stream_exit)
+    {
+        /* all the readers are woken by every fetch of samples */
+        if (rt_sensor_reader_wait(&r->reader, RT_WAITING_FOREVER) != RT_EOK)
+            break;
+
+        len = rt_sensor_reader_read(&r->reader, data, STREAM_BATCH);
+        for (i = 0; i < len; i++)
+        {
+            rt_uint32_t seq = data[i].data.acce.x;
+
+            if (!first)
+            {
+                if ((rt_int32_t)(seq - last_seq) <= 0)
+                    r->duplicated ++;
+                else
+                    r->missing += seq - last_seq - 1;
+                if ((rt_int32_t)(data[i].time_us - last_time) < 0)
+                    r->backwards ++;
+            }
+            first = RT_FALSE;
+            last_seq = seq;
+            last_time = data[i].time_us;
+        }
+        r->samples += len;
+
+        if (r->delay > 0)
+            rt_thread_mdelay(r->delay);
+    }
+
+    rt_sem_release(&stream_done);
+}
+
+static void sensor_stream(int argc, char **argv)
+{
+    rt_device_t dev;
+    rt_thread_t tid;
+    int i, count = 3, ms = 1000, odr = 800, started = 0;
+
+    if (argc > 1) count = atoi(argv[1]);
+    if (argc > 2) ms = atoi(argv[2]);
+    if (argc > 3) odr = atoi(argv[3]);
+    if (count > STREAM_READER_MAX) count = STREAM_READER_MAX;
+
+    dev = sim_get();
+    if (rt_device_open(dev, RT_DEVICE_FLAG_FIFO_RX) != RT_EOK)
+    {
+        rt_kprintf("open %s failed\n", dev->parent.name);
+        return;
+    }
+    rt_device_control(dev, RT_SENSOR_CTRL_SET_ODR, (void *)odr);
+
+    rt_sem_init(&stream_done, "stream", 0, RT_IPC_FLAG_FIFO);
+    stream_exit = RT_FALSE;
+    sim.lost = 0;
+    for (i = 0; i < count; i++)
+    {
+        rt_memset(&readers[i], 0, sizeof(struct stream_reader));
+        rt_sensor_reader_init(&readers[i].reader, &sim.sensor);
+        readers[i].delay = i * 20;
+
+        tid = rt_thread_create("stream", stream_reader_entry, &readers[i], 1024, RT_THREAD_PRIORITY_MAX / 2, 10);
+        if (tid == RT_NULL)
+            break;
+        rt_thread_startup(tid);
+        started ++;
+    }
+
+    rt_thread_mdelay(ms);
+    stream_exit = RT_TRUE;
+    for (i = 0; i < started; i++)
+    {
+        rt_sem_take(&stream_done, RT_WAITING_FOREVER);
+    }
+    rt_sem_detach(&stream_done);
+    rt_device_close(dev);
+
+    rt_kprintf("%d Hz, %d samples made, %d lost in hardware FIFO\n", odr, sim.seq, sim.lost);
+    for (i = 0; i < started; i++)
+    {
+        rt_kprintf("reader %d: %d samples, %d overrun, %d missing, %d duplicated, %d backwards\n", i,
+                   readers[i].samples, readers[i].reader.overrun, readers[i].missing,
+                   readers[i].duplicated, readers[i].backwards);
+    }
+}
+MSH_CMD_EXPORT(sensor_stream, read the stream of a simulated sensor by several readers);
+
+#endif /* RT_USING_SENSOR && RT_SENSOR_USING_STREAM */
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-23     RT-Thread    the first version
+ */
+
+/*
+ * The throughput of SPI transfers, the blocking rt_spi_transfer() against
+ * the queued transfers (RT_USING_SPI_ASYNC). The CPU time left to the
+ * thread while the queue is transferred is counted too:
+ *
+ *     msh />spi_bench spi10 512 1000
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#if defined(RT_USING_SPI) && defined(RT_USING_SPI_ASYNC)
+
+#define SPI_BENCH_DEPTH     4
+
+static struct rt_semaphore done_sem;
+static volatile int async_failed;
+
+static void spi_bench_done(struct rt_spi_async *async)
+{
+    if (async->result != RT_EOK)
+        async_failed ++;
+    rt_sem_release(&done_sem);
+}
+
+static void spi_bench(int argc, char **argv)
+{
+    struct rt_spi_device *device;
+    struct rt_spi_async async[SPI_BENCH_DEPTH];
+    struct rt_spi_message message[SPI_BENCH_DEPTH];
+    rt_uint8_t *buf = RT_NULL;
+    rt_size_t size = 512;
+    int i, count = 1000, submitted, finished, failed = 0;
+    rt_uint32_t idle = 0;
+    rt_tick_t tick;
+
+    if (argc < 2)
+    {
+        rt_kprintf("Usage: spi_bench <spi device> [size] [count]\n");
+        return;
+    }
+    if (argc > 2) size = atoi(argv[2]);
+    if (argc > 3) count = atoi(argv[3]);
+
+    device = (struct rt_spi_device *)rt_device_find(argv[1]);
+    if (device == RT_NULL || device->parent.type != RT_Device_Class_SPIDevice)
+    {
+        rt_kprintf("%s is not a SPI device\n", argv[1]);
+        return;
+    }
+
+    buf = rt_malloc(size * SPI_BENCH_DEPTH);
+    if (buf == RT_NULL)
+    {
+        rt_kprintf("no memory\n");
+        return;
+    }
+    rt_memset(buf, 0x5A, size * SPI_BENCH_DEPTH);
+
+    /* blocking transfers */
+    tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        if (rt_spi_transfer(device, buf, RT_NULL, size) != size)
+            failed ++;
+    }
+    tick = rt_tick_get() - tick;
+    rt_kprintf("sync : %d x %d bytes in %d ticks, %d failed\n", count, size, tick, failed);
+
+    /* queued transfers, the thread counts while waiting */
+    rt_sem_init(&done_sem, "spi_b", 0, RT_IPC_FLAG_FIFO);
+    rt_memset(message, 0, sizeof(message));
+    for (i = 0; i < SPI_BENCH_DEPTH; i++)
+    {
+        message[i].send_buf = buf + i * size;
+        message[i].length = size;
+        message[i].cs_take = 1;
+        message[i].cs_release = 1;
+        rt_spi_async_init(&async[i], &message[i], spi_bench_done, RT_NULL, RT_NULL);
+    }
+
+    async_failed = 0;
+    submitted = finished = 0;
+    tick = rt_tick_get();
+    while (finished < count)
+    {
+        /* keep the queue full */
+        for (i = 0; i < SPI_BENCH_DEPTH && submitted < count; i++)
+        {
+            if (rt_spi_transfer_async(device, &async[i]) == RT_EOK)
+                submitted ++;
+        }
+
+        while (rt_sem_trytake(&done_sem) != RT_EOK)
+        {
+            idle ++;
+        }
+        finished ++;
+    }
+    tick = rt_tick_get() - tick;
+    rt_sem_detach(&done_sem);
+
+    rt_kprintf("async: %d x %d bytes in %d ticks, %d failed, %d idle loops\n", count, size, tick, async_failed, idle);
+
+    rt_free(buf);
+}
+MSH_CMD_EXPORT(spi_bench, measure the blocking and queued SPI transfers);
+
+#endif /* RT_USING_SPI && RT_USING_SPI_ASYNC */
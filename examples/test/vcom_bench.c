@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-30     RT-Thread    the first version
+ */
+
+/*
+ * The tx throughput of USB virtual com in DMA mode, the blocks are sent to
+ * the endpoint without copying. Open the port on host and read it out:
+ *
+ *     $ cat /dev/ttyACM0 > /dev/null
+ *     msh />vcom_bench 1024
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#if defined(RT_USB_DEVICE_CDC) && defined(RT_SERIAL_USING_DMA)
+
+#define VCOM_BENCH_BLOCK    512
+#define VCOM_BENCH_DEPTH    4
+
+static struct rt_semaphore done_sem;
+
+static rt_err_t vcom_bench_tx_done(rt_device_t dev, void *buffer)
+{
+    rt_sem_release(&done_sem);
+    return RT_EOK;
+}
+
+static void vcom_bench(int argc, char **argv)
+{
+    static rt_uint8_t block[VCOM_BENCH_DEPTH][VCOM_BENCH_BLOCK];
+    rt_device_t dev;
+    int i, count, kbytes = 256;
+    rt_tick_t tick;
+
+    if (argc > 1) kbytes = atoi(argv[1]);
+    count = kbytes * 1024 / VCOM_BENCH_BLOCK;
+
+    dev = rt_device_find("vcom");
+    if (dev == RT_NULL)
+    {
+        rt_kprintf("no vcom device\n");
+        return;
+    }
+    if (rt_device_open(dev, RT_DEVICE_OFLAG_RDWR | RT_DEVICE_FLAG_DMA_TX) != RT_EOK)
+    {
+        rt_kprintf("open vcom failed\n");
+        return;
+    }
+    if (!(dev->open_flag & RT_DEVICE_FLAG_DMA_TX))
+    {
+        rt_kprintf("vcom has been opened in other mode\n");
+        rt_device_close(dev);
+        return;
+    }
+
+    for (i = 0; i < VCOM_BENCH_DEPTH; i++)
+    {
+        rt_memset(block[i], '0' + i, VCOM_BENCH_BLOCK);
+    }
+
+    rt_sem_init(&done_sem, "vcom_b", VCOM_BENCH_DEPTH, RT_IPC_FLAG_FIFO);
+    rt_device_set_tx_complete(dev, vcom_bench_tx_done);
+
+    tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        /* a block is reused after it has been sent */
+        rt_sem_take(&done_sem, RT_WAITING_FOREVER);
+        rt_device_write(dev, 0, block[i % VCOM_BENCH_DEPTH], VCOM_BENCH_BLOCK);
+    }
+    for (i = 0; i < VCOM_BENCH_DEPTH; i++)
+    {
+        rt_sem_take(&done_sem, RT_WAITING_FOREVER);
+    }
+    tick = rt_tick_get() - tick;
+
+    rt_device_set_tx_complete(dev, RT_NULL);
+    rt_device_close(dev);
+    rt_sem_detach(&done_sem);
+
+    rt_kprintf("%d KB in %d ticks, %d KB/s\n", kbytes, tick,
+               tick ? kbytes * RT_TICK_PER_SECOND / tick : 0);
+}
+MSH_CMD_EXPORT(vcom_bench, measure the tx throughput of USB virtual com);
+
+#endif /* RT_USB_DEVICE_CDC && RT_SERIAL_USING_DMA */
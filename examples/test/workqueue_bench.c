@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-10-21     RT-Thread    the first version
+ * 2019-10-26     RT-Thread    run with one worker and with the pool
+ */
+
+/*
+ * The latency of works in a workqueue which has a slow work, with one worker
+ * and with a pool of workers. The works of the highest priority and of the
+ * default priority are measured, the delayed works check the timing wheel:
+ *
+ *     msh />workqueue_bench 2 64 50
+ *
+ * creates a workqueue of 1 worker, then a workqueue of 2 workers, the slow
+ * work sleeps 50 ms, then 64 works and 64 delayed works (1 to 64 ticks) are
+ * submitted to each of them.
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#if defined(RT_USING_HEAP) && defined(RT_WORKQUEUE_USING_STAT)
+
+#define BENCH_WORKS_MAX     256
+
+struct bench_work
+{
+    struct rt_delayed_work delayed;
+    rt_tick_t submit_tick;
+    rt_tick_t expect_tick;
+};
+
+static struct bench_work bench_works[BENCH_WORKS_MAX];
+static struct rt_work slow_work;
+static struct rt_semaphore bench_done;
+static rt_uint32_t late_max, late_sum;
+
+static void bench_slow_func(struct rt_work *work, void *work_data)
+{
+    rt_thread_mdelay((int)work_data);
+    rt_sem_release(&bench_done);
+}
+
+static void bench_work_func(struct rt_work *work, void *work_data)
+{
+    rt_sem_release(&bench_done);
+}
+
+static void bench_delayed_func(struct rt_work *work, void *work_data)
+{
+    struct bench_work *bench = (struct bench_work *)work_data;
+    rt_tick_t late = rt_tick_get() - bench->expect_tick;
+
+    late_sum += late;
+    if (late > late_max)
+        late_max = late;
+    rt_sem_release(&bench_done);
+}
+
+static void bench_wait(int count)
+{
+    while (count--)
+    {
+        rt_sem_take(&bench_done, RT_WAITING_FOREVER);
+    }
+}
+
+static void bench_report(struct rt_workqueue *queue, const char *name)
+{
+    struct rt_workqueue_stat stat;
+
+    rt_workqueue_get_stat(queue, &stat);
+    rt_kprintf("%-10s: %d done, latency %d/%d ticks (avg/max), exec %d/%d ticks, %d pending at most\n", name,
+               stat.done, stat.done ? stat.latency_sum / stat.done : 0, stat.latency_max,
+               stat.done ? stat.exec_sum / stat.done : 0, stat.exec_max, stat.pending_max);
+    rt_workqueue_reset_stat(queue);
+}
+
+/* the works of a priority are submitted behind the slow work */
+static void bench_priority(struct rt_workqueue *queue, int count, int slow_ms, rt_uint8_t priority, const char *name)
+{
+    int i;
+
+    rt_work_init(&slow_work, bench_slow_func, (void *)slow_ms);
+    rt_work_set_priority(&slow_work, RT_WORKQUEUE_PRIORITY_NUM - 1);
+    rt_workqueue_dowork(queue, &slow_work);
+
+    for (i = 0; i < count; i++)
+    {
+        rt_work_init(&bench_works[i].delayed.work, bench_work_func, &bench_works[i]);
+        rt_work_set_priority(&bench_works[i].delayed.work, priority);
+        rt_workqueue_dowork(queue, &bench_works[i].delayed.work);
+    }
+    bench_wait(count + 1);
+    bench_report(queue, name);
+}
+
+static void bench_delayed(struct rt_workqueue *queue, int count)
+{
+    rt_tick_t ticks;
+    int i;
+
+    late_max = late_sum = 0;
+    for (i = 0; i < count; i++)
+    {
+        ticks = i % 64 + 1;
+        rt_delayed_work_init(&bench_works[i].delayed, bench_delayed_func, &bench_works[i]);
+        bench_works[i].submit_tick = rt_tick_get();
+        bench_works[i].expect_tick = bench_works[i].submit_tick + ticks;
+        rt_workqueue_submit_work(queue, &bench_works[i].delayed.work, ticks);
+    }
+    bench_wait(count);
+    bench_report(queue, "delayed");
+    rt_kprintf("%-10s: %d works of 1 to 64 ticks, late %d/%d ticks (avg/max)\n", "wheel", count,
+               late_sum / count, late_max);
+}
+
+static void bench_queue(int workers, int count, int slow_ms)
+{
+    struct rt_workqueue *queue;
+
+    queue = rt_workqueue_create_workers("wqbench", 1024, RT_THREAD_PRIORITY_MAX / 2, workers);
+    if (queue == RT_NULL)
+    {
+        rt_kprintf("create workqueue failed\n");
+        return;
+    }
+    rt_kprintf("%d workers, %d priority levels, the slow work is %d ms\n", queue->worker_num,
+               RT_WORKQUEUE_PRIORITY_NUM, slow_ms);
+
+    bench_priority(queue, count, slow_ms, 0, "highest");
+    bench_priority(queue, count, slow_ms, RT_WORK_PRIORITY_DEFAULT, "default");
+    bench_delayed(queue, count);
+
+    rt_workqueue_destroy(queue);
+}
+
+static void workqueue_bench(int argc, char **argv)
+{
+    int workers = 2, count = 64, slow_ms = 50;
+
+    if (argc > 1) workers = atoi(argv[1]);
+    if (argc > 2) count = atoi(argv[2]);
+    if (argc > 3) slow_ms = atoi(argv[3]);
+    if (count <= 0 || count > BENCH_WORKS_MAX)
+        count = BENCH_WORKS_MAX;
+
+    rt_sem_init(&bench_done, "wqbench", 0, RT_IPC_FLAG_FIFO);
+    /* one worker against the pool */
+    bench_queue(1, count, slow_ms);
+    if (workers > 1)
+        bench_queue(workers, count, slow_ms);
+    rt_sem_detach(&bench_done);
+}
+MSH_CMD_EXPORT(workqueue_bench, measure the latency of workqueue);
+
+#endif /* RT_USING_HEAP && RT_WORKQUEUE_USING_STAT */
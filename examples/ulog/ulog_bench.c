@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-26     RT-Thread    the first version
+ * 2019-08-29     RT-Thread    add latency under contention
+ * 2019-09-05     RT-Thread    add throughput of backends
+ */
+
+/*
+ * The cost of a log call on the caller's thread, run it with and without the
+ * binary log mode (ULOG_USING_BINARY) to compare:
+ *
+ *     msh />ulog_bench
+ *
+ * The latency of log calls from the threads of different priorities, run it
+ * with different line buffer bands (ULOG_LINE_BUF_BANDS) to compare:
+ *
+ *     msh />ulog_bench_contend
+ *
+ * The records per second until they are written by all backends, disable the
+ * console backend to measure the file backend (ULOG_BACKEND_USING_FILE) or
+ * the RAM ring backend (ULOG_BACKEND_USING_RAM) alone:
+ *
+ *     msh />ulog_bench_rate 10000
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h>
+
+#define LOG_TAG              "bench"
+#define LOG_LVL              LOG_LVL_DBG
+#include <ulog.h>
+
+#if !defined(RT_USING_CPUTIME)
+#error "Please enable RT_USING_CPUTIME!"
+#endif
+
+/* the calls of a batch should fit in the async buffer */
+#define ULOG_BENCH_BATCH     8
+#define ULOG_BENCH_LOOPS     32
+
+static void ulog_bench(void)
+{
+    int i, j;
+    uint32_t start, cost = 0;
+
+    for (i = 0; i < ULOG_BENCH_LOOPS; i++)
+    {
+        start = clock_cpu_gettime();
+        for (j = 0; j < ULOG_BENCH_BATCH; j++)
+        {
+            LOG_I("bench %d/%d: %s 0x%08x", i, j, "RT-Thread", start);
+        }
+        cost += clock_cpu_gettime() - start;
+
+        /* output the logs out of the measurement */
+        ulog_flush();
+    }
+
+    rt_kprintf("ulog: %d calls, %d ns per call\n", ULOG_BENCH_LOOPS * ULOG_BENCH_BATCH,
+               clock_cpu_microsecond(cost) * 1000 / (ULOG_BENCH_LOOPS * ULOG_BENCH_BATCH));
+}
+MSH_CMD_EXPORT(ulog_bench, measure the cost of log call);
+
+#define ULOG_CONTEND_THREADS 8
+#define ULOG_CONTEND_LOOPS   64
+
+struct ulog_contend
+{
+    rt_thread_t thread;
+    rt_uint8_t priority;
+    uint32_t max;
+    uint32_t total;
+};
+
+static struct ulog_contend contend[ULOG_CONTEND_THREADS];
+static struct rt_semaphore contend_done;
+
+static void ulog_contend_entry(void *parameter)
+{
+    struct ulog_contend *ctx = (struct ulog_contend *)parameter;
+    uint32_t start, cost;
+    int i;
+
+    for (i = 0; i < ULOG_CONTEND_LOOPS; i++)
+    {
+        start = clock_cpu_gettime();
+        LOG_D("contend %d: %s %d", ctx - contend, "RT-Thread", i);
+        cost = clock_cpu_gettime() - start;
+
+        ctx->total += cost;
+        if (cost > ctx->max)
+            ctx->max = cost;
+
+        /* let the threads of lower priority run into the log call */
+        rt_thread_delay(ctx - contend + 1);
+    }
+
+    rt_sem_release(&contend_done);
+}
+
+static void ulog_bench_contend(void)
+{
+    int i;
+
+    rt_sem_init(&contend_done, "ulogb", 0, RT_IPC_FLAG_FIFO);
+    rt_memset(contend, 0, sizeof(contend));
+
+    for (i = 0; i < ULOG_CONTEND_THREADS; i++)
+    {
+        /* spread the threads over the priorities */
+        contend[i].priority = RT_THREAD_PRIORITY_MAX * (i + 1) / (ULOG_CONTEND_THREADS + 2);
+        contend[i].thread = rt_thread_create("ulogb", ulog_contend_entry, &contend[i], 1024,
+                contend[i].priority, 5);
+        if (contend[i].thread == RT_NULL)
+        {
+            rt_kprintf("create thread failed\n");
+            break;
+        }
+    }
+
+    /* start from the lowest priority one */
+    while (i-- > 0)
+        rt_thread_startup(contend[i].thread);
+
+    for (i = 0; i < ULOG_CONTEND_THREADS && contend[i].thread; i++)
+        rt_sem_take(&contend_done, RT_WAITING_FOREVER);
+
+    for (i = 0; i < ULOG_CONTEND_THREADS && contend[i].thread; i++)
+    {
+        rt_kprintf("thread %d priority %2d: avg %d us, max %d us\n", i, contend[i].priority,
+                   clock_cpu_microsecond(contend[i].total) / ULOG_CONTEND_LOOPS,
+                   clock_cpu_microsecond(contend[i].max));
+    }
+
+    rt_sem_detach(&contend_done);
+}
+MSH_CMD_EXPORT(ulog_bench_contend, measure the latency of log call under contention);
+
+static void ulog_bench_rate(int argc, char **argv)
+{
+    int i, count = 1000;
+    rt_tick_t tick;
+
+    if (argc > 1)
+        count = atoi(argv[1]);
+    if (count <= 0)
+    {
+        rt_kprintf("Usage: ulog_bench_rate [count]\n");
+        return;
+    }
+
+    ulog_flush();
+    tick = rt_tick_get();
+    for (i = 0; i < count; i++)
+    {
+        LOG_I("rate %d: %s 0x%08x", i, "RT-Thread", tick);
+#ifdef ULOG_USING_ASYNC_OUTPUT
+        /* the calls of a batch should fit in the async buffer */
+        if (i % ULOG_BENCH_BATCH == ULOG_BENCH_BATCH - 1)
+            ulog_async_output();
+#endif
+    }
+    /* all records are written and synced by the backends */
+    ulog_flush();
+    tick = rt_tick_get() - tick;
+
+    if (tick == 0)
+        tick = 1;
+    rt_kprintf("ulog: %d records in %d ticks, %d records/s\n", count, tick,
+               count * RT_TICK_PER_SECOND / tick);
+}
+MSH_CMD_EXPORT(ulog_bench_rate, measure the records per second of backends);
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-09-19     RT-Thread    the first version
+ */
+
+/*
+ * The standard benchmarks of kernel (UTEST_USING_BENCH), every result is a
+ * JSON line. The results of two releases are compared by:
+ *
+ *     msh />utest_run bench.kernel
+ *     python tools/utest_bench_diff.py old.log new.log
+ */
+
+#include <rtthread.h>
+#include <rtdevice.h>
+#include "utest.h"
+
+#ifdef UTEST_USING_BENCH
+
+#define BENCH_WARMUP            100
+#define BENCH_ITERATIONS        1000
+#define BENCH_PEER_STACK_SIZE   1024
+#define BENCH_RB_SIZE           256
+#define BENCH_RB_CHUNK          64
+
+static struct rt_semaphore req_sem, ack_sem, done_sem;
+static struct rt_mailbox req_mb, ack_mb;
+static rt_ubase_t req_pool[1], ack_pool[1];
+static volatile rt_bool_t peer_exit;
+
+static rt_bool_t bench_peer_start(const char *name, void (*entry)(void *), rt_uint8_t priority)
+{
+    rt_thread_t tid;
+
+    peer_exit = RT_FALSE;
+    tid = rt_thread_create(name, entry, RT_NULL, BENCH_PEER_STACK_SIZE, priority, 10);
+    if (tid == RT_NULL)
+        return RT_FALSE;
+
+    rt_thread_startup(tid);
+    return RT_TRUE;
+}
+
+static void yield_peer_entry(void *parameter)
+{
+    while (!peer_exit)
+    {
+        rt_thread_yield();
+    }
+    rt_sem_release(&done_sem);
+}
+
+/* two threads in same priority, an iteration is two context switches */
+static void bench_thread_yield(void)
+{
+    struct utest_bench bench;
+
+    if (!bench_peer_start("b_yield", yield_peer_entry, rt_thread_self()->current_priority))
+    {
+        uassert_true(RT_FALSE);
+        return;
+    }
+
+    UTEST_BENCH(&bench, "kernel.thread_yield", BENCH_WARMUP, BENCH_ITERATIONS)
+    {
+        rt_thread_yield();
+    }
+
+    peer_exit = RT_TRUE;
+    uassert_int_equal(rt_sem_take(&done_sem, RT_WAITING_FOREVER), RT_EOK);
+}
+
+static void sem_peer_entry(void *parameter)
+{
+    while (rt_sem_take(&req_sem, RT_WAITING_FOREVER) == RT_EOK && !peer_exit)
+    {
+        rt_sem_release(&ack_sem);
+    }
+    rt_sem_release(&done_sem);
+}
+
+/* wake up a higher priority thread and wait for its reply */
+static void bench_sem_round_trip(void)
+{
+    struct utest_bench bench;
+
+    if (!bench_peer_start("b_sem", sem_peer_entry, rt_thread_self()->current_priority - 1))
+    {
+        uassert_true(RT_FALSE);
+        return;
+    }
+
+    UTEST_BENCH(&bench, "kernel.sem_round_trip", BENCH_WARMUP, BENCH_ITERATIONS)
+    {
+        rt_sem_release(&req_sem);
+        rt_sem_take(&ack_sem, RT_WAITING_FOREVER);
+    }
+
+    peer_exit = RT_TRUE;
+    rt_sem_release(&req_sem);
+    uassert_int_equal(rt_sem_take(&done_sem, RT_WAITING_FOREVER), RT_EOK);
+}
+
+static void mb_peer_entry(void *parameter)
+{
+    rt_ubase_t value;
+
+    while (rt_mb_recv(&req_mb, &value, RT_WAITING_FOREVER) == RT_EOK && !peer_exit)
+    {
+        rt_mb_send(&ack_mb, value);
+    }
+    rt_sem_release(&done_sem);
+}
+
+static void bench_mb_round_trip(void)
+{
+    struct utest_bench bench;
+    rt_ubase_t value;
+
+    if (!bench_peer_start("b_mb", mb_peer_entry, rt_thread_self()->current_priority - 1))
+    {
+        uassert_true(RT_FALSE);
+        return;
+    }
+
+    UTEST_BENCH(&bench, "kernel.mb_round_trip", BENCH_WARMUP, BENCH_ITERATIONS)
+    {
+        rt_mb_send(&req_mb, 0);
+        rt_mb_recv(&ack_mb, &value, RT_WAITING_FOREVER);
+    }
+
+    peer_exit = RT_TRUE;
+    rt_mb_send(&req_mb, 0);
+    uassert_int_equal(rt_sem_take(&done_sem, RT_WAITING_FOREVER), RT_EOK);
+}
+
+static void bench_malloc_free(void)
+{
+    struct utest_bench bench;
+
+    UTEST_BENCH(&bench, "kernel.malloc_free", BENCH_WARMUP, BENCH_ITERATIONS)
+    {
+        rt_free(rt_malloc(64));
+    }
+}
+
+static void bench_timeout(void *parameter)
+{
+}
+
+static void bench_timer_start_stop(void)
+{
+    struct utest_bench bench;
+    struct rt_timer timer;
+
+    rt_timer_init(&timer, "b_timer", bench_timeout, RT_NULL, RT_TICK_PER_SECOND, RT_TIMER_FLAG_ONE_SHOT);
+
+    UTEST_BENCH(&bench, "kernel.timer_start_stop", BENCH_WARMUP, BENCH_ITERATIONS)
+    {
+        rt_timer_start(&timer);
+        rt_timer_stop(&timer);
+    }
+
+    rt_timer_detach(&timer);
+}
+
+static void bench_ringbuffer(void)
+{
+    struct utest_bench bench;
+    struct rt_ringbuffer rb;
+    static rt_uint8_t pool[BENCH_RB_SIZE];
+    rt_uint8_t data[BENCH_RB_CHUNK];
+    rt_size_t length = 0;
+
+    rt_ringbuffer_init(&rb, pool, sizeof(pool));
+    rt_memset(data, 0x5A, sizeof(data));
+
+    UTEST_BENCH(&bench, "kernel.ringbuffer_put_get", BENCH_WARMUP, BENCH_ITERATIONS)
+    {
+        rt_ringbuffer_put(&rb, data, sizeof(data));
+        length += rt_ringbuffer_get(&rb, data, sizeof(data));
+    }
+    uassert_int_equal(length, (BENCH_WARMUP + BENCH_ITERATIONS) * sizeof(data));
+}
+
+static rt_err_t utest_tc_init(void)
+{
+    rt_sem_init(&req_sem, "b_req", 0, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&ack_sem, "b_ack", 0, RT_IPC_FLAG_FIFO);
+    rt_sem_init(&done_sem, "b_done", 0, RT_IPC_FLAG_FIFO);
+    rt_mb_init(&req_mb, "b_req", req_pool, 1, RT_IPC_FLAG_FIFO);
+    rt_mb_init(&ack_mb, "b_ack", ack_pool, 1, RT_IPC_FLAG_FIFO);
+
+    return RT_EOK;
+}
+
+static rt_err_t utest_tc_cleanup(void)
+{
+    rt_sem_detach(&req_sem);
+    rt_sem_detach(&ack_sem);
+    rt_sem_detach(&done_sem);
+    rt_mb_detach(&req_mb);
+    rt_mb_detach(&ack_mb);
+
+    return RT_EOK;
+}
+
+static void testcase(void)
+{
+    UTEST_UNIT_RUN(bench_thread_yield);
+    UTEST_UNIT_RUN(bench_sem_round_trip);
+    UTEST_UNIT_RUN(bench_mb_round_trip);
+    UTEST_UNIT_RUN(bench_malloc_free);
+    UTEST_UNIT_RUN(bench_timer_start_stop);
+    UTEST_UNIT_RUN(bench_ringbuffer);
+}
+UTEST_TC_EXPORT(testcase, "bench.kernel", utest_tc_init, utest_tc_cleanup, 60);
+
+#endif /* UTEST_USING_BENCH */
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-19     RT-Thread    the first version
+ * 2019-10-28     RT-Thread    the Interlocked intrinsics of MSVC
+ */
+
+#ifndef __RT_ATOMIC_H__
+#define __RT_ATOMIC_H__
+
+#include <rthw.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Atomic operations on a machine word.
+ *
+ * - RT_USING_HW_ATOMIC: the libcpu of the architecture provides the
+ *   rt_hw_atomic_* routines, e.g. LDREX/STREX on ARMv7-M and ARMv7-A/R.
+ * - RT_USING_BUILTIN_ATOMIC: the compiler builtins, used by the host
+ *   simulator. They are the __atomic builtins of GCC, or the Interlocked
+ *   intrinsics of MSVC which are always sequentially consistent.
+ * - otherwise: the operations are done with the interrupt disabled, which
+ *   is only atomic on a single core.
+ *
+ * The *_explicit variants take a memory order, the others are sequentially
+ * consistent. The fetch-and-modify operations return the old value.
+ */
+
+typedef rt_base_t rt_atomic_t;
+
+/* memory orders, the same values as the __ATOMIC_* of GCC */
+#define RT_ATOMIC_RELAXED   0
+#define RT_ATOMIC_ACQUIRE   2
+#define RT_ATOMIC_RELEASE   3
+#define RT_ATOMIC_ACQ_REL   4
+#define RT_ATOMIC_SEQ_CST   5
+
+#define RT_ATOMIC_INIT(value)   (value)
+
+#if defined(RT_USING_HW_ATOMIC)
+
+rt_atomic_t rt_hw_atomic_load(volatile rt_atomic_t *ptr, int mo);
+void rt_hw_atomic_store(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo);
+rt_atomic_t rt_hw_atomic_add(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo);
+rt_atomic_t rt_hw_atomic_sub(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo);
+rt_atomic_t rt_hw_atomic_and(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo);
+rt_atomic_t rt_hw_atomic_or(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo);
+rt_atomic_t rt_hw_atomic_xchg(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo);
+rt_bool_t rt_hw_atomic_cas(volatile rt_atomic_t *ptr, rt_atomic_t *expected,
+                           rt_atomic_t desired, int mo);
+
+#define rt_atomic_load_explicit(ptr, mo)                rt_hw_atomic_load(ptr, mo)
+#define rt_atomic_store_explicit(ptr, val, mo)          rt_hw_atomic_store(ptr, val, mo)
+#define rt_atomic_add_explicit(ptr, val, mo)            rt_hw_atomic_add(ptr, val, mo)
+#define rt_atomic_sub_explicit(ptr, val, mo)            rt_hw_atomic_sub(ptr, val, mo)
+#define rt_atomic_and_explicit(ptr, val, mo)            rt_hw_atomic_and(ptr, val, mo)
+#define rt_atomic_or_explicit(ptr, val, mo)             rt_hw_atomic_or(ptr, val, mo)
+#define rt_atomic_xchg_explicit(ptr, val, mo)           rt_hw_atomic_xchg(ptr, val, mo)
+#define rt_atomic_cas_explicit(ptr, expected, val, mo)  rt_hw_atomic_cas(ptr, expected, val, mo)
+
+#elif defined(RT_USING_BUILTIN_ATOMIC) && defined(__GNUC__)
+
+#define rt_atomic_load_explicit(ptr, mo)                __atomic_load_n(ptr, mo)
+#define rt_atomic_store_explicit(ptr, val, mo)          __atomic_store_n(ptr, val, mo)
+#define rt_atomic_add_explicit(ptr, val, mo)            __atomic_fetch_add(ptr, val, mo)
+#define rt_atomic_sub_explicit(ptr, val, mo)            __atomic_fetch_sub(ptr, val, mo)
+#define rt_atomic_and_explicit(ptr, val, mo)            __atomic_fetch_and(ptr, val, mo)
+#define rt_atomic_or_explicit(ptr, val, mo)             __atomic_fetch_or(ptr, val, mo)
+#define rt_atomic_xchg_explicit(ptr, val, mo)           __atomic_exchange_n(ptr, val, mo)
+/* a failed compare can't be a release operation */
+#define rt_atomic_cas_explicit(ptr, expected, val, mo)                      \
+    __atomic_compare_exchange_n(ptr, expected, val, 0, mo,                  \
+        ((mo) == RT_ATOMIC_RELEASE) ? RT_ATOMIC_RELAXED :                   \
+        ((mo) == RT_ATOMIC_ACQ_REL) ? RT_ATOMIC_ACQUIRE : (mo))
+
+#elif defined(RT_USING_BUILTIN_ATOMIC) && defined(_MSC_VER)
+
+#include <intrin.h>
+
+/* rt_atomic_t is a long, the same as the operands of the intrinsics */
+rt_inline rt_bool_t rt_msvc_atomic_cas(volatile rt_atomic_t *ptr,
+                                       rt_atomic_t *expected, rt_atomic_t desired)
+{
+    rt_atomic_t old;
+
+    old = _InterlockedCompareExchange(ptr, desired, *expected);
+    if (old == *expected)
+        return RT_TRUE;
+
+    *expected = old;
+    return RT_FALSE;
+}
+
+#define rt_atomic_load_explicit(ptr, mo)                _InterlockedOr(ptr, 0)
+#define rt_atomic_store_explicit(ptr, val, mo)          ((void)_InterlockedExchange(ptr, val))
+#define rt_atomic_add_explicit(ptr, val, mo)            _InterlockedExchangeAdd(ptr, val)
+#define rt_atomic_sub_explicit(ptr, val, mo)            _InterlockedExchangeAdd(ptr, -(val))
+#define rt_atomic_and_explicit(ptr, val, mo)            _InterlockedAnd(ptr, val)
+#define rt_atomic_or_explicit(ptr, val, mo)             _InterlockedOr(ptr, val)
+#define rt_atomic_xchg_explicit(ptr, val, mo)           _InterlockedExchange(ptr, val)
+#define rt_atomic_cas_explicit(ptr, expected, val, mo)  rt_msvc_atomic_cas(ptr, expected, val)
+
+#else
+
+/* the interrupt disable/enable routines are also compiler barriers */
+rt_inline rt_atomic_t rt_soft_atomic_load(volatile rt_atomic_t *ptr)
+{
+    return *ptr;
+}
+
+rt_inline void rt_soft_atomic_store(volatile rt_atomic_t *ptr, rt_atomic_t val)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    *ptr = val;
+    rt_hw_interrupt_enable(level);
+}
+
+#define RT_SOFT_ATOMIC_FETCH_OP(name, op)                                   \
+rt_inline rt_atomic_t rt_soft_atomic_##name(volatile rt_atomic_t *ptr,      \
+                                            rt_atomic_t val)                \
+{                                                                           \
+    rt_base_t level;                                                        \
+    rt_atomic_t old;                                                        \
+                                                                            \
+    level = rt_hw_interrupt_disable();                                      \
+    old = *ptr;                                                             \
+    *ptr = op;                                                              \
+    rt_hw_interrupt_enable(level);                                          \
+                                                                            \
+    return old;                                                             \
+}
+
+RT_SOFT_ATOMIC_FETCH_OP(add,  old + val)
+RT_SOFT_ATOMIC_FETCH_OP(sub,  old - val)
+RT_SOFT_ATOMIC_FETCH_OP(and,  old & val)
+RT_SOFT_ATOMIC_FETCH_OP(or,   old | val)
+RT_SOFT_ATOMIC_FETCH_OP(xchg, val)
+
+rt_inline rt_bool_t rt_soft_atomic_cas(volatile rt_atomic_t *ptr,
+                                       rt_atomic_t *expected, rt_atomic_t desired)
+{
+    rt_base_t level;
+    rt_bool_t result = RT_TRUE;
+
+    level = rt_hw_interrupt_disable();
+    if (*ptr == *expected)
+    {
+        *ptr = desired;
+    }
+    else
+    {
+        *expected = *ptr;
+        result = RT_FALSE;
+    }
+    rt_hw_interrupt_enable(level);
+
+    return result;
+}
+
+#define rt_atomic_load_explicit(ptr, mo)                rt_soft_atomic_load(ptr)
+#define rt_atomic_store_explicit(ptr, val, mo)          rt_soft_atomic_store(ptr, val)
+#define rt_atomic_add_explicit(ptr, val, mo)            rt_soft_atomic_add(ptr, val)
+#define rt_atomic_sub_explicit(ptr, val, mo)            rt_soft_atomic_sub(ptr, val)
+#define rt_atomic_and_explicit(ptr, val, mo)            rt_soft_atomic_and(ptr, val)
+#define rt_atomic_or_explicit(ptr, val, mo)             rt_soft_atomic_or(ptr, val)
+#define rt_atomic_xchg_explicit(ptr, val, mo)           rt_soft_atomic_xchg(ptr, val)
+#define rt_atomic_cas_explicit(ptr, expected, val, mo)  rt_soft_atomic_cas(ptr, expected, val)
+
+#endif
+
+#define rt_atomic_load(ptr)                 rt_atomic_load_explicit(ptr, RT_ATOMIC_SEQ_CST)
+#define rt_atomic_store(ptr, val)           rt_atomic_store_explicit(ptr, val, RT_ATOMIC_SEQ_CST)
+#define rt_atomic_add(ptr, val)             rt_atomic_add_explicit(ptr, val, RT_ATOMIC_SEQ_CST)
+#define rt_atomic_sub(ptr, val)             rt_atomic_sub_explicit(ptr, val, RT_ATOMIC_SEQ_CST)
+#define rt_atomic_and(ptr, val)             rt_atomic_and_explicit(ptr, val, RT_ATOMIC_SEQ_CST)
+#define rt_atomic_or(ptr, val)              rt_atomic_or_explicit(ptr, val, RT_ATOMIC_SEQ_CST)
+#define rt_atomic_xchg(ptr, val)            rt_atomic_xchg_explicit(ptr, val, RT_ATOMIC_SEQ_CST)
+#define rt_atomic_cas(ptr, expected, val)   rt_atomic_cas_explicit(ptr, expected, val, RT_ATOMIC_SEQ_CST)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RT_ATOMIC_H__ */
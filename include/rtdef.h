@@ -31,6 +31,7 @@
  *                             add smp relevant macros
  * 2019-01-27     Bernard      change version number to v4.0.1
  * 2019-05-17     Bernard      change version number to v4.0.2
+ * 2019-08-22     RT-Thread    add reader-writer lock
  */
 
 #ifndef __RT_DEF_H__
@@ -383,6 +384,7 @@ enum rt_object_class_type
     RT_Object_Class_Device,                             /**< The object is a device */
     RT_Object_Class_Timer,                              /**< The object is a timer. */
     RT_Object_Class_Module,                             /**< The object is a module. */
+    RT_Object_Class_RWLock,                             /**< The object is a reader-writer lock. */
     RT_Object_Class_Unknown,                            /**< The object is unknown. */
     RT_Object_Class_Static = 0x80                       /**< The object is a static object. */
 };
@@ -683,6 +685,33 @@ struct rt_mutex
 typedef struct rt_mutex *rt_mutex_t;
 #endif
 
+#ifdef RT_USING_RWLOCK
+/**
+ * flag defintions in reader-writer lock, besides RT_IPC_FLAG_FIFO/PRIO
+ */
+#define RT_RWLOCK_FLAG_PREFER_READER    0x02            /**< readers go ahead of the waiting writers */
+
+#define RT_RWLOCK_WRITE_LOCKED          (-1)            /**< value of the lock held by a writer */
+
+/**
+ * Reader-writer lock structure
+ */
+struct rt_rwlock
+{
+    struct rt_ipc_object parent;                        /**< inherit from ipc_object, the suspended writers */
+
+    rt_list_t            reader_thread;                 /**< the suspended readers */
+
+    volatile rt_base_t   value;                         /**< number of readers, or RT_RWLOCK_WRITE_LOCKED */
+
+    rt_uint8_t           original_priority;             /**< priority of the writer before inheritance */
+    rt_uint8_t           reserved[3];
+
+    struct rt_thread    *owner;                         /**< the writer holding the lock */
+};
+typedef struct rt_rwlock *rt_rwlock_t;
+#endif
+
 #ifdef RT_USING_EVENT
 /**
  * flag defintions in event
@@ -14,6 +14,7 @@
  * 2013-06-24     Bernard      add rt_kprintf re-define when not use RT_USING_CONSOLE.
  * 2016-08-09     ArdaFu       add new thread and interrupt hook.
  * 2018-11-22     Jesven       add all cpu's lock and ipi handler
+ * 2019-08-22     RT-Thread    add reader-writer lock APIs
  */
 
 #ifndef __RT_THREAD_H__
@@ -322,6 +323,20 @@ rt_err_t rt_mutex_release(rt_mutex_t mutex);
 rt_err_t rt_mutex_control(rt_mutex_t mutex, int cmd, void *arg);
 #endif
 
+#ifdef RT_USING_RWLOCK
+/*
+ * reader-writer lock interface
+ */
+rt_err_t rt_rwlock_init(rt_rwlock_t rwlock, const char *name, rt_uint8_t flag);
+rt_err_t rt_rwlock_detach(rt_rwlock_t rwlock);
+rt_rwlock_t rt_rwlock_create(const char *name, rt_uint8_t flag);
+rt_err_t rt_rwlock_delete(rt_rwlock_t rwlock);
+
+rt_err_t rt_rwlock_take_read(rt_rwlock_t rwlock, rt_int32_t time);
+rt_err_t rt_rwlock_take_write(rt_rwlock_t rwlock, rt_int32_t time);
+rt_err_t rt_rwlock_release(rt_rwlock_t rwlock);
+#endif
+
 #ifdef RT_USING_EVENT
 /*
  * event interface
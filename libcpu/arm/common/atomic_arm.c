@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2006-2018, RT-Thread Development Team
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Change Logs:
+ * Date           Author       Notes
+ * 2019-08-19     RT-Thread    the first version
+ */
+
+#include <rtthread.h>
+#include <rtatomic.h>
+
+#ifdef RT_USING_HW_ATOMIC
+
+/*
+ * The exclusive access instructions of ARMv6/ARMv7 (Cortex-M3/M4/M7,
+ * Cortex-R and Cortex-A). The memory order is mapped to DMB: before the
+ * access for release, after the access for acquire.
+ */
+#if defined(__CC_ARM)
+#define _arm_ldrex(ptr)         ((rt_atomic_t)__ldrex(ptr))
+#define _arm_strex(ptr, val)    __strex(val, ptr)
+#define _arm_clrex()            __clrex()
+#define _arm_dmb()              __dmb(0xF)
+#elif defined(__ICCARM__)
+#include <intrinsics.h>
+#define _arm_ldrex(ptr)         ((rt_atomic_t)__LDREX((unsigned long *)(ptr)))
+#define _arm_strex(ptr, val)    __STREX((unsigned long)(val), (unsigned long *)(ptr))
+#define _arm_clrex()            __CLREX()
+#define _arm_dmb()              __DMB()
+#elif defined(__GNUC__)
+rt_inline rt_atomic_t _arm_ldrex(volatile rt_atomic_t *ptr)
+{
+    rt_atomic_t val;
+
+    __asm volatile ("ldrex %0, [%1]" : "=r" (val) : "r" (ptr) : "memory");
+    return val;
+}
+
+/* return 0 on the store is done */
+rt_inline int _arm_strex(volatile rt_atomic_t *ptr, rt_atomic_t val)
+{
+    int result;
+
+    __asm volatile ("strex %0, %2, [%1]" : "=&r" (result) : "r" (ptr), "r" (val) : "memory");
+    return result;
+}
+
+#define _arm_clrex()            __asm volatile ("clrex" ::: "memory")
+#define _arm_dmb()              __asm volatile ("dmb" ::: "memory")
+#else
+#error "not supported compiler for RT_USING_HW_ATOMIC"
+#endif
+
+#define _barrier_before(mo)     do { if ((mo) >= RT_ATOMIC_RELEASE) _arm_dmb(); } while (0)
+#define _barrier_after(mo)      do { if ((mo) != RT_ATOMIC_RELAXED && \
+                                         (mo) != RT_ATOMIC_RELEASE) _arm_dmb(); } while (0)
+
+rt_atomic_t rt_hw_atomic_load(volatile rt_atomic_t *ptr, int mo)
+{
+    rt_atomic_t val;
+
+    val = *ptr;
+    _barrier_after(mo);
+
+    return val;
+}
+
+void rt_hw_atomic_store(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo)
+{
+    _barrier_before(mo);
+    *ptr = val;
+    if (mo == RT_ATOMIC_SEQ_CST)
+        _arm_dmb();
+}
+
+#define HW_ATOMIC_FETCH_OP(name, op)                                            \
+rt_atomic_t rt_hw_atomic_##name(volatile rt_atomic_t *ptr, rt_atomic_t val, int mo) \
+{                                                                               \
+    rt_atomic_t old;                                                            \
+                                                                                \
+    _barrier_before(mo);                                                        \
+    do                                                                          \
+    {                                                                           \
+        old = _arm_ldrex(ptr);                                                  \
+    } while (_arm_strex(ptr, op) != 0);                                         \
+    _barrier_after(mo);                                                         \
+                                                                                \
+    return old;                                                                 \
+}
+
+HW_ATOMIC_FETCH_OP(add,  old + val)
+HW_ATOMIC_FETCH_OP(sub,  old - val)
+HW_ATOMIC_FETCH_OP(and,  old & val)
+HW_ATOMIC_FETCH_OP(or,   old | val)
+HW_ATOMIC_FETCH_OP(xchg, val)
+
+rt_bool_t rt_hw_atomic_cas(volatile rt_atomic_t *ptr, rt_atomic_t *expected,
+                           rt_atomic_t desired, int mo)
+{
+    rt_atomic_t old;
+
+    _barrier_before(mo);
+    do
+    {
+        old = _arm_ldrex(ptr);
+        if (old != *expected)
+        {
+            /* drop the exclusive monitor */
+            _arm_clrex();
+            *expected = old;
+            _barrier_after(mo);
+
+            return RT_FALSE;
+        }
+    } while (_arm_strex(ptr, desired) != 0);
+    _barrier_after(mo);
+
+    return RT_TRUE;
+}
+
+#endif /* RT_USING_HW_ATOMIC */
@@ -33,10 +33,13 @@
  * 2011-12-18     Bernard      add more parameter checking in message queue
  * 2013-09-14     Grissiom     add an option check in rt_event_recv
  * 2018-10-02     Bernard      add 64bit support for mailbox
+ * 2019-08-22     RT-Thread    add reader-writer lock
+ * 2019-10-28     RT-Thread    pass the inherited priority on to the next writer
  */
 
 #include <rtthread.h>
 #include <rthw.h>
+#include <rtatomic.h>
 
 #ifdef RT_USING_HOOK
 extern void (*rt_object_trytake_hook)(struct rt_object *object);
@@ -900,6 +903,574 @@ rt_err_t rt_mutex_control(rt_mutex_t mutex, int cmd, void *arg)
 RTM_EXPORT(rt_mutex_control);
 #endif /* end of RT_USING_MUTEX */
 
+#ifdef RT_USING_RWLOCK
+/**
+ * This function will initialize a reader-writer lock and put it under
+ * control of resource management.
+ *
+ * @param rwlock the reader-writer lock object
+ * @param name the name of reader-writer lock
+ * @param flag the flag of reader-writer lock, RT_IPC_FLAG_FIFO/RT_IPC_FLAG_PRIO
+ *        with an optional RT_RWLOCK_FLAG_PREFER_READER
+ *
+ * @return the operation status, RT_EOK on successful
+ */
+rt_err_t rt_rwlock_init(rt_rwlock_t rwlock, const char *name, rt_uint8_t flag)
+{
+    /* parameter check */
+    RT_ASSERT(rwlock != RT_NULL);
+
+    /* init object */
+    rt_object_init(&(rwlock->parent.parent), RT_Object_Class_RWLock, name);
+
+    /* init ipc object */
+    rt_ipc_object_init(&(rwlock->parent));
+    rt_list_init(&(rwlock->reader_thread));
+
+    rwlock->value = 0;
+    rwlock->owner = RT_NULL;
+    rwlock->original_priority = 0xFF;
+
+    /* set flag */
+    rwlock->parent.parent.flag = flag;
+
+    return RT_EOK;
+}
+RTM_EXPORT(rt_rwlock_init);
+
+/**
+ * This function will detach a reader-writer lock from resource management
+ *
+ * @param rwlock the reader-writer lock object
+ *
+ * @return the operation status, RT_EOK on successful
+ *
+ * @see rt_rwlock_delete
+ */
+rt_err_t rt_rwlock_detach(rt_rwlock_t rwlock)
+{
+    /* parameter check */
+    RT_ASSERT(rwlock != RT_NULL);
+    RT_ASSERT(rt_object_get_type(&rwlock->parent.parent) == RT_Object_Class_RWLock);
+    RT_ASSERT(rt_object_is_systemobject(&rwlock->parent.parent));
+
+    /* wakeup all suspend threads */
+    rt_ipc_list_resume_all(&(rwlock->parent.suspend_thread));
+    rt_ipc_list_resume_all(&(rwlock->reader_thread));
+
+    /* detach reader-writer lock object */
+    rt_object_detach(&(rwlock->parent.parent));
+
+    return RT_EOK;
+}
+RTM_EXPORT(rt_rwlock_detach);
+
+#ifdef RT_USING_HEAP
+/**
+ * This function will create a reader-writer lock from system resource
+ *
+ * @param name the name of reader-writer lock
+ * @param flag the flag of reader-writer lock
+ *
+ * @return the created reader-writer lock, RT_NULL on error happen
+ *
+ * @see rt_rwlock_init
+ */
+rt_rwlock_t rt_rwlock_create(const char *name, rt_uint8_t flag)
+{
+    struct rt_rwlock *rwlock;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    /* allocate object */
+    rwlock = (rt_rwlock_t)rt_object_allocate(RT_Object_Class_RWLock, name);
+    if (rwlock == RT_NULL)
+        return rwlock;
+
+    /* init ipc object */
+    rt_ipc_object_init(&(rwlock->parent));
+    rt_list_init(&(rwlock->reader_thread));
+
+    rwlock->value             = 0;
+    rwlock->owner             = RT_NULL;
+    rwlock->original_priority = 0xFF;
+
+    /* set flag */
+    rwlock->parent.parent.flag = flag;
+
+    return rwlock;
+}
+RTM_EXPORT(rt_rwlock_create);
+
+/**
+ * This function will delete a reader-writer lock object and release the
+ * memory
+ *
+ * @param rwlock the reader-writer lock object
+ *
+ * @return the error code
+ *
+ * @see rt_rwlock_detach
+ */
+rt_err_t rt_rwlock_delete(rt_rwlock_t rwlock)
+{
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    /* parameter check */
+    RT_ASSERT(rwlock != RT_NULL);
+    RT_ASSERT(rt_object_get_type(&rwlock->parent.parent) == RT_Object_Class_RWLock);
+    RT_ASSERT(rt_object_is_systemobject(&rwlock->parent.parent) == RT_FALSE);
+
+    /* wakeup all suspend threads */
+    rt_ipc_list_resume_all(&(rwlock->parent.suspend_thread));
+    rt_ipc_list_resume_all(&(rwlock->reader_thread));
+
+    /* delete reader-writer lock object */
+    rt_object_delete(&(rwlock->parent.parent));
+
+    return RT_EOK;
+}
+RTM_EXPORT(rt_rwlock_delete);
+#endif
+
+/* whether a new reader can take the lock, called with interrupt disabled or
+ * as the lock-free test of the fast path */
+rt_inline rt_bool_t rt_rwlock_readable(rt_rwlock_t rwlock, rt_base_t value)
+{
+    if (value < 0)
+        return RT_FALSE;
+
+    /* writer preference: the waiting writers block the new readers */
+    if (!(rwlock->parent.parent.flag & RT_RWLOCK_FLAG_PREFER_READER) &&
+        !rt_list_isempty(&(rwlock->parent.suspend_thread)))
+        return RT_FALSE;
+
+    return RT_TRUE;
+}
+
+/*
+ * suspend the current thread on a list of the reader-writer lock, the writer
+ * holding the lock inherits the priority of the current thread. It's called
+ * with interrupt disabled and returns with interrupt enabled.
+ */
+static rt_err_t rt_rwlock_suspend(rt_rwlock_t rwlock, rt_list_t *list,
+                                  struct rt_thread *thread, rt_int32_t time,
+                                  rt_base_t level)
+{
+    struct rt_thread *owner = rwlock->owner;
+
+    /* raise the priority of the writer */
+    if (owner != RT_NULL && thread->current_priority < owner->current_priority)
+    {
+        rt_thread_control(owner, RT_THREAD_CTRL_CHANGE_PRIORITY,
+                          &thread->current_priority);
+    }
+
+    /* suspend current thread */
+    rt_ipc_list_suspend(list, thread, rwlock->parent.parent.flag & RT_IPC_FLAG_PRIO);
+
+    /* has waiting time, start thread timer */
+    if (time > 0)
+    {
+        rt_timer_control(&(thread->thread_timer), RT_TIMER_CTRL_SET_TIME, &time);
+        rt_timer_start(&(thread->thread_timer));
+    }
+
+    /* enable interrupt */
+    rt_hw_interrupt_enable(level);
+
+    /* do schedule */
+    rt_schedule();
+
+    return thread->error;
+}
+
+/**
+ * This function will take a reader-writer lock for reading, if the lock is
+ * held by a writer (or writers are waiting when the writers are preferred),
+ * the thread shall wait for a specified time.
+ *
+ * The uncontended read lock is a single atomic operation.
+ *
+ * @param rwlock the reader-writer lock object
+ * @param time the waiting time
+ *
+ * @return the error code
+ */
+rt_err_t rt_rwlock_take_read(rt_rwlock_t rwlock, rt_int32_t time)
+{
+    register rt_base_t temp;
+    struct rt_thread *thread;
+    rt_atomic_t value;
+    rt_err_t result;
+
+    /* this function must not be used in interrupt even if time = 0 */
+    RT_DEBUG_IN_THREAD_CONTEXT;
+
+    /* parameter check */
+    RT_ASSERT(rwlock != RT_NULL);
+    RT_ASSERT(rt_object_get_type(&rwlock->parent.parent) == RT_Object_Class_RWLock);
+
+    /* fast path */
+    value = rt_atomic_load_explicit(&rwlock->value, RT_ATOMIC_RELAXED);
+    if (rt_rwlock_readable(rwlock, value) &&
+        rt_atomic_cas_explicit(&rwlock->value, &value, value + 1, RT_ATOMIC_ACQUIRE))
+    {
+        RT_OBJECT_HOOK_CALL(rt_object_take_hook, (&(rwlock->parent.parent)));
+
+        return RT_EOK;
+    }
+
+    thread = rt_thread_self();
+
+__again:
+    /* disable interrupt */
+    temp = rt_hw_interrupt_disable();
+
+    RT_OBJECT_HOOK_CALL(rt_object_trytake_hook, (&(rwlock->parent.parent)));
+
+    /* reset thread error */
+    thread->error = RT_EOK;
+
+    value = rt_atomic_load_explicit(&rwlock->value, RT_ATOMIC_RELAXED);
+    while (rt_rwlock_readable(rwlock, value))
+    {
+        if (rt_atomic_cas_explicit(&rwlock->value, &value, value + 1, RT_ATOMIC_ACQUIRE))
+        {
+            /* enable interrupt */
+            rt_hw_interrupt_enable(temp);
+
+            RT_OBJECT_HOOK_CALL(rt_object_take_hook, (&(rwlock->parent.parent)));
+
+            return RT_EOK;
+        }
+    }
+
+    /* no waiting, return with timeout */
+    if (time == 0)
+    {
+        thread->error = -RT_ETIMEOUT;
+
+        /* enable interrupt */
+        rt_hw_interrupt_enable(temp);
+
+        return -RT_ETIMEOUT;
+    }
+
+    RT_DEBUG_LOG(RT_DEBUG_IPC, ("rwlock_take_read: suspend thread: %s\n",
+                                thread->name));
+
+    /* the lock is handed over by the release */
+    result = rt_rwlock_suspend(rwlock, &(rwlock->reader_thread), thread, time, temp);
+    if (result != RT_EOK)
+    {
+        /* interrupt by signal, try it again */
+        if (result == -RT_EINTR) goto __again;
+
+        return result;
+    }
+
+    RT_OBJECT_HOOK_CALL(rt_object_take_hook, (&(rwlock->parent.parent)));
+
+    return RT_EOK;
+}
+RTM_EXPORT(rt_rwlock_take_read);
+
+static rt_bool_t rt_rwlock_wakeup(rt_rwlock_t rwlock);
+
+/**
+ * This function will take a reader-writer lock for writing, if the lock is
+ * held by readers or a writer, the thread shall wait for a specified time.
+ *
+ * @param rwlock the reader-writer lock object
+ * @param time the waiting time
+ *
+ * @return the error code
+ */
+rt_err_t rt_rwlock_take_write(rt_rwlock_t rwlock, rt_int32_t time)
+{
+    register rt_base_t temp;
+    struct rt_thread *thread;
+    rt_atomic_t value;
+    rt_err_t result;
+    rt_bool_t need_schedule;
+
+    /* this function must not be used in interrupt even if time = 0 */
+    RT_DEBUG_IN_THREAD_CONTEXT;
+
+    /* parameter check */
+    RT_ASSERT(rwlock != RT_NULL);
+    RT_ASSERT(rt_object_get_type(&rwlock->parent.parent) == RT_Object_Class_RWLock);
+
+    thread = rt_thread_self();
+
+__again:
+    /* disable interrupt */
+    temp = rt_hw_interrupt_disable();
+
+    RT_OBJECT_HOOK_CALL(rt_object_trytake_hook, (&(rwlock->parent.parent)));
+
+    /* reset thread error */
+    thread->error = RT_EOK;
+
+    /* the owner is set with interrupt disabled, so that the blocked threads
+     * always find the writer to inherit their priority */
+    value = 0;
+    if (rt_atomic_cas_explicit(&rwlock->value, &value, RT_RWLOCK_WRITE_LOCKED, RT_ATOMIC_ACQUIRE))
+    {
+        rwlock->owner             = thread;
+        rwlock->original_priority = thread->current_priority;
+
+        /* enable interrupt */
+        rt_hw_interrupt_enable(temp);
+
+        RT_OBJECT_HOOK_CALL(rt_object_take_hook, (&(rwlock->parent.parent)));
+
+        return RT_EOK;
+    }
+
+    /* no waiting, return with timeout */
+    if (time == 0)
+    {
+        thread->error = -RT_ETIMEOUT;
+
+        /* enable interrupt */
+        rt_hw_interrupt_enable(temp);
+
+        return -RT_ETIMEOUT;
+    }
+
+    RT_DEBUG_LOG(RT_DEBUG_IPC, ("rwlock_take_write: suspend thread: %s\n",
+                                thread->name));
+
+    /* the lock is handed over by the release */
+    result = rt_rwlock_suspend(rwlock, &(rwlock->parent.suspend_thread), thread, time, temp);
+    if (result != RT_EOK)
+    {
+        /* the readers queued behind this writer may take the lock now */
+        temp = rt_hw_interrupt_disable();
+        need_schedule = rt_rwlock_wakeup(rwlock);
+        rt_hw_interrupt_enable(temp);
+
+        if (need_schedule == RT_TRUE)
+            rt_schedule();
+
+        /* interrupt by signal, try it again */
+        if (result == -RT_EINTR) goto __again;
+
+        return result;
+    }
+
+    RT_OBJECT_HOOK_CALL(rt_object_take_hook, (&(rwlock->parent.parent)));
+
+    return RT_EOK;
+}
+RTM_EXPORT(rt_rwlock_take_write);
+
+/*
+ * the new writer inherits the highest priority of the threads still blocked
+ * on the lock, with interrupt disabled
+ */
+static void rt_rwlock_inherit(rt_rwlock_t rwlock, struct rt_thread *owner)
+{
+    struct rt_list_node *n;
+    struct rt_thread *thread;
+    rt_uint8_t priority = owner->current_priority;
+
+    rt_list_for_each(n, &(rwlock->parent.suspend_thread))
+    {
+        thread = rt_list_entry(n, struct rt_thread, tlist);
+        if (thread->current_priority < priority)
+            priority = thread->current_priority;
+    }
+    rt_list_for_each(n, &(rwlock->reader_thread))
+    {
+        thread = rt_list_entry(n, struct rt_thread, tlist);
+        if (thread->current_priority < priority)
+            priority = thread->current_priority;
+    }
+
+    if (priority != owner->current_priority)
+        rt_thread_control(owner, RT_THREAD_CTRL_CHANGE_PRIORITY, &priority);
+}
+
+/* hand the lock over to the first waiting writer, with interrupt disabled */
+static rt_bool_t rt_rwlock_wakeup_writer(rt_rwlock_t rwlock, rt_base_t value)
+{
+    struct rt_thread *thread;
+
+    if (rt_list_isempty(&(rwlock->parent.suspend_thread)))
+        return RT_FALSE;
+
+    /* a reader may slip in on the fast path, it hands over on its release */
+    if (value != RT_RWLOCK_WRITE_LOCKED &&
+        !rt_atomic_cas_explicit(&rwlock->value, &value, RT_RWLOCK_WRITE_LOCKED, RT_ATOMIC_ACQUIRE))
+        return RT_FALSE;
+
+    thread = rt_list_entry(rwlock->parent.suspend_thread.next, struct rt_thread, tlist);
+
+    RT_DEBUG_LOG(RT_DEBUG_IPC, ("rwlock_release: resume writer: %s\n",
+                                thread->name));
+
+    rwlock->owner             = thread;
+    rwlock->original_priority = thread->current_priority;
+    thread->error = RT_EOK;
+
+    rt_ipc_list_resume(&(rwlock->parent.suspend_thread));
+
+    /* the boost of the previous writer is passed on with the lock */
+    rt_rwlock_inherit(rwlock, thread);
+
+    return RT_TRUE;
+}
+
+/* hand the lock over to all the waiting readers, with interrupt disabled */
+static rt_bool_t rt_rwlock_wakeup_readers(rt_rwlock_t rwlock)
+{
+    struct rt_thread *thread;
+
+    if (rt_list_isempty(&(rwlock->reader_thread)))
+        return RT_FALSE;
+
+    while (!rt_list_isempty(&(rwlock->reader_thread)))
+    {
+        thread = rt_list_entry(rwlock->reader_thread.next, struct rt_thread, tlist);
+        thread->error = RT_EOK;
+
+        rt_atomic_add_explicit(&rwlock->value, 1, RT_ATOMIC_RELAXED);
+
+        /* remove the thread from the suspend list and make it ready */
+        rt_thread_resume(thread);
+    }
+
+    return RT_TRUE;
+}
+
+/*
+ * hand the lock which is not held for writing over to the waiting threads,
+ * with interrupt disabled. The first waiting writer takes a free lock, the
+ * readers take it when no writer is waiting any more.
+ */
+static rt_bool_t rt_rwlock_wakeup(rt_rwlock_t rwlock)
+{
+    rt_atomic_t value = rt_atomic_load_explicit(&rwlock->value, RT_ATOMIC_RELAXED);
+
+    /* the writer hands over on its release */
+    if (value < 0)
+        return RT_FALSE;
+
+    if (!rt_list_isempty(&(rwlock->parent.suspend_thread)))
+    {
+        /* the last reader hands over to the writer on its release */
+        if (value != 0)
+            return RT_FALSE;
+
+        return rt_rwlock_wakeup_writer(rwlock, 0);
+    }
+
+    return rt_rwlock_wakeup_readers(rwlock);
+}
+
+/**
+ * This function will release a reader-writer lock held by the current thread
+ * for either reading or writing. The writer releasing the lock hands it over
+ * to the waiting writer first, or the waiting readers when the readers are
+ * preferred.
+ *
+ * @param rwlock the reader-writer lock object
+ *
+ * @return the error code
+ */
+rt_err_t rt_rwlock_release(rt_rwlock_t rwlock)
+{
+    register rt_base_t temp;
+    struct rt_thread *thread;
+    rt_atomic_t value;
+    rt_bool_t need_schedule = RT_FALSE;
+
+    /* parameter check */
+    RT_ASSERT(rwlock != RT_NULL);
+    RT_ASSERT(rt_object_get_type(&rwlock->parent.parent) == RT_Object_Class_RWLock);
+
+    RT_DEBUG_IN_THREAD_CONTEXT;
+
+    value = rt_atomic_load_explicit(&rwlock->value, RT_ATOMIC_RELAXED);
+
+    /* fast path of reader, the last reader always takes the slow path to
+     * hand the lock over to the waiting writer */
+    if (value > 1 &&
+        rt_atomic_cas_explicit(&rwlock->value, &value, value - 1, RT_ATOMIC_RELEASE))
+    {
+        RT_OBJECT_HOOK_CALL(rt_object_put_hook, (&(rwlock->parent.parent)));
+
+        return RT_EOK;
+    }
+
+    thread = rt_thread_self();
+
+    /* disable interrupt */
+    temp = rt_hw_interrupt_disable();
+
+    RT_OBJECT_HOOK_CALL(rt_object_put_hook, (&(rwlock->parent.parent)));
+
+    value = rt_atomic_load_explicit(&rwlock->value, RT_ATOMIC_RELAXED);
+    if (value > 0)
+    {
+        /* the last reader hands over to the waiting writer */
+        value = rt_atomic_sub_explicit(&rwlock->value, 1, RT_ATOMIC_RELEASE) - 1;
+        if (value == 0)
+            need_schedule = rt_rwlock_wakeup(rwlock);
+    }
+    else if (value == RT_RWLOCK_WRITE_LOCKED && rwlock->owner == thread)
+    {
+        /* change the owner thread to original priority */
+        if (rwlock->original_priority != thread->current_priority)
+        {
+            rt_thread_control(thread, RT_THREAD_CTRL_CHANGE_PRIORITY,
+                              &(rwlock->original_priority));
+        }
+        rwlock->owner             = RT_NULL;
+        rwlock->original_priority = 0xFF;
+
+        if (rwlock->parent.parent.flag & RT_RWLOCK_FLAG_PREFER_READER)
+        {
+            rt_atomic_store_explicit(&rwlock->value, 0, RT_ATOMIC_RELEASE);
+            need_schedule = rt_rwlock_wakeup_readers(rwlock) ||
+                            rt_rwlock_wakeup_writer(rwlock, 0);
+        }
+        else if (rt_rwlock_wakeup_writer(rwlock, RT_RWLOCK_WRITE_LOCKED))
+        {
+            need_schedule = RT_TRUE;
+        }
+        else
+        {
+            rt_atomic_store_explicit(&rwlock->value, 0, RT_ATOMIC_RELEASE);
+            need_schedule = rt_rwlock_wakeup_readers(rwlock);
+        }
+    }
+    else
+    {
+        /* not held by the current thread */
+        thread->error = -RT_ERROR;
+
+        /* enable interrupt */
+        rt_hw_interrupt_enable(temp);
+
+        return -RT_ERROR;
+    }
+
+    /* enable interrupt */
+    rt_hw_interrupt_enable(temp);
+
+    /* perform a schedule */
+    if (need_schedule == RT_TRUE)
+        rt_schedule();
+
+    return RT_EOK;
+}
+RTM_EXPORT(rt_rwlock_release);
+#endif /* end of RT_USING_RWLOCK */
+
 #ifdef RT_USING_EVENT
 /**
  * This function will initialize an event and put it under control of resource
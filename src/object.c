@@ -13,6 +13,7 @@
  * 2010-10-26     yi.qiu       add module support in rt_object_allocate and rt_object_free
  * 2017-12-10     Bernard      Add object_info enum.
  * 2018-01-25     Bernard      Fix the object find issue when enable MODULE.
+ * 2019-08-22     RT-Thread    Add reader-writer lock container.
  */
 
 #include <rtthread.h>
@@ -55,6 +56,9 @@ enum rt_object_info_type
     RT_Object_Info_Timer,                              /**< The object is a timer. */
 #ifdef RT_USING_MODULE
     RT_Object_Info_Module,                             /**< The object is a module. */
+#endif
+#ifdef RT_USING_RWLOCK
+    RT_Object_Info_RWLock,                             /**< The object is a reader-writer lock. */
 #endif
     RT_Object_Info_Unknown,                            /**< The object is unknown. */
 };
@@ -103,6 +107,10 @@ static struct rt_object_information rt_object_container[RT_Object_Info_Unknown]
     /* initialize object container - module */
     {RT_Object_Class_Module, _OBJ_CONTAINER_LIST_INIT(RT_Object_Info_Module), sizeof(struct rt_dlmodule)},
 #endif
+#ifdef RT_USING_RWLOCK
+    /* initialize object container - reader-writer lock */
+    {RT_Object_Class_RWLock, _OBJ_CONTAINER_LIST_INIT(RT_Object_Info_RWLock), sizeof(struct rt_rwlock)},
+#endif
 };
 
 #ifdef RT_USING_HOOK
@@ -0,0 +1,185 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2006-2018, RT-Thread Development Team
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Change Logs:
+# Date           Author       Notes
+# 2019-08-26     RT-Thread    the first version
+# 2019-10-26     RT-Thread    the tag is copied into the frame
+#
+
+"""
+Decode the binary log of ulog (ULOG_USING_BINARY with ULOG_BINARY_HOST_FORMAT).
+
+The log frame has the address of the format string, it is read from the ELF
+file of the firmware. The tag is copied into the frame after the arguments:
+
+    python ulog_decode.py rtthread.elf log.bin
+    cat /dev/ttyUSB0 | python ulog_decode.py rtthread.elf
+"""
+
+import sys
+import struct
+import argparse
+
+ULOG_BIN_FRAME_MAGIC = 0x11
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+LEVEL_INFO = {0: 'A/', 3: 'E/', 4: 'W/', 6: 'I/', 7: 'D/'}
+
+class Elf(object):
+    def __init__(self, name):
+        data = open(name, 'rb').read()
+        if data[:4] != b'\x7fELF':
+            raise ValueError('%s is not an ELF file' % name)
+
+        self.ptr_size = 8 if bytearray(data)[4] == 2 else 4
+        self.endian = '>' if bytearray(data)[5] == 2 else '<'
+
+        if self.ptr_size == 8:
+            shoff, = struct.unpack_from(self.endian + 'Q', data, 0x28)
+            shentsize, shnum = struct.unpack_from(self.endian + 'HH', data, 0x3A)
+            shdr = self.endian + 'IIQQQQ'
+        else:
+            shoff, = struct.unpack_from(self.endian + 'I', data, 0x20)
+            shentsize, shnum = struct.unpack_from(self.endian + 'HH', data, 0x2E)
+            shdr = self.endian + 'IIIIII'
+
+        # the loaded sections which have the data in file
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(shdr, data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, size, data[offset:offset + size]))
+
+    def string(self, addr):
+        for start, size, data in self.sections:
+            if start <= addr < start + size:
+                end = data.find(b'\0', addr - start)
+                if end < 0:
+                    end = size
+                return data[addr - start:end].decode('utf-8', 'replace')
+
+        return '<0x%x>' % addr
+
+class Decoder(object):
+    def __init__(self, elf):
+        self.elf = elf
+        e = elf.endian
+        p = 'Q' if elf.ptr_size == 8 else 'I'
+        self.head = struct.Struct(e + 'BBBBII')
+        self.ptrs = struct.Struct(e + p + p)
+        # the pointers are aligned to their size
+        self.ptrs_offset = (self.head.size + elf.ptr_size - 1) // elf.ptr_size * elf.ptr_size
+        self.frame_size = self.ptrs_offset + self.ptrs.size
+        self.int = {
+            'int': (e + 'i', e + 'I'),
+            'long': (e + ('q' if elf.ptr_size == 8 else 'i'), e + p),
+            'llong': (e + 'q', e + 'Q'),
+            'ptr': (e + p, e + p),
+        }
+        self.double = e + 'd'
+
+    def format(self, fmt, args):
+        """ format the C style format string by the raw arguments """
+        out = []
+        pos = 0
+        i = 0
+
+        def take(code):
+            value, = struct.unpack_from(code, args, pos)
+            return value, pos + struct.calcsize(code)
+
+        try:
+            while i < len(fmt):
+                if fmt[i] != '%':
+                    out.append(fmt[i])
+                    i += 1
+                    continue
+
+                j = i + 1
+                while j < len(fmt) and fmt[j] in '-+ #0':
+                    j += 1
+                spec = fmt[i:j]
+                # width and precision, '*' is an int argument
+                while j < len(fmt) and (fmt[j].isdigit() or fmt[j] in '.*'):
+                    if fmt[j] == '*':
+                        value, pos = take(self.int['int'][0])
+                        spec += str(value)
+                    else:
+                        spec += fmt[j]
+                    j += 1
+                size = 'int'
+                while j < len(fmt) and fmt[j] in 'hlz':
+                    if fmt[j] == 'l':
+                        size = 'llong' if size == 'long' else 'long'
+                    elif fmt[j] == 'z':
+                        size = 'ptr'
+                    j += 1
+                conv = fmt[j] if j < len(fmt) else ''
+                i = j + 1
+
+                if conv in 'di':
+                    value, pos = take(self.int[size][0])
+                    out.append((spec + 'd') % value)
+                elif conv in 'uxXoc':
+                    value, pos = take(self.int[size][1])
+                    out.append((spec + ('d' if conv == 'u' else conv)) % value)
+                elif conv == 'p':
+                    value, pos = take(self.int['ptr'][1])
+                    out.append((spec + 's') % ('0x%x' % value))
+                elif conv in 'fFeEgG':
+                    value, pos = take(self.double)
+                    out.append((spec + conv) % value)
+                elif conv == 's':
+                    length = bytearray(args[pos:pos + 1])[0]
+                    value = args[pos + 1:pos + 1 + length].decode('utf-8', 'replace')
+                    pos += length + 2
+                    out.append((spec + 's') % value)
+                elif conv == '%':
+                    out.append('%')
+        except (struct.error, IndexError):
+            # the arguments are truncated on the device
+            pass
+
+        return ''.join(out)
+
+    def decode(self, stream):
+        """ decode all log frames in stream, the broken bytes are skipped """
+        data = stream.read()
+        pos = 0
+
+        while pos + self.frame_size <= len(data):
+            magic, level, newline, tag_len, args_len, tick = self.head.unpack_from(data, pos)
+            if magic != ULOG_BIN_FRAME_MAGIC or level not in LEVEL_INFO or \
+                    pos + self.frame_size + args_len + tag_len > len(data):
+                pos += 1
+                continue
+
+            _, fmt = self.ptrs.unpack_from(data, pos + self.ptrs_offset)
+            args = data[pos + self.frame_size:pos + self.frame_size + args_len]
+            pos += self.frame_size + args_len
+            tag = data[pos:pos + tag_len].decode('utf-8', 'replace')
+            pos += tag_len
+
+            log = '[%d] %s%s: %s' % (tick, LEVEL_INFO[level], tag,
+                                     self.format(self.elf.string(fmt), args))
+            yield log + ('\n' if newline else '')
+
+def main():
+    parser = argparse.ArgumentParser(description='decode the binary log of ulog')
+    parser.add_argument('elf', help='the ELF file of the firmware')
+    parser.add_argument('log', nargs='?', help='the binary log file, default to stdin')
+    args = parser.parse_args()
+
+    stream = open(args.log, 'rb') if args.log else getattr(sys.stdin, 'buffer', sys.stdin)
+    decoder = Decoder(Elf(args.elf))
+    for log in decoder.decode(stream):
+        sys.stdout.write(log)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2006-2018, RT-Thread Development Team
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+# Change Logs:
+# Date           Author       Notes
+# 2019-09-19     RT-Thread    the first version
+#
+
+"""
+Compare the benchmark results of utest (UTEST_USING_BENCH) in two logs.
+
+The JSON lines of results are picked up from the console logs, the other
+lines are ignored:
+
+    python utest_bench_diff.py old.log new.log
+    python utest_bench_diff.py --threshold 10 old.log new.log
+
+The exit code is 1 when the median or p99 of any benchmark is slower than
+the threshold (percent).
+"""
+
+import sys
+import json
+import argparse
+
+STATS = ('min', 'median', 'p99', 'max')
+
+def load(name):
+    """ the last result of every benchmark in log """
+    results = {}
+    for line in open(name, 'rb'):
+        line = line.decode('utf-8', 'replace')
+        start = line.find('{"bench":')
+        if start < 0:
+            continue
+        try:
+            result = json.loads(line[start:].strip())
+        except ValueError:
+            # the line is broken by other outputs
+            continue
+        results[result['bench']] = result
+
+    return results
+
+def change(old, new):
+    if old == 0:
+        return 0.0 if new == 0 else float('inf')
+    return (new - old) * 100.0 / old
+
+def main():
+    parser = argparse.ArgumentParser(description='compare the benchmark results of utest')
+    parser.add_argument('old', help='the log of baseline')
+    parser.add_argument('new', help='the log to compare')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='the regression threshold in percent, default 5')
+    args = parser.parse_args()
+
+    old = load(args.old)
+    new = load(args.new)
+    regression = False
+
+    print('%-32s %8s %8s %8s %8s' % (('bench',) + STATS))
+    for name in sorted(set(old) | set(new)):
+        if name not in old or name not in new:
+            print('%-32s %s' % (name, 'only in new' if name in new else 'only in old'))
+            continue
+
+        columns = []
+        for stat in STATS:
+            columns.append('%+7.1f%%' % change(old[name][stat], new[name][stat]))
+        flag = ''
+        if change(old[name]['median'], new[name]['median']) > args.threshold or \
+                change(old[name]['p99'], new[name]['p99']) > args.threshold:
+            flag = ' <- regression'
+            regression = True
+        print('%-32s %8s %8s %8s %8s%s' % tuple([name] + columns + [flag]))
+
+    return 1 if regression else 0
+
+if __name__ == '__main__':
+    sys.exit(main())